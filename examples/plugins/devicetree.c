@@ -0,0 +1,137 @@
+/*
+ * devicetree.c — Example LogPilot plugin: Zephyr devicetree error decoding
+ *
+ * dtc / gen_defines errors span several lines ("zephyr.dts:847:" then
+ * "node '/soc/...' depends on undefined node 'ord,3'"), which pattern
+ * lists cannot stitch together. This plugin joins them into one summary
+ * fact, relabels the block as a devicetree error, and drops the generic
+ * advice lines that follow it.
+ *
+ * Build as a shared object against plugin_api.h only, then either set
+ *   [plugin]
+ *   path = "path/to/lp_devicetree"
+ * in a mode TOML, or pass --plugin path/to/lp_devicetree to logparse.
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plugin_api.h"
+
+#define MAX_FACTS 8
+
+typedef struct {
+    char   location[160];        /* "zephyr.dts:847" of the pending error */
+    char   facts[MAX_FACTS][512];
+    size_t fact_count;
+    char   text[MAX_FACTS * 520];
+} dt_ctx;
+
+static void *dt_create(const char *mode_name) {
+    (void)mode_name;
+    return calloc(1, sizeof(dt_ctx));
+}
+
+static void dt_destroy(void *ctx) {
+    free(ctx);
+}
+
+/* Copy the quoted value following key ("node '", "undefined node '") */
+static bool quoted_after(const char *line, const char *key, char *out, size_t cap) {
+    const char *p = strstr(line, key);
+    if (!p) return false;
+    p += strlen(key);
+    const char *end = strchr(p, '\'');
+    if (!end) return false;
+    size_t len = (size_t)(end - p);
+    if (len >= cap) len = cap - 1;
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return true;
+}
+
+static int dt_classify(void *ctx, const char *line) {
+    (void)ctx;
+    const char *p = line;
+    while (*p == ' ') p++;
+    /* Canned advice printed under every devicetree error */
+    if (strncmp(p, "Check overlay file", 18) == 0) return LP_PLUGIN_DROP;
+    if (strncmp(p, "Base DTS:", 9) == 0) return LP_PLUGIN_DROP;
+    return LP_PLUGIN_DEFER;
+}
+
+static void dt_post_segment(void *ctx, lp_plugin_segment *seg) {
+    (void)ctx;
+    for (size_t i = 0; i < seg->line_count; i++) {
+        if (strstr(seg->lines[i], "depends on undefined node") ||
+            strstr(seg->lines[i], "devicetree error")) {
+            seg->type = LP_PLUGIN_SEG_ERROR;
+            seg->label = "devicetree";
+            return;
+        }
+    }
+}
+
+static void dt_summary_line(void *ctx, const char *line, size_t line_num) {
+    dt_ctx *dt = (dt_ctx *)ctx;
+    (void)line_num;
+
+    /* "path/zephyr.dts:847:" — remember as location of the next error */
+    const char *dts = strstr(line, ".dts:");
+    if (dts && !strstr(line, " ")) {
+        const char *base = line;
+        for (const char *q = line; q < dts; q++) {
+            if (*q == '/' || *q == '\\') base = q + 1;
+        }
+        size_t len = strlen(base);
+        if (len > 0 && base[len - 1] == ':') len--;
+        if (len >= sizeof(dt->location)) len = sizeof(dt->location) - 1;
+        memcpy(dt->location, base, len);
+        dt->location[len] = '\0';
+        return;
+    }
+
+    char node[200], ref[100];
+    if (dt->fact_count < MAX_FACTS &&
+        quoted_after(line, "node '", node, sizeof(node)) &&
+        quoted_after(line, "undefined node '", ref, sizeof(ref))) {
+        /* Format apart from dt: location lives in the same object */
+        char fact[sizeof(dt->facts[0])];
+        if (dt->location[0]) {
+            snprintf(fact, sizeof(fact), "DT: %s -> undefined '%s' (%s)",
+                     node, ref, dt->location);
+        } else {
+            snprintf(fact, sizeof(fact), "DT: %s -> undefined '%s'", node, ref);
+        }
+        memcpy(dt->facts[dt->fact_count++], fact, sizeof(fact));
+        dt->location[0] = '\0';
+    }
+}
+
+static const char *dt_summary_text(void *ctx) {
+    dt_ctx *dt = (dt_ctx *)ctx;
+    size_t pos = 0;
+    dt->text[0] = '\0';
+    for (size_t i = 0; i < dt->fact_count; i++) {
+        int n = snprintf(dt->text + pos, sizeof(dt->text) - pos, "%s\n", dt->facts[i]);
+        if (n < 0 || (size_t)n >= sizeof(dt->text) - pos) break;
+        pos += (size_t)n;
+    }
+    return dt->text;
+}
+
+static const lp_plugin_api DT_API = {
+    LP_PLUGIN_ABI_VERSION,
+    "devicetree",
+    dt_create,
+    dt_destroy,
+    dt_classify,
+    dt_post_segment,
+    dt_summary_line,
+    dt_summary_text,
+};
+
+LP_PLUGIN_EXPORT const lp_plugin_api *logpilot_plugin(void) {
+    return &DT_API;
+}
@@ -2,7 +2,9 @@
  * budget.c — Token budget packing (greedy knapsack)
  */
 #include "budget.h"
+#include "dedup.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -27,23 +29,34 @@ static int cmp_size_t_asc(const void *a, const void *b) {
     return 0;
 }
 
-lp_budget_result lp_budget_pack(lp_segment *segs, size_t seg_count,
-                                size_t budget_tokens, size_t reserve_tokens) {
+static lp_budget_result result_new(size_t seg_count, size_t budget_tokens,
+                                   size_t reserve_tokens) {
     lp_budget_result result;
     result.budget_tokens = budget_tokens;
-    result.indices = (size_t *)malloc(seg_count * sizeof(size_t));
+    result.reserve_tokens = reserve_tokens;
+    result.indices = (size_t *)malloc((seg_count ? seg_count : 1) * sizeof(size_t));
     result.count = 0;
     result.total_tokens = 0;
+    return result;
+}
 
-    size_t available = budget_tokens > reserve_tokens ? budget_tokens - reserve_tokens : 0;
-
-    /* Phase 1: mandatory error segments */
+static void pack_errors(const lp_segment *segs, size_t seg_count, lp_budget_result *result) {
     for (size_t i = 0; i < seg_count; i++) {
         if (segs[i].type == LP_SEG_ERROR) {
-            result.indices[result.count++] = i;
-            result.total_tokens += segs[i].token_count;
+            result->indices[result->count++] = i;
+            result->total_tokens += segs[i].token_count;
         }
     }
+}
+
+lp_budget_result lp_budget_pack(lp_segment *segs, size_t seg_count,
+                                size_t budget_tokens, size_t reserve_tokens) {
+    lp_budget_result result = result_new(seg_count, budget_tokens, reserve_tokens);
+
+    size_t available = budget_tokens > reserve_tokens ? budget_tokens - reserve_tokens : 0;
+
+    /* Phase 1: mandatory error segments */
+    pack_errors(segs, seg_count, &result);
 
     /* Phase 2: fill remaining with highest-scoring non-error segments */
     scored_idx *candidates = (scored_idx *)malloc(seg_count * sizeof(scored_idx));
@@ -73,8 +86,376 @@ lp_budget_result lp_budget_pack(lp_segment *segs, size_t seg_count,
     return result;
 }
 
+/* ---- Diversity-aware packing ----
+ *
+ * Objective over the selected set S:
+ *   f(S) = SCORE_SHARE * sum(score of S) + sum over features k of v_k * (1 - 2^-c_k)
+ * where c_k counts the segments in S carrying feature k (a diagnostic key,
+ * a file, the phase) and v_k is the best score among segments carrying it.
+ * Each term is concave in S, so f is submodular and a segment's marginal
+ * gain only shrinks as S grows: lazy greedy keeps stale gains in a max-heap
+ * as upper bounds and recomputes just the top until it stays on top.
+ */
+
+#define DIVERSE_MAX_FEATURES 8
+#define DIVERSE_SCORE_SHARE  0.25f
+#define DIVERSE_SLACK        0.05f   /* Take a recomputed top within 5% of the next bound */
+
+typedef struct {
+    uint64_t key;        /* 0 = empty */
+    float    gain;       /* v_k * 2^-(c_k+1): what covering k once more adds */
+} feature_slot;
+
+typedef struct {
+    feature_slot *slots;
+    size_t        cap;   /* Power of 2 */
+    size_t        used;
+} feature_table;
+
+static feature_slot *feature_get(feature_table *t, uint64_t key) {
+    if ((t->used + 1) * 2 > t->cap) {
+        feature_slot *old = t->slots;
+        size_t old_cap = t->cap;
+        t->cap = old_cap ? old_cap * 2 : 1024;
+        t->slots = (feature_slot *)calloc(t->cap, sizeof(feature_slot));
+        for (size_t i = 0; i < old_cap; i++) {
+            if (!old[i].key) continue;
+            size_t j = (size_t)old[i].key & (t->cap - 1);
+            while (t->slots[j].key) j = (j + 1) & (t->cap - 1);
+            t->slots[j] = old[i];
+        }
+        free(old);
+    }
+    size_t j = (size_t)key & (t->cap - 1);
+    while (t->slots[j].key && t->slots[j].key != key) j = (j + 1) & (t->cap - 1);
+    if (!t->slots[j].key) {
+        t->slots[j].key = key;
+        t->used++;
+    }
+    return &t->slots[j];
+}
+
+static uint64_t feature_key(char kind, const char *s, size_t len) {
+    uint64_t h = lp_fnv1a(s, len) * 31 + (unsigned char)kind;
+    return h ? h : 1;
+}
+
+static void add_feature(uint64_t *feats, size_t *n, uint64_t key) {
+    for (size_t i = 0; i < *n; i++)
+        if (feats[i] == key) return;
+    if (*n < DIVERSE_MAX_FEATURES) feats[(*n)++] = key;
+}
+
+/* Diagnostic key of a warning/error line: its [-Wflag], else the message
+   up to the first quoted name (which varies between instances) */
+static bool diag_key(const char *line, const char **key, size_t *len) {
+    const char *p = strstr(line, "warning: ");
+    if (p) p += 9;
+    else if ((p = strstr(line, "error: ")) != NULL) p += 7;
+    else return false;
+    const char *flag = strstr(p, "[-W");
+    if (flag) {
+        const char *end = strchr(flag, ']');
+        *key = flag;
+        *len = end ? (size_t)(end - flag) : strlen(flag);
+        return true;
+    }
+    size_t n = strcspn(p, "'\"`\xe2");
+    *key = p;
+    *len = n;
+    return n > 0;
+}
+
+/* File of a "path:line:" diagnostic location */
+static bool diag_file(const char *line, const char **file, size_t *len) {
+    while (*line == ' ' || *line == '\t') line++;
+    const char *colon = strchr(line, ':');
+    if (!colon || colon == line || colon[1] < '0' || colon[1] > '9') return false;
+    size_t n = (size_t)(colon - line);
+    if (memchr(line, ' ', n)) return false;
+    if (!memchr(line, '.', n) && !memchr(line, '/', n)) return false;
+    *file = line;
+    *len = n;
+    return true;
+}
+
+static size_t segment_features(const lp_segment *seg, size_t phase, uint64_t *feats) {
+    size_t n = 0;
+    add_feature(feats, &n, feature_key('p', (const char *)&phase, sizeof(phase)));
+    for (size_t l = 0; l < seg->line_count && n < DIVERSE_MAX_FEATURES; l++) {
+        const char *s;
+        size_t len;
+        if (diag_key(seg->lines[l], &s, &len)) add_feature(feats, &n, feature_key('k', s, len));
+        if (diag_file(seg->lines[l], &s, &len)) add_feature(feats, &n, feature_key('f', s, len));
+    }
+    return n;
+}
+
+/* A packing candidate. Candidates with the same features form a class
+   whose members differ only in score, so their order within the class
+   never changes and only each class's best remaining member needs a
+   place in the heap. */
+typedef struct {
+    size_t   idx;
+    float    score;
+    uint8_t  nfeat;
+    uint32_t slots[DIVERSE_MAX_FEATURES];   /* Feature slots, ascending */
+} candidate;
+
+static int cmp_candidate(const void *a, const void *b) {
+    const candidate *x = (const candidate *)a;
+    const candidate *y = (const candidate *)b;
+    if (x->nfeat != y->nfeat) return x->nfeat < y->nfeat ? -1 : 1;
+    for (size_t k = 0; k < x->nfeat; k++)
+        if (x->slots[k] != y->slots[k]) return x->slots[k] < y->slots[k] ? -1 : 1;
+    if (x->score != y->score) return x->score > y->score ? -1 : 1;
+    return x->idx < y->idx ? -1 : x->idx > y->idx;
+}
+
+static bool same_class(const candidate *x, const candidate *y) {
+    return x->nfeat == y->nfeat &&
+           memcmp(x->slots, y->slots, x->nfeat * sizeof(uint32_t)) == 0;
+}
+
+/* Heap entries pack the bound and the head's segment into one key that
+   orders by larger gain, then earlier segment. Gains are non-negative, so
+   their float bits compare as integers. */
+typedef struct {
+    uint64_t key;
+    uint32_t cls;
+} heap_entry;
+
+typedef struct {
+    uint32_t head;   /* Position of the class's best remaining member */
+    uint32_t end;    /* One past its last member */
+} candidate_class;
+
+static uint64_t heap_key(float gain, size_t idx) {
+    uint32_t bits;
+    memcpy(&bits, &gain, sizeof(bits));
+    return (uint64_t)bits << 32 | (uint32_t)(UINT32_MAX - idx);
+}
+
+static float heap_gain(uint64_t key) {
+    uint32_t bits = (uint32_t)(key >> 32);
+    float gain;
+    memcpy(&gain, &bits, sizeof(gain));
+    return gain;
+}
+
+static void heap_down(heap_entry *h, size_t n, size_t i) {
+    for (;;) {
+        size_t best = i, l = 2 * i + 1, r = l + 1;
+        if (l < n && h[l].key > h[best].key) best = l;
+        if (r < n && h[r].key > h[best].key) best = r;
+        if (best == i) return;
+        heap_entry t = h[i]; h[i] = h[best]; h[best] = t;
+        i = best;
+    }
+}
+
+static float marginal_gain(const feature_table *ft, const candidate *c) {
+    float g = DIVERSE_SCORE_SHARE * c->score;
+    for (size_t k = 0; k < c->nfeat; k++)
+        g += ft->slots[c->slots[k]].gain;
+    return g;
+}
+
+static void cover(feature_table *ft, const candidate *c) {
+    for (size_t k = 0; k < c->nfeat; k++) {
+        feature_slot *f = &ft->slots[c->slots[k]];
+        f->gain = f->gain > 1e-6f ? 0.5f * f->gain : 0.0f;   /* no denormals */
+    }
+}
+
+lp_budget_result lp_budget_pack_diverse(lp_segment *segs, size_t seg_count,
+                                        size_t budget_tokens, size_t reserve_tokens) {
+    lp_budget_result result = result_new(seg_count, budget_tokens, reserve_tokens);
+    size_t available = budget_tokens > reserve_tokens ? budget_tokens - reserve_tokens : 0;
+    size_t alloc = seg_count ? seg_count : 1;
+
+    /* Features of every segment, and v_k = best score carrying k */
+    uint64_t *keys = (uint64_t *)malloc(alloc * DIVERSE_MAX_FEATURES * sizeof(uint64_t));
+    uint8_t *nkeys = (uint8_t *)malloc(alloc);
+    feature_table ft = { NULL, 0, 0 };
+    size_t phase = 0;
+    for (size_t i = 0; i < seg_count; i++) {
+        if (segs[i].type == LP_SEG_PHASE) phase = i + 1;
+        uint64_t *ki = keys + i * DIVERSE_MAX_FEATURES;
+        nkeys[i] = (uint8_t)segment_features(&segs[i], phase, ki);
+        float half = segs[i].score > 0.0f ? 0.5f * segs[i].score : 0.0f;
+        for (size_t k = 0; k < nkeys[i]; k++) {
+            feature_slot *f = feature_get(&ft, ki[k]);
+            if (half > f->gain) f->gain = half;
+        }
+    }
+
+    /* The table no longer grows: resolve keys to slots. Mandatory errors
+       cover their features first; the rest become candidates. */
+    pack_errors(segs, seg_count, &result);
+    candidate *cands = (candidate *)malloc(alloc * sizeof(candidate));
+    size_t ncand = 0, min_cost = SIZE_MAX;
+    for (size_t i = 0; i < seg_count; i++) {
+        if (segs[i].type != LP_SEG_ERROR && segs[i].score < 0.0f)
+            continue;                               /* boilerplate — never include */
+        candidate c;
+        c.idx = i;
+        c.score = segs[i].score;
+        c.nfeat = nkeys[i];
+        for (size_t k = 0; k < c.nfeat; k++) {
+            uint32_t slot = (uint32_t)(feature_get(&ft, keys[i * DIVERSE_MAX_FEATURES + k]) - ft.slots);
+            size_t at = k;
+            while (at > 0 && c.slots[at - 1] > slot) { c.slots[at] = c.slots[at - 1]; at--; }
+            c.slots[at] = slot;
+        }
+        if (segs[i].type == LP_SEG_ERROR) cover(&ft, &c);
+        else {
+            cands[ncand++] = c;
+            if (segs[i].token_count < min_cost) min_cost = segs[i].token_count;
+        }
+    }
+    free(keys);
+    free(nkeys);
+
+    /* One heap entry per class, keyed by its head's gain */
+    qsort(cands, ncand, sizeof(candidate), cmp_candidate);
+    size_t nalloc = ncand ? ncand : 1;
+    heap_entry *heap = (heap_entry *)malloc(nalloc * sizeof(heap_entry));
+    candidate_class *classes = (candidate_class *)malloc(nalloc * sizeof(candidate_class));
+    size_t n = 0;
+    for (size_t c = 0; c < ncand; ) {
+        size_t end = c + 1;
+        while (end < ncand && same_class(&cands[c], &cands[end])) end++;
+        classes[n].head = (uint32_t)c;
+        classes[n].end = (uint32_t)end;
+        heap[n].key = heap_key(marginal_gain(&ft, &cands[c]), cands[c].idx);
+        heap[n].cls = (uint32_t)n;
+        n++;
+        c = end;
+    }
+    for (size_t i = n / 2; i-- > 0; )
+        heap_down(heap, n, i);
+
+    /* Stop once not even the cheapest candidate fits */
+    while (n > 0 && result.total_tokens + min_cost <= available) {
+        candidate_class *cls = &classes[heap[0].cls];
+        const candidate *c = &cands[cls->head];
+        size_t cost = segs[c->idx].token_count;
+
+        /* The budget only shrinks: what does not fit now never will */
+        if (result.total_tokens + cost <= available) {
+            /* Stale bound: sink under the true gain and look again. A head
+               within DIVERSE_SLACK of the next bound is taken as is. */
+            float gain = marginal_gain(&ft, c);
+            uint64_t next = n > 1 ? heap[1].key : 0;
+            if (n > 2 && heap[2].key > next) next = heap[2].key;
+            if (gain < heap_gain(next) * (1.0f - DIVERSE_SLACK)) {
+                heap[0].key = heap_key(gain, c->idx);
+                heap_down(heap, n, 0);
+                continue;
+            }
+            result.indices[result.count++] = c->idx;
+            result.total_tokens += cost;
+            cover(&ft, c);
+        }
+
+        /* Advance the class to its next member, or retire it */
+        if (++cls->head < cls->end) {
+            c = &cands[cls->head];
+            heap[0].key = heap_key(marginal_gain(&ft, c), c->idx);
+        } else {
+            heap[0] = heap[--n];
+        }
+        heap_down(heap, n, 0);
+    }
+
+    free(classes);
+    free(heap);
+    free(cands);
+    free(ft.slots);
+
+    qsort(result.indices, result.count, sizeof(size_t), cmp_size_t_asc);
+    result.total_tokens += reserve_tokens;
+    return result;
+}
+
 void lp_budget_result_free(lp_budget_result *r) {
     free(r->indices);
     r->indices = NULL;
     r->count = 0;
 }
+
+/* ---- Accounting ---- */
+
+static bool is_candidate(const lp_segment *seg) {
+    return seg->type == LP_SEG_ERROR || seg->score >= 0.0f;
+}
+
+static void row_add(lp_budget_row *row, const lp_segment *seg, size_t kept, bool packed) {
+    row->segments++;
+    row->tokens += seg->token_count;
+    row->lines += seg->line_count;
+    row->kept_lines += kept;
+    if (is_candidate(seg)) row->candidates++;
+    if (packed) {
+        row->packed++;
+        row->packed_tokens += seg->token_count;
+    }
+}
+
+void lp_budget_report_build(const lp_segment *segs, size_t seg_count,
+                            const lp_budget_result *r, const size_t *kept_lines,
+                            lp_budget_report *rep) {
+    memset(rep, 0, sizeof(*rep));
+    rep->cutoff_score = -1.0f;
+    rep->best_dropped = -1.0f;
+    size_t alloc = seg_count ? seg_count + 1 : 1;
+    rep->by_phase = (lp_budget_row *)calloc(alloc, sizeof(lp_budget_row));
+    rep->phase_first = (size_t *)malloc(alloc * sizeof(size_t));
+    rep->phase_first[0] = 0;
+    rep->phase_count = 1;
+
+    /* r->indices is sorted, so one merge walk tells packed from not */
+    size_t next = 0;
+    for (size_t i = 0; i < seg_count; i++) {
+        const lp_segment *seg = &segs[i];
+        bool packed = next < r->count && r->indices[next] == i;
+        if (packed) next++;
+
+        if (seg->type == LP_SEG_PHASE && i > 0) {
+            rep->phase_first[rep->phase_count++] = i;
+        }
+        size_t kept = kept_lines ? kept_lines[i] : seg->line_count;
+        row_add(&rep->by_type[seg->type], seg, kept, packed);
+        row_add(&rep->by_phase[rep->phase_count - 1], seg, kept, packed);
+
+        if (packed && seg->type == LP_SEG_ERROR) {
+            rep->error_tokens += seg->token_count;
+        } else if (packed) {
+            if (rep->cutoff_score < 0.0f || seg->score < rep->cutoff_score)
+                rep->cutoff_score = seg->score;
+        } else {
+            if (is_candidate(seg) && seg->score > rep->best_dropped)
+                rep->best_dropped = seg->score;
+
+            /* Keep the largest exclusions, biggest first */
+            size_t n = rep->excluded_count;
+            if (n == LP_BUDGET_TOP_EXCLUDED &&
+                segs[rep->excluded[n - 1]].token_count >= seg->token_count)
+                continue;
+            if (n < LP_BUDGET_TOP_EXCLUDED) rep->excluded_count++;
+            else n--;
+            while (n > 0 && segs[rep->excluded[n - 1]].token_count < seg->token_count) {
+                rep->excluded[n] = rep->excluded[n - 1];
+                n--;
+            }
+            rep->excluded[n] = i;
+        }
+    }
+}
+
+void lp_budget_report_free(lp_budget_report *rep) {
+    free(rep->by_phase);
+    free(rep->phase_first);
+    memset(rep, 0, sizeof(*rep));
+}
@@ -14,6 +14,7 @@ typedef struct {
     size_t   count;          /* Number of packed segments */
     size_t   total_tokens;   /* Total tokens consumed */
     size_t   budget_tokens;  /* Original budget */
+    size_t   reserve_tokens; /* Held back from packing (counted in total_tokens) */
 } lp_budget_result;
 
 /* Pack segments into a token budget.
@@ -24,6 +25,48 @@ typedef struct {
 lp_budget_result lp_budget_pack(lp_segment *segs, size_t seg_count,
                                 size_t budget_tokens, size_t reserve_tokens);
 
+/* Pack like lp_budget_pack, but fill the rest of the budget for coverage:
+   each segment is worth a share of its score plus, per diagnostic key,
+   file and phase it mentions, a value that halves with every selected
+   segment already covering it. Lazy greedy over this submodular objective
+   (a max-heap of stale gains), so 10^5 candidates pack in milliseconds;
+   ties go to the earlier segment, so the result is reproducible. */
+lp_budget_result lp_budget_pack_diverse(lp_segment *segs, size_t seg_count,
+                                        size_t budget_tokens, size_t reserve_tokens);
+
 void lp_budget_result_free(lp_budget_result *r);
 
+/* ---- Accounting: where the budget went ---- */
+
+#define LP_BUDGET_TOP_EXCLUDED 5
+
+typedef struct {
+    size_t segments;
+    size_t candidates;      /* Eligible to pack (errors, non-negative score) */
+    size_t packed;
+    size_t tokens;          /* Tokens of all its segments */
+    size_t packed_tokens;
+    size_t lines;           /* Raw lines */
+    size_t kept_lines;      /* Lines the fate filter keeps */
+} lp_budget_row;
+
+typedef struct {
+    lp_budget_row  by_type[LP_SEG_TYPE_COUNT];
+    lp_budget_row *by_phase;          /* Phase 0 runs up to the first phase marker */
+    size_t        *phase_first;       /* First segment of each phase */
+    size_t         phase_count;
+    size_t         error_tokens;      /* Spent on mandatory errors */
+    float          cutoff_score;      /* Lowest score packed on merit (-1 if none) */
+    float          best_dropped;      /* Highest eligible score left out (-1 if none) */
+    size_t         excluded[LP_BUDGET_TOP_EXCLUDED];   /* Largest left out, by tokens */
+    size_t         excluded_count;
+} lp_budget_report;
+
+/* Account for a packing from the segments and the result alone.
+   kept_lines[i] is segment i's fate-filtered line count (NULL: all kept). */
+void lp_budget_report_build(const lp_segment *segs, size_t seg_count,
+                            const lp_budget_result *r, const size_t *kept_lines,
+                            lp_budget_report *rep);
+void lp_budget_report_free(lp_budget_report *rep);
+
 #endif /* LP_BUDGET_H */
@@ -0,0 +1,40 @@
+/*
+ * builtin.c — Built-in modes compiled into the core library
+ */
+#include "builtin.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef LP_HAVE_BUILTIN_MODES
+/* Built without lpmodec output: no built-in modes */
+lp_mode *const lp_builtin_modes[1] = { NULL };
+const size_t   lp_builtin_mode_count = 0;
+#endif
+
+lp_mode *lp_builtin_find(const char *name) {
+    for (size_t i = 0; i < lp_builtin_mode_count; i++) {
+        if (strcmp(lp_builtin_modes[i]->name, name) == 0)
+            return lp_builtin_modes[i];
+    }
+    return NULL;
+}
+
+lp_mode **lp_mode_load_all(const char *dir, size_t *count) {
+    size_t toml_count = 0;
+    lp_mode **modes = dir ? lp_mode_load_dir(dir, &toml_count) : NULL;
+
+    modes = (lp_mode **)realloc(modes,
+                                (toml_count + lp_builtin_mode_count + 1) * sizeof(lp_mode *));
+    size_t n = toml_count;
+    for (size_t i = 0; i < toml_count; i++) {
+        if (modes[i]->name && lp_builtin_find(modes[i]->name))
+            modes[i]->overrides_builtin = true;
+    }
+    for (size_t b = 0; b < lp_builtin_mode_count; b++) {
+        if (lp_mode_find(modes, toml_count, lp_builtin_modes[b]->name)) continue;
+        modes[n++] = lp_builtin_modes[b];
+    }
+    *count = n;
+    return modes;
+}
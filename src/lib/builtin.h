@@ -0,0 +1,25 @@
+/*
+ * builtin.h — Built-in modes compiled into the core library
+ *
+ * lpmodec turns each shipped TOML mode into a C translation unit (constant
+ * tables plus switch-based literal matchers) at build time. TOML files
+ * found at runtime still win over a built-in of the same name.
+ */
+#ifndef LP_BUILTIN_H
+#define LP_BUILTIN_H
+
+#include <stddef.h>
+#include "mode.h"
+
+/* Registry emitted by lpmodec (empty when LOGPILOT_BUILTIN_MODES is off) */
+extern lp_mode *const lp_builtin_modes[];
+extern const size_t   lp_builtin_mode_count;
+
+/* Find a built-in mode by name. Returns NULL if not compiled in. */
+lp_mode *lp_builtin_find(const char *name);
+
+/* Load TOML modes from dir (may be NULL), then add every built-in mode not
+   overridden by a TOML mode of the same name. Free with lp_modes_free(). */
+lp_mode **lp_mode_load_all(const char *dir, size_t *count);
+
+#endif /* LP_BUILTIN_H */
@@ -0,0 +1,180 @@
+/*
+ * cmdline.c — Compiler invocation factoring
+ */
+#include "cmdline.h"
+#include "dedup.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/* Flags whose argument is a separate token */
+static const char *PAIRED_FLAGS[] = {
+    "-o", "-MF", "-MT", "-MQ", "-isystem", "-include", "-imacros", "-iquote",
+    "-x", "-I", "-D", "-U", "-L", "-T", "-Xlinker", "--param", "/Fo", "/Fd"
+};
+#define PAIRED_FLAG_COUNT (sizeof(PAIRED_FLAGS) / sizeof(PAIRED_FLAGS[0]))
+
+static bool is_paired_flag(const char *tok) {
+    for (size_t i = 0; i < PAIRED_FLAG_COUNT; i++) {
+        if (strcmp(tok, PAIRED_FLAGS[i]) == 0) return true;
+    }
+    return false;
+}
+
+void lp_cmd_init(lp_cmd_table *t) {
+    t->capacity = 256;
+    t->count = 0;
+    t->cmd_count = 0;
+    t->buckets = (lp_cmd_token *)calloc(t->capacity, sizeof(lp_cmd_token));
+    t->first = NULL;
+    t->first_count = 0;
+}
+
+void lp_cmd_free(lp_cmd_table *t) {
+    free(t->buckets);
+    lp_free_strings(t->first, t->first_count);
+    memset(t, 0, sizeof(*t));
+}
+
+char **lp_cmd_tokenize(const char *line, size_t *count) {
+    LP_VEC(char *) toks;
+    lp_vec_init(toks);
+
+    const char *p = line;
+    while (*p) {
+        while (*p && isspace((unsigned char)*p)) p++;
+        if (!*p) break;
+        const char *start = p;
+        bool quoted = false;
+        while (*p && (quoted || !isspace((unsigned char)*p))) {
+            if (*p == '"') quoted = !quoted;
+            p++;
+        }
+        char *tok = lp_strdup_range(start, 0, (size_t)(p - start));
+
+        /* Join "-o file" style pairs so they diff as one unit */
+        if (toks.len > 0 && is_paired_flag(toks.items[toks.len - 1])) {
+            char *flag = toks.items[toks.len - 1];
+            size_t flen = strlen(flag), tlen = strlen(tok);
+            char *joined = (char *)malloc(flen + tlen + 2);
+            memcpy(joined, flag, flen);
+            joined[flen] = ' ';
+            memcpy(joined + flen + 1, tok, tlen + 1);
+            free(flag);
+            free(tok);
+            toks.items[toks.len - 1] = joined;
+            continue;
+        }
+        lp_vec_push(toks, tok);
+    }
+    *count = toks.len;
+    return toks.items;
+}
+
+static lp_cmd_token *cmd_find(const lp_cmd_table *t, uint64_t h) {
+    size_t idx = (size_t)(h & (t->capacity - 1));
+    while (t->buckets[idx].occupied) {
+        if (t->buckets[idx].hash == h) return &t->buckets[idx];
+        idx = (idx + 1) & (t->capacity - 1);
+    }
+    return NULL;
+}
+
+static void cmd_grow(lp_cmd_table *t) {
+    size_t new_cap = t->capacity * 2;
+    lp_cmd_token *nb = (lp_cmd_token *)calloc(new_cap, sizeof(lp_cmd_token));
+    for (size_t i = 0; i < t->capacity; i++) {
+        if (!t->buckets[i].occupied) continue;
+        size_t idx = (size_t)(t->buckets[i].hash & (new_cap - 1));
+        while (nb[idx].occupied) idx = (idx + 1) & (new_cap - 1);
+        nb[idx] = t->buckets[i];
+    }
+    free(t->buckets);
+    t->buckets = nb;
+    t->capacity = new_cap;
+}
+
+void lp_cmd_add(lp_cmd_table *t, const char *line) {
+    size_t ntok;
+    char **toks = lp_cmd_tokenize(line, &ntok);
+    size_t cmd_id = ++t->cmd_count;
+
+    for (size_t i = 0; i < ntok; i++) {
+        if (t->count * 10 > t->capacity * 7) cmd_grow(t);
+        uint64_t h = lp_fnv1a(toks[i], strlen(toks[i]));
+        size_t idx = (size_t)(h & (t->capacity - 1));
+        while (t->buckets[idx].occupied && t->buckets[idx].hash != h)
+            idx = (idx + 1) & (t->capacity - 1);
+        lp_cmd_token *e = &t->buckets[idx];
+        if (!e->occupied) {
+            e->occupied = true;
+            e->hash = h;
+            t->count++;
+        }
+        /* Document frequency: count each token once per invocation */
+        if (e->last_cmd != cmd_id) {
+            e->last_cmd = cmd_id;
+            e->count++;
+        }
+    }
+
+    if (!t->first) {
+        t->first = toks;
+        t->first_count = ntok;
+    } else {
+        lp_free_strings(toks, ntok);
+    }
+}
+
+bool lp_cmd_is_common(const lp_cmd_table *t, const char *tok) {
+    if (t->cmd_count == 0) return false;
+    lp_cmd_token *e = cmd_find(t, lp_fnv1a(tok, strlen(tok)));
+    return e && e->count == t->cmd_count;
+}
+
+char *lp_cmd_legend(const lp_cmd_table *t, size_t *common_count) {
+    *common_count = 0;
+    if (t->cmd_count == 0) return NULL;
+    lp_string out = lp_string_new(512);
+    for (size_t i = 0; i < t->first_count; i++) {
+        if (!lp_cmd_is_common(t, t->first[i])) continue;
+        if (out.len > 0) lp_string_append_cstr(&out, " ");
+        lp_string_append_cstr(&out, t->first[i]);
+        (*common_count)++;
+    }
+    char *result = strdup(lp_string_cstr(&out));
+    lp_string_free(&out);
+    return result;
+}
+
+char *lp_cmd_compress(const lp_cmd_table *t, const char *line) {
+    size_t ntok;
+    char **toks = lp_cmd_tokenize(line, &ntok);
+    lp_string out = lp_string_new(128);
+    bool have_common = false;
+    for (size_t i = 0; i < ntok; i++) {
+        if (lp_cmd_is_common(t, toks[i])) {
+            have_common = true;
+            continue;
+        }
+        if (out.len > 0) lp_string_append_cstr(&out, " ");
+        lp_string_append_cstr(&out, toks[i]);
+    }
+    if (have_common) {
+        /* Prefix the placeholder once the diff tokens are known */
+        lp_string full = lp_string_new(out.len + 16);
+        lp_string_append_cstr(&full, "<common>");
+        if (out.len > 0) {
+            lp_string_append_cstr(&full, " ");
+            lp_string_append(&full, out.data, out.len);
+        }
+        lp_string_free(&out);
+        out = full;
+    }
+    lp_free_strings(toks, ntok);
+    char *result = strdup(lp_string_cstr(&out));
+    lp_string_free(&out);
+    return result;
+}
@@ -0,0 +1,55 @@
+/*
+ * cmdline.h — Compiler invocation factoring
+ *
+ * Compiler command lines in a build share most of their flags. The table
+ * collects every invocation in the log, finds the token set common to all
+ * of them by hash, and renders a single command as a diff against that
+ * set: "<common> -DFOO=2 -c src/main.c". The legend is printed once.
+ */
+#ifndef LP_CMDLINE_H
+#define LP_CMDLINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Per-token document frequency (how many invocations contain it) */
+typedef struct {
+    uint64_t hash;
+    size_t   count;
+    size_t   last_cmd;   /* Last invocation that counted this token */
+    bool     occupied;
+} lp_cmd_token;
+
+typedef struct {
+    lp_cmd_token *buckets;
+    size_t        capacity;      /* Power of 2 */
+    size_t        count;         /* Distinct tokens */
+    size_t        cmd_count;     /* Invocations added */
+    char        **first;         /* Tokens of the first invocation (legend order) */
+    size_t        first_count;
+} lp_cmd_table;
+
+void lp_cmd_init(lp_cmd_table *t);
+void lp_cmd_free(lp_cmd_table *t);
+
+/* Split a command line into tokens. Double quotes group, and flags that
+   take a separate argument (-o out, -isystem dir, ...) stay joined.
+   Returns malloc'd array of malloc'd strings. Sets *count. */
+char **lp_cmd_tokenize(const char *line, size_t *count);
+
+/* Record one compiler invocation */
+void lp_cmd_add(lp_cmd_table *t, const char *line);
+
+/* True if the token occurs in every recorded invocation */
+bool lp_cmd_is_common(const lp_cmd_table *t, const char *tok);
+
+/* Space-joined common tokens in first-invocation order. malloc'd.
+   Sets *common_count. Returns NULL if nothing was recorded. */
+char *lp_cmd_legend(const lp_cmd_table *t, size_t *common_count);
+
+/* Render a command as "<common> <tokens not in the common set>". The
+   placeholder is omitted when the command shares nothing. malloc'd. */
+char *lp_cmd_compress(const lp_cmd_table *t, const char *line);
+
+#endif /* LP_CMDLINE_H */
@@ -136,6 +136,7 @@ lp_dedup_entry *lp_dedup_insert(lp_dedup_table *t, const char *line, size_t line
         if (t->buckets[idx].hash == h && strcmp(t->buckets[idx].normalized, norm) == 0) {
             /* Existing entry */
             t->buckets[idx].count++;
+            t->buckets[idx].bytes += strlen(line);
             free(norm);
             return &t->buckets[idx];
         }
@@ -149,6 +150,7 @@ lp_dedup_entry *lp_dedup_insert(lp_dedup_table *t, const char *line, size_t line
     t->buckets[idx].original = strdup(line);
     t->buckets[idx].first_line = line_num;
     t->buckets[idx].count = 1;
+    t->buckets[idx].bytes = strlen(line);
     t->count++;
 
     return &t->buckets[idx];
@@ -159,6 +161,9 @@ static int cmp_freq_desc(const void *a, const void *b) {
     const lp_dedup_entry *eb = *(const lp_dedup_entry **)b;
     if (ea->count > eb->count) return -1;
     if (ea->count < eb->count) return 1;
+    /* Ties in log order, whatever the table's capacity */
+    if (ea->first_line < eb->first_line) return -1;
+    if (ea->first_line > eb->first_line) return 1;
     return 0;
 }
 
@@ -14,6 +14,7 @@ typedef struct {
     char    *original;     /* First-seen original line text */
     size_t   first_line;   /* Line number of first occurrence */
     size_t   count;        /* Number of occurrences */
+    size_t   bytes;        /* Total length of all occurrences */
     uint64_t hash;         /* FNV-1a hash of normalized text */
     bool     occupied;
 } lp_dedup_entry;
@@ -0,0 +1,608 @@
+/*
+ * dtindex.c — Devicetree symbol index over a Zephyr build directory
+ *
+ * The cache is an lp_strtab (magic "LPDTIX1") whose header word holds
+ * the node count.
+ */
+#include "dtindex.h"
+#include "dedup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+static const char DT_MAGIC[8] = "LPDTIX1";
+
+/* Generated header location, newest Zephyr layout first */
+static const char *GEN_HEADERS[] = {
+    "zephyr/include/generated/zephyr/devicetree_generated.h",
+    "zephyr/include/generated/devicetree_generated.h",
+};
+
+static bool is_ident(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+static bool contains(const char *s, size_t len, const char *needle) {
+    size_t n = strlen(needle);
+    for (size_t i = 0; i + n <= len; i++)
+        if (memcmp(s + i, needle, n) == 0) return true;
+    return false;
+}
+
+static bool has_prefix(const char *s, size_t len, const char *prefix) {
+    size_t n = strlen(prefix);
+    return len >= n && memcmp(s, prefix, n) == 0;
+}
+
+static bool has_suffix(const char *s, size_t len, const char *suffix) {
+    size_t n = strlen(suffix);
+    return len >= n && memcmp(s + len - n, suffix, n) == 0;
+}
+
+/* Calls fn for each line of a mapped file, without the line terminator */
+typedef void (*line_fn)(lp_strtab_builder *b, const char *s, size_t len, size_t line_no, void *ud);
+
+static void for_each_line(const lp_mapped_file *mf, lp_strtab_builder *b, line_fn fn, void *ud) {
+    const char *p = mf->data, *end = mf->data + mf->len;
+    for (size_t line_no = 1; p < end; line_no++) {
+        const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+        size_t len = (size_t)((nl ? nl : end) - p);
+        while (len > 0 && (p[len - 1] == '\r' || p[len - 1] == ' ' || p[len - 1] == '\t')) len--;
+        fn(b, p, len, line_no, ud);
+        p = nl ? nl + 1 : end;
+    }
+}
+
+/* "#define NAME VALUE": false for any other line */
+static bool parse_define(const char *s, size_t len, const char **name, size_t *name_len,
+                         const char **value, size_t *value_len) {
+    if (!has_prefix(s, len, "#define ")) return false;
+    size_t i = 8;
+    size_t n0 = i;
+    while (i < len && is_ident(s[i])) i++;
+    *name = s + n0;
+    *name_len = i - n0;
+    while (i < len && (s[i] == ' ' || s[i] == '\t')) i++;
+    *value = s + i;
+    *value_len = len - i;
+    return *name_len > 0;
+}
+
+static bool is_node_id(const char *s, size_t len) {
+    return len >= 4 && memcmp(s, "DT_N", 4) == 0 && (len == 4 || s[4] == '_');
+}
+
+typedef struct {
+    bool   in_ordering;     /* Inside the "Node dependency ordering" comment */
+    size_t node_count;
+} node_scan;
+
+/* Pass 1: node ids and the ordinal table in the header comment */
+static void scan_nodes(lp_strtab_builder *b, const char *s, size_t len, size_t line_no, void *ud) {
+    (void)line_no;
+    node_scan *ns = (node_scan *)ud;
+    if (ns->in_ordering) {
+        if (contains(s, len, "*/")) { ns->in_ordering = false; return; }
+        /* " *   3   /soc/i2c@40003000" */
+        size_t i = 0;
+        while (i < len && (s[i] == ' ' || s[i] == '*' || s[i] == '\t')) i++;
+        size_t d0 = i;
+        while (i < len && isdigit((unsigned char)s[i])) i++;
+        size_t d1 = i;
+        while (i < len && (s[i] == ' ' || s[i] == '\t')) i++;
+        if (d1 > d0 && i < len && s[i] == '/')
+            lp_strtab_put(b, LP_DT_ORD, s + d0, d1 - d0, s + i, len - i);
+        return;
+    }
+    if (len > 0 && s[0] != '#') {
+        if (contains(s, len, "Node dependency ordering")) ns->in_ordering = true;
+        return;
+    }
+
+    const char *name, *value;
+    size_t name_len, value_len;
+    if (!parse_define(s, len, &name, &name_len, &value, &value_len)) return;
+    if (!has_suffix(name, name_len, "_PATH") || value_len < 2 || value[0] != '"') return;
+    name_len -= 5;
+    if (!is_node_id(name, name_len)) return;
+    const char *q = (const char *)memchr(value + 1, '"', value_len - 1);
+    if (!q) return;
+    lp_strtab_put(b, LP_DT_NODE, name, name_len, value + 1, (size_t)(q - value - 1));
+    ns->node_count++;
+}
+
+typedef struct {
+    lp_string aliases;
+    lp_string labels;
+} name_lists;
+
+static void add_name(lp_string *list, const char *name, size_t len) {
+    if (list->len) lp_string_append(list, ",", 1);
+    lp_string_append(list, name, len);
+}
+
+/* Pass 2: symbols defined in terms of node ids */
+static void scan_symbols(lp_strtab_builder *b, const char *s, size_t len, size_t line_no, void *ud) {
+    (void)line_no;
+    name_lists *names = (name_lists *)ud;
+    const char *name, *value;
+    size_t name_len, value_len;
+    if (!parse_define(s, len, &name, &name_len, &value, &value_len)) return;
+
+    if (is_node_id(name, name_len) && has_suffix(name, name_len, "_ORD")) {
+        for (size_t i = 0; i < value_len; i++)
+            if (!isdigit((unsigned char)value[i])) return;
+        const char *path = lp_strtab_builder_get(b, LP_DT_NODE, name, name_len - 4);
+        if (path && value_len) lp_strtab_put(b, LP_DT_ORD, value, value_len, path, strlen(path));
+        return;
+    }
+
+    char kind;
+    size_t skip;
+    if (has_prefix(name, name_len, "DT_N_ALIAS_")) {
+        kind = LP_DT_ALIAS;
+        skip = 11;
+    } else if (has_prefix(name, name_len, "DT_N_NODELABEL_")) {
+        kind = LP_DT_LABEL;
+        skip = 15;
+    } else if (has_prefix(name, name_len, "DT_CHOSEN_")) {
+        kind = LP_DT_CHOSEN;
+        skip = 10;
+    } else {
+        return;
+    }
+    if (!is_node_id(value, value_len) || name_len <= skip) return;
+    const char *path = lp_strtab_builder_get(b, LP_DT_NODE, value, value_len);
+    if (!path) return;
+    if (!lp_strtab_builder_get(b, kind, name + skip, name_len - skip)) {
+        if (kind == LP_DT_ALIAS) add_name(&names->aliases, name + skip, name_len - skip);
+        if (kind == LP_DT_LABEL) add_name(&names->labels, name + skip, name_len - skip);
+    }
+    lp_strtab_put(b, kind, name + skip, name_len - skip, path, strlen(path));
+}
+
+typedef struct {
+    lp_string path;
+    LP_VEC(size_t) stack;   /* path length before each open node */
+} dts_walk;
+
+/* zephyr.dts: the line each node is opened on */
+static void scan_dts(lp_strtab_builder *b, const char *s, size_t len, size_t line_no, void *ud) {
+    dts_walk *w = (dts_walk *)ud;
+    while (len > 0 && (*s == ' ' || *s == '\t')) { s++; len--; }
+    if (len == 0) return;
+    if (s[0] == '}') {
+        if (w->stack.len) w->path.len = w->stack.items[--w->stack.len];
+        return;
+    }
+    if (s[len - 1] != '{' || has_prefix(s, len, "/*") || s[0] == '*') return;
+
+    /* "label: other_label: name@addr {" */
+    size_t end = len - 1;
+    while (end > 0 && (s[end - 1] == ' ' || s[end - 1] == '\t')) end--;
+    size_t start = end;
+    while (start > 0 && s[start - 1] != ' ' && s[start - 1] != '\t') start--;
+    if (start == end) return;
+
+    lp_vec_push(w->stack, w->path.len);
+    if (end - start == 1 && s[start] == '/') {
+        w->path.len = 0;
+        lp_string_append(&w->path, "/", 1);
+    } else {
+        if (w->path.len != 1) lp_string_append(&w->path, "/", 1);
+        lp_string_append(&w->path, s + start, end - start);
+    }
+    char where[32];
+    int n = snprintf(where, sizeof(where), "zephyr.dts:%zu", line_no);
+    lp_strtab_put(b, LP_DT_LINE, w->path.data, w->path.len, where, (size_t)n);
+}
+
+static char *find_gen_header(const char *build_dir) {
+    for (size_t i = 0; i < sizeof(GEN_HEADERS) / sizeof(GEN_HEADERS[0]); i++) {
+        char *path = lp_path_join(build_dir, GEN_HEADERS[i]);
+        if (lp_file_exists(path)) return path;
+        free(path);
+    }
+    return NULL;
+}
+
+/* Build the table from the generated header and zephyr.dts */
+static bool build_index(lp_dt_index *ix, const char *gen_path, const char *dts_path,
+                        uint64_t stamp, const char *cache_path) {
+    lp_mapped_file gen;
+    if (!lp_map_file(gen_path, &gen)) return false;
+
+    lp_strtab_builder b;
+    lp_strtab_builder_init(&b);
+
+    node_scan ns = { false, 0 };
+    for_each_line(&gen, &b, scan_nodes, &ns);
+    name_lists names = { lp_string_new(256), lp_string_new(256) };
+    for_each_line(&gen, &b, scan_symbols, &names);
+    lp_strtab_put(&b, LP_DT_NAMES, "a", 1, names.aliases.data, names.aliases.len);
+    lp_strtab_put(&b, LP_DT_NAMES, "l", 1, names.labels.data, names.labels.len);
+    lp_string_free(&names.aliases);
+    lp_string_free(&names.labels);
+    lp_unmap_file(&gen);
+
+    lp_mapped_file dts;
+    if (lp_map_file(dts_path, &dts)) {
+        dts_walk w;
+        w.path = lp_string_new(256);
+        lp_vec_init(w.stack);
+        for_each_line(&dts, &b, scan_dts, &w);
+        lp_string_free(&w.path);
+        free(w.stack.items);
+        lp_unmap_file(&dts);
+    }
+
+    lp_strtab_finish(&b, DT_MAGIC, stamp, (uint32_t)ns.node_count, cache_path, &ix->tab);
+    return ix->tab.slots != NULL;
+}
+
+/* ---- Opening ---- */
+
+char *lp_dt_index_default_path(const char *build_dir) {
+    char name[64];
+    snprintf(name, sizeof(name), "dtindex-%016llx.bin",
+             (unsigned long long)lp_fnv1a(build_dir, strlen(build_dir)));
+    return lp_cache_path(name);
+}
+
+bool lp_dt_index_open(lp_dt_index *ix, const char *build_dir, const char *cache_path) {
+    memset(ix, 0, sizeof(*ix));
+    char *gen_path = find_gen_header(build_dir);
+    if (!gen_path) return false;
+    char *dts_path = lp_path_join(build_dir, "zephyr/zephyr.dts");
+    uint64_t stamp = lp_file_stamp(gen_path) * 31 ^ lp_file_stamp(dts_path);
+
+    bool ok = cache_path && lp_strtab_open(&ix->tab, cache_path, DT_MAGIC, stamp);
+    if (!ok) {
+        ix->rebuilt = true;
+        ok = build_index(ix, gen_path, dts_path, stamp, cache_path);
+    }
+    free(gen_path);
+    free(dts_path);
+    if (!ok) {
+        lp_dt_index_close(ix);
+        return false;
+    }
+    ix->build_dir = strdup(build_dir);
+    ix->node_count = ix->tab.user;
+    return true;
+}
+
+void lp_dt_index_close(lp_dt_index *ix) {
+    lp_strtab_close(&ix->tab);
+    free(ix->build_dir);
+    memset(ix, 0, sizeof(*ix));
+}
+
+const char *lp_dt_index_get(const lp_dt_index *ix, char kind, const char *name, size_t len) {
+    return lp_strtab_get(&ix->tab, kind, name, len);
+}
+
+/* ---- Finding the build directory ---- */
+
+/* Path token ending just before 'end' in line, back to whitespace or a quote */
+static char *path_before(const char *line, const char *end) {
+    const char *start = end;
+    while (start > line && !isspace((unsigned char)start[-1]) &&
+           start[-1] != '\'' && start[-1] != '"')
+        start--;
+    if (end - start < 2) return NULL;
+    return lp_strdup_range(start, 0, (size_t)(end - start));
+}
+
+/* First whitespace-delimited token after marker */
+static char *token_after(const char *line, const char *marker) {
+    const char *p = strstr(line, marker);
+    if (!p) return NULL;
+    p += strlen(marker);
+    while (*p == ' ' || *p == '\t') p++;
+    size_t n = 0;
+    while (p[n] && !isspace((unsigned char)p[n])) n++;
+    return n ? lp_strdup_range(p, 0, n) : NULL;
+}
+
+/* Strip "/zephyr/zephyr.dts" (either separator) from a dts path */
+static char *dts_build_dir(char *dts) {
+    size_t n = strlen(dts);
+    const size_t tail = strlen("/zephyr/zephyr.dts");
+    if (n > tail && strcmp(dts + n - 10, "zephyr.dts") == 0 &&
+        (dts[n - tail] == '/' || dts[n - tail] == '\\') &&
+        strncmp(dts + n - tail + 1, "zephyr", 6) == 0) {
+        dts[n - tail] = '\0';
+        return dts;
+    }
+    free(dts);
+    return NULL;
+}
+
+char *lp_dt_find_build_dir(const char *const *lines, size_t count) {
+    /* Ranked: an error located in zephyr.dts names the failing image, the
+       last generated zephyr.dts is the application in a sysbuild, and the
+       west/CMake banners name the top-level build directory */
+    char *best = NULL;
+    int best_rank = 0;
+    for (size_t i = 0; i < count && best_rank < 4; i++) {
+        const char *line = lines[i];
+        char *dir = NULL;
+        int rank = 0;
+        const char *at;
+        if ((at = strstr(line, "zephyr.dts:")) && strstr(line, "Generated zephyr.dts:") == NULL) {
+            char *dts = path_before(line, at + 10);
+            dir = dts ? dts_build_dir(dts) : NULL;
+            rank = 4;
+        } else if (strstr(line, "Generated zephyr.dts:")) {
+            char *dts = token_after(line, "Generated zephyr.dts:");
+            dir = dts ? dts_build_dir(dts) : NULL;
+            rank = 3;
+        } else if (strstr(line, "west build: making build dir")) {
+            dir = token_after(line, "making build dir");
+            rank = 2;
+        } else if (strstr(line, "Build files have been written to:")) {
+            dir = token_after(line, "written to:");
+            rank = 1;
+        }
+        if (!dir) continue;
+        if (rank > best_rank || (rank == 3 && best_rank == 3)) {
+            free(best);
+            best = dir;
+            best_rank = rank;
+        } else {
+            free(dir);
+        }
+    }
+    return best;
+}
+
+/* ---- Explaining ---- */
+
+static size_t edit_distance(const char *a, size_t alen, const char *b, size_t blen) {
+    if (alen > 63 || blen > 63) return 64;
+    size_t row[64];
+    for (size_t j = 0; j <= blen; j++) row[j] = j;
+    for (size_t i = 1; i <= alen; i++) {
+        size_t diag = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= blen; j++) {
+            size_t up = row[j];
+            size_t best = diag + (a[i - 1] != b[j - 1]);
+            if (up + 1 < best) best = up + 1;
+            if (row[j - 1] + 1 < best) best = row[j - 1] + 1;
+            row[j] = best;
+            diag = up;
+        }
+    }
+    return row[blen];
+}
+
+/* " (did you mean x?)", the defined names when there are few, or a count */
+static void append_suggestions(const lp_dt_index *ix, char list_kind, const char *name,
+                               size_t len, lp_string *out) {
+    char k[1] = { list_kind };
+    const char *list = lp_dt_index_get(ix, LP_DT_NAMES, k, 1);
+    if (!list || !list[0]) {
+        lp_string_append_cstr(out, " (none defined)");
+        return;
+    }
+
+    size_t limit = len / 3 > 2 ? len / 3 : 2;
+    const char *close[3] = { NULL, NULL, NULL };
+    size_t close_len[3] = { 0, 0, 0 }, close_dist[3] = { 0, 0, 0 };
+    size_t total = 0, close_count = 0;
+    for (const char *p = list; *p; ) {
+        const char *comma = strchr(p, ',');
+        size_t n = comma ? (size_t)(comma - p) : strlen(p);
+        size_t d = edit_distance(name, len, p, n);
+        total++;
+        if (d <= limit) {
+            /* Keep the three nearest, in order */
+            size_t at = close_count < 3 ? close_count++ : 3;
+            while (at > 0 && close_dist[at - 1] > d) {
+                if (at < 3) {
+                    close[at] = close[at - 1];
+                    close_len[at] = close_len[at - 1];
+                    close_dist[at] = close_dist[at - 1];
+                }
+                at--;
+            }
+            if (at < 3) {
+                close[at] = p;
+                close_len[at] = n;
+                close_dist[at] = d;
+            }
+        }
+        p += n + (comma ? 1 : 0);
+    }
+
+    if (close_count > 0) {
+        lp_string_append_cstr(out, " (did you mean ");
+        for (size_t i = 0; i < close_count; i++) {
+            if (i) lp_string_append_cstr(out, ", ");
+            lp_string_append(out, close[i], close_len[i]);
+        }
+        lp_string_append_cstr(out, "?)");
+    } else if (total <= 8) {
+        lp_string_append_cstr(out, " (defined: ");
+        for (const char *p = list; *p; p++) {
+            if (*p == ',') lp_string_append_cstr(out, ", ");
+            else lp_string_append(out, p, 1);
+        }
+        lp_string_append_cstr(out, ")");
+    } else {
+        char buf[48];
+        snprintf(buf, sizeof(buf), " (%zu defined)", total);
+        lp_string_append_cstr(out, buf);
+    }
+}
+
+/* "<path> (zephyr.dts:N)\n" */
+static void append_node(const lp_dt_index *ix, const char *path, lp_string *out) {
+    lp_string_append_cstr(out, path);
+    const char *where = lp_dt_index_get(ix, LP_DT_LINE, path, strlen(path));
+    if (where) {
+        lp_string_append_cstr(out, " (");
+        lp_string_append_cstr(out, where);
+        lp_string_append_cstr(out, ")");
+    }
+    lp_string_append(out, "\n", 1);
+}
+
+static void explain_ord(const lp_dt_index *ix, const char *digits, size_t len, lp_string *out) {
+    lp_string_append_cstr(out, "ord ");
+    lp_string_append(out, digits, len);
+    const char *path = lp_dt_index_get(ix, LP_DT_ORD, digits, len);
+    if (path) {
+        lp_string_append_cstr(out, " = ");
+        append_node(ix, path, out);
+    } else {
+        char buf[64];
+        snprintf(buf, sizeof(buf), ": no such node (ords run 0-%zu)\n",
+                 ix->node_count ? ix->node_count - 1 : 0);
+        lp_string_append_cstr(out, buf);
+    }
+}
+
+/* Longest '_'-delimited prefix of sym that is a key of this kind */
+static size_t longest_known(const lp_dt_index *ix, char kind, const char *sym, size_t len,
+                            const char **value) {
+    for (size_t n = len; n > 0; n--) {
+        if (n < len && sym[n] != '_') continue;
+        *value = lp_dt_index_get(ix, kind, sym, n);
+        if (*value) return n;
+    }
+    *value = NULL;
+    return 0;
+}
+
+/* Alias, node label or chosen name, possibly followed by a macro suffix */
+static void explain_named(const lp_dt_index *ix, char kind, const char *what,
+                          const char *name, size_t len, lp_string *out) {
+    const char *path;
+    size_t n = longest_known(ix, kind, name, len, &path);
+    if (path) {
+        lp_string_append_cstr(out, what);
+        lp_string_append(out, " ", 1);
+        lp_string_append(out, name, n);
+        lp_string_append_cstr(out, " = ");
+        append_node(ix, path, out);
+        return;
+    }
+    /* Drop the macro suffix: _ORD, _EXISTS, _P_<property>, ... */
+    for (size_t i = 0; i + 3 <= len; i++) {
+        if (memcmp(name + i, "_P_", 3) == 0) { len = i; break; }
+    }
+    if (has_suffix(name, len, "_ORD")) len -= 4;
+    else if (has_suffix(name, len, "_EXISTS")) len -= 7;
+    lp_string_append_cstr(out, what);
+    lp_string_append(out, " ", 1);
+    lp_string_append(out, name, len);
+    lp_string_append_cstr(out, ": not defined in this build");
+    if (kind != LP_DT_CHOSEN)
+        append_suggestions(ix, kind == LP_DT_ALIAS ? 'a' : 'l', name, len, out);
+    lp_string_append(out, "\n", 1);
+}
+
+static void explain_node_id(const lp_dt_index *ix, const char *sym, size_t len,
+                            lp_string *out) {
+    const char *path;
+    size_t n = longest_known(ix, LP_DT_NODE, sym, len, &path);
+    if (!path) return;
+    if (n < len && has_prefix(sym + n, len - n, "_S_")) {
+        /* The child is missing: name the deepest node that exists */
+        size_t end = len;
+        if (has_suffix(sym, end, "_ORD")) end -= 4;
+        lp_string_append(out, sym, end);
+        lp_string_append_cstr(out, ": no such node under ");
+        append_node(ix, path, out);
+        return;
+    }
+    lp_string_append(out, sym, n);
+    lp_string_append_cstr(out, " = ");
+    append_node(ix, path, out);
+}
+
+static void explain_symbol(const lp_dt_index *ix, const char *sym, size_t len, lp_string *out) {
+    if (has_prefix(sym, len, "DT_N_ALIAS_") && len > 11)
+        explain_named(ix, LP_DT_ALIAS, "alias", sym + 11, len - 11, out);
+    else if (has_prefix(sym, len, "DT_N_NODELABEL_") && len > 15)
+        explain_named(ix, LP_DT_LABEL, "label", sym + 15, len - 15, out);
+    else if (has_prefix(sym, len, "DT_CHOSEN_") && len > 10)
+        explain_named(ix, LP_DT_CHOSEN, "chosen", sym + 10, len - 10, out);
+    else if (is_node_id(sym, len))
+        explain_node_id(ix, sym, len, out);
+}
+
+size_t lp_dt_index_explain(const lp_dt_index *ix, const char *line, lp_string *out) {
+    if (!ix->tab.slots) return 0;
+    size_t before = out->len;
+    for (const char *p = line; *p; ) {
+        if (p != line && is_ident(p[-1])) {
+            p++;
+            continue;
+        }
+        /* ord,N */
+        if (strncmp(p, "ord,", 4) == 0 && isdigit((unsigned char)p[4])) {
+            size_t n = 0;
+            while (isdigit((unsigned char)p[4 + n])) n++;
+            explain_ord(ix, p + 4, n, out);
+            p += 4 + n;
+            continue;
+        }
+        if (!is_ident(*p)) {
+            p++;
+            continue;
+        }
+        size_t len = 0;
+        while (is_ident(p[len])) len++;
+        const char *sym = p;
+        size_t sym_len = len;
+        p += len;
+
+        if (has_prefix(sym, sym_len, "__device_dts_ord_")) {
+            sym += 17;
+            sym_len -= 17;
+            size_t d = 0;
+            while (d < sym_len && isdigit((unsigned char)sym[d])) d++;
+            if (d > 0 && d == sym_len) {
+                explain_ord(ix, sym, d, out);
+                continue;
+            }
+        }
+        if (has_prefix(sym, sym_len, "DT_")) {
+            /* DT_ALIAS(x) and friends, as written in the source */
+            const char *kind_what = NULL;
+            char kind = 0;
+            if (sym_len == 8 && memcmp(sym, "DT_ALIAS", 8) == 0) {
+                kind = LP_DT_ALIAS;
+                kind_what = "alias";
+            } else if (sym_len == 12 && memcmp(sym, "DT_NODELABEL", 12) == 0) {
+                kind = LP_DT_LABEL;
+                kind_what = "label";
+            } else if (sym_len == 9 && memcmp(sym, "DT_CHOSEN", 9) == 0) {
+                kind = LP_DT_CHOSEN;
+                kind_what = "chosen";
+            }
+            if (kind && *p == '(') {
+                const char *arg = p + 1;
+                while (*arg == ' ') arg++;
+                size_t an = 0;
+                while (is_ident(arg[an])) an++;
+                if (an > 0) {
+                    explain_named(ix, kind, kind_what, arg, an, out);
+                    p = arg + an;
+                }
+                continue;
+            }
+            explain_symbol(ix, sym, sym_len, out);
+        }
+    }
+
+    size_t notes = 0;
+    for (size_t i = before; i < out->len; i++) notes += out->data[i] == '\n';
+    return notes;
+}
@@ -0,0 +1,59 @@
+/*
+ * dtindex.h — Devicetree symbol index over a Zephyr build directory
+ *
+ * Resolves the node references Zephyr errors are phrased in (ord,N,
+ * __device_dts_ord_N, DT_N_S_..., DT_N_ALIAS_..., DT_N_NODELABEL_...)
+ * to node paths and zephyr.dts line numbers. The index is built once
+ * from devicetree_generated.h and zephyr.dts and cached as an lp_strtab
+ * that is mapped and probed in place; it is stamped with the size and
+ * mtime of both sources and rebuilt when either changes.
+ */
+#ifndef LP_DTINDEX_H
+#define LP_DTINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "util.h"
+#include "strtab.h"
+
+/* Kinds of key, stored as the first byte of each key */
+#define LP_DT_ORD      'o'   /* ordinal          -> node path */
+#define LP_DT_NODE     'n'   /* DT_N_S_... id    -> node path */
+#define LP_DT_ALIAS    'a'   /* alias            -> node path */
+#define LP_DT_LABEL    'l'   /* node label       -> node path */
+#define LP_DT_CHOSEN   'c'   /* chosen property  -> node path */
+#define LP_DT_LINE     'p'   /* node path        -> "zephyr.dts:N" */
+#define LP_DT_NAMES    '*'   /* kind byte        -> comma list of names */
+
+typedef struct {
+    lp_strtab  tab;
+    char      *build_dir;
+    size_t     node_count;
+    bool       rebuilt;      /* Cache was stale or missing */
+} lp_dt_index;
+
+/* Build directory named in a west/CMake log ("-- Generated zephyr.dts:",
+   "west build: making build dir", a zephyr.dts error location, ...).
+   Returns malloc'd path, or NULL if the log names none. */
+char *lp_dt_find_build_dir(const char *const *lines, size_t count);
+
+/* $LOGPILOT_CACHE/dtindex-<hash of build_dir>.bin (see lp_cache_path).
+   Returns malloc'd path, or NULL. */
+char *lp_dt_index_default_path(const char *build_dir);
+
+/* Open the index for build_dir, (re)building the cache at cache_path when
+   its stamp is stale. Works without a writable cache by building in
+   memory. False if the build has no devicetree_generated.h. */
+bool lp_dt_index_open(lp_dt_index *ix, const char *build_dir, const char *cache_path);
+void lp_dt_index_close(lp_dt_index *ix);
+
+/* Value for a key of the given kind, or NULL */
+const char *lp_dt_index_get(const lp_dt_index *ix, char kind, const char *name, size_t len);
+
+/* Resolve every devicetree reference in line, appending one
+   newline-terminated note per reference to out. Returns the note count. */
+size_t lp_dt_index_explain(const lp_dt_index *ix, const char *line, lp_string *out);
+
+#endif /* LP_DTINDEX_H */
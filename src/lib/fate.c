@@ -0,0 +1,173 @@
+/*
+ * fate.c — Profiling line-fate classifier
+ */
+#include "fate.h"
+#include "mode.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Groups are the pattern stages of lp_fate_steps, in the same order */
+_Static_assert(LP_FATE_GROUP_KEEP == LP_FATE_STAGE_KEEP - LP_FATE_STAGE_KEEP, "fate group order");
+_Static_assert(LP_FATE_GROUP_DROP == LP_FATE_STAGE_DROP - LP_FATE_STAGE_KEEP, "fate group order");
+_Static_assert(LP_FATE_GROUP_KEEP_ONCE == LP_FATE_STAGE_KEEP_ONCE - LP_FATE_STAGE_KEEP,
+               "fate group order");
+
+static const char *GROUP_NAMES[LP_FATE_GROUP_COUNT] = { "keep", "drop", "keep_once" };
+
+static void add_rule(lp_fate_classifier *fc, lp_fate_group g, size_t *cap,
+                     const char *pattern, bool ci) {
+    if (fc->counts[g] >= *cap) {
+        *cap = *cap ? *cap * 2 : 16;
+        fc->rules[g] = (lp_fate_rule *)realloc(fc->rules[g], *cap * sizeof(lp_fate_rule));
+    }
+    lp_fate_rule *r = &fc->rules[g][fc->counts[g]++];
+    r->pattern = pattern;
+    r->ci = ci;
+    r->hits = 0;
+}
+
+void lp_fate_init(lp_fate_classifier *fc, const struct lp_mode *mode,
+                  size_t profile_lines) {
+    memset(fc, 0, sizeof(*fc));
+    fc->mode = mode;
+    fc->profile_lines = profile_lines ? profile_lines : LP_FATE_PROFILE_LINES;
+
+    /* Pattern steps of lp_fate_steps, grouped by stage in declaration order */
+    size_t cap[LP_FATE_GROUP_COUNT] = {0};
+    for (size_t s = 0; s < lp_fate_step_count; s++) {
+        const lp_fate_step *step = &lp_fate_steps[s];
+        if (step->check) continue;
+        lp_fate_group g = (lp_fate_group)(step->stage - LP_FATE_STAGE_KEEP);
+        if (step->set == LP_FATE_GENERIC) {
+            for (size_t i = 0; i < lp_fate_generic_count; i++)
+                add_rule(fc, g, &cap[g], lp_fate_generic[i], true);
+            continue;
+        }
+        if (!mode) continue;
+        size_t count;
+        char **pats = lp_mode_patterns(mode, (lp_pattern_set)step->set, &count);
+        bool ci = lp_pattern_set_ci((lp_pattern_set)step->set);
+        for (size_t i = 0; i < count; i++)
+            add_rule(fc, g, &cap[g], pats[i], ci);
+    }
+}
+
+void lp_fate_free(lp_fate_classifier *fc) {
+    for (int g = 0; g < LP_FATE_GROUP_COUNT; g++)
+        free(fc->rules[g]);
+    memset(fc, 0, sizeof(*fc));
+}
+
+const char *lp_fate_group_name(lp_fate_group g) {
+    return (g >= 0 && g < LP_FATE_GROUP_COUNT) ? GROUP_NAMES[g] : "?";
+}
+
+void lp_fate_reorder(lp_fate_classifier *fc) {
+    /* Stable insertion sort, most hits first. Groups are small (tens). */
+    for (int g = 0; g < LP_FATE_GROUP_COUNT; g++) {
+        lp_fate_rule *r = fc->rules[g];
+        for (size_t i = 1; i < fc->counts[g]; i++) {
+            lp_fate_rule tmp = r[i];
+            size_t j = i;
+            while (j > 0 && r[j - 1].hits < tmp.hits) {
+                r[j] = r[j - 1];
+                j--;
+            }
+            r[j] = tmp;
+        }
+    }
+    fc->ordered = true;
+}
+
+/* First rule in the group that matches, counting the hit */
+static bool group_match(lp_fate_classifier *fc, lp_fate_group g, const char *line) {
+    lp_fate_rule *r = fc->rules[g];
+    for (size_t i = 0; i < fc->counts[g]; i++) {
+        bool hit = r[i].ci ? lp_str_contains_ci(line, r[i].pattern)
+                           : lp_str_contains(line, r[i].pattern);
+        if (hit) {
+            r[i].hits++;
+            return true;
+        }
+    }
+    return false;
+}
+
+lp_fate lp_fate_classify(lp_fate_classifier *fc, const char *line) {
+    if (!line) return LP_FATE_DROP;
+
+    if (!fc->ordered && ++fc->seen >= fc->profile_lines)
+        lp_fate_reorder(fc);
+
+    /* Native plugin logic beats pattern interpretation */
+    int pf = lp_plugin_classify(fc->plugin, line);
+    if (pf != LP_PLUGIN_DEFER) return (lp_fate)pf;
+
+    /* lp_line_fate's steps, each pattern group as a whole: order inside a
+       group is free, order between groups is not */
+    lp_fate_stage done = LP_FATE_STAGE_FIXED;
+    for (size_t s = 0; s < lp_fate_step_count; s++) {
+        const lp_fate_step *step = &lp_fate_steps[s];
+        if (step->check) {
+            if (step->check(line)) return step->fate;
+        } else if (step->stage != done) {
+            done = step->stage;
+            if (group_match(fc, (lp_fate_group)(step->stage - LP_FATE_STAGE_KEEP), line))
+                return step->fate;
+        }
+    }
+    return LP_FATE_KEEP;
+}
+
+/* ---- Persistence ---- */
+
+bool lp_fate_load_stats(lp_fate_classifier *fc, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return false;
+
+    char *buf = NULL;
+    size_t buf_cap = 0;
+    while (lp_readline(fp, &buf, &buf_cap) >= 0) {
+        if (buf[0] == '#' || buf[0] == '\0') continue;
+        char *end;
+        unsigned long long hits = strtoull(buf, &end, 10);
+        if (end == buf || *end != '\t') continue;
+        char *group = end + 1;
+        char *tab = strchr(group, '\t');
+        if (!tab) continue;
+        *tab = '\0';
+        const char *pattern = tab + 1;
+
+        for (int g = 0; g < LP_FATE_GROUP_COUNT; g++) {
+            if (strcmp(group, GROUP_NAMES[g]) != 0) continue;
+            for (size_t i = 0; i < fc->counts[g]; i++) {
+                if (strcmp(fc->rules[g][i].pattern, pattern) == 0) {
+                    fc->rules[g][i].hits += (size_t)hits;
+                    break;
+                }
+            }
+        }
+    }
+    free(buf);
+    fclose(fp);
+
+    lp_fate_reorder(fc);
+    return true;
+}
+
+bool lp_fate_save_stats(const lp_fate_classifier *fc, const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) return false;
+    fprintf(fp, "# LogPilot line-fate hit counts: <hits>\\t<group>\\t<pattern>\n");
+    for (int g = 0; g < LP_FATE_GROUP_COUNT; g++) {
+        for (size_t i = 0; i < fc->counts[g]; i++) {
+            const lp_fate_rule *r = &fc->rules[g][i];
+            fprintf(fp, "%zu\t%s\t%s\n", r->hits, GROUP_NAMES[g], r->pattern);
+        }
+    }
+    fclose(fp);
+    return true;
+}
@@ -0,0 +1,65 @@
+/*
+ * fate.h — Profiling line-fate classifier
+ *
+ * Same decisions as lp_line_fate(), but the patterns inside each priority
+ * group are reordered by observed hit count. Groups keep their fixed
+ * precedence (KEEP, then DROP, then KEEP_ONCE), so reordering only changes
+ * how quickly a match is found, never which fate wins. Hit counts can be
+ * persisted per mode so the next run starts out already ordered.
+ */
+#ifndef LP_FATE_H
+#define LP_FATE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "segment.h"
+#include "plugin.h"
+
+#define LP_FATE_PROFILE_LINES 2000  /* Lines observed before reordering */
+
+/* Priority groups, in precedence order */
+typedef enum {
+    LP_FATE_GROUP_KEEP,       /* Generic + mode error/warning patterns (ci) */
+    LP_FATE_GROUP_DROP,       /* drop_contains + boilerplate patterns */
+    LP_FATE_GROUP_KEEP_ONCE,  /* keep_once_contains */
+    LP_FATE_GROUP_COUNT
+} lp_fate_group;
+
+typedef struct {
+    const char *pattern;  /* Not owned (mode strings or literals) */
+    bool        ci;       /* Case-insensitive match */
+    size_t      hits;
+} lp_fate_rule;
+
+typedef struct {
+    lp_fate_rule         *rules[LP_FATE_GROUP_COUNT];
+    size_t                counts[LP_FATE_GROUP_COUNT];
+    const struct lp_mode *mode;
+    lp_plugin            *plugin;         /* Consulted first; may be NULL */
+    size_t                profile_lines;  /* Reorder after this many lines */
+    size_t                seen;
+    bool                  ordered;
+} lp_fate_classifier;
+
+/* Build the rule table from a mode (may be NULL). profile_lines = 0 uses
+   LP_FATE_PROFILE_LINES. */
+void lp_fate_init(lp_fate_classifier *fc, const struct lp_mode *mode,
+                  size_t profile_lines);
+void lp_fate_free(lp_fate_classifier *fc);
+
+/* Classify a line. Equivalent to lp_line_fate(line, mode), except that a
+   plugin's classify_line hook (when set) decides first. */
+lp_fate lp_fate_classify(lp_fate_classifier *fc, const char *line);
+
+/* "keep", "drop", "keep_once" (also the group names in stats files) */
+const char *lp_fate_group_name(lp_fate_group g);
+
+/* Sort each group by hits now, rather than waiting for the profile window */
+void lp_fate_reorder(lp_fate_classifier *fc);
+
+/* Persisted hit counts ("<hits>\t<group>\t<pattern>" per line).
+   Loading adds the stored counts and reorders immediately. */
+bool lp_fate_load_stats(lp_fate_classifier *fc, const char *path);
+bool lp_fate_save_stats(const lp_fate_classifier *fc, const char *path);
+
+#endif /* LP_FATE_H */
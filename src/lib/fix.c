@@ -9,6 +9,9 @@
  */
 #include "fix.h"
 #include "util.h"
+#include "thread.h"
+#include "journal.h"
+#include "dedup.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -16,6 +19,10 @@
 #include <stdio.h>
 #include <re.h>
 
+/* Loading is I/O-bound (often a networked home directory): use more
+   threads than CPUs so reads overlap */
+#define LP_FIX_LOAD_THREADS 16
+
 /* ---- Minimal YAML parser for fix files ---- */
 
 static void yaml_skip_ws(const char **p) {
@@ -144,9 +151,14 @@ lp_fix *lp_fix_load(const char *path) {
     size_t file_len;
     char *data = lp_read_file(path, &file_len);
     if (!data) return NULL;
+    lp_fix *f = lp_fix_parse(data, path);
+    free(data);
+    return f;
+}
 
+lp_fix *lp_fix_parse(const char *data, const char *origin) {
     lp_fix *f = (lp_fix *)calloc(1, sizeof(lp_fix));
-    f->file_path = strdup(path);
+    f->file_path = strdup(origin);
 
     const char *p = data;
     while (*p) {
@@ -198,7 +210,6 @@ lp_fix *lp_fix_load(const char *path) {
         if (*p) p++;
     }
 
-    free(data);
     return f;
 }
 
@@ -217,27 +228,82 @@ void lp_fix_free(lp_fix *f) {
 }
 
 typedef struct {
-    lp_fix **fixes;
-    size_t   count;
-    size_t   cap;
-} fix_collector;
-
-static void collect_fix(const char *path, void *userdata) {
-    fix_collector *fc = (fix_collector *)userdata;
-    lp_fix *f = lp_fix_load(path);
-    if (!f) return;
-    if (fc->count >= fc->cap) {
-        fc->cap = fc->cap ? fc->cap * 2 : 8;
-        fc->fixes = (lp_fix **)realloc(fc->fixes, fc->cap * sizeof(lp_fix *));
+    char   **paths;
+    lp_fix **fixes;   /* Slot i belongs to paths[i] */
+} fix_load_job;
+
+static void load_fix_task(void *ctx, size_t i) {
+    fix_load_job *job = (fix_load_job *)ctx;
+    job->fixes[i] = lp_fix_load(job->paths[i]);
+}
+
+static lp_fix **load_snapshot(const char *dir, size_t *count) {
+    size_t path_count = 0;
+    char **paths = lp_dir_list_recursive(dir, ".yaml", &path_count);
+    *count = 0;
+    if (path_count == 0) {
+        free(paths);
+        return NULL;
+    }
+
+    /* Each worker fills its own slots, so the result follows the sorted
+       path order however the work was scheduled */
+    fix_load_job job;
+    job.paths = paths;
+    job.fixes = (lp_fix **)calloc(path_count, sizeof(lp_fix *));
+    size_t threads = lp_cpu_count();
+    if (threads < LP_FIX_LOAD_THREADS) threads = LP_FIX_LOAD_THREADS;
+    lp_parallel_for(path_count, threads, load_fix_task, &job);
+
+    /* Compact out unreadable files */
+    size_t n = 0;
+    for (size_t i = 0; i < path_count; i++) {
+        if (job.fixes[i]) job.fixes[n++] = job.fixes[i];
+    }
+    lp_free_strings(paths, path_count);
+    *count = n;
+    return job.fixes;
+}
+
+#define LP_FIX_LOAD_RETRIES 3
+
+/* Snapshot plus journal. Polling the journal before and after the scan
+   detects a compaction in between (the generation changes), in which case
+   records may be missing or doubled, so the load starts over. */
+lp_fix **lp_fix_load_dir_tail(const char *dir, size_t *count, lp_journal *journal) {
+    lp_fix **fixes = NULL;
+    for (int attempt = 0; attempt < LP_FIX_LOAD_RETRIES; attempt++) {
+        lp_journal_free(journal);
+        lp_journal_init(journal, dir);
+        lp_fix **pending = NULL;
+        size_t pending_count = 0;
+        lp_journal_poll(journal, &pending, &pending_count);
+
+        fixes = load_snapshot(dir, count);
+
+        lp_journal_status st = lp_journal_poll(journal, &pending, &pending_count);
+        if (st == LP_JOURNAL_RESET && attempt + 1 < LP_FIX_LOAD_RETRIES) {
+            lp_fixes_free(pending, pending_count);
+            lp_fixes_free(fixes, *count);
+            continue;
+        }
+        if (pending_count > 0) {
+            fixes = (lp_fix **)realloc(fixes, (*count + pending_count) * sizeof(lp_fix *));
+            memcpy(fixes + *count, pending, pending_count * sizeof(lp_fix *));
+            *count += pending_count;
+        }
+        free(pending);
+        break;
     }
-    fc->fixes[fc->count++] = f;
+    return fixes;
 }
 
 lp_fix **lp_fix_load_dir(const char *dir, size_t *count) {
-    fix_collector fc = { NULL, 0, 0 };
-    lp_dir_iter_recursive(dir, ".yaml", collect_fix, &fc);
-    *count = fc.count;
-    return fc.fixes;
+    lp_journal j;
+    lp_journal_init(&j, dir);
+    lp_fix **fixes = lp_fix_load_dir_tail(dir, count, &j);
+    lp_journal_free(&j);
+    return fixes;
 }
 
 void lp_fixes_free(lp_fix **fixes, size_t count) {
@@ -321,8 +387,13 @@ static int cmp_match_desc(const void *a, const void *b) {
 
 lp_fix_match *lp_fix_match_all(const char *error_text, lp_fix **fixes, size_t fix_count,
                                 size_t *match_count, float min_confidence) {
+    return lp_fix_match_ids(error_text, fixes, NULL, fix_count, match_count, min_confidence);
+}
+
+lp_fix_match *lp_fix_match_ids(const char *error_text, lp_fix **fixes, const uint32_t *ids,
+                                size_t id_count, size_t *match_count, float min_confidence) {
     *match_count = 0;
-    if (!error_text || fix_count == 0) return NULL;
+    if (!error_text || id_count == 0) return NULL;
 
     char *norm_error = normalize_for_match(error_text);
     size_t norm_len = strlen(norm_error);
@@ -330,7 +401,8 @@ lp_fix_match *lp_fix_match_all(const char *error_text, lp_fix **fixes, size_t fi
     size_t cap = 8;
     lp_fix_match *matches = (lp_fix_match *)malloc(cap * sizeof(lp_fix_match));
 
-    for (size_t i = 0; i < fix_count; i++) {
+    for (size_t n = 0; n < id_count; n++) {
+        size_t i = ids ? ids[n] : n;
         float conf = 0.0f;
 
         /* Try regex match first */
@@ -368,6 +440,7 @@ lp_fix_match *lp_fix_match_all(const char *error_text, lp_fix **fixes, size_t fi
             }
             matches[*match_count].fix = fixes[i];
             matches[*match_count].confidence = conf;
+            matches[*match_count].id = (uint32_t)i;
             (*match_count)++;
         }
     }
@@ -378,6 +451,89 @@ lp_fix_match *lp_fix_match_all(const char *error_text, lp_fix **fixes, size_t fi
     return matches;
 }
 
+/* ---- Match memo ---- */
+
+static uint64_t mix64(uint64_t h, uint64_t v) {
+    h ^= v;
+    h *= 0x100000001b3ULL;
+    return h ^ (h >> 29);
+}
+
+static uint64_t str_hash(const char *s) {
+    return s ? lp_fnv1a(s, strlen(s)) : 0;
+}
+
+uint64_t lp_fix_db_generation(lp_fix **fixes, size_t count) {
+    uint64_t h = mix64(0xcbf29ce484222325ULL, count);
+    for (size_t i = 0; i < count; i++) {
+        const lp_fix *f = fixes[i];
+        h = mix64(h, str_hash(f->pattern));
+        h = mix64(h, str_hash(f->regex));
+        h = mix64(h, f->tag_count);
+        for (size_t t = 0; t < f->tag_count; t++)
+            h = mix64(h, str_hash(f->tags[t]));
+        h = mix64(h, str_hash(f->fix_text));
+        h = mix64(h, str_hash(f->context));
+        h = mix64(h, str_hash(f->severity));
+        h = mix64(h, str_hash(f->resolved));
+        h = mix64(h, str_hash(f->commit_ref));
+    }
+    return h;
+}
+
+/* NULL when a hit names an id past fix_count: a memo written for another
+   database that happened to share its generation, or a damaged file */
+static lp_fix_match *matches_from_memo(lp_fix **fixes, size_t fix_count, const lp_memo_hit *hits,
+                                       size_t count, size_t *match_count) {
+    for (size_t i = 0; i < count; i++)
+        if (hits[i].id >= fix_count) return NULL;
+    lp_fix_match *matches = (lp_fix_match *)malloc((count ? count : 1) * sizeof(lp_fix_match));
+    for (size_t i = 0; i < count; i++) {
+        matches[i].fix = fixes[hits[i].id];
+        matches[i].confidence = hits[i].confidence;
+        matches[i].id = hits[i].id;
+    }
+    *match_count = count;
+    return matches;
+}
+
+static void remember(lp_memo *memo, uint64_t key, const lp_fix_match *matches, size_t count) {
+    lp_memo_hit *hits = (lp_memo_hit *)malloc((count ? count : 1) * sizeof(lp_memo_hit));
+    for (size_t i = 0; i < count; i++) {
+        hits[i].id = matches[i].id;
+        hits[i].confidence = matches[i].confidence;
+    }
+    lp_memo_put(memo, key, hits, count);
+    free(hits);
+}
+
+lp_fix_match *lp_fix_match_memo(lp_memo *memo, uint64_t scope, const char *error_text,
+                                lp_fix **fixes, size_t fix_count, const uint32_t *ids,
+                                size_t id_count, size_t *match_count, float min_confidence) {
+    *match_count = 0;
+    if (!error_text || id_count == 0) return NULL;
+
+    uint32_t conf_bits;
+    memcpy(&conf_bits, &min_confidence, sizeof(conf_bits));
+    scope = mix64(scope, conf_bits);
+
+    /* Regexes and substrings match the raw line, so only the exact text
+       identifies a result: a line that differs in a number may match
+       differently */
+    const lp_memo_hit *hits;
+    size_t hit_count;
+    uint64_t key = mix64(scope, str_hash(error_text));
+    if (lp_memo_get(memo, key, &hits, &hit_count)) {
+        lp_fix_match *matches = matches_from_memo(fixes, fix_count, hits, hit_count, match_count);
+        if (matches) return matches;
+    }
+
+    lp_fix_match *matches = lp_fix_match_ids(error_text, fixes, ids, id_count, match_count,
+                                             min_confidence);
+    remember(memo, key, matches, *match_count);
+    return matches;
+}
+
 void lp_fix_matches_free(lp_fix_match *matches, size_t count) {
     (void)count;
     free(matches);
@@ -399,41 +555,82 @@ bool lp_fix_validate(const lp_fix *f, char *errbuf, size_t errlen) {
     return true;
 }
 
-int lp_fix_write(const char *path, const lp_fix *f) {
-    FILE *fp = fopen(path, "w");
-    if (!fp) return -1;
+static void append_field(lp_string *s, const char *key, const char *val, bool quoted) {
+    lp_string_append_cstr(s, key);
+    lp_string_append_cstr(s, quoted ? ": \"" : ": ");
+    lp_string_append_cstr(s, val);
+    lp_string_append_cstr(s, quoted ? "\"\n" : "\n");
+}
 
-    fprintf(fp, "pattern: \"%s\"\n", f->pattern ? f->pattern : "");
+char *lp_fix_serialize(const lp_fix *f) {
+    lp_string s = lp_string_new(256);
+    append_field(&s, "pattern", f->pattern ? f->pattern : "", true);
     if (f->regex && f->regex[0])
-        fprintf(fp, "regex: \"%s\"\n", f->regex);
+        append_field(&s, "regex", f->regex, true);
     if (f->tags && f->tag_count > 0) {
-        fprintf(fp, "tags: [");
+        lp_string_append_cstr(&s, "tags: [");
         for (size_t i = 0; i < f->tag_count; i++) {
-            if (i > 0) fprintf(fp, ", ");
-            fprintf(fp, "%s", f->tags[i]);
+            if (i > 0) lp_string_append_cstr(&s, ", ");
+            lp_string_append_cstr(&s, f->tags[i]);
         }
-        fprintf(fp, "]\n");
+        lp_string_append_cstr(&s, "]\n");
     }
     if (f->fix_text) {
-        fprintf(fp, "fix: |\n");
+        lp_string_append_cstr(&s, "fix: |\n");
         /* Indent each line */
         const char *p = f->fix_text;
         while (*p) {
-            fprintf(fp, "  ");
-            while (*p && *p != '\n') { fputc(*p++, fp); }
-            fputc('\n', fp);
+            const char *eol = strchr(p, '\n');
+            size_t len = eol ? (size_t)(eol - p) : strlen(p);
+            lp_string_append_cstr(&s, "  ");
+            lp_string_append(&s, p, len);
+            lp_string_append_cstr(&s, "\n");
+            p += len;
             if (*p == '\n') p++;
         }
     }
-    if (f->context) fprintf(fp, "context: \"%s\"\n", f->context);
-    if (f->resolved) fprintf(fp, "resolved: %s\n", f->resolved);
-    if (f->commit_ref) fprintf(fp, "commit_ref: \"%s\"\n", f->commit_ref);
-    if (f->severity) fprintf(fp, "severity: %s\n", f->severity);
+    if (f->context) append_field(&s, "context", f->context, true);
+    if (f->resolved) append_field(&s, "resolved", f->resolved, false);
+    if (f->commit_ref) append_field(&s, "commit_ref", f->commit_ref, true);
+    if (f->severity) append_field(&s, "severity", f->severity, false);
+
+    char *out = strdup(lp_string_cstr(&s));
+    lp_string_free(&s);
+    return out;
+}
 
+int lp_fix_write(const char *path, const lp_fix *f) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) return -1;
+    char *text = lp_fix_serialize(f);
+    fputs(text, fp);
+    free(text);
     fclose(fp);
     return 0;
 }
 
+char *lp_fix_default_path(const char *dir, const lp_fix *f) {
+    /* Use primary tag as subdirectory */
+    const char *primary_tag = (f->tag_count > 0) ? f->tags[0] : "general";
+    char *subdir = lp_path_join(dir, primary_tag);
+
+    /* Slugify pattern for filename */
+    char slug[64];
+    size_t si = 0;
+    for (const char *p = f->pattern ? f->pattern : ""; *p && si < sizeof(slug) - 6; p++) {
+        if (isalnum((unsigned char)*p)) slug[si++] = (char)tolower((unsigned char)*p);
+        else if (si > 0 && slug[si - 1] != '-') slug[si++] = '-';
+    }
+    while (si > 0 && slug[si - 1] == '-') si--;
+    slug[si] = '\0';
+
+    char filename[128];
+    snprintf(filename, sizeof(filename), "%s.yaml", si ? slug : "fix");
+    char *path = lp_path_join(subdir, filename);
+    free(subdir);
+    return path;
+}
+
 char *lp_fix_find_dir(void) {
     if (lp_file_exists("fixes")) return strdup("fixes");
     const char *env = getenv("LOGPILOT_FIXES");
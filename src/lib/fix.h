@@ -5,8 +5,11 @@
 #define LP_FIX_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
+#include "memo.h"
+
 /* A fix entry */
 typedef struct {
     char   *pattern;      /* Short match pattern */
@@ -23,19 +26,29 @@ typedef struct {
 
 /* A match result */
 typedef struct {
-    lp_fix *fix;
-    float   confidence;   /* 0.0 - 1.0 */
+    lp_fix  *fix;
+    float    confidence;   /* 0.0 - 1.0 */
+    uint32_t id;           /* Index of fix in the array matched against */
 } lp_fix_match;
 
 /* Load a single fix from a YAML file */
 lp_fix *lp_fix_load(const char *path);
 
+/* Parse a fix from YAML text; origin becomes file_path */
+lp_fix *lp_fix_parse(const char *data, const char *origin);
+
 /* Free a fix */
 void lp_fix_free(lp_fix *f);
 
-/* Load all fixes from a directory (recursive) */
+/* Load all fixes from a directory (recursive), including journal records */
 lp_fix **lp_fix_load_dir(const char *dir, size_t *count);
 
+struct lp_journal;
+
+/* As lp_fix_load_dir, leaving journal (lp_journal_init'd on dir) at the
+   end of the records loaded, so lp_journal_poll returns only later ones */
+lp_fix **lp_fix_load_dir_tail(const char *dir, size_t *count, struct lp_journal *journal);
+
 /* Free an array of fixes */
 void lp_fixes_free(lp_fix **fixes, size_t count);
 
@@ -45,6 +58,23 @@ void lp_fixes_free(lp_fix **fixes, size_t count);
 lp_fix_match *lp_fix_match_all(const char *error_text, lp_fix **fixes, size_t fix_count,
                                 size_t *match_count, float min_confidence);
 
+/* As lp_fix_match_all, over fixes[ids[0]] .. fixes[ids[id_count - 1]] only
+   (e.g. the ids passing a tag filter); ids == NULL means the first id_count */
+lp_fix_match *lp_fix_match_ids(const char *error_text, lp_fix **fixes, const uint32_t *ids,
+                                size_t id_count, size_t *match_count, float min_confidence);
+
+/* As lp_fix_match_ids, answered from memo when the exact error text was
+   seen before and recorded in it otherwise. scope must identify the id subset, e.g. a hash of the tag
+   filter; the memo must have been opened with lp_fix_db_generation. A
+   remembered id outside fixes[0 .. fix_count) counts as a miss. */
+lp_fix_match *lp_fix_match_memo(lp_memo *memo, uint64_t scope, const char *error_text,
+                                lp_fix **fixes, size_t fix_count, const uint32_t *ids,
+                                size_t id_count, size_t *match_count, float min_confidence);
+
+/* Hash of the order and every field of the fixes: changes whenever a
+   memoised result could */
+uint64_t lp_fix_db_generation(lp_fix **fixes, size_t count);
+
 /* Free match results */
 void lp_fix_matches_free(lp_fix_match *matches, size_t count);
 
@@ -54,6 +84,13 @@ bool lp_fix_validate(const lp_fix *f, char *errbuf, size_t errlen);
 /* Write a fix entry to a YAML file */
 int lp_fix_write(const char *path, const lp_fix *f);
 
+/* The YAML text lp_fix_write produces. Returns malloc'd string. */
+char *lp_fix_serialize(const lp_fix *f);
+
+/* Conventional location: <dir>/<primary-tag>/<pattern-slug>.yaml.
+   Returns malloc'd path; the file may already exist. */
+char *lp_fix_default_path(const char *dir, const lp_fix *f);
+
 /* Find fixes directory. Tries: ./fixes, $LOGPILOT_FIXES, exe dir. */
 char *lp_fix_find_dir(void);
 
@@ -0,0 +1,493 @@
+/*
+ * journal.c — Append-only fix journal shared by concurrent writers
+ */
+#include "journal.h"
+#include "util.h"
+#include "dedup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <process.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define HEADER_FMT     "# lp-journal v1 generation %llu\n"
+#define RECORD_MARK    "--- #lp-record "
+#define MAX_SUFFIX     1000   /* <slug>-2.yaml ... before giving up */
+
+/* ---- Platform file primitives ---- */
+
+#ifdef _WIN32
+typedef HANDLE jfile;
+#define JFILE_NONE INVALID_HANDLE_VALUE
+
+static jfile jopen(const char *path, bool write) {
+    return CreateFileA(path, GENERIC_READ | (write ? GENERIC_WRITE : 0),
+                       FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                       write ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+}
+
+static void jclose(jfile f) { CloseHandle(f); }
+
+static bool jlock(jfile f, bool exclusive, bool wait) {
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    DWORD flags = (exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0) |
+                  (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY);
+    return LockFileEx(f, flags, 0, MAXDWORD, MAXDWORD, &ov) != 0;
+}
+
+static void junlock(jfile f) {
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    UnlockFileEx(f, 0, MAXDWORD, MAXDWORD, &ov);
+}
+
+static bool jsize(jfile f, size_t *size) {
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(f, &sz)) return false;
+    *size = (size_t)sz.QuadPart;
+    return true;
+}
+
+static bool jread_at(jfile f, size_t off, char *buf, size_t len) {
+    while (len > 0) {
+        OVERLAPPED ov;
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (DWORD)((unsigned long long)off & 0xffffffffu);
+        ov.OffsetHigh = (DWORD)((unsigned long long)off >> 32);
+        DWORD got = 0;
+        DWORD want = len > 0x40000000u ? 0x40000000u : (DWORD)len;
+        if (!ReadFile(f, buf, want, &got, &ov) || got == 0) return false;
+        buf += got;
+        off += got;
+        len -= got;
+    }
+    return true;
+}
+
+/* Caller holds the exclusive lock, so seek-then-write is atomic */
+static bool jappend(jfile f, const char *buf, size_t len) {
+    LARGE_INTEGER zero;
+    zero.QuadPart = 0;
+    if (!SetFilePointerEx(f, zero, NULL, FILE_END)) return false;
+    DWORD put = 0;
+    return WriteFile(f, buf, (DWORD)len, &put, NULL) && put == (DWORD)len;
+}
+
+static bool jrestart(jfile f, const char *head, size_t len) {
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    DWORD put = 0;
+    if (!WriteFile(f, head, (DWORD)len, &put, &ov) || put != (DWORD)len) return false;
+    LARGE_INTEGER end;
+    end.QuadPart = (LONGLONG)len;
+    return SetFilePointerEx(f, end, NULL, FILE_BEGIN) && SetEndOfFile(f);
+}
+
+static void make_dir(const char *path) { _mkdir(path); }
+
+static int process_id(void) { return _getpid(); }
+
+/* Rename without replacing an existing file */
+static bool publish(const char *tmp, const char *final) {
+    return MoveFileExA(tmp, final, MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+#else
+typedef int jfile;
+#define JFILE_NONE (-1)
+
+static jfile jopen(const char *path, bool write) {
+    return write ? open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644)
+                 : open(path, O_RDONLY | O_CLOEXEC);
+}
+
+static void jclose(jfile f) { close(f); }
+
+/* fcntl record locks: unlike flock(), they also work over NFS */
+static bool jlock(jfile f, bool exclusive, bool wait) {
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = exclusive ? F_WRLCK : F_RDLCK;
+    fl.l_whence = SEEK_SET;
+    int rc;
+    do {
+        rc = fcntl(f, wait ? F_SETLKW : F_SETLK, &fl);
+    } while (rc != 0 && errno == EINTR);
+    return rc == 0;
+}
+
+static void junlock(jfile f) {
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_UNLCK;
+    fl.l_whence = SEEK_SET;
+    fcntl(f, F_SETLK, &fl);
+}
+
+static bool jsize(jfile f, size_t *size) {
+    struct stat st;
+    if (fstat(f, &st) != 0) return false;
+    *size = (size_t)st.st_size;
+    return true;
+}
+
+static bool jread_at(jfile f, size_t off, char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t got = pread(f, buf, len, (off_t)off);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        buf += got;
+        off += (size_t)got;
+        len -= (size_t)got;
+    }
+    return true;
+}
+
+/* O_APPEND: the offset update and the write are one atomic step */
+static bool jappend(jfile f, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t put = write(f, buf, len);
+        if (put < 0 && errno == EINTR) continue;
+        if (put <= 0) return false;
+        buf += put;
+        len -= (size_t)put;
+    }
+    return true;
+}
+
+/* Writes at offset 0 need O_APPEND off for the duration */
+static bool jrestart(jfile f, const char *head, size_t len) {
+    int flags = fcntl(f, F_GETFL);
+    if (flags < 0 || fcntl(f, F_SETFL, flags & ~O_APPEND) != 0) return false;
+    bool ok = true;
+    for (size_t off = 0; ok && off < len;) {
+        ssize_t put = pwrite(f, head + off, len - off, (off_t)off);
+        if (put < 0 && errno == EINTR) continue;
+        if (put <= 0) ok = false;
+        else off += (size_t)put;
+    }
+    if (ok) ok = ftruncate(f, (off_t)len) == 0;
+    fcntl(f, F_SETFL, flags);
+    return ok;
+}
+
+static void make_dir(const char *path) { mkdir(path, 0755); }
+
+static int process_id(void) { return (int)getpid(); }
+
+/* link() fails with EEXIST rather than replacing the target */
+static bool publish(const char *tmp, const char *final) {
+    if (link(tmp, final) != 0) return false;
+    unlink(tmp);
+    return true;
+}
+#endif
+
+/* ---- Record framing ---- */
+
+typedef void (*record_fn)(void *ctx, const char *body, size_t len, size_t offset);
+
+/* Generation from the header line; 0 if the buffer does not start with one */
+static uint64_t parse_header(const char *buf, size_t len, size_t *header_len) {
+    *header_len = 0;
+    const char *nl = (const char *)memchr(buf, '\n', len);
+    if (!nl) return 0;
+    unsigned long long gen = 0;
+    char line[96];
+    size_t n = (size_t)(nl - buf) + 1;
+    if (n >= sizeof(line)) return 0;
+    memcpy(line, buf, n);
+    line[n] = '\0';
+    if (sscanf(line, "# lp-journal v1 generation %llu", &gen) != 1) return 0;
+    *header_len = n;
+    return (uint64_t)gen;
+}
+
+/* Walk complete records in buf; base is buf's file offset. Returns bytes
+   consumed: a trailing incomplete record is left for the next read. */
+static size_t parse_records(const char *buf, size_t len, size_t base,
+                            record_fn fn, void *ctx, size_t *corrupt) {
+    const size_t mark_len = strlen(RECORD_MARK);
+    size_t pos = 0;
+    while (pos < len) {
+        if (len - pos < mark_len) break;
+        if (memcmp(buf + pos, RECORD_MARK, mark_len) != 0) {
+            /* Resynchronise on the next record marker */
+            (*corrupt)++;
+            size_t next = pos + 1;
+            while (next + mark_len <= len &&
+                   !(buf[next - 1] == '\n' && memcmp(buf + next, RECORD_MARK, mark_len) == 0))
+                next++;
+            pos = next + mark_len <= len ? next : len;
+            continue;
+        }
+        const char *nl = (const char *)memchr(buf + pos, '\n', len - pos);
+        if (!nl) break;
+        size_t head_len = (size_t)(nl - (buf + pos)) + 1;
+        char head[96];
+        if (head_len >= sizeof(head)) {
+            (*corrupt)++;
+            pos += head_len;
+            continue;
+        }
+        memcpy(head, buf + pos, head_len);
+        head[head_len] = '\0';
+        unsigned long long body_len = 0, hash = 0;
+        if (sscanf(head + mark_len, "%llu %llx", &body_len, &hash) != 2) {
+            (*corrupt)++;
+            pos += head_len;
+            continue;
+        }
+        if (pos + head_len + body_len > len) break;   /* Still being written */
+        const char *body = buf + pos + head_len;
+        if (lp_fnv1a(body, (size_t)body_len) == (uint64_t)hash) {
+            fn(ctx, body, (size_t)body_len, base + pos);
+        } else {
+            (*corrupt)++;
+        }
+        pos += head_len + (size_t)body_len;
+    }
+    return pos;
+}
+
+/* ---- Readers ---- */
+
+void lp_journal_init(lp_journal *j, const char *fix_dir) {
+    memset(j, 0, sizeof(*j));
+    j->path = lp_path_join(fix_dir, LP_JOURNAL_NAME);
+}
+
+void lp_journal_free(lp_journal *j) {
+    free(j->path);
+    j->path = NULL;
+}
+
+typedef struct {
+    const char *path;
+    lp_fix   ***fixes;
+    size_t     *count;
+} poll_ctx;
+
+static void collect_record(void *ctx, const char *body, size_t len, size_t offset) {
+    poll_ctx *pc = (poll_ctx *)ctx;
+    char *text = lp_strdup_range(body, 0, len);
+    char origin[1024];
+    snprintf(origin, sizeof(origin), "%s@%zu", pc->path, offset);
+    lp_fix *f = lp_fix_parse(text, origin);
+    free(text);
+    *pc->fixes = (lp_fix **)realloc(*pc->fixes, (*pc->count + 1) * sizeof(lp_fix *));
+    (*pc->fixes)[(*pc->count)++] = f;
+}
+
+lp_journal_status lp_journal_poll(lp_journal *j, lp_fix ***fixes, size_t *count) {
+    jfile fd = jopen(j->path, false);
+    if (fd == JFILE_NONE) return LP_JOURNAL_OK;   /* No journal yet */
+    if (!jlock(fd, false, true)) {
+        jclose(fd);
+        return LP_JOURNAL_ERROR;
+    }
+
+    lp_journal_status status = LP_JOURNAL_OK;
+    size_t size = 0;
+    if (!jsize(fd, &size)) status = LP_JOURNAL_ERROR;
+
+    char head[96];
+    size_t head_len = 0;
+    uint64_t gen = 0;
+    if (status == LP_JOURNAL_OK && size > 0) {
+        size_t n = size < sizeof(head) ? size : sizeof(head);
+        if (jread_at(fd, 0, head, n)) gen = parse_header(head, n, &head_len);
+    }
+    if (status == LP_JOURNAL_OK && j->generation != 0 && gen != j->generation) {
+        /* Compacted: the records we read are in the snapshot now */
+        j->generation = gen;
+        j->offset = head_len;
+        status = LP_JOURNAL_RESET;
+    }
+    if (status == LP_JOURNAL_OK) {
+        if (j->generation == 0) {
+            j->generation = gen;
+            if (j->offset < head_len) j->offset = head_len;
+        }
+        if (size > j->offset) {
+            size_t len = size - j->offset;
+            char *buf = (char *)malloc(len);
+            if (jread_at(fd, j->offset, buf, len)) {
+                poll_ctx pc = { j->path, fixes, count };
+                j->offset += parse_records(buf, len, j->offset, collect_record, &pc,
+                                           &j->corrupt);
+            } else {
+                status = LP_JOURNAL_ERROR;
+            }
+            free(buf);
+        }
+    }
+
+    junlock(fd);
+    jclose(fd);
+    return status;
+}
+
+/* ---- Writers ---- */
+
+int lp_journal_append(const char *fix_dir, const lp_fix *f) {
+    make_dir(fix_dir);
+    char *path = lp_path_join(fix_dir, LP_JOURNAL_NAME);
+    jfile fd = jopen(path, true);
+    free(path);
+    if (fd == JFILE_NONE) return -1;
+
+    char *body = lp_fix_serialize(f);
+    size_t body_len = strlen(body);
+    lp_string rec = lp_string_new(body_len + 128);
+    char line[96];
+
+    int rc = -1;
+    size_t size = 0;
+    if (jlock(fd, true, true)) {
+        if (jsize(fd, &size)) {
+            if (size == 0) {
+                snprintf(line, sizeof(line), HEADER_FMT, 1ULL);
+                lp_string_append_cstr(&rec, line);
+            }
+            snprintf(line, sizeof(line), RECORD_MARK "%zu %016llx\n", body_len,
+                     (unsigned long long)lp_fnv1a(body, body_len));
+            lp_string_append_cstr(&rec, line);
+            lp_string_append(&rec, body, body_len);
+            /* One write per record: readers under the shared lock see it whole */
+            if (jappend(fd, lp_string_cstr(&rec), rec.len)) {
+                rc = 0;
+                size += rec.len;
+            }
+        }
+        junlock(fd);
+    }
+    jclose(fd);
+    lp_string_free(&rec);
+    free(body);
+
+    if (rc == 0 && size > LP_JOURNAL_COMPACT_BYTES)
+        lp_journal_compact(fix_dir, false);
+    return rc;
+}
+
+typedef struct {
+    const char *fix_dir;
+    int         folded;
+    bool        failed;
+} compact_ctx;
+
+static bool same_content(const char *path, const char *body, size_t len) {
+    size_t have = 0;
+    char *data = lp_read_file(path, &have);
+    bool same = data && have == len && memcmp(data, body, len) == 0;
+    free(data);
+    return same;
+}
+
+/* Publish one record as <tag>/<slug>[-N].yaml. A file with identical
+   content counts as done, so re-running after a crash adds no copies. */
+static void fold_record(void *ctx, const char *body, size_t len, size_t offset) {
+    compact_ctx *cc = (compact_ctx *)ctx;
+    (void)offset;
+    char *text = lp_strdup_range(body, 0, len);
+    lp_fix *f = lp_fix_parse(text, "");
+    char *path = lp_fix_default_path(cc->fix_dir, f);
+    lp_fix_free(f);
+    free(text);
+
+    char *slash = strrchr(path, '/');
+#ifdef _WIN32
+    char *bslash = strrchr(path, '\\');
+    if (bslash && (!slash || bslash > slash)) slash = bslash;
+#endif
+    if (slash) {
+        *slash = '\0';
+        make_dir(path);
+        *slash = '/';
+    }
+
+    char tmp[1100];
+    snprintf(tmp, sizeof(tmp), "%s.tmp%d", path, process_id());
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp || fwrite(body, 1, len, fp) != len) {
+        if (fp) fclose(fp);
+        remove(tmp);
+        free(path);
+        cc->failed = true;
+        return;
+    }
+    fclose(fp);
+
+    size_t stem_len = strlen(path) - strlen(".yaml");
+    bool done = false;
+    for (int n = 1; n <= MAX_SUFFIX && !done; n++) {
+        char target[1100];
+        if (n == 1) snprintf(target, sizeof(target), "%s", path);
+        else snprintf(target, sizeof(target), "%.*s-%d.yaml", (int)stem_len, path, n);
+        if (publish(tmp, target)) {
+            done = true;
+        } else if (same_content(target, body, len)) {
+            remove(tmp);
+            done = true;
+        }
+    }
+    if (done) cc->folded++;
+    else {
+        remove(tmp);
+        cc->failed = true;
+    }
+    free(path);
+}
+
+int lp_journal_compact(const char *fix_dir, bool wait) {
+    char *path = lp_path_join(fix_dir, LP_JOURNAL_NAME);
+    jfile fd = jopen(path, true);
+    free(path);
+    if (fd == JFILE_NONE) return -1;
+    if (!jlock(fd, true, wait)) {
+        jclose(fd);
+        return wait ? -1 : 0;
+    }
+
+    int rc = -1;
+    size_t size = 0;
+    if (jsize(fd, &size)) {
+        char *buf = (char *)malloc(size ? size : 1);
+        if (size == 0 || jread_at(fd, 0, buf, size)) {
+            size_t head_len = 0;
+            uint64_t gen = size ? parse_header(buf, size, &head_len) : 0;
+            compact_ctx cc = { fix_dir, 0, false };
+            size_t corrupt = 0;
+            parse_records(buf + head_len, size - head_len, head_len, fold_record, &cc, &corrupt);
+
+            /* Only restart the journal once every record is in the snapshot.
+               The new header goes in over the old one before the records are
+               cut off, so a crash in between leaves the next generation
+               (tailing readers reload; the records fold again as no-ops)
+               rather than an empty journal that restarts at generation 1 */
+            if (!cc.failed && size > 0) {
+                char line[96];
+                snprintf(line, sizeof(line), HEADER_FMT, (unsigned long long)(gen + 1));
+                if (jrestart(fd, line, strlen(line))) rc = cc.folded;
+            } else if (size == 0) {
+                rc = 0;
+            }
+        }
+        free(buf);
+    }
+    junlock(fd);
+    jclose(fd);
+    return rc;
+}
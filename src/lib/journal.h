@@ -0,0 +1,61 @@
+/*
+ * journal.h — Append-only fix journal shared by concurrent writers
+ *
+ * New fixes are appended to <fixes>/journal.ylog as framed records, each
+ * in one locked O_APPEND write, so any number of processes can add fixes
+ * without slug collisions or torn files. Readers keep an offset and read
+ * only what was appended since. Compaction folds the records into the
+ * per-file YAML snapshot and restarts the journal under a new generation,
+ * which tells tailing readers to reload the snapshot.
+ *
+ * File layout (itself a multi-document YAML stream):
+ *   # lp-journal v1 generation <N>
+ *   --- #lp-record <body-bytes> <fnv1a-hex>
+ *   <fix YAML, as lp_fix_serialize writes it>
+ */
+#ifndef LP_JOURNAL_H
+#define LP_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "fix.h"
+
+#define LP_JOURNAL_NAME          "journal.ylog"
+#define LP_JOURNAL_COMPACT_BYTES (64 * 1024)   /* Auto-compact past this */
+
+typedef struct lp_journal {
+    char     *path;
+    uint64_t  generation;   /* 0 until the first poll */
+    size_t    offset;       /* End of the last complete record read */
+    size_t    corrupt;      /* Records skipped: bad frame or checksum */
+} lp_journal;
+
+typedef enum {
+    LP_JOURNAL_OK,
+    LP_JOURNAL_RESET,   /* Compacted since the last poll: reload the snapshot */
+    LP_JOURNAL_ERROR
+} lp_journal_status;
+
+void lp_journal_init(lp_journal *j, const char *fix_dir);
+void lp_journal_free(lp_journal *j);
+
+/* Append fixes appended since the last poll to *fixes (realloc'd, *count
+   updated). On LP_JOURNAL_RESET nothing is appended and the offset
+   restarts; poll again after reloading the snapshot. A missing journal
+   is an empty one. */
+lp_journal_status lp_journal_poll(lp_journal *j, lp_fix ***fixes, size_t *count);
+
+/* Append one fix as a single record. Returns 0 on success. Compacts
+   opportunistically once the journal passes LP_JOURNAL_COMPACT_BYTES. */
+int lp_journal_append(const char *fix_dir, const lp_fix *f);
+
+/* Write every record to the snapshot (<tag>/<slug>.yaml, suffixed on
+   collision, published by rename so readers never see partial files),
+   then empty the journal under the next generation. wait=false returns
+   0 at once if another process holds the journal. Returns records
+   folded, or -1 on error. */
+int lp_journal_compact(const char *fix_dir, bool wait);
+
+#endif /* LP_JOURNAL_H */
@@ -0,0 +1,365 @@
+/*
+ * kconfig.c — Kconfig symbol origin index for a Zephyr configuration
+ *
+ * The cache is an lp_strtab (magic "LPKCIX1") whose header word holds
+ * the fragment count.
+ */
+#include "kconfig.h"
+#include "dedup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+static const char KC_MAGIC[8] = "LPKCIX1";
+
+/* ---- Finding the configuration files ---- */
+
+bool lp_kconfig_is_warning(const char *line) {
+    if (!strstr(line, "warning:") && !strstr(line, "error:")) return false;
+    return strstr(line, "CONFIG_") || strstr(line, "(defined at ");
+}
+
+/* Path quoted after marker ("Merged configuration '<path>'"), or NULL */
+static char *quoted_after(const char *line, const char *marker) {
+    const char *p = strstr(line, marker);
+    if (!p) return NULL;
+    p += strlen(marker);
+    while (*p == ' ') p++;
+    if (*p != '\'' && *p != '"') return NULL;
+    const char *end = strchr(p + 1, *p);
+    if (!end || end == p + 1) return NULL;
+    return lp_strdup_range(p, 1, (size_t)(end - p));
+}
+
+typedef struct {
+    LP_VEC(char *) files;
+    char *config;
+    bool  warned;
+} kconfig_run;
+
+static void run_clear(kconfig_run *r) {
+    for (size_t i = 0; i < r->files.len; i++) free(r->files.items[i]);
+    free(r->files.items);
+    free(r->config);
+    memset(r, 0, sizeof(*r));
+}
+
+char **lp_kconfig_find_fragments(const char *const *lines, size_t count,
+                                 size_t *fragment_count, char **config_path) {
+    kconfig_run cur, chosen;
+    memset(&cur, 0, sizeof(cur));
+    memset(&chosen, 0, sizeof(chosen));
+    bool have_chosen = false;
+
+    for (size_t i = 0; i <= count; i++) {
+        const char *line = i < count ? lines[i] : NULL;
+        char *path = line ? quoted_after(line, "Loaded configuration") : NULL;
+        if (!line || path) {
+            /* A run ends where the next one loads its base configuration */
+            if (cur.files.len && cur.warned && !have_chosen) {
+                chosen = cur;
+                have_chosen = true;
+                memset(&cur, 0, sizeof(cur));
+            }
+            if (!line) break;
+            run_clear(&cur);
+            lp_vec_push(cur.files, path);
+            continue;
+        }
+        if ((path = quoted_after(line, "Merged configuration"))) {
+            lp_vec_push(cur.files, path);
+        } else if ((path = quoted_after(line, "Configuration saved to"))) {
+            free(cur.config);
+            cur.config = path;
+        } else if (cur.files.len && lp_kconfig_is_warning(line)) {
+            cur.warned = true;
+        }
+    }
+
+    kconfig_run *r = have_chosen ? &chosen : &cur;
+    *fragment_count = r->files.len;
+    *config_path = r->config;
+    char **files = r->files.items;
+    if (r->files.len == 0) {
+        free(files);
+        files = NULL;
+    }
+    r->config = NULL;
+    r->files.items = NULL;
+    r->files.len = 0;
+    run_clear(&cur);
+    run_clear(&chosen);
+    return files;
+}
+
+/* ---- Building ---- */
+
+static uint64_t files_hash(char *const *fragments, size_t count, const char *config_path,
+                           bool with_stamps) {
+    uint64_t h = 0;
+    for (size_t i = 0; i <= count; i++) {
+        const char *path = i < count ? fragments[i] : config_path;
+        if (!path) continue;
+        h = h * 31 ^ lp_fnv1a(path, strlen(path));
+        if (with_stamps) h = h * 31 ^ lp_file_stamp(path);
+    }
+    return h ? h : 1;
+}
+
+char *lp_kconfig_default_path(char *const *fragments, size_t count, const char *config_path) {
+    char name[64];
+    snprintf(name, sizeof(name), "kconfig-%016llx.bin",
+             (unsigned long long)files_hash(fragments, count, config_path, false));
+    return lp_cache_path(name);
+}
+
+/* "CONFIG_FOO=value" or "# CONFIG_FOO is not set"; name excludes CONFIG_ */
+static bool parse_assignment(const char *s, size_t len, const char **name, size_t *name_len,
+                             const char **value, size_t *value_len) {
+    while (len > 0 && (*s == ' ' || *s == '\t')) { s++; len--; }
+    while (len > 0 && isspace((unsigned char)s[len - 1])) len--;
+    static const char NOT_SET[] = " is not set";
+    size_t ns = sizeof(NOT_SET) - 1;
+    if (len > 9 + ns && memcmp(s, "# CONFIG_", 9) == 0 &&
+        memcmp(s + len - ns, NOT_SET, ns) == 0) {
+        *name = s + 9;
+        *name_len = len - 9 - ns;
+        *value = "n";
+        *value_len = 1;
+        return true;
+    }
+    if (len < 9 || memcmp(s, "CONFIG_", 7) != 0) return false;
+    const char *eq = (const char *)memchr(s, '=', len);
+    if (!eq || eq == s + 7) return false;
+    *name = s + 7;
+    *name_len = (size_t)(eq - s) - 7;
+    while (*name_len > 0 && (*name)[*name_len - 1] == ' ') (*name_len)--;
+    *value = eq + 1;
+    *value_len = len - (size_t)(eq + 1 - s);
+    while (*value_len > 0 && **value == ' ') { (*value)++; (*value_len)--; }
+    return *name_len > 0;
+}
+
+typedef struct {
+    const char *name;
+    size_t      name_len;
+    const char *value;
+    size_t      value_len;
+    uint32_t    fragment;
+    uint32_t    line;
+    size_t      order;       /* Merge order, for a stable sort */
+} assignment;
+
+typedef LP_VEC(assignment) assignment_vec;
+
+static int cmp_assignment(const void *a, const void *b) {
+    const assignment *x = (const assignment *)a, *y = (const assignment *)b;
+    size_t n = x->name_len < y->name_len ? x->name_len : y->name_len;
+    int c = memcmp(x->name, y->name, n);
+    if (c) return c;
+    if (x->name_len != y->name_len) return x->name_len < y->name_len ? -1 : 1;
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+/* Collect the assignments in a mapped configuration file */
+static void scan_file(const lp_mapped_file *mf, uint32_t fragment, assignment_vec *out) {
+    const char *p = mf->data, *end = mf->data + mf->len;
+    for (uint32_t line_no = 1; p < end; line_no++) {
+        const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+        size_t len = (size_t)((nl ? nl : end) - p);
+        assignment a;
+        if (parse_assignment(p, len, &a.name, &a.name_len, &a.value, &a.value_len)) {
+            a.fragment = fragment;
+            a.line = line_no;
+            a.order = out->len;
+            lp_vec_push(*out, a);
+        }
+        p = nl ? nl + 1 : end;
+    }
+}
+
+static bool build_index(lp_kconfig_index *ix, char *const *fragments, size_t count,
+                        const char *config_path, uint64_t stamp, const char *cache_path) {
+    lp_mapped_file *maps = (lp_mapped_file *)calloc(count + 1, sizeof(lp_mapped_file));
+    assignment_vec merged;
+    lp_vec_init(merged);
+    size_t readable = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!lp_map_file(fragments[i], &maps[i])) continue;
+        readable++;
+        scan_file(&maps[i], (uint32_t)i, &merged);
+    }
+
+    lp_strtab_builder b;
+    lp_strtab_builder_init(&b);
+
+    /* Origins: every assignment to a symbol, in merge order */
+    if (merged.len) qsort(merged.items, merged.len, sizeof(assignment), cmp_assignment);
+    lp_string origins = lp_string_new(256);
+    for (size_t i = 0; i < merged.len; ) {
+        size_t j = i;
+        lp_string_clear(&origins);
+        while (j < merged.len && merged.items[j].name_len == merged.items[i].name_len &&
+               memcmp(merged.items[j].name, merged.items[i].name, merged.items[i].name_len) == 0) {
+            char pos[32];
+            int n = snprintf(pos, sizeof(pos), "%u:%u:", merged.items[j].fragment,
+                             merged.items[j].line);
+            lp_string_append(&origins, pos, (size_t)n);
+            lp_string_append(&origins, merged.items[j].value, merged.items[j].value_len);
+            lp_string_append(&origins, "\n", 1);
+            j++;
+        }
+        lp_strtab_put(&b, LP_KC_ORIGINS, merged.items[i].name, merged.items[i].name_len,
+                      origins.data, origins.len);
+        i = j;
+    }
+    lp_string_free(&origins);
+    free(merged.items);
+
+    for (size_t i = 0; i < count; i++) {
+        char key[24];
+        int n = snprintf(key, sizeof(key), "%zu", i);
+        lp_strtab_put(&b, LP_KC_FRAGMENT, key, (size_t)n, fragments[i], strlen(fragments[i]));
+    }
+
+    /* Values that landed in the saved configuration */
+    if (config_path && lp_map_file(config_path, &maps[count])) {
+        readable++;
+        assignment_vec final;
+        lp_vec_init(final);
+        scan_file(&maps[count], 0, &final);
+        for (size_t i = 0; i < final.len; i++)
+            lp_strtab_put(&b, LP_KC_FINAL, final.items[i].name, final.items[i].name_len,
+                          final.items[i].value, final.items[i].value_len);
+        free(final.items);
+        lp_strtab_put(&b, LP_KC_FRAGMENT, "c", 1, config_path, strlen(config_path));
+    }
+
+    for (size_t i = 0; i <= count; i++) lp_unmap_file(&maps[i]);
+    free(maps);
+
+    if (readable == 0) {
+        lp_strtab_finish(&b, KC_MAGIC, stamp, 0, NULL, &ix->tab);
+        return false;
+    }
+    lp_strtab_finish(&b, KC_MAGIC, stamp, (uint32_t)count, cache_path, &ix->tab);
+    return ix->tab.slots != NULL;
+}
+
+/* ---- Opening ---- */
+
+bool lp_kconfig_index_open(lp_kconfig_index *ix, char *const *fragments, size_t count,
+                           const char *config_path, const char *cache_path) {
+    memset(ix, 0, sizeof(*ix));
+    uint64_t stamp = files_hash(fragments, count, config_path, true);
+    bool ok = cache_path && lp_strtab_open(&ix->tab, cache_path, KC_MAGIC, stamp);
+    if (!ok) {
+        ix->rebuilt = true;
+        ok = build_index(ix, fragments, count, config_path, stamp, cache_path);
+    }
+    if (!ok) {
+        lp_kconfig_index_close(ix);
+        return false;
+    }
+    ix->fragment_count = ix->tab.user;
+    ix->has_config = lp_strtab_get(&ix->tab, LP_KC_FRAGMENT, "c", 1) != NULL;
+    return true;
+}
+
+void lp_kconfig_index_close(lp_kconfig_index *ix) {
+    lp_strtab_close(&ix->tab);
+    memset(ix, 0, sizeof(*ix));
+}
+
+/* ---- Explaining ---- */
+
+static bool is_ident(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+/* Bare Kconfig-style name: upper case, digits and underscores */
+static bool is_symbol_name(const char *s, size_t len) {
+    if (len < 2 || !isupper((unsigned char)s[0])) return false;
+    for (size_t i = 0; i < len; i++)
+        if (!isupper((unsigned char)s[i]) && !isdigit((unsigned char)s[i]) && s[i] != '_')
+            return false;
+    return true;
+}
+
+/* "y (prj.conf:3), n (boards/x.conf:4)" */
+static void append_origins(const lp_kconfig_index *ix, const char *origins, lp_string *out) {
+    for (const char *p = origins; *p; ) {
+        const char *nl = strchr(p, '\n');
+        if (!nl) break;
+        const char *c1 = strchr(p, ':');
+        const char *c2 = c1 && c1 < nl ? strchr(c1 + 1, ':') : NULL;
+        if (!c2 || c2 > nl) break;
+        if (p != origins) lp_string_append_cstr(out, ", ");
+        lp_string_append(out, c2 + 1, (size_t)(nl - c2 - 1));
+        const char *path = lp_strtab_get(&ix->tab, LP_KC_FRAGMENT, p, (size_t)(c1 - p));
+        lp_string_append_cstr(out, " (");
+        lp_string_append_cstr(out, path ? path : "?");
+        lp_string_append(out, ":", 1);
+        lp_string_append(out, c1 + 1, (size_t)(c2 - c1 - 1));
+        lp_string_append(out, ")", 1);
+        p = nl + 1;
+    }
+}
+
+size_t lp_kconfig_explain(const lp_kconfig_index *ix, const char *line, lp_string *out) {
+    if (!ix->tab.slots) return 0;
+    size_t notes = 0;
+    lp_string seen = lp_string_new(64);
+    lp_string_append(&seen, " ", 1);
+
+    for (const char *p = line; *p; ) {
+        if (!is_ident(*p) || (p != line && is_ident(p[-1]))) {
+            p++;
+            continue;
+        }
+        size_t len = 0;
+        while (is_ident(p[len])) len++;
+        const char *sym = p;
+        p += len;
+
+        bool explicit_name = len > 7 && memcmp(sym, "CONFIG_", 7) == 0;
+        if (explicit_name) {
+            sym += 7;
+            len -= 7;
+        } else if (!is_symbol_name(sym, len)) {
+            continue;
+        }
+
+        const char *origins = lp_strtab_get(&ix->tab, LP_KC_ORIGINS, sym, len);
+        const char *final = lp_strtab_get(&ix->tab, LP_KC_FINAL, sym, len);
+        if (!origins && !final && !explicit_name) continue;
+
+        /* Once per symbol per line: seen holds " SYM " for each */
+        lp_string key = lp_string_new(len + 3);
+        lp_string_append(&key, " ", 1);
+        lp_string_append(&key, sym, len);
+        lp_string_append(&key, " ", 1);
+        bool dup = strstr(lp_string_cstr(&seen), lp_string_cstr(&key)) != NULL;
+        if (!dup) lp_string_append(&seen, key.data + 1, key.len - 1);
+        lp_string_free(&key);
+        if (dup) continue;
+
+        lp_string_append_cstr(out, "CONFIG_");
+        lp_string_append(out, sym, len);
+        lp_string_append_cstr(out, ": ");
+        if (origins) append_origins(ix, origins, out);
+        else lp_string_append_cstr(out, "not set in any fragment");
+        if (final) {
+            lp_string_append_cstr(out, " -> .config ");
+            lp_string_append_cstr(out, final);
+        } else if (ix->has_config) {
+            lp_string_append_cstr(out, " -> absent from .config");
+        }
+        lp_string_append(out, "\n", 1);
+        notes++;
+    }
+    lp_string_free(&seen);
+    return notes;
+}
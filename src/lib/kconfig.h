@@ -0,0 +1,59 @@
+/*
+ * kconfig.h — Kconfig symbol origin index for a Zephyr configuration
+ *
+ * Zephyr logs the configuration files it merges ("Loaded configuration
+ * '...'", "Merged configuration '...'", "Configuration saved to '...'").
+ * This indexes every assignment in those files once, symbol -> each
+ * file:line and value in merge order plus the value that landed in the
+ * saved .config, so a Kconfig warning can be annotated with where its
+ * symbols were set without searching the tree. The index is an lp_strtab
+ * cached per .config and stamped with the size and mtime of every file.
+ */
+#ifndef LP_KCONFIG_H
+#define LP_KCONFIG_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "util.h"
+#include "strtab.h"
+
+/* Kinds of key (symbol names are stored without the CONFIG_ prefix) */
+#define LP_KC_ORIGINS  's'   /* symbol   -> "<fragment>:<line>:<value>\n" per assignment */
+#define LP_KC_FINAL    'v'   /* symbol   -> value in the saved .config ("n" if not set) */
+#define LP_KC_FRAGMENT 'f'   /* fragment -> path, fragments numbered from 0 */
+
+typedef struct {
+    lp_strtab  tab;
+    size_t     fragment_count;
+    bool       has_config;   /* The saved .config was indexed too */
+    bool       rebuilt;      /* Cache was stale or missing */
+} lp_kconfig_index;
+
+/* Line is a Kconfig warning or error (one naming CONFIG_ symbols or
+   "(defined at ...)" locations) */
+bool lp_kconfig_is_warning(const char *line);
+
+/* Configuration files one Kconfig run in the log merged, in order. With
+   several runs (sysbuild images), the first run followed by a Kconfig
+   warning wins, else the last. *config_path gets the saved .config
+   (malloc'd, or NULL). Returns an array for lp_free_strings; NULL if the
+   log names no configuration files. */
+char **lp_kconfig_find_fragments(const char *const *lines, size_t count,
+                                 size_t *fragment_count, char **config_path);
+
+/* $LOGPILOT_CACHE/kconfig-<hash of the file list>.bin (see lp_cache_path).
+   Returns malloc'd path, or NULL. */
+char *lp_kconfig_default_path(char *const *fragments, size_t count, const char *config_path);
+
+/* Open the index, (re)building the cache at cache_path when stale. False
+   if none of the files can be read. */
+bool lp_kconfig_index_open(lp_kconfig_index *ix, char *const *fragments, size_t count,
+                           const char *config_path, const char *cache_path);
+void lp_kconfig_index_close(lp_kconfig_index *ix);
+
+/* Annotate the symbols a warning line names with their origins, one
+   newline-terminated note per symbol. Returns the note count. */
+size_t lp_kconfig_explain(const lp_kconfig_index *ix, const char *line, lp_string *out);
+
+#endif /* LP_KCONFIG_H */
@@ -0,0 +1,218 @@
+/*
+ * lineidx.c — Line indexer with fused encoding and length statistics
+ */
+#include "lineidx.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LP_LINEIDX_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define CHUNK 16
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static unsigned ctz32(unsigned x) {
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return (unsigned)i;
+}
+#else
+static unsigned ctz32(unsigned x) {
+    return (unsigned)__builtin_ctz(x);
+}
+#endif
+
+static unsigned popcount16(unsigned x) {
+    x = x - ((x >> 1) & 0x5555u);
+    x = (x & 0x3333u) + ((x >> 2) & 0x3333u);
+    x = (x + (x >> 4)) & 0x0f0fu;
+    return (x + (x >> 8)) & 0x1fu;
+}
+
+/* Per-byte bitmasks of one chunk (bit i = byte i) */
+typedef struct {
+    unsigned eol;    /* \n or \r */
+    unsigned high;   /* >= 0x80 */
+    unsigned ctrl;   /* C0 control, excluding \t \n \r \f ESC */
+    unsigned nul;
+} chunk_masks;
+
+static bool is_benign_ctrl(unsigned char c) {
+    return c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == 0x1b;
+}
+
+static void scan_chunk(const unsigned char *p, size_t n, chunk_masks *m) {
+#ifdef LP_LINEIDX_SSE2
+    if (n == CHUNK) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i lf = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+        __m128i cr = _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'));
+        __m128i benign = _mm_or_si128(_mm_or_si128(lf, cr),
+                         _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                         _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\f')),
+                                      _mm_cmpeq_epi8(v, _mm_set1_epi8(0x1b)))));
+        /* Signed compare: high bytes are negative, so mask them out below */
+        __m128i low = _mm_cmplt_epi8(v, _mm_set1_epi8(0x20));
+        m->eol  = (unsigned)_mm_movemask_epi8(_mm_or_si128(lf, cr));
+        m->high = (unsigned)_mm_movemask_epi8(v);
+        m->ctrl = (unsigned)_mm_movemask_epi8(low) & ~m->high &
+                  ~(unsigned)_mm_movemask_epi8(benign);
+        m->nul  = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+        return;
+    }
+#endif
+    m->eol = m->high = m->ctrl = m->nul = 0;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = p[i];
+        unsigned bit = 1u << i;
+        if (c == '\n' || c == '\r') m->eol |= bit;
+        if (c >= 0x80) m->high |= bit;
+        else if (c < 0x20 && !is_benign_ctrl(c)) m->ctrl |= bit;
+        if (c == 0) m->nul |= bit;
+    }
+}
+
+/* Length of the well-formed UTF-8 sequence at p, or 0 (overlongs,
+   surrogates and code points above U+10FFFF are rejected) */
+static size_t utf8_seq(const unsigned char *p, size_t avail) {
+    unsigned char c = p[0];
+    if (c < 0xC2 || c > 0xF4) return 0;
+    size_t n = c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+    if (avail < n) return 0;
+    unsigned char lo = 0x80, hi = 0xBF;
+    if (c == 0xE0) lo = 0xA0;
+    else if (c == 0xED) hi = 0x9F;
+    else if (c == 0xF0) lo = 0x90;
+    else if (c == 0xF4) hi = 0x8F;
+    if (p[1] < lo || p[1] > hi) return 0;
+    for (size_t i = 2; i < n; i++) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+    }
+    return n;
+}
+
+/* Validate [from, to); sequences may run past 'to', *done records where
+   validation stopped so the next chunk does not re-check them */
+static void validate_utf8(lp_line_index *idx, const unsigned char *u, size_t len,
+                          size_t from, size_t to, size_t *done) {
+    size_t p = from > *done ? from : *done;
+    while (p < to) {
+        if (u[p] < 0x80) {
+            p++;
+            continue;
+        }
+        size_t n = utf8_seq(u + p, len - p);
+        if (n == 0) {
+            if (idx->invalid_seqs++ == 0) idx->first_invalid = p;
+            idx->non_ascii_bytes++;
+            p++;
+        } else {
+            idx->non_ascii_bytes += n;
+            p += n;
+        }
+    }
+    *done = p;
+}
+
+static void add_line(lp_line_index *idx, size_t start, size_t len) {
+    if (idx->count >= idx->cap) {
+        idx->cap = idx->cap ? idx->cap * 2 : 1024;
+        idx->starts = (size_t *)realloc(idx->starts, idx->cap * sizeof(size_t));
+        idx->lengths = (size_t *)realloc(idx->lengths, idx->cap * sizeof(size_t));
+    }
+    idx->starts[idx->count] = start;
+    idx->lengths[idx->count] = len;
+    idx->count++;
+
+    idx->total_len += len;
+    if (len > idx->longest) idx->longest = len;
+    size_t b = 0;
+    for (size_t v = len; v && b < LP_LINE_HIST_BUCKETS - 1; v >>= 1) b++;
+    idx->hist[b]++;
+}
+
+void lp_line_index_build(lp_line_index *idx, const char *data, size_t len) {
+    memset(idx, 0, sizeof(*idx));
+    idx->first_invalid = (size_t)-1;
+    idx->bytes = len;
+
+    const unsigned char *u = (const unsigned char *)data;
+    size_t line_start = 0;
+    size_t validated = 0;
+    size_t skip_lf = (size_t)-1;   /* The \n of a CRLF already counted */
+
+    for (size_t base = 0; base < len; base += CHUNK) {
+        size_t n = len - base < CHUNK ? len - base : CHUNK;
+        chunk_masks m;
+        scan_chunk(u + base, n, &m);
+
+        if (m.nul) idx->nul_bytes += popcount16(m.nul);
+        if (m.ctrl) idx->ctrl_bytes += popcount16(m.ctrl);
+        if (m.high) validate_utf8(idx, u, len, base + ctz32(m.high), base + n, &validated);
+
+        unsigned eol = m.eol;
+        while (eol) {
+            size_t at = base + ctz32(eol);
+            eol &= eol - 1;
+            if (at == skip_lf) continue;
+            size_t next = at + 1;
+            if (u[at] == '\n') {
+                idx->lf++;
+            } else if (next < len && u[next] == '\n') {
+                idx->crlf++;
+                skip_lf = next++;
+            } else {
+                idx->cr++;
+            }
+            add_line(idx, line_start, at - line_start);
+            line_start = next;
+        }
+    }
+    if (line_start < len) add_line(idx, line_start, len - line_start);
+    idx->final_newline = len > 0 && (u[len - 1] == '\n' || u[len - 1] == '\r');
+}
+
+void lp_line_index_free(lp_line_index *idx) {
+    free(idx->starts);
+    free(idx->lengths);
+    idx->starts = idx->lengths = NULL;
+    idx->count = idx->cap = 0;
+}
+
+lp_encoding lp_line_index_encoding(const lp_line_index *idx) {
+    /* Logs carry the odd stray control byte; binary needs NULs or >1% */
+    if (idx->nul_bytes > 0 || idx->ctrl_bytes * 100 > idx->bytes) return LP_ENC_BINARY;
+    if (idx->invalid_seqs > 0) return LP_ENC_INVALID;
+    if (idx->non_ascii_bytes > 0) return LP_ENC_UTF8;
+    return LP_ENC_ASCII;
+}
+
+const char *lp_encoding_name(lp_encoding e) {
+    switch (e) {
+        case LP_ENC_ASCII:   return "ASCII";
+        case LP_ENC_UTF8:    return "UTF-8";
+        case LP_ENC_INVALID: return "invalid UTF-8";
+        case LP_ENC_BINARY:  return "binary";
+    }
+    return "unknown";
+}
+
+size_t lp_line_index_percentile(const lp_line_index *idx, double p) {
+    if (idx->count == 0) return 0;
+    size_t target = (size_t)(p * (double)idx->count);
+    if (target >= idx->count) target = idx->count - 1;
+    size_t seen = 0;
+    for (size_t b = 0; b < LP_LINE_HIST_BUCKETS; b++) {
+        seen += idx->hist[b];
+        if (seen > target) {
+            if (b == 0) return 0;
+            size_t upper = ((size_t)1 << b) - 1;
+            return b == LP_LINE_HIST_BUCKETS - 1 || upper > idx->longest ? idx->longest : upper;
+        }
+    }
+    return idx->longest;
+}
@@ -0,0 +1,53 @@
+/*
+ * lineidx.h — Line indexer with fused encoding and length statistics
+ *
+ * One pass over a buffer finds line boundaries (LF, CRLF or lone CR, as
+ * lp_readline splits them) and, from the same 16-byte chunks, classifies
+ * the content: ASCII runs are skipped with SSE2 where available, and only
+ * chunks with high-bit bytes go through the UTF-8 validator.
+ */
+#ifndef LP_LINEIDX_H
+#define LP_LINEIDX_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define LP_LINE_HIST_BUCKETS 16   /* 0 = empty, b = lengths [2^(b-1), 2^b) */
+
+typedef enum {
+    LP_ENC_ASCII,
+    LP_ENC_UTF8,
+    LP_ENC_INVALID,   /* Not UTF-8: usually Latin-1 or another 8-bit codepage */
+    LP_ENC_BINARY     /* NUL bytes or a high share of control characters */
+} lp_encoding;
+
+typedef struct {
+    size_t *starts;            /* Offset of each line */
+    size_t *lengths;           /* Excluding the terminator */
+    size_t  count;
+    size_t  cap;
+
+    size_t  lf, crlf, cr;      /* Terminators by kind */
+    bool    final_newline;
+    size_t  longest;
+    size_t  total_len;         /* Sum of line lengths */
+    size_t  hist[LP_LINE_HIST_BUCKETS];
+
+    size_t  bytes;             /* Buffer size */
+    size_t  non_ascii_bytes;
+    size_t  invalid_seqs;      /* Malformed UTF-8 sequences */
+    size_t  first_invalid;     /* Byte offset of the first, or (size_t)-1 */
+    size_t  nul_bytes;
+    size_t  ctrl_bytes;        /* C0 controls other than \t \n \r \f ESC */
+} lp_line_index;
+
+void lp_line_index_build(lp_line_index *idx, const char *data, size_t len);
+void lp_line_index_free(lp_line_index *idx);
+
+lp_encoding lp_line_index_encoding(const lp_line_index *idx);
+const char *lp_encoding_name(lp_encoding e);
+
+/* Upper bound of the histogram bucket holding the p-th percentile length */
+size_t lp_line_index_percentile(const lp_line_index *idx, double p);
+
+#endif /* LP_LINEIDX_H */
@@ -0,0 +1,226 @@
+/*
+ * memo.c — Persistent memo of fix matches per error line
+ *
+ * File layout (native byte order; it is a per-machine cache):
+ *   char     magic[8]      "LPMEMO1\0"
+ *   uint64_t generation
+ *   uint32_t slot_count    power of 2
+ *   uint32_t hit_count
+ *   lp_memo_slot slots[slot_count]
+ *   lp_memo_hit  hits[hit_count]
+ */
+#include "memo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char MEMO_MAGIC[8] = "LPMEMO1";
+
+typedef struct {
+    char     magic[8];
+    uint64_t generation;
+    uint32_t slot_count;
+    uint32_t hit_count;
+} memo_header;
+
+/* ---- Reading ---- */
+
+char *lp_memo_default_path(void) {
+    return lp_cache_path(LP_MEMO_NAME);
+}
+
+void lp_memo_open(lp_memo *m, const char *path, uint64_t generation) {
+    memset(m, 0, sizeof(*m));
+    m->path = strdup(path);
+    m->generation = generation;
+    if (!lp_map_file(path, &m->file)) return;
+
+    memo_header h;
+    if (m->file.len < sizeof(h)) return;
+    memcpy(&h, m->file.data, sizeof(h));
+    size_t want = sizeof(h) + (size_t)h.slot_count * sizeof(lp_memo_slot) +
+                  (size_t)h.hit_count * sizeof(lp_memo_hit);
+    if (memcmp(h.magic, MEMO_MAGIC, sizeof(h.magic)) != 0 || h.generation != generation ||
+        h.slot_count == 0 || (h.slot_count & (h.slot_count - 1)) != 0 || m->file.len != want)
+        return;
+
+    m->loaded = true;
+    m->slots = (const lp_memo_slot *)(m->file.data + sizeof(h));
+    m->slot_count = h.slot_count;
+    m->hits = (const lp_memo_hit *)(m->slots + h.slot_count);
+    m->hit_count = h.hit_count;
+}
+
+static const lp_memo_slot *probe(const lp_memo_slot *slots, size_t slot_count, uint64_t key) {
+    size_t mask = slot_count - 1;
+    for (size_t i = (size_t)key & mask, n = 0; n < slot_count; i = (i + 1) & mask, n++) {
+        if (slots[i].key == key) return &slots[i];
+        if (slots[i].key == 0) return NULL;
+    }
+    return NULL;
+}
+
+bool lp_memo_get(lp_memo *m, uint64_t key, const lp_memo_hit **hits, size_t *count) {
+    if (key == 0) key = 1;
+    m->lookups++;
+    if (m->loaded) {
+        const lp_memo_slot *s = probe(m->slots, m->slot_count, key);
+        if (s && (size_t)s->offset + s->count <= m->hit_count) {
+            *hits = m->hits + s->offset;
+            *count = s->count;
+            m->found++;
+            return true;
+        }
+    }
+    if (m->added_cap > 0) {
+        const lp_memo_slot *s = probe(m->added, m->added_cap, key);
+        if (s) {
+            *hits = m->added_hits + s->offset;
+            *count = s->count;
+            m->found++;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Slot holding key, else the empty slot it would go in (the table is
+   kept at most half full, so there is one) */
+static lp_memo_slot *slot_for(lp_memo_slot *slots, size_t slot_count, uint64_t key) {
+    size_t mask = slot_count - 1;
+    size_t i = (size_t)key & mask;
+    while (slots[i].key != 0 && slots[i].key != key) i = (i + 1) & mask;
+    return &slots[i];
+}
+
+static void grow_added(lp_memo *m) {
+    size_t cap = m->added_cap ? m->added_cap * 2 : 64;
+    lp_memo_slot *slots = (lp_memo_slot *)calloc(cap, sizeof(lp_memo_slot));
+    for (size_t i = 0; i < m->added_cap; i++) {
+        if (m->added[i].key != 0) *slot_for(slots, cap, m->added[i].key) = m->added[i];
+    }
+    free(m->added);
+    m->added = slots;
+    m->added_cap = cap;
+}
+
+void lp_memo_put(lp_memo *m, uint64_t key, const lp_memo_hit *hits, size_t count) {
+    if (key == 0) key = 1;
+    if ((m->added_count + 1) * 2 > m->added_cap) grow_added(m);
+    while (m->added_hit_count + count > m->added_hit_cap) {
+        m->added_hit_cap = m->added_hit_cap ? m->added_hit_cap * 2 : 64;
+        m->added_hits = (lp_memo_hit *)realloc(m->added_hits,
+                                               m->added_hit_cap * sizeof(lp_memo_hit));
+    }
+    lp_memo_slot *s = slot_for(m->added, m->added_cap, key);
+    if (s->key == 0) {
+        s->key = key;
+        m->added_count++;
+    }
+    s->offset = (uint32_t)m->added_hit_count;
+    s->count = (uint32_t)count;
+    if (count) memcpy(m->added_hits + m->added_hit_count, hits, count * sizeof(lp_memo_hit));
+    m->added_hit_count += count;
+}
+
+/* ---- Writing ---- */
+
+typedef struct {
+    lp_memo_slot *slots;
+    size_t        slot_count;
+    lp_memo_hit  *hits;
+    size_t        hit_count;
+} memo_table;
+
+static void table_insert(memo_table *t, uint64_t key, const lp_memo_hit *hits, uint32_t count) {
+    lp_memo_slot *s = slot_for(t->slots, t->slot_count, key);
+    if (s->key == key) return;
+    s->key = key;
+    s->offset = (uint32_t)t->hit_count;
+    s->count = count;
+    if (count) memcpy(t->hits + t->hit_count, hits, count * sizeof(lp_memo_hit));
+    t->hit_count += count;
+}
+
+static bool write_table(const char *path, uint64_t generation, const memo_table *t) {
+    char tmp[1100];
+#ifdef _WIN32
+    snprintf(tmp, sizeof(tmp), "%s.tmp%d", path, _getpid());
+#else
+    snprintf(tmp, sizeof(tmp), "%s.tmp%d", path, (int)getpid());
+#endif
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) return false;
+
+    memo_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MEMO_MAGIC, sizeof(h.magic));
+    h.generation = generation;
+    h.slot_count = (uint32_t)t->slot_count;
+    h.hit_count = (uint32_t)t->hit_count;
+    bool ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+              fwrite(t->slots, sizeof(lp_memo_slot), t->slot_count, fp) == t->slot_count &&
+              fwrite(t->hits, sizeof(lp_memo_hit), t->hit_count, fp) == t->hit_count;
+    if (fclose(fp) != 0) ok = false;
+#ifdef _WIN32
+    if (ok) ok = MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    if (ok) ok = rename(tmp, path) == 0;
+#endif
+    if (!ok) remove(tmp);
+    return ok;
+}
+
+void lp_memo_close(lp_memo *m) {
+    if (m->added_count > 0) {
+        /* Keep the old entries unless that would overflow the memo */
+        size_t old_entries = 0;
+        if (m->loaded) {
+            for (size_t i = 0; i < m->slot_count; i++) old_entries += m->slots[i].key != 0;
+            if (old_entries + m->added_count > LP_MEMO_MAX_ENTRIES) old_entries = 0;
+        }
+        size_t entries = old_entries + m->added_count;
+        size_t slot_count = 64;
+        while (slot_count < entries * 2) slot_count <<= 1;
+
+        memo_table t;
+        t.slots = (lp_memo_slot *)calloc(slot_count, sizeof(lp_memo_slot));
+        t.slot_count = slot_count;
+        size_t hit_cap = (old_entries ? m->hit_count : 0) + m->added_hit_count + 1;
+        t.hits = (lp_memo_hit *)malloc(hit_cap * sizeof(lp_memo_hit));
+        t.hit_count = 0;
+
+        for (size_t i = 0; i < m->added_cap; i++) {
+            const lp_memo_slot *s = &m->added[i];
+            if (s->key != 0) table_insert(&t, s->key, m->added_hits + s->offset, s->count);
+        }
+        if (old_entries) {
+            for (size_t i = 0; i < m->slot_count; i++) {
+                const lp_memo_slot *s = &m->slots[i];
+                if (s->key != 0 && (size_t)s->offset + s->count <= m->hit_count)
+                    table_insert(&t, s->key, m->hits + s->offset, s->count);
+            }
+        }
+
+        /* Release the mapping first: Windows cannot replace a mapped file */
+        lp_unmap_file(&m->file);
+        lp_make_parent_dirs(m->path);
+        write_table(m->path, m->generation, &t);
+        free(t.slots);
+        free(t.hits);
+    }
+
+    lp_unmap_file(&m->file);
+    free(m->added);
+    free(m->added_hits);
+    free(m->path);
+    memset(m, 0, sizeof(*m));
+}
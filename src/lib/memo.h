@@ -0,0 +1,74 @@
+/*
+ * memo.h — Persistent memo of fix matches per error line
+ *
+ * Maps a 64-bit hash of an error line to the ranked fix ids matching
+ * produced for it, so errors that recur across builds skip the database
+ * scan. The file is an open-addressing hash table that is mapped and
+ * probed in place; it is stamped with the fix database generation
+ * (lp_fix_db_generation) and ignored once the database changes.
+ * New entries are merged in on close, written to a temp file and renamed
+ * over the old memo: concurrent writers may lose each other's entries,
+ * but a reader never sees a partial table.
+ */
+#ifndef LP_MEMO_H
+#define LP_MEMO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "util.h"
+
+#define LP_MEMO_NAME        "match-memo.bin"
+#define LP_MEMO_MAX_ENTRIES 16384   /* Past this, old entries are dropped */
+
+typedef struct {
+    uint32_t id;           /* Index into the fix array */
+    float    confidence;
+} lp_memo_hit;
+
+typedef struct {
+    uint64_t key;          /* 0 = empty slot */
+    uint32_t offset;       /* First hit in the hit array */
+    uint32_t count;
+} lp_memo_slot;
+
+typedef struct {
+    char               *path;
+    uint64_t            generation;
+
+    lp_mapped_file      file;        /* Table as last written */
+    bool                loaded;      /* file is a table of this generation */
+    const lp_memo_slot *slots;
+    size_t              slot_count;  /* Power of 2 */
+    const lp_memo_hit  *hits;
+    size_t              hit_count;
+
+    lp_memo_slot       *added;       /* Entries from this run, hashed like slots */
+    size_t              added_count;
+    size_t              added_cap;   /* Power of 2, or 0 before the first put */
+    lp_memo_hit        *added_hits;
+    size_t              added_hit_count;
+    size_t              added_hit_cap;
+
+    size_t              lookups;
+    size_t              found;
+} lp_memo;
+
+/* $LOGPILOT_CACHE/match-memo.bin, else ~/.logpilot/cache/match-memo.bin.
+   Returns malloc'd path, or NULL if neither is available. */
+char *lp_memo_default_path(void);
+
+/* Open the memo at path for a database generation. A missing, foreign or
+   stale file gives an empty memo. */
+void lp_memo_open(lp_memo *m, const char *path, uint64_t generation);
+
+/* Write back any new entries, then release the memo */
+void lp_memo_close(lp_memo *m);
+
+/* Look up key: true with the ranked hits (possibly none) if memoised */
+bool lp_memo_get(lp_memo *m, uint64_t key, const lp_memo_hit **hits, size_t *count);
+
+void lp_memo_put(lp_memo *m, uint64_t key, const lp_memo_hit *hits, size_t count);
+
+#endif /* LP_MEMO_H */
@@ -55,6 +55,16 @@ static char *parse_string(const char **p) {
     return s;
 }
 
+/* Parse a bare (unquoted) scalar: true, false, 42.
+   Returns malloc'd string with trailing comment/whitespace removed. */
+static char *parse_bare(const char **p) {
+    const char *start = *p;
+    while (**p && **p != '\n' && **p != '#') (*p)++;
+    const char *end = *p;
+    while (end > start && isspace((unsigned char)end[-1])) end--;
+    return lp_strdup_range(start, 0, (size_t)(end - start));
+}
+
 /* Parse a string array: ["a", "b", "c"]
    Returns malloc'd array of malloc'd strings. Sets *count. */
 static char **parse_string_array(const char **p, size_t *count) {
@@ -87,6 +97,18 @@ static char **parse_string_array(const char **p, size_t *count) {
     return arr;
 }
 
+const float LP_SCORE_DEFAULTS[LP_SF_COUNT] = {
+    [LP_SF_ERROR]        = 10.0f,
+    [LP_SF_WARNING]      = 5.0f,
+    [LP_SF_DATA]         = 2.0f,
+    [LP_SF_PHASE]        = 1.0f,
+    [LP_SF_PROGRESS]     = 0.5f,
+    [LP_SF_KEYWORD]      = 3.0f,
+    [LP_SF_TRIGGER]      = 1.0f,
+    [LP_SF_CLI_KEYWORD]  = 3.0f,
+    [LP_SF_FREQ_OUTLIER] = 2.0f,
+};
+
 /* Assign a string array to a mode field */
 static void assign_array(const char *section, const char *key, char **values, size_t count,
                          lp_mode *m) {
@@ -109,6 +131,18 @@ static void assign_array(const char *section, const char *key, char **values, si
         if (strcmp(key, "boilerplate_patterns") == 0) {
             m->boilerplate_patterns = values; m->boilerplate_count = count; return;
         }
+        if (strcmp(key, "segment_start_patterns") == 0) {
+            m->segment_start_patterns = values; m->segment_start_count = count; return;
+        }
+        if (strcmp(key, "segment_end_patterns") == 0) {
+            m->segment_end_patterns = values; m->segment_end_count = count; return;
+        }
+        if (strcmp(key, "nest_begin_patterns") == 0) {
+            m->nest_begin_patterns = values; m->nest_begin_count = count; return;
+        }
+        if (strcmp(key, "nest_end_patterns") == 0) {
+            m->nest_end_patterns = values; m->nest_end_count = count; return;
+        }
     }
     if (strcmp(section, "interest") == 0) {
         if (strcmp(key, "keywords") == 0) {
@@ -129,6 +163,9 @@ static void assign_array(const char *section, const char *key, char **values, si
             m->keep_once_contains = values; m->keep_once_count = count; return;
         }
     }
+    if (strcmp(section, "summary") == 0 && strcmp(key, "tail_markers") == 0) {
+        m->tail_markers = values; m->tail_marker_count = count; return;
+    }
     /* Unrecognized — free */
     (void)dst;
     (void)dst_count;
@@ -141,6 +178,7 @@ lp_mode *lp_mode_load(const char *path) {
     if (!data) return NULL;
 
     lp_mode *m = (lp_mode *)calloc(1, sizeof(lp_mode));
+    memcpy(m->score_weights, LP_SCORE_DEFAULTS, sizeof(m->score_weights));
     char section[64] = "";
 
     const char *p = data;
@@ -202,6 +240,8 @@ lp_mode *lp_mode_load(const char *path) {
                     free(m->memory_pattern); m->memory_pattern = val;
                 } else if (strcmp(section, "summary") == 0 && strcmp(key, "output_pattern") == 0) {
                     free(m->output_pattern); m->output_pattern = val;
+                } else if (strcmp(section, "plugin") == 0 && strcmp(key, "path") == 0) {
+                    free(m->plugin_path); m->plugin_path = val;
                 } else {
                     free(val);
                 }
@@ -213,6 +253,22 @@ lp_mode *lp_mode_load(const char *path) {
             if (arr) {
                 assign_array(section, key, arr, count, m);
             }
+        } else {
+            /* Bare value: boolean or number */
+            char *val = parse_bare(&p);
+            lp_score_feature sf = lp_score_feature_find(key);
+            if (strcmp(section, "score") == 0 && sf < LP_SF_COUNT) {
+                m->score_weights[sf] = strtof(val, NULL);
+            } else if (strcmp(section, "summary") == 0 && strcmp(key, "tail_resident") == 0) {
+                m->tail_resident = (strcmp(val, "true") == 0);
+            } else if (strcmp(section, "summary") == 0 && strcmp(key, "tail_scan_lines") == 0) {
+                m->tail_scan_lines = (size_t)strtoul(val, NULL, 10);
+            } else if (strcmp(section, "enrich") == 0 && strcmp(key, "devicetree") == 0) {
+                m->enrich_devicetree = (strcmp(val, "true") == 0);
+            } else if (strcmp(section, "enrich") == 0 && strcmp(key, "kconfig") == 0) {
+                m->enrich_kconfig = (strcmp(val, "true") == 0);
+            }
+            free(val);
         }
 
         skip_line(&p);
@@ -223,7 +279,7 @@ lp_mode *lp_mode_load(const char *path) {
 }
 
 void lp_mode_free(lp_mode *m) {
-    if (!m) return;
+    if (!m || m->builtin) return;
     free(m->name);
     free(m->description);
     lp_free_strings(m->signatures, m->sig_count);
@@ -234,6 +290,10 @@ void lp_mode_free(lp_mode *m) {
     lp_free_strings(m->error_patterns, m->error_count);
     lp_free_strings(m->warning_patterns, m->warning_count);
     lp_free_strings(m->boilerplate_patterns, m->boilerplate_count);
+    lp_free_strings(m->segment_start_patterns, m->segment_start_count);
+    lp_free_strings(m->segment_end_patterns, m->segment_end_count);
+    lp_free_strings(m->nest_begin_patterns, m->nest_begin_count);
+    lp_free_strings(m->nest_end_patterns, m->nest_end_count);
     lp_free_strings(m->drop_contains, m->drop_count);
     lp_free_strings(m->keep_once_contains, m->keep_once_count);
     free(m->progress_pattern);
@@ -243,6 +303,8 @@ void lp_mode_free(lp_mode *m) {
     free(m->overlay_pattern);
     free(m->memory_pattern);
     free(m->output_pattern);
+    lp_free_strings(m->tail_markers, m->tail_marker_count);
+    free(m->plugin_path);
     free(m);
 }
 
@@ -277,6 +339,72 @@ void lp_modes_free(lp_mode **modes, size_t count) {
     free(modes);
 }
 
+/* ---- Pattern sets ---- */
+
+char **lp_mode_patterns(const lp_mode *m, lp_pattern_set set, size_t *count) {
+    switch (set) {
+        case LP_PAT_SIGNATURES:  *count = m->sig_count;         return m->signatures;
+        case LP_PAT_KEYWORDS:    *count = m->keyword_count;     return m->keywords;
+        case LP_PAT_TRIGGERS:    *count = m->trigger_count;     return m->block_triggers;
+        case LP_PAT_PHASES:      *count = m->phase_count;       return m->phase_markers;
+        case LP_PAT_ERRORS:      *count = m->error_count;       return m->error_patterns;
+        case LP_PAT_WARNINGS:    *count = m->warning_count;     return m->warning_patterns;
+        case LP_PAT_DROP:        *count = m->drop_count;        return m->drop_contains;
+        case LP_PAT_BOILERPLATE: *count = m->boilerplate_count; return m->boilerplate_patterns;
+        case LP_PAT_KEEP_ONCE:   *count = m->keep_once_count;   return m->keep_once_contains;
+        case LP_PAT_COUNT:       break;
+    }
+    *count = 0;
+    return NULL;
+}
+
+bool lp_pattern_set_ci(lp_pattern_set set) {
+    return set == LP_PAT_TRIGGERS || set == LP_PAT_ERRORS || set == LP_PAT_WARNINGS;
+}
+
+const char *lp_pattern_set_name(lp_pattern_set set) {
+    static const char *names[LP_PAT_COUNT] = {
+        "signatures", "keywords", "triggers", "phases", "errors",
+        "warnings", "drop", "boilerplate", "keep_once"
+    };
+    return set < LP_PAT_COUNT ? names[set] : "unknown";
+}
+
+static const char *SCORE_FEATURE_NAMES[LP_SF_COUNT] = {
+    "error", "warning", "data", "phase", "progress",
+    "keyword", "trigger", "cli_keyword", "freq_outlier"
+};
+
+const char *lp_score_feature_name(lp_score_feature f) {
+    return f < LP_SF_COUNT ? SCORE_FEATURE_NAMES[f] : "unknown";
+}
+
+lp_score_feature lp_score_feature_find(const char *name) {
+    for (int f = 0; f < LP_SF_COUNT; f++) {
+        if (strcmp(name, SCORE_FEATURE_NAMES[f]) == 0) return (lp_score_feature)f;
+    }
+    return LP_SF_COUNT;
+}
+
+size_t lp_mode_match(const lp_mode *m, lp_pattern_set set, const char *line,
+                     bool first_only) {
+    if (!m || !line) return 0;
+    if (m->matchers && m->matchers->fn[set])
+        return m->matchers->fn[set](line, first_only);
+
+    size_t count;
+    char **pats = lp_mode_patterns(m, set, &count);
+    bool ci = lp_pattern_set_ci(set);
+    size_t found = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (ci ? lp_str_contains_ci(line, pats[i]) : lp_str_contains(line, pats[i])) {
+            found++;
+            if (first_only) break;
+        }
+    }
+    return found;
+}
+
 const char *lp_mode_detect(const char **first_lines, size_t line_count,
                            lp_mode **modes, size_t mode_count) {
     const char *best_name = "generic";
@@ -286,10 +414,8 @@ const char *lp_mode_detect(const char **first_lines, size_t line_count,
         if (!modes[m]->signatures || modes[m]->sig_count == 0) continue;
         int score = 0;
         for (size_t l = 0; l < line_count; l++) {
-            for (size_t s = 0; s < modes[m]->sig_count; s++) {
-                if (lp_str_contains(first_lines[l], modes[m]->signatures[s]))
-                    score++;
-            }
+            score += (int)lp_mode_match(modes[m], LP_PAT_SIGNATURES,
+                                        first_lines[l], false);
         }
         if (score > best_score) {
             best_score = score;
@@ -7,6 +7,47 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+/* Literal pattern sets a mode matches lines against */
+typedef enum {
+    LP_PAT_SIGNATURES,
+    LP_PAT_KEYWORDS,
+    LP_PAT_TRIGGERS,      /* Case-insensitive */
+    LP_PAT_PHASES,
+    LP_PAT_ERRORS,        /* Case-insensitive */
+    LP_PAT_WARNINGS,      /* Case-insensitive */
+    LP_PAT_DROP,
+    LP_PAT_BOILERPLATE,
+    LP_PAT_KEEP_ONCE,
+    LP_PAT_COUNT
+} lp_pattern_set;
+
+/* Signals summed into a segment's interest score, each multiplied by a
+   weight from the mode's [score] section (keys are lp_score_feature_name) */
+typedef enum {
+    LP_SF_ERROR,          /* Segment type base scores */
+    LP_SF_WARNING,
+    LP_SF_DATA,
+    LP_SF_PHASE,
+    LP_SF_PROGRESS,
+    LP_SF_KEYWORD,        /* Per mode keyword found */
+    LP_SF_TRIGGER,        /* Per block trigger found */
+    LP_SF_CLI_KEYWORD,    /* Per --keywords match */
+    LP_SF_FREQ_OUTLIER,   /* Per very frequent or unique line */
+    LP_SF_COUNT
+} lp_score_feature;
+
+extern const float LP_SCORE_DEFAULTS[LP_SF_COUNT];
+
+/* Specialised matcher emitted by lpmodec for one pattern set. Returns the
+   number of distinct patterns found in line, stopping at the first one
+   when first_only is set. */
+typedef size_t (*lp_literal_match_fn)(const char *line, bool first_only);
+
+/* Generated matchers of a built-in mode (NULL entry = interpret patterns) */
+struct lp_mode_matchers {
+    lp_literal_match_fn fn[LP_PAT_COUNT];
+};
+
 /* Build system mode configuration */
 typedef struct lp_mode {
     char  *name;
@@ -29,6 +70,19 @@ typedef struct lp_mode {
     char **boilerplate_patterns;
     size_t boilerplate_count;
 
+    /* Declarative segmentation rules (regex), compiled by segment.c into
+       its state machine: a start line opens a new segment, an end line
+       closes the current one after itself, and nest_begin[i] ...
+       nest_end[i] pairs keep a block whole across blank lines */
+    char **segment_start_patterns;
+    size_t segment_start_count;
+    char **segment_end_patterns;
+    size_t segment_end_count;
+    char **nest_begin_patterns;
+    size_t nest_begin_count;
+    char **nest_end_patterns;
+    size_t nest_end_count;
+
     /* Elision: lines matching these are silently dropped (never shown) */
     char **drop_contains;
     size_t drop_count;
@@ -43,6 +97,31 @@ typedef struct lp_mode {
     char  *overlay_pattern;
     char  *memory_pattern;
     char  *output_pattern;
+
+    /* Tail-resident summary: the key facts sit at the end of the log, so a
+       summary-only run scans backwards from EOF instead of reading it all */
+    bool   tail_resident;
+    char **tail_markers;      /* Header line of the trailing summary section */
+    size_t tail_marker_count;
+    size_t tail_scan_lines;   /* Max lines scanned back from EOF (0 = default) */
+
+    /* Native plugin (shared object implementing plugin_api.h) */
+    char  *plugin_path;
+
+    /* Enrichment: resolve devicetree references in error segments against
+       the build directory's generated files (dtindex.h) */
+    bool   enrich_devicetree;
+    /* ...and annotate Kconfig warnings with where their symbols were set
+       in the merged configuration files (kconfig.h) */
+    bool   enrich_kconfig;
+
+    /* Interest score weights, LP_SCORE_DEFAULTS unless [score] overrides */
+    float  score_weights[LP_SF_COUNT];
+
+    /* Built-in modes are static tables compiled in by lpmodec */
+    bool   builtin;            /* Static storage — lp_mode_free() ignores it */
+    bool   overrides_builtin;  /* Loaded from TOML, shadowing a built-in */
+    const struct lp_mode_matchers *matchers;
 } lp_mode;
 
 /* Load a single mode from a TOML file. Returns NULL on error. */
@@ -57,6 +136,20 @@ lp_mode **lp_mode_load_dir(const char *dir, size_t *count);
 /* Free an array of modes */
 void lp_modes_free(lp_mode **modes, size_t count);
 
+/* Patterns of one set, its case sensitivity, and its name in generated code */
+char      **lp_mode_patterns(const lp_mode *m, lp_pattern_set set, size_t *count);
+bool        lp_pattern_set_ci(lp_pattern_set set);
+const char *lp_pattern_set_name(lp_pattern_set set);
+
+/* [score] key of a feature, and the reverse lookup (LP_SF_COUNT if unknown) */
+const char      *lp_score_feature_name(lp_score_feature f);
+lp_score_feature lp_score_feature_find(const char *name);
+
+/* Number of distinct patterns of a set contained in line (at most 1 when
+   first_only). Uses the generated matcher when the mode has one. */
+size_t lp_mode_match(const lp_mode *m, lp_pattern_set set, const char *line,
+                     bool first_only);
+
 /* Auto-detect: sniff first N lines against all loaded modes.
    Returns the best-matching mode name (from modes array), or "generic".
    The returned pointer is owned by the modes array. */
@@ -0,0 +1,213 @@
+/*
+ * pipeline.c — In-process reduction pipeline for mode evaluation
+ */
+#include "pipeline.h"
+#include "segment.h"
+#include "dedup.h"
+#include "score.h"
+#include "budget.h"
+#include "token.h"
+#include "util.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PIPELINE_RESERVE_TOKENS 200   /* Same reserve logparse packs with */
+#define PIPELINE_MIN_CONTEXT    3.0f  /* logparse hides lower-scoring context */
+
+struct lp_pipeline {
+    const char   **lines;
+    size_t         count;
+    const lp_mode *mode;
+    lp_segment    *segs;
+    size_t         seg_count;
+    float        (*features)[LP_SF_COUNT];
+    uint8_t       *stage;        /* lp_fate_stage deciding each line under the base mode */
+    uint8_t       *fate;
+    uint8_t       *truth;        /* 1 = error line, 2 = warning line */
+    size_t         error_lines;
+    size_t         warning_lines;
+    size_t        *tokens;
+    size_t         words;        /* Bitset words per literal */
+    LP_VEC(uint64_t *) literals;
+    LP_VEC(uint64_t *) strip_keys;
+};
+
+static const char *GENERIC_ERRORS[] = { "error:", "fatal:", "FAILED", "undefined reference" };
+#define GENERIC_ERROR_COUNT (sizeof(GENERIC_ERRORS) / sizeof(GENERIC_ERRORS[0]))
+
+/* Ground truth: the same error/warning notion segment typing uses */
+static uint8_t truth_of(const char *line, const lp_mode *mode) {
+    if (mode && lp_mode_match(mode, LP_PAT_ERRORS, line, true)) return 1;
+    if (mode && lp_mode_match(mode, LP_PAT_WARNINGS, line, true)) return 2;
+    for (size_t i = 0; i < GENERIC_ERROR_COUNT; i++) {
+        if (lp_str_contains_ci(line, GENERIC_ERRORS[i])) return 1;
+    }
+    return lp_str_contains_ci(line, "warning:") ? 2 : 0;
+}
+
+lp_pipeline *lp_pipeline_prepare(const char **lines, size_t count, const lp_mode *mode) {
+    lp_pipeline *p = (lp_pipeline *)calloc(1, sizeof(lp_pipeline));
+    p->lines = lines;
+    p->count = count;
+    p->mode = mode;
+    p->words = (count + 63) / 64;
+    lp_vec_init(p->literals);
+    lp_vec_init(p->strip_keys);
+
+    p->stage = (uint8_t *)malloc(count ? count : 1);
+    p->fate = (uint8_t *)malloc(count ? count : 1);
+    p->truth = (uint8_t *)malloc(count ? count : 1);
+    p->tokens = (size_t *)malloc((count ? count : 1) * sizeof(size_t));
+    for (size_t i = 0; i < count; i++) {
+        lp_fate_stage st;
+        p->fate[i] = (uint8_t)lp_line_fate_stage(lines[i], (const struct lp_mode *)mode, &st);
+        p->stage[i] = (uint8_t)st;
+        p->truth[i] = truth_of(lines[i], mode);
+        if (p->truth[i] == 1) p->error_lines++;
+        if (p->truth[i] == 2) p->warning_lines++;
+        p->tokens[i] = lp_estimate_tokens(lines[i], strlen(lines[i]));
+    }
+
+    /* Segments and their score features never depend on the candidates */
+    const char **strip = mode ? (const char **)mode->strip_patterns : NULL;
+    size_t strip_count = mode ? mode->strip_count : 0;
+    lp_dedup_table dedup;
+    lp_dedup_init(&dedup, count / 2 + 64);
+    for (size_t i = 0; i < count; i++)
+        lp_dedup_insert(&dedup, lines[i], i, strip, strip_count);
+    p->segs = lp_segment_detect(lines, count, (const struct lp_mode *)mode, &p->seg_count);
+    p->features = (float (*)[LP_SF_COUNT])calloc(p->seg_count ? p->seg_count : 1,
+                                                 sizeof(*p->features));
+    for (size_t s = 0; s < p->seg_count; s++)
+        lp_score_features(&p->segs[s], (const struct lp_mode *)mode, NULL, 0, &dedup,
+                          p->features[s]);
+    lp_dedup_free(&dedup);
+
+    lp_pipeline_add_strip_set(p, NULL, 0);
+    return p;
+}
+
+void lp_pipeline_free(lp_pipeline *p) {
+    if (!p) return;
+    for (size_t i = 0; i < p->literals.len; i++) free(p->literals.items[i]);
+    for (size_t i = 0; i < p->strip_keys.len; i++) free(p->strip_keys.items[i]);
+    lp_vec_free(p->literals);
+    lp_vec_free(p->strip_keys);
+    lp_segments_free(p->segs, p->seg_count);
+    free(p->features);
+    free(p->stage);
+    free(p->fate);
+    free(p->truth);
+    free(p->tokens);
+    free(p);
+}
+
+size_t lp_pipeline_add_literal(lp_pipeline *p, const char *literal) {
+    uint64_t *bits = (uint64_t *)calloc(p->words ? p->words : 1, sizeof(uint64_t));
+    for (size_t i = 0; i < p->count; i++) {
+        if (lp_str_contains(p->lines[i], literal))
+            bits[i / 64] |= 1ULL << (i % 64);
+    }
+    lp_vec_push(p->literals, bits);
+    return p->literals.len - 1;
+}
+
+size_t lp_pipeline_add_strip_set(lp_pipeline *p, const char **extra, size_t extra_count) {
+    size_t base = p->mode ? p->mode->strip_count : 0;
+    const char **pats = (const char **)malloc((base + extra_count + 1) * sizeof(char *));
+    for (size_t i = 0; i < base; i++) pats[i] = p->mode->strip_patterns[i];
+    for (size_t i = 0; i < extra_count; i++) pats[base + i] = extra[i];
+
+    uint64_t *keys = (uint64_t *)malloc((p->count ? p->count : 1) * sizeof(uint64_t));
+    for (size_t i = 0; i < p->count; i++) {
+        char *norm = lp_normalize_line(p->lines[i], pats, base + extra_count);
+        keys[i] = lp_fnv1a(norm, strlen(norm)) | 1;   /* 0 marks an empty slot */
+        free(norm);
+    }
+    free(pats);
+    lp_vec_push(p->strip_keys, keys);
+    return p->strip_keys.len - 1;
+}
+
+void lp_pipeline_config_init(lp_pipeline_config *cfg, const lp_mode *mode) {
+    memset(cfg, 0, sizeof(*cfg));
+    memcpy(cfg->weights, mode ? mode->score_weights : LP_SCORE_DEFAULTS, sizeof(cfg->weights));
+}
+
+static bool any_bit(const lp_pipeline *p, const size_t *idx, size_t n, size_t line) {
+    for (size_t k = 0; k < n; k++) {
+        if (p->literals.items[idx[k]][line / 64] & (1ULL << (line % 64))) return true;
+    }
+    return false;
+}
+
+/* Candidate drops only reach lines the base mode decides after its drop
+   group, keep-once candidates only lines decided after keep-once */
+static lp_fate eval_fate(const lp_pipeline *p, const lp_pipeline_config *cfg, size_t i) {
+    lp_fate_stage st = (lp_fate_stage)p->stage[i];
+    if (st > LP_FATE_STAGE_DROP && any_bit(p, cfg->drop, cfg->drop_count, i))
+        return LP_FATE_DROP;
+    if (st > LP_FATE_STAGE_KEEP_ONCE && any_bit(p, cfg->keep_once, cfg->keep_once_count, i))
+        return LP_FATE_KEEP_ONCE;
+    return (lp_fate)p->fate[i];
+}
+
+/* First time this key is emitted? Open addressing over a power-of-2 table. */
+static bool key_first(uint64_t *set, size_t mask, uint64_t key) {
+    size_t idx = (size_t)(key & mask);
+    while (set[idx]) {
+        if (set[idx] == key) return false;
+        idx = (idx + 1) & mask;
+    }
+    set[idx] = key;
+    return true;
+}
+
+void lp_pipeline_eval(const lp_pipeline *p, const lp_pipeline_config *cfg,
+                      size_t budget_tokens, lp_pipeline_result *r) {
+    memset(r, 0, sizeof(*r));
+    r->lines = p->count;
+    r->error_lines = p->error_lines;
+    r->warning_lines = p->warning_lines;
+    if (p->seg_count == 0) return;
+
+    /* Re-score a private copy of the segments and pack it */
+    lp_segment *segs = (lp_segment *)malloc(p->seg_count * sizeof(lp_segment));
+    memcpy(segs, p->segs, p->seg_count * sizeof(lp_segment));
+    for (size_t s = 0; s < p->seg_count; s++)
+        segs[s].score = lp_score_weighted(segs[s].type, p->features[s], cfg->weights);
+    lp_budget_result packed = lp_budget_pack(segs, p->seg_count, budget_tokens,
+                                             PIPELINE_RESERVE_TOKENS);
+
+    size_t cap = 64;
+    while (cap < p->count * 2) cap <<= 1;
+    uint64_t *seen = (uint64_t *)calloc(cap, sizeof(uint64_t));
+    const uint64_t *keys = p->strip_keys.items[cfg->strip_set];
+
+    for (size_t b = 0; b < packed.count; b++) {
+        const lp_segment *seg = &segs[packed.indices[b]];
+        if (seg->type == LP_SEG_BUILD_PROGRESS || seg->type == LP_SEG_BOILERPLATE) continue;
+        bool diag = seg->type == LP_SEG_ERROR || seg->type == LP_SEG_WARNING;
+        if (!diag && seg->score < PIPELINE_MIN_CONTEXT) continue;
+
+        for (size_t l = 0; l < seg->line_count; l++) {
+            size_t i = seg->start_line + l;
+            if (i >= p->count) break;
+            lp_fate f = eval_fate(p, cfg, i);
+            if (f == LP_FATE_DROP && !(diag && lp_is_blank(p->lines[i]))) continue;
+            if (f == LP_FATE_KEEP_ONCE && !diag) continue;
+
+            if (p->truth[i] == 1) r->errors_kept++;
+            if (p->truth[i] == 2) r->warnings_kept++;
+            if (!key_first(seen, cap - 1, keys[i])) continue;   /* Shown as [xN] */
+            r->output_lines++;
+            r->output_tokens += p->tokens[i];
+        }
+    }
+
+    free(seen);
+    lp_budget_result_free(&packed);
+    free(segs);
+}
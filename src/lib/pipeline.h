@@ -0,0 +1,59 @@
+/*
+ * pipeline.h — In-process reduction pipeline for mode evaluation
+ *
+ * Measures what logparse's text body would keep of one log for a mode
+ * plus candidate additions, without printing it: dedup, segment, score,
+ * budget-pack, then line-fate filtering with repeated lines (by
+ * normalized key) counted once. Everything the candidates cannot change
+ * is computed once by lp_pipeline_prepare(); lp_pipeline_eval() only
+ * combines cached per-line fates, candidate match bitsets and per-segment
+ * score features, so evaluations are cheap and may run concurrently.
+ */
+#ifndef LP_PIPELINE_H
+#define LP_PIPELINE_H
+
+#include <stddef.h>
+#include "mode.h"
+
+typedef struct lp_pipeline lp_pipeline;
+
+typedef struct {
+    size_t lines;
+    size_t output_lines;
+    size_t output_tokens;
+    size_t error_lines;      /* Ground truth from the base mode */
+    size_t errors_kept;
+    size_t warning_lines;
+    size_t warnings_kept;
+} lp_pipeline_result;
+
+/* Candidate additions to evaluate, by index into the registered literals
+   and strip sets. Weights replace the mode's [score] weights. */
+typedef struct {
+    const size_t *drop;        /* Extra drop_contains literals */
+    size_t        drop_count;
+    const size_t *keep_once;   /* Extra keep_once_contains literals */
+    size_t        keep_once_count;
+    size_t        strip_set;   /* 0 = the mode's own strip_patterns */
+    float         weights[LP_SF_COUNT];
+} lp_pipeline_config;
+
+/* Analyse one log under the base mode. lines must outlive the pipeline. */
+lp_pipeline *lp_pipeline_prepare(const char **lines, size_t count, const lp_mode *mode);
+void         lp_pipeline_free(lp_pipeline *p);
+
+/* Register a literal (substring) candidate. Returns its index. */
+size_t lp_pipeline_add_literal(lp_pipeline *p, const char *literal);
+
+/* Register a strip set: the mode's strip_patterns followed by extra.
+   Runs the regex engine, so call it from one thread only. Returns its id. */
+size_t lp_pipeline_add_strip_set(lp_pipeline *p, const char **extra, size_t extra_count);
+
+/* Evaluate a configuration. Reads the pipeline only; thread-safe. */
+void lp_pipeline_eval(const lp_pipeline *p, const lp_pipeline_config *cfg,
+                      size_t budget_tokens, lp_pipeline_result *r);
+
+/* Config with the mode's weights and no additions */
+void lp_pipeline_config_init(lp_pipeline_config *cfg, const lp_mode *mode);
+
+#endif /* LP_PIPELINE_H */
@@ -0,0 +1,186 @@
+/*
+ * plugin.c — Native mode plugin loader
+ */
+#include "plugin.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+/* classify_line results and segment types must line up with lp_fate and
+   lp_seg_type */
+_Static_assert(LP_PLUGIN_KEEP == (int)LP_FATE_KEEP, "plugin fate mismatch");
+_Static_assert(LP_PLUGIN_KEEP_ONCE == (int)LP_FATE_KEEP_ONCE, "plugin fate mismatch");
+_Static_assert(LP_PLUGIN_DROP == (int)LP_FATE_DROP, "plugin fate mismatch");
+_Static_assert(LP_PLUGIN_SEG_ERROR == (int)LP_SEG_ERROR, "plugin segment type mismatch");
+_Static_assert(LP_PLUGIN_SEG_WARNING == (int)LP_SEG_WARNING, "plugin segment type mismatch");
+_Static_assert(LP_PLUGIN_SEG_INFO == (int)LP_SEG_INFO, "plugin segment type mismatch");
+_Static_assert(LP_PLUGIN_SEG_DATA == (int)LP_SEG_DATA, "plugin segment type mismatch");
+_Static_assert(LP_PLUGIN_SEG_PHASE == (int)LP_SEG_PHASE, "plugin segment type mismatch");
+_Static_assert(LP_PLUGIN_SEG_BUILD_PROGRESS == (int)LP_SEG_BUILD_PROGRESS,
+               "plugin segment type mismatch");
+_Static_assert(LP_PLUGIN_SEG_BOILERPLATE == (int)LP_SEG_BOILERPLATE,
+               "plugin segment type mismatch");
+_Static_assert(LP_PLUGIN_SEG_NORMAL == (int)LP_SEG_NORMAL, "plugin segment type mismatch");
+
+struct lp_plugin {
+    void                *handle;
+    const lp_plugin_api *api;
+    void                *ctx;
+};
+
+/* ---- Platform shims ---- */
+
+static void *lib_open(const char *path) {
+#ifdef _WIN32
+    return (void *)LoadLibraryA(path);
+#else
+    return dlopen(path, RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+static void lib_close(void *handle) {
+#ifdef _WIN32
+    FreeLibrary((HMODULE)handle);
+#else
+    dlclose(handle);
+#endif
+}
+
+static lp_plugin_entry_fn lib_entry(void *handle) {
+    lp_plugin_entry_fn fn = NULL;
+#ifdef _WIN32
+    FARPROC sym = GetProcAddress((HMODULE)handle, LP_PLUGIN_ENTRY);
+#else
+    void *sym = dlsym(handle, LP_PLUGIN_ENTRY);
+#endif
+    /* Object-to-function pointer conversion without a pedantic warning */
+    if (sym) memcpy(&fn, &sym, sizeof(fn));
+    return fn;
+}
+
+static const char *lib_error(void) {
+#ifdef _WIN32
+    return "LoadLibrary failed";
+#else
+    const char *e = dlerror();
+    return e ? e : "dlopen failed";
+#endif
+}
+
+/* Try path, then path + suffix */
+static void *open_candidate(const char *path) {
+    void *h = NULL;
+    if (lp_file_exists(path)) h = lib_open(path);
+    if (h) return h;
+
+    size_t len = strlen(path) + strlen(LP_PLUGIN_SUFFIX) + 1;
+    char *with_suffix = (char *)malloc(len);
+    snprintf(with_suffix, len, "%s%s", path, LP_PLUGIN_SUFFIX);
+    if (lp_file_exists(with_suffix)) h = lib_open(with_suffix);
+    free(with_suffix);
+    return h;
+}
+
+static bool is_absolute(const char *path) {
+    if (path[0] == '/' || path[0] == '\\') return true;
+    return path[0] && path[1] == ':';  /* C:\... */
+}
+
+/* ---- Loader ---- */
+
+lp_plugin *lp_plugin_load(const char *path, const char *search_dir,
+                          const char *mode_name, char *err, size_t err_cap) {
+    void *handle = open_candidate(path);
+    if (!handle && search_dir && !is_absolute(path)) {
+        char *alt = lp_path_join(search_dir, path);
+        handle = open_candidate(alt);
+        free(alt);
+    }
+    if (!handle) {
+        snprintf(err, err_cap, "cannot load plugin '%s': %s", path, lib_error());
+        return NULL;
+    }
+
+    lp_plugin_entry_fn entry = lib_entry(handle);
+    const lp_plugin_api *api = entry ? entry() : NULL;
+    if (!api) {
+        snprintf(err, err_cap, "'%s' does not export %s()", path, LP_PLUGIN_ENTRY);
+        lib_close(handle);
+        return NULL;
+    }
+    if (api->abi_version != LP_PLUGIN_ABI_VERSION) {
+        snprintf(err, err_cap, "'%s' has plugin ABI %u, expected %u", path,
+                 (unsigned)api->abi_version, (unsigned)LP_PLUGIN_ABI_VERSION);
+        lib_close(handle);
+        return NULL;
+    }
+
+    lp_plugin *p = (lp_plugin *)calloc(1, sizeof(lp_plugin));
+    p->handle = handle;
+    p->api = api;
+    p->ctx = api->create ? api->create(mode_name) : NULL;
+    return p;
+}
+
+void lp_plugin_unload(lp_plugin *p) {
+    if (!p) return;
+    if (p->api->destroy) p->api->destroy(p->ctx);
+    lib_close(p->handle);
+    free(p);
+}
+
+const char *lp_plugin_name(const lp_plugin *p) {
+    return p && p->api->name ? p->api->name : "plugin";
+}
+
+/* ---- Hooks ---- */
+
+int lp_plugin_classify(lp_plugin *p, const char *line) {
+    if (!p || !p->api->classify_line) return LP_PLUGIN_DEFER;
+    int fate = p->api->classify_line(p->ctx, line);
+    if (fate < LP_PLUGIN_KEEP || fate > LP_PLUGIN_DROP) return LP_PLUGIN_DEFER;
+    return fate;
+}
+
+void lp_plugin_summary_line(lp_plugin *p, const char *line, size_t line_num) {
+    if (!p || !p->api->summary_line) return;
+    p->api->summary_line(p->ctx, line, line_num);
+}
+
+const char *lp_plugin_summary_text(lp_plugin *p) {
+    if (!p || !p->api->summary_text) return NULL;
+    const char *text = p->api->summary_text(p->ctx);
+    return text && *text ? text : NULL;
+}
+
+void lp_plugin_post_segments(lp_plugin *p, lp_segment *segs, size_t seg_count) {
+    if (!p || !p->api->post_segment) return;
+    for (size_t i = 0; i < seg_count; i++) {
+        lp_segment *seg = &segs[i];
+        lp_plugin_segment view;
+        view.lines = (const char *const *)seg->lines;
+        view.line_count = seg->line_count;
+        view.start_line = seg->start_line;
+        view.type = (int)seg->type;
+        view.score = seg->score;
+        view.label = NULL;
+
+        p->api->post_segment(p->ctx, &view);
+
+        if (view.type >= (int)LP_SEG_ERROR && view.type <= (int)LP_SEG_NORMAL)
+            seg->type = (lp_seg_type)view.type;
+        seg->score = view.score;
+        if (view.label) {
+            free(seg->label);
+            seg->label = strdup(view.label);
+        }
+    }
+}
@@ -0,0 +1,38 @@
+/*
+ * plugin.h — Native mode plugin loader
+ *
+ * Loads a shared object implementing plugin_api.h (dlopen / LoadLibrary)
+ * and exposes its hooks to logparse. Every wrapper accepts a NULL plugin
+ * and then does nothing, so callers need no special casing.
+ */
+#ifndef LP_PLUGIN_H
+#define LP_PLUGIN_H
+
+#include <stddef.h>
+#include "plugin_api.h"
+#include "segment.h"
+
+typedef struct lp_plugin lp_plugin;
+
+/* Load a plugin. A relative path is tried as given, then under search_dir
+   (may be NULL); each also with LP_PLUGIN_SUFFIX appended. On failure
+   returns NULL and writes a message to err. */
+lp_plugin *lp_plugin_load(const char *path, const char *search_dir,
+                          const char *mode_name, char *err, size_t err_cap);
+void       lp_plugin_unload(lp_plugin *p);
+
+const char *lp_plugin_name(const lp_plugin *p);
+
+/* Fate from the plugin, or LP_PLUGIN_DEFER */
+int         lp_plugin_classify(lp_plugin *p, const char *line);
+
+/* Feed one line of the main pass */
+void        lp_plugin_summary_line(lp_plugin *p, const char *line, size_t line_num);
+
+/* Extra summary lines, or NULL */
+const char *lp_plugin_summary_text(lp_plugin *p);
+
+/* Run post_segment over detected (and scored) segments */
+void        lp_plugin_post_segments(lp_plugin *p, lp_segment *segs, size_t seg_count);
+
+#endif /* LP_PLUGIN_H */
@@ -0,0 +1,82 @@
+/*
+ * plugin_api.h — Native mode plugin ABI
+ *
+ * A mode can name a shared object ([plugin] path = "...") that implements
+ * format-specific logic pattern lists cannot express: devicetree error
+ * decoding, gradle task graphs, pytest parametrised ids. The object exports
+ * one symbol, LP_PLUGIN_ENTRY, returning a static lp_plugin_api table.
+ *
+ * This header is the only one a plugin includes. The ABI uses plain C
+ * types so plugins need not link against logpilot_core.
+ */
+#ifndef LP_PLUGIN_API_H
+#define LP_PLUGIN_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LP_PLUGIN_ABI_VERSION 1
+#define LP_PLUGIN_ENTRY       "logpilot_plugin"
+
+#ifdef _WIN32
+#define LP_PLUGIN_EXPORT __declspec(dllexport)
+#define LP_PLUGIN_SUFFIX ".dll"
+#elif defined(__APPLE__)
+#define LP_PLUGIN_EXPORT __attribute__((visibility("default")))
+#define LP_PLUGIN_SUFFIX ".dylib"
+#else
+#define LP_PLUGIN_EXPORT __attribute__((visibility("default")))
+#define LP_PLUGIN_SUFFIX ".so"
+#endif
+
+/* classify_line results (same values as lp_fate) */
+#define LP_PLUGIN_DEFER     (-1)  /* Fall back to the mode's patterns */
+#define LP_PLUGIN_KEEP      0
+#define LP_PLUGIN_KEEP_ONCE 1
+#define LP_PLUGIN_DROP      2
+
+/* Segment types for lp_plugin_segment.type (same values as lp_seg_type) */
+#define LP_PLUGIN_SEG_ERROR          0
+#define LP_PLUGIN_SEG_WARNING        1
+#define LP_PLUGIN_SEG_INFO           2
+#define LP_PLUGIN_SEG_DATA           3
+#define LP_PLUGIN_SEG_PHASE          4
+#define LP_PLUGIN_SEG_BUILD_PROGRESS 5
+#define LP_PLUGIN_SEG_BOILERPLATE    6
+#define LP_PLUGIN_SEG_NORMAL         7
+
+/* Segment view handed to post_segment. type and score may be changed;
+   label may be pointed at a plugin-owned string to relabel the block. */
+typedef struct {
+    const char *const *lines;
+    size_t             line_count;
+    size_t             start_line;
+    int                type;    /* LP_PLUGIN_SEG_* */
+    float              score;
+    const char        *label;
+} lp_plugin_segment;
+
+/* Hook table. Any hook may be NULL. ctx is whatever create() returned. */
+typedef struct {
+    uint32_t    abi_version;    /* LP_PLUGIN_ABI_VERSION */
+    const char *name;
+
+    void *(*create)(const char *mode_name);
+    void  (*destroy)(void *ctx);
+
+    /* Fate of one line, or LP_PLUGIN_DEFER */
+    int   (*classify_line)(void *ctx, const char *line);
+
+    /* Called once per segment after scoring */
+    void  (*post_segment)(void *ctx, lp_plugin_segment *seg);
+
+    /* Called for every input line, in order, during the main pass */
+    void  (*summary_line)(void *ctx, const char *line, size_t line_num);
+
+    /* Extra summary lines ("Key: value\n..."), plugin-owned; NULL for none */
+    const char *(*summary_text)(void *ctx);
+} lp_plugin_api;
+
+typedef const lp_plugin_api *(*lp_plugin_entry_fn)(void);
+
+#endif /* LP_PLUGIN_API_H */
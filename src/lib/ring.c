@@ -0,0 +1,119 @@
+/*
+ * ring.c — Lock-free single-producer/single-consumer ring buffer
+ */
+#include "ring.h"
+#include "thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <stdatomic.h>
+#include <time.h>
+#endif
+
+#define RING_CACHE_LINE 64
+
+#ifdef _WIN32
+/* MSVC lacks <stdatomic.h> in C mode; Interlocked calls are full barriers */
+typedef volatile LONG64 ring_index;
+static size_t load_acquire(ring_index *p) { return (size_t)InterlockedOr64(p, 0); }
+static void store_release(ring_index *p, size_t v) { InterlockedExchange64(p, (LONG64)v); }
+#else
+typedef atomic_size_t ring_index;
+static size_t load_acquire(ring_index *p) { return atomic_load_explicit(p, memory_order_acquire); }
+static void store_release(ring_index *p, size_t v) { atomic_store_explicit(p, v, memory_order_release); }
+#endif
+
+struct lp_ring {
+    /* Producer's line */
+    ring_index tail;            /* Next slot to write */
+    size_t     head_cache;      /* Producer's last view of head */
+    char       pad0[RING_CACHE_LINE - sizeof(ring_index) - sizeof(size_t)];
+    /* Consumer's line */
+    ring_index head;            /* Next slot to read */
+    size_t     tail_cache;      /* Consumer's last view of tail */
+    char       pad1[RING_CACHE_LINE - sizeof(ring_index) - sizeof(size_t)];
+    /* Shared, read-mostly */
+    ring_index closed;
+    size_t     mask;
+    size_t     elem_size;
+    char      *slots;
+};
+
+/* Wait step n: spin, then yield, then sleep up to 1 ms */
+static void backoff(unsigned n) {
+    if (n < 64) return;
+    if (n < 128) { lp_thread_yield(); return; }
+    unsigned shift = n - 128 < 5 ? n - 128 : 5;
+#ifdef _WIN32
+    (void)shift;
+    Sleep(1);
+#else
+    struct timespec ts = { 0, 31250L << shift };   /* 31 us .. 1 ms */
+    nanosleep(&ts, NULL);
+#endif
+}
+
+lp_ring *lp_ring_new(size_t capacity, size_t elem_size) {
+    size_t cap = 2;
+    while (cap < capacity) cap *= 2;
+    lp_ring *r = (lp_ring *)calloc(1, sizeof(lp_ring));
+    if (!r) return NULL;
+    r->slots = (char *)malloc(cap * elem_size);
+    if (!r->slots) { free(r); return NULL; }
+    r->mask = cap - 1;
+    r->elem_size = elem_size;
+    store_release(&r->head, 0);
+    store_release(&r->tail, 0);
+    store_release(&r->closed, 0);
+    return r;
+}
+
+void lp_ring_free(lp_ring *r) {
+    if (!r) return;
+    free(r->slots);
+    free(r);
+}
+
+bool lp_ring_try_push(lp_ring *r, const void *elem) {
+    size_t tail = load_acquire(&r->tail);          /* Only this thread writes it */
+    if (tail - r->head_cache > r->mask) {
+        r->head_cache = load_acquire(&r->head);
+        if (tail - r->head_cache > r->mask) return false;
+    }
+    memcpy(r->slots + (tail & r->mask) * r->elem_size, elem, r->elem_size);
+    store_release(&r->tail, tail + 1);
+    return true;
+}
+
+void lp_ring_push(lp_ring *r, const void *elem) {
+    for (unsigned n = 0; !lp_ring_try_push(r, elem); n++)
+        backoff(n);
+}
+
+void lp_ring_close(lp_ring *r) {
+    store_release(&r->closed, 1);
+}
+
+bool lp_ring_try_pop(lp_ring *r, void *elem) {
+    size_t head = load_acquire(&r->head);          /* Only this thread writes it */
+    if (head == r->tail_cache) {
+        r->tail_cache = load_acquire(&r->tail);
+        if (head == r->tail_cache) return false;
+    }
+    memcpy(elem, r->slots + (head & r->mask) * r->elem_size, r->elem_size);
+    store_release(&r->head, head + 1);
+    return true;
+}
+
+bool lp_ring_pop(lp_ring *r, void *elem) {
+    for (unsigned n = 0; ; n++) {
+        if (lp_ring_try_pop(r, elem)) return true;
+        /* Closed is set after the last push, so recheck once after seeing it */
+        if (load_acquire(&r->closed)) return lp_ring_try_pop(r, elem);
+        backoff(n);
+    }
+}
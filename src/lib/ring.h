@@ -0,0 +1,36 @@
+/*
+ * ring.h — Lock-free single-producer/single-consumer ring buffer
+ *
+ * Connects two pipeline stages on different threads: exactly one thread
+ * pushes and exactly one pops. Elements are fixed-size and copied in and
+ * out (pass pointers to larger items). The producer and consumer indices
+ * live on separate cache lines and each side caches the other's index, so
+ * the fast path touches no shared line it does not own. Blocking calls
+ * spin briefly, then yield, then sleep with backoff, so a stage waiting on
+ * a slow pipe does not burn a core.
+ */
+#ifndef LP_RING_H
+#define LP_RING_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct lp_ring lp_ring;
+
+/* capacity is rounded up to a power of 2. NULL on allocation failure. */
+lp_ring *lp_ring_new(size_t capacity, size_t elem_size);
+void lp_ring_free(lp_ring *r);
+
+/* Producer side. lp_ring_push waits for room. */
+bool lp_ring_try_push(lp_ring *r, const void *elem);
+void lp_ring_push(lp_ring *r, const void *elem);
+
+/* Producer side: no more elements will be pushed */
+void lp_ring_close(lp_ring *r);
+
+/* Consumer side. lp_ring_pop waits for an element; false once the ring
+   is closed and drained. */
+bool lp_ring_try_pop(lp_ring *r, void *elem);
+bool lp_ring_pop(lp_ring *r, void *elem);
+
+#endif /* LP_RING_H */
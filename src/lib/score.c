@@ -7,34 +7,56 @@
 #include <stdlib.h>
 #include <string.h>
 
-float lp_score_segment(lp_segment *seg, const struct lp_mode *mode,
-                       const char **extra_keywords, size_t extra_kw_count,
-                       lp_dedup_table *dedup) {
-    float score = 0.0f;
+/* Frequency-outlier thresholds: the count at the top 5% and bottom 5% of
+   the dedup table. Returns false when the table is empty. */
+typedef struct {
+    size_t top5_count;
+    size_t bot5_count;
+    bool   valid;
+} freq_thresholds;
+
+static freq_thresholds compute_thresholds(lp_dedup_table *dedup) {
+    freq_thresholds ft = { 0, 0, false };
+    if (!dedup || dedup->count == 0) return ft;
+    size_t sorted_count;
+    lp_dedup_entry **sorted = lp_dedup_sorted(dedup, &sorted_count);
+    if (sorted_count > 0) {
+        size_t top5_threshold_idx = sorted_count / 20;  /* 5% */
+        ft.top5_count = sorted[top5_threshold_idx < sorted_count ? top5_threshold_idx : 0]->count;
+        size_t bot5_idx = sorted_count - sorted_count / 20 - 1;
+        if (bot5_idx >= sorted_count) bot5_idx = sorted_count - 1;
+        ft.bot5_count = sorted[bot5_idx]->count;
+        ft.valid = true;
+    }
+    free(sorted);
+    return ft;
+}
+
+static void features_with(const lp_segment *seg, const struct lp_mode *mode,
+                          const char **extra_keywords, size_t extra_kw_count,
+                          lp_dedup_table *dedup, const freq_thresholds *ft,
+                          float f[LP_SF_COUNT]) {
+    memset(f, 0, LP_SF_COUNT * sizeof(float));
 
     /* Type-based base score */
     switch (seg->type) {
-        case LP_SEG_ERROR:          score += 10.0f; break;
-        case LP_SEG_WARNING:        score += 5.0f;  break;
-        case LP_SEG_DATA:           score += 2.0f;  break;
-        case LP_SEG_PHASE:          score += 1.0f;  break;
-        case LP_SEG_BUILD_PROGRESS: score += 0.5f;  break;
-        case LP_SEG_BOILERPLATE:    return -1.0f;    /* never include */
+        case LP_SEG_ERROR:          f[LP_SF_ERROR] = 1.0f;    break;
+        case LP_SEG_WARNING:        f[LP_SF_WARNING] = 1.0f;  break;
+        case LP_SEG_DATA:           f[LP_SF_DATA] = 1.0f;     break;
+        case LP_SEG_PHASE:          f[LP_SF_PHASE] = 1.0f;    break;
+        case LP_SEG_BUILD_PROGRESS: f[LP_SF_PROGRESS] = 1.0f; break;
+        case LP_SEG_BOILERPLATE:    return;   /* never include */
         default: break;
     }
 
     /* Keyword matches from mode */
     if (mode) {
         for (size_t i = 0; i < seg->line_count; i++) {
-            for (size_t k = 0; k < mode->keyword_count; k++) {
-                if (lp_str_contains(seg->lines[i], mode->keywords[k]))
-                    score += 3.0f;
-            }
+            f[LP_SF_KEYWORD] += (float)lp_mode_match(mode, LP_PAT_KEYWORDS,
+                                                     seg->lines[i], false);
             /* Mode-specific trigger match */
-            for (size_t k = 0; k < mode->trigger_count; k++) {
-                if (lp_str_contains_ci(seg->lines[i], mode->block_triggers[k]))
-                    score += 1.0f;
-            }
+            f[LP_SF_TRIGGER] += (float)lp_mode_match(mode, LP_PAT_TRIGGERS,
+                                                     seg->lines[i], false);
         }
     }
 
@@ -42,49 +64,67 @@ float lp_score_segment(lp_segment *seg, const struct lp_mode *mode,
     for (size_t i = 0; i < seg->line_count; i++) {
         for (size_t k = 0; k < extra_kw_count; k++) {
             if (lp_str_contains(seg->lines[i], extra_keywords[k]))
-                score += 3.0f;
+                f[LP_SF_CLI_KEYWORD] += 1.0f;
         }
     }
 
     /* Frequency outlier bonus */
-    if (dedup && dedup->count > 0) {
-        /* Get approximate percentile thresholds */
-        size_t sorted_count;
-        lp_dedup_entry **sorted = lp_dedup_sorted(dedup, &sorted_count);
-        if (sorted_count > 0) {
-            size_t top5_threshold_idx = sorted_count / 20;  /* 5% */
-            size_t top5_count = sorted[top5_threshold_idx < sorted_count ? top5_threshold_idx : 0]->count;
-            size_t bot5_idx = sorted_count - sorted_count / 20 - 1;
-            if (bot5_idx >= sorted_count) bot5_idx = sorted_count - 1;
-            size_t bot5_count = sorted[bot5_idx]->count;
-
-            for (size_t i = 0; i < seg->line_count; i++) {
-                /* Look up each line in the dedup table */
-                size_t len = strlen(seg->lines[i]);
-                uint64_t h = lp_fnv1a(seg->lines[i], len);
-                size_t idx = (size_t)(h & (dedup->capacity - 1));
-                while (dedup->buckets[idx].occupied) {
-                    if (dedup->buckets[idx].hash == h) {
-                        size_t c = dedup->buckets[idx].count;
-                        if (c >= top5_count && top5_count > 1) score += 2.0f;
-                        if (c <= bot5_count && c == 1) score += 2.0f;
-                        break;
-                    }
-                    idx = (idx + 1) & (dedup->capacity - 1);
+    if (ft->valid) {
+        for (size_t i = 0; i < seg->line_count; i++) {
+            /* Look up each line in the dedup table */
+            size_t len = strlen(seg->lines[i]);
+            uint64_t h = lp_fnv1a(seg->lines[i], len);
+            size_t idx = (size_t)(h & (dedup->capacity - 1));
+            while (dedup->buckets[idx].occupied) {
+                if (dedup->buckets[idx].hash == h) {
+                    size_t c = dedup->buckets[idx].count;
+                    if (c >= ft->top5_count && ft->top5_count > 1) f[LP_SF_FREQ_OUTLIER] += 1.0f;
+                    if (c <= ft->bot5_count && c == 1) f[LP_SF_FREQ_OUTLIER] += 1.0f;
+                    break;
                 }
+                idx = (idx + 1) & (dedup->capacity - 1);
             }
         }
-        free(sorted);
     }
+}
+
+void lp_score_features(const lp_segment *seg, const struct lp_mode *mode,
+                       const char **extra_keywords, size_t extra_kw_count,
+                       lp_dedup_table *dedup, float features[LP_SF_COUNT]) {
+    freq_thresholds ft = compute_thresholds(dedup);
+    features_with(seg, mode, extra_keywords, extra_kw_count, dedup, &ft, features);
+}
 
+float lp_score_weighted(lp_seg_type type, const float features[LP_SF_COUNT],
+                        const float weights[LP_SF_COUNT]) {
+    if (type == LP_SEG_BOILERPLATE) return -1.0f;
+    float score = 0.0f;
+    for (int f = 0; f < LP_SF_COUNT; f++)
+        score += weights[f] * features[f];
     return score;
 }
 
+static const float *mode_weights(const struct lp_mode *mode) {
+    return mode ? mode->score_weights : LP_SCORE_DEFAULTS;
+}
+
+float lp_score_segment(lp_segment *seg, const struct lp_mode *mode,
+                       const char **extra_keywords, size_t extra_kw_count,
+                       lp_dedup_table *dedup) {
+    float f[LP_SF_COUNT];
+    lp_score_features(seg, mode, extra_keywords, extra_kw_count, dedup, f);
+    return lp_score_weighted(seg->type, f, mode_weights(mode));
+}
+
 void lp_score_all(lp_segment *segs, size_t seg_count,
                   const struct lp_mode *mode,
                   const char **extra_keywords, size_t extra_kw_count,
                   lp_dedup_table *dedup) {
+    /* Thresholds depend only on the table: compute them once, not per segment */
+    freq_thresholds ft = compute_thresholds(dedup);
     for (size_t i = 0; i < seg_count; i++) {
-        segs[i].score = lp_score_segment(&segs[i], mode, extra_keywords, extra_kw_count, dedup);
+        float f[LP_SF_COUNT];
+        features_with(&segs[i], mode, extra_keywords, extra_kw_count, dedup, &ft, f);
+        segs[i].score = lp_score_weighted(segs[i].type, f, mode_weights(mode));
     }
 }
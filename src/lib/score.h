@@ -1,13 +1,25 @@
 /*
  * score.h — Interest scoring for segments
+ *
+ * A segment's score is a weighted sum of raw signals (lp_score_feature):
+ * its type, keyword/trigger hits and frequency outliers. The weights come
+ * from the mode's [score] section.
  */
 #ifndef LP_SCORE_H
 #define LP_SCORE_H
 
 #include "segment.h"
 #include "dedup.h"
+#include "mode.h"
 
-struct lp_mode;
+/* Raw signals of one segment, before weighting */
+void lp_score_features(const lp_segment *seg, const struct lp_mode *mode,
+                       const char **extra_keywords, size_t extra_kw_count,
+                       lp_dedup_table *dedup, float features[LP_SF_COUNT]);
+
+/* Weighted sum; boilerplate segments are always -1 (never packed) */
+float lp_score_weighted(lp_seg_type type, const float features[LP_SF_COUNT],
+                        const float weights[LP_SF_COUNT]);
 
 /* Score a single segment based on mode config, keywords, and dedup stats.
    extra_keywords/extra_kw_count: CLI --keywords additions. */
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <re.h>
 
 int lp_indent_level(const char *line) {
     int level = 0;
@@ -28,37 +29,114 @@ bool lp_is_blank(const char *line) {
     return true;
 }
 
-bool lp_is_tabular(const char **lines, size_t count) {
+/* Widest prefix of a line the column detector considers; anything past
+   it belongs to the last column */
+#define LP_TABLE_MAX_WIDTH 512
+
+static bool is_gap_char(char c) { return c == ' ' || c == '\t'; }
+
+/* Line has text inside a column gap (a title spanning the table) */
+static bool row_spans_gap(const char *line, size_t n, const lp_columns *cols) {
+    for (size_t c = 0; c + 1 < cols->count; c++) {
+        for (size_t k = cols->end[c]; k < cols->start[c + 1] && k < n; k++)
+            if (!is_gap_char(line[k])) return true;
+    }
+    return false;
+}
+
+/* Line has a run of 2+ blanks between two of its words */
+static bool has_cell_gap(const char *line) {
+    while (is_gap_char(*line)) line++;
+    for (const char *p = line; *p; p++) {
+        if (is_gap_char(p[0]) && is_gap_char(p[1])) {
+            while (is_gap_char(*p)) p++;
+            return *p != '\0';
+        }
+    }
+    return false;
+}
+
+bool lp_detect_columns(const char **lines, size_t count, lp_columns *cols) {
+    memset(cols, 0, sizeof(*cols));
     if (count < 3) return false;
-    /* Check if lines have consistent column alignment by looking for
-       2+ consecutive spaces (column separator) at similar positions */
-    int col_positions[32] = {0};
-    int max_cols = 0;
 
-    for (size_t i = 0; i < count && i < 5; i++) {
+    /* One pass: mark every position a multi-cell line has a non-blank byte
+       at. Single-cell lines (titles, rules) may span the table's gaps. */
+    unsigned char used[LP_TABLE_MAX_WIDTH] = {0};
+    size_t width = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (lp_is_source_context(lines[i])) return false;   /* a code excerpt */
+        if (!has_cell_gap(lines[i])) continue;
+        size_t pos = 0;
+        for (const char *p = lines[i]; *p && pos < LP_TABLE_MAX_WIDTH; p++, pos++)
+            if (!is_gap_char(*p)) used[pos] = 1;
+        if (pos > width) width = pos;
+    }
+
+    /* Columns start after each gap of 2+ positions no such line uses */
+    size_t pos = 0;
+    while (pos < width && !used[pos]) pos++;
+    if (pos == width) return false;
+    cols->start[cols->count++] = pos;
+    while (pos < width && cols->count < LP_MAX_COLUMNS) {
+        while (pos < width && used[pos]) pos++;
+        size_t gap_start = pos;
+        while (pos < width && !used[pos]) pos++;
+        if (pos < width && pos - gap_start >= 2) {
+            cols->end[cols->count - 1] = gap_start;
+            cols->start[cols->count++] = pos;
+        }
+    }
+    cols->end[cols->count - 1] = (size_t)-1;
+    if (cols->count < 2) return false;
+
+    /* Most rows must actually fill the layout, not just share a ragged edge */
+    size_t rows = 0;
+    for (size_t i = 0; i < count; i++) {
         const char *p = lines[i];
-        int ncols = 0;
-        int pos = 0;
-        bool in_space = false;
-        while (*p && ncols < 32) {
-            if (*p == ' ' || *p == '\t') {
-                if (!in_space && pos > 0) {
-                    in_space = true;
-                }
-            } else {
-                if (in_space) {
-                    col_positions[ncols]++;
-                    ncols++;
-                    in_space = false;
-                }
+        size_t n = strlen(p);
+        if (row_spans_gap(p, n, cols)) continue;
+        size_t cells = 0;
+        for (size_t c = 0; c < cols->count; c++) {
+            for (size_t k = cols->start[c]; k < n && k < cols->end[c]; k++) {
+                if (!is_gap_char(p[k])) { cells++; break; }
             }
-            pos++;
-            p++;
         }
-        if (ncols > max_cols) max_cols = ncols;
+        if (cells >= 2) rows++;
     }
-    /* If most lines have similar column counts, it's tabular */
-    return max_cols >= 2;
+    return rows * 3 >= count * 2;
+}
+
+void lp_format_row(const char *line, const lp_columns *cols, lp_string *out) {
+    size_t n = strlen(line);
+    if (row_spans_gap(line, n, cols)) {
+        size_t from = 0, to = n;
+        while (from < to && is_gap_char(line[from])) from++;
+        while (to > from && is_gap_char(line[to - 1])) to--;
+        lp_string_append(out, line + from, to - from);
+        return;
+    }
+    size_t emitted = 0;   /* Cells written so far; empty ones still owe a '|' */
+    size_t pending = 0;
+    for (size_t c = 0; c < cols->count; c++) {
+        size_t from = c == 0 ? 0 : cols->start[c];
+        size_t to = c + 1 < cols->count ? cols->start[c + 1] : n;
+        if (from > n) from = n;
+        if (to > n) to = n;
+        while (from < to && is_gap_char(line[from])) from++;
+        while (to > from && is_gap_char(line[to - 1])) to--;
+        if (from == to) { pending++; continue; }
+        for (size_t k = 0; k < pending + (emitted ? 1 : 0); k++)
+            lp_string_append(out, "|", 1);
+        lp_string_append(out, line + from, to - from);
+        emitted++;
+        pending = 0;
+    }
+}
+
+bool lp_is_tabular(const char **lines, size_t count) {
+    lp_columns cols;
+    return lp_detect_columns(lines, count, &cols);
 }
 
 bool lp_is_build_progress(const char *line) {
@@ -103,11 +181,7 @@ bool lp_is_compiler_command(const char *line) {
 
 bool lp_is_boilerplate(const char *line, const struct lp_mode *mode) {
     if (!mode || !mode->boilerplate_patterns) return false;
-    for (size_t i = 0; i < mode->boilerplate_count; i++) {
-        if (lp_str_contains(line, mode->boilerplate_patterns[i]))
-            return true;
-    }
-    return false;
+    return lp_mode_match(mode, LP_PAT_BOILERPLATE, line, true) > 0;
 }
 
 bool lp_is_source_context(const char *line) {
@@ -169,90 +243,91 @@ bool lp_is_caret_line(const char *line) {
     return false;
 }
 
-lp_fate lp_line_fate(const char *line, const struct lp_mode *mode) {
-    if (!line) return LP_FATE_DROP;
-
-    /* Blank lines: drop */
-    if (lp_is_blank(line)) return LP_FATE_DROP;
-
-    /* Caret/underline lines: visual noise, drop */
-    if (lp_is_caret_line(line)) return LP_FATE_DROP;
-
+bool lp_is_sdk_include_continuation(const char *line) {
     /* Include-chain continuation lines: "                 from path/file.h:NN,"
        These follow "In file included from" (already in drop_contains) but
        the continuation lines don't match that pattern. Drop SDK paths,
        but keep references to the user's own source code. */
-    {
-        const char *p = line;
-        while (*p == ' ') p++;
-        if (strncmp(p, "from ", 5) == 0) {
-            /* Verify it looks like a path reference: has a colon after the path */
-            const char *colon = strchr(p + 5, ':');
-            if (colon && (isdigit((unsigned char)*(colon + 1)) ||
-                          (colon > p + 5 && *(colon - 1) != ' '))) {
-                /* Only drop if it's an SDK path, not the user's source */
-                if (strstr(p, "/ncs/") || strstr(p, "/zephyr/") ||
-                    strstr(p, "/modules/") || strstr(p, "/sdk-nrf/") ||
-                    strstr(p, "\\ncs\\") || strstr(p, "\\zephyr\\") ||
-                    strstr(p, "\\modules\\") || strstr(p, "\\sdk-nrf\\"))
-                    return LP_FATE_DROP;
-            }
-        }
-    }
+    const char *p = line;
+    while (*p == ' ') p++;
+    if (strncmp(p, "from ", 5) != 0) return false;
+    /* Verify it looks like a path reference: has a colon after the path */
+    const char *colon = strchr(p + 5, ':');
+    if (!colon || !(isdigit((unsigned char)*(colon + 1)) ||
+                    (colon > p + 5 && *(colon - 1) != ' ')))
+        return false;
+    /* Only an SDK path, not the user's source */
+    return strstr(p, "/ncs/") || strstr(p, "/zephyr/") ||
+           strstr(p, "/modules/") || strstr(p, "/sdk-nrf/") ||
+           strstr(p, "\\ncs\\") || strstr(p, "\\zephyr\\") ||
+           strstr(p, "\\modules\\") || strstr(p, "\\sdk-nrf\\");
+}
 
+const char *const lp_fate_generic[] = {
+    "error:", "fatal:", "FAILED", "undefined reference", "warning:"
+};
+const size_t lp_fate_generic_count = sizeof(lp_fate_generic) / sizeof(lp_fate_generic[0]);
+
+const lp_fate_step lp_fate_steps[] = {
+    /* Visual noise and SDK include chains: drop */
+    { LP_FATE_STAGE_FIXED,     LP_FATE_DROP,      "blank line",        lp_is_blank,            0 },
+    { LP_FATE_STAGE_FIXED,     LP_FATE_DROP,      "caret line",        lp_is_caret_line,       0 },
+    { LP_FATE_STAGE_FIXED,     LP_FATE_DROP,      "sdk include chain",
+      lp_is_sdk_include_continuation, 0 },
     /* Error/warning lines always survive */
-    if (lp_str_contains_ci(line, "error:") || lp_str_contains_ci(line, "fatal:") ||
-        lp_str_contains_ci(line, "FAILED") || lp_str_contains_ci(line, "undefined reference"))
-        return LP_FATE_KEEP;
-    if (lp_str_contains_ci(line, "warning:"))
-        return LP_FATE_KEEP;
-
-    if (mode) {
-        /* Mode-specific error/warning patterns → KEEP */
-        for (size_t i = 0; i < mode->error_count; i++) {
-            if (lp_str_contains_ci(line, mode->error_patterns[i]))
-                return LP_FATE_KEEP;
-        }
-        for (size_t i = 0; i < mode->warning_count; i++) {
-            if (lp_str_contains_ci(line, mode->warning_patterns[i]))
-                return LP_FATE_KEEP;
-        }
-
-        /* Explicit drop patterns → DROP */
-        for (size_t i = 0; i < mode->drop_count; i++) {
-            if (lp_str_contains(line, mode->drop_contains[i]))
-                return LP_FATE_DROP;
-        }
-
-        /* Boilerplate → DROP */
-        if (lp_is_boilerplate(line, mode))
-            return LP_FATE_DROP;
-
-        /* Keep-once patterns → KEEP_ONCE */
-        for (size_t i = 0; i < mode->keep_once_count; i++) {
-            if (lp_str_contains(line, mode->keep_once_contains[i]))
-                return LP_FATE_KEEP_ONCE;
+    { LP_FATE_STAGE_KEEP,      LP_FATE_KEEP,      "generic",           NULL, LP_FATE_GENERIC },
+    { LP_FATE_STAGE_KEEP,      LP_FATE_KEEP,      "error_patterns",    NULL, LP_PAT_ERRORS },
+    { LP_FATE_STAGE_KEEP,      LP_FATE_KEEP,      "warning_patterns",  NULL, LP_PAT_WARNINGS },
+    /* Mode drops, then boilerplate, then keep-once facts */
+    { LP_FATE_STAGE_DROP,      LP_FATE_DROP,      "drop_contains",     NULL, LP_PAT_DROP },
+    { LP_FATE_STAGE_DROP,      LP_FATE_DROP,      "boilerplate",       NULL, LP_PAT_BOILERPLATE },
+    { LP_FATE_STAGE_KEEP_ONCE, LP_FATE_KEEP_ONCE, "keep_once_contains", NULL, LP_PAT_KEEP_ONCE },
+    /* Build progress and compiler commands */
+    { LP_FATE_STAGE_LATE_DROP, LP_FATE_DROP,      "build progress",    lp_is_build_progress,   0 },
+    { LP_FATE_STAGE_LATE_DROP, LP_FATE_DROP,      "compiler command",  lp_is_compiler_command, 0 },
+};
+const size_t lp_fate_step_count = sizeof(lp_fate_steps) / sizeof(lp_fate_steps[0]);
+
+lp_fate lp_line_fate_stage(const char *line, const struct lp_mode *mode,
+                           lp_fate_stage *stage) {
+    lp_fate_stage st = LP_FATE_STAGE_FIXED;
+    lp_fate fate = LP_FATE_DROP;
+    if (line) {
+        st = LP_FATE_STAGE_DEFAULT;
+        fate = LP_FATE_KEEP;
+        for (size_t s = 0; s < lp_fate_step_count; s++) {
+            const lp_fate_step *step = &lp_fate_steps[s];
+            bool hit = false;
+            if (step->check) {
+                hit = step->check(line);
+            } else if (step->set == LP_FATE_GENERIC) {
+                for (size_t i = 0; i < lp_fate_generic_count && !hit; i++)
+                    hit = lp_str_contains_ci(line, lp_fate_generic[i]);
+            } else {
+                hit = lp_mode_match(mode, (lp_pattern_set)step->set, line, true) > 0;
+            }
+            if (hit) {
+                st = step->stage;
+                fate = step->fate;
+                break;
+            }
         }
     }
+    if (stage) *stage = st;
+    return fate;
+}
 
-    /* Build progress and compiler commands → DROP */
-    if (lp_is_build_progress(line)) return LP_FATE_DROP;
-    if (lp_is_compiler_command(line)) return LP_FATE_DROP;
-
-    return LP_FATE_KEEP;
+lp_fate lp_line_fate(const char *line, const struct lp_mode *mode) {
+    return lp_line_fate_stage(line, mode, NULL);
 }
 
 static lp_seg_type classify_line(const char *line, const struct lp_mode *mode) {
     /* Check mode-specific error patterns */
     if (mode) {
-        for (size_t i = 0; i < mode->error_count; i++) {
-            if (lp_str_contains_ci(line, mode->error_patterns[i]))
-                return LP_SEG_ERROR;
-        }
-        for (size_t i = 0; i < mode->warning_count; i++) {
-            if (lp_str_contains_ci(line, mode->warning_patterns[i]))
-                return LP_SEG_WARNING;
-        }
+        if (lp_mode_match(mode, LP_PAT_ERRORS, line, true))
+            return LP_SEG_ERROR;
+        if (lp_mode_match(mode, LP_PAT_WARNINGS, line, true))
+            return LP_SEG_WARNING;
     }
     /* Generic fallbacks */
     if (lp_str_contains_ci(line, "error:") || lp_str_contains_ci(line, "fatal:") ||
@@ -265,25 +340,187 @@ static lp_seg_type classify_line(const char *line, const struct lp_mode *mode) {
 
 static bool is_phase_marker(const char *line, const struct lp_mode *mode) {
     if (!mode) return false;
-    for (size_t i = 0; i < mode->phase_count; i++) {
-        if (lp_str_contains(line, mode->phase_markers[i]))
-            return true;
-    }
-    return false;
+    return lp_mode_match(mode, LP_PAT_PHASES, line, true) > 0;
 }
 
 static bool is_block_trigger(const char *line, const struct lp_mode *mode) {
     if (!mode) return false;
-    for (size_t i = 0; i < mode->trigger_count; i++) {
-        if (lp_str_contains_ci(line, mode->block_triggers[i]))
+    return lp_mode_match(mode, LP_PAT_TRIGGERS, line, true) > 0;
+}
+
+/* ---- Declarative rules ----
+ *
+ * The [segments] start/end/nest patterns are compiled once per detection
+ * pass. Each line is then reduced to a single event and the transition
+ * table decides what it does to the current segment, so the pass stays
+ * linear with work per line bounded by the pattern count. Lines no rule
+ * claims fall through to the blank-line/indent/trigger heuristics.
+ */
+
+#define SEG_MAX_DEPTH      16
+#define SEG_NEST_MAX_LINES 1000   /* An unclosed begin stops holding the block after this */
+
+/* A compiled pattern. Patterns without regex operators are matched as
+   (optionally anchored) literals; the rest are prefiltered on their longest
+   required literal before tiny-regex runs. */
+typedef struct {
+    const char *regex;     /* NULL = lit decides alone */
+    char        lit[32];
+    size_t      lit_len;
+    bool        at_start;  /* Literal-only: ^ anchor */
+    bool        at_end;    /* Literal-only: $ anchor */
+} seg_pattern;
+
+typedef struct {
+    seg_pattern *pats;     /* start, end, nest begin, nest end (one block each) */
+    size_t       start_count;
+    size_t       end_count;
+    size_t       nest_count;   /* Complete begin/end pairs */
+} seg_rules;
+
+typedef enum {
+    SEG_EV_LINE,       /* No rule matches */
+    SEG_EV_START,
+    SEG_EV_END,
+    SEG_EV_BEGIN,      /* Some nest begin */
+    SEG_EV_REBEGIN,    /* Begin of a pair already open: a sibling block */
+    SEG_EV_CLOSE,      /* The innermost open block's nest end */
+    SEG_EV_COUNT
+} seg_event;
+
+typedef enum {
+    SEG_ST_FIRST,      /* First line of a segment */
+    SEG_ST_OPEN,
+    SEG_ST_NESTED,
+    SEG_ST_COUNT
+} seg_state;
+
+typedef enum {
+    SEG_ACT_HEURISTIC, /* Heuristics decide whether the line splits */
+    SEG_ACT_TAKE,      /* Line joins the segment */
+    SEG_ACT_SPLIT,     /* Segment ends before the line, which starts the next */
+    SEG_ACT_LAST,      /* Line joins and ends the segment */
+    SEG_ACT_PUSH,      /* Line joins and opens a nested block */
+    SEG_ACT_POP        /* Line joins and closes the innermost block */
+} seg_action;
+
+static const seg_action SEG_ACTIONS[SEG_ST_COUNT][SEG_EV_COUNT] = {
+    /*                LINE               START          END           BEGIN          REBEGIN        CLOSE */
+    [SEG_ST_FIRST]  = { SEG_ACT_TAKE,      SEG_ACT_TAKE,  SEG_ACT_LAST, SEG_ACT_PUSH,  SEG_ACT_PUSH,  SEG_ACT_TAKE },
+    [SEG_ST_OPEN]   = { SEG_ACT_HEURISTIC, SEG_ACT_SPLIT, SEG_ACT_LAST, SEG_ACT_SPLIT, SEG_ACT_SPLIT, SEG_ACT_HEURISTIC },
+    [SEG_ST_NESTED] = { SEG_ACT_TAKE,      SEG_ACT_SPLIT, SEG_ACT_TAKE, SEG_ACT_PUSH,  SEG_ACT_SPLIT, SEG_ACT_POP },
+};
+
+static void compile_pattern(const char *re, seg_pattern *p) {
+    memset(p, 0, sizeof(*p));
+    size_t len = strlen(re);
+    const char *body = re;
+    size_t body_len = len;
+    bool at_start = body_len > 0 && body[0] == '^';
+    if (at_start) { body++; body_len--; }
+    bool at_end = body_len > 0 && body[body_len - 1] == '$' &&
+                  (body_len < 2 || body[body_len - 2] != '\\');
+    if (at_end) body_len--;
+
+    bool literal = body_len < sizeof(p->lit);
+    for (size_t i = 0; i < body_len && literal; i++)
+        if (strchr(".*+?[]\\^$", body[i])) literal = false;
+    if (literal) {
+        memcpy(p->lit, body, body_len);
+        p->lit_len = body_len;
+        p->at_start = at_start;
+        p->at_end = at_end;
+        return;
+    }
+
+    /* Longest run of plain characters every match must contain */
+    p->regex = re;
+    size_t best = 0, best_len = 0;
+    for (size_t i = 0; i < len; ) {
+        if (re[i] == '\\') { i += 2; continue; }
+        if (re[i] == '[') {
+            while (i < len && re[i] != ']') i++;
+            i++;
+            continue;
+        }
+        size_t j = i;
+        while (j < len && !strchr(".*+?[]\\^$", re[j])) j++;
+        size_t run = j - i;
+        if (j < len && (re[j] == '*' || re[j] == '?') && run > 0) run--;
+        if (run > best_len) { best = i; best_len = run; }
+        i = j > i ? j : i + 1;
+    }
+    if (best_len >= sizeof(p->lit)) best_len = sizeof(p->lit) - 1;
+    memcpy(p->lit, re + best, best_len);
+    p->lit_len = best_len;
+}
+
+static bool pattern_match(const seg_pattern *p, const char *line) {
+    if (p->regex) {
+        if (p->lit_len && !strstr(line, p->lit)) return false;
+        int match_len = 0;
+        return re_match(p->regex, line, &match_len) >= 0;
+    }
+    size_t n = strlen(line);
+    if (n < p->lit_len) return false;
+    if (p->at_start && p->at_end) return n == p->lit_len && memcmp(line, p->lit, n) == 0;
+    if (p->at_start) return memcmp(line, p->lit, p->lit_len) == 0;
+    if (p->at_end) return memcmp(line + n - p->lit_len, p->lit, p->lit_len) == 0;
+    return strstr(line, p->lit) != NULL;
+}
+
+static void compile_rules(const struct lp_mode *mode, seg_rules *r) {
+    memset(r, 0, sizeof(*r));
+    if (!mode) return;
+    r->start_count = mode->segment_start_count;
+    r->end_count = mode->segment_end_count;
+    r->nest_count = mode->nest_begin_count < mode->nest_end_count
+                  ? mode->nest_begin_count : mode->nest_end_count;
+    size_t total = r->start_count + r->end_count + 2 * r->nest_count;
+    if (total == 0) return;
+    r->pats = (seg_pattern *)malloc(total * sizeof(seg_pattern));
+    seg_pattern *p = r->pats;
+    for (size_t i = 0; i < r->start_count; i++) compile_pattern(mode->segment_start_patterns[i], p++);
+    for (size_t i = 0; i < r->end_count; i++) compile_pattern(mode->segment_end_patterns[i], p++);
+    for (size_t i = 0; i < r->nest_count; i++) compile_pattern(mode->nest_begin_patterns[i], p++);
+    for (size_t i = 0; i < r->nest_count; i++) compile_pattern(mode->nest_end_patterns[i], p++);
+}
+
+static bool any_match(const seg_pattern *pats, size_t count, const char *line, size_t *which) {
+    for (size_t i = 0; i < count; i++) {
+        if (pattern_match(&pats[i], line)) {
+            if (which) *which = i;
             return true;
+        }
     }
     return false;
 }
 
+/* Reduce a line to its event given the open blocks (pair indices,
+   innermost last). *pair gets the pair a BEGIN opens. Start lines are hard
+   boundaries even inside a block; end lines are not. */
+static seg_event line_event(const seg_rules *r, const char *line,
+                            const size_t *open, size_t depth, size_t *pair) {
+    if (!r->pats) return SEG_EV_LINE;
+    const seg_pattern *starts = r->pats;
+    const seg_pattern *ends = starts + r->start_count;
+    const seg_pattern *begins = ends + r->end_count;
+    const seg_pattern *closes = begins + r->nest_count;
+    if (depth > 0 && pattern_match(&closes[open[depth - 1]], line)) return SEG_EV_CLOSE;
+    if (any_match(begins, r->nest_count, line, pair)) {
+        for (size_t d = 0; d < depth; d++)
+            if (open[d] == *pair) return SEG_EV_REBEGIN;
+        return SEG_EV_BEGIN;
+    }
+    if (any_match(starts, r->start_count, line, NULL)) return SEG_EV_START;
+    if (depth == 0 && any_match(ends, r->end_count, line, NULL)) return SEG_EV_END;
+    return SEG_EV_LINE;
+}
+
 /* Build and push a segment onto the vector */
 static void push_segment(void *segs_ptr, const char **lines,
-                         size_t seg_start, size_t seg_end, lp_seg_type seg_type) {
+                         size_t seg_start, size_t seg_end, lp_seg_type seg_type,
+                         const lp_columns *cols) {
     /* segs_ptr is LP_VEC(lp_segment)* — we use a macro-compatible approach */
     typedef struct { lp_segment *items; size_t len; size_t cap; } seg_vec;
     seg_vec *sv = (seg_vec *)segs_ptr;
@@ -297,14 +534,28 @@ static void push_segment(void *segs_ptr, const char **lines,
     seg.type = seg_type;
     seg.line_count = seg_lines;
     seg.score = 0.0f;
+    seg.columns = NULL;
 
     /* Copy line pointers (not the strings themselves) */
     seg.lines = (char **)malloc(seg_lines * sizeof(char *));
     for (size_t j = 0; j < seg_lines; j++)
         seg.lines[j] = (char *)lines[seg_start + j];
 
-    /* Estimate tokens */
-    seg.token_count = lp_estimate_tokens_lines((const char **)(lines + seg_start), seg_lines);
+    /* Estimate tokens; tables are budgeted as the compact rows they print as */
+    if (cols) {
+        seg.columns = (lp_columns *)malloc(sizeof(lp_columns));
+        *seg.columns = *cols;
+        lp_string row = lp_string_new(256);
+        seg.token_count = 0;
+        for (size_t j = 0; j < seg_lines; j++) {
+            lp_string_clear(&row);
+            lp_format_row(lines[seg_start + j], cols, &row);
+            seg.token_count += lp_estimate_tokens(row.data, row.len) + 1;
+        }
+        lp_string_free(&row);
+    } else {
+        seg.token_count = lp_estimate_tokens_lines((const char **)(lines + seg_start), seg_lines);
+    }
 
     /* Generate label */
     char label_buf[128];
@@ -338,6 +589,9 @@ lp_segment *lp_segment_detect(const char **lines, size_t count,
         return NULL;
     }
 
+    seg_rules rules;
+    compile_rules(mode, &rules);
+
     size_t i = 0;
     while (i < count) {
         /* Skip blank lines between segments */
@@ -349,6 +603,14 @@ lp_segment *lp_segment_detect(const char **lines, size_t count,
         int base_indent = lp_indent_level(lines[i]);
         bool saw_error_content = false;
 
+        /* Open nested blocks (pair indices), innermost last */
+        size_t nest[SEG_MAX_DEPTH];
+        size_t depth = 0;
+        size_t nest_start = i;
+        size_t pair = 0;
+        seg_action act = SEG_ACTIONS[SEG_ST_FIRST][line_event(&rules, lines[i], nest, 0, &pair)];
+        if (act == SEG_ACT_PUSH) nest[depth++] = pair;
+
         /* Check if this is a phase marker */
         if (is_phase_marker(lines[i], mode)) {
             seg_type = LP_SEG_PHASE;
@@ -362,6 +624,8 @@ lp_segment *lp_segment_detect(const char **lines, size_t count,
         if (line_type == LP_SEG_ERROR) {
             seg_type = LP_SEG_ERROR;
             saw_error_content = true;
+        } else if (line_type == LP_SEG_WARNING && seg_type == LP_SEG_NORMAL) {
+            seg_type = LP_SEG_WARNING;
         } else if (line_type > seg_type) {
             seg_type = line_type;
         }
@@ -373,32 +637,49 @@ lp_segment *lp_segment_detect(const char **lines, size_t count,
 
         i++;
 
-        /* Extend segment: continue until blank line, major indent change, or phase marker */
-        while (i < count) {
-            if (lp_is_blank(lines[i])) break;
-            if (is_phase_marker(lines[i], mode) && i > seg_start) break;
-
-            int indent = lp_indent_level(lines[i]);
-            /* A big indent decrease (back to base or less) after indented block = new segment */
-            if (indent < base_indent - 2 && i > seg_start + 1) break;
+        /* Extend segment: rules first, then until blank line, major indent
+           change, or phase marker */
+        while (i < count && act != SEG_ACT_LAST) {
+            if (depth > 0 && i - nest_start > SEG_NEST_MAX_LINES) depth = 0;
+            seg_state state = depth > 0 ? SEG_ST_NESTED : SEG_ST_OPEN;
+            act = SEG_ACT_HEURISTIC;
+            if (depth > 0 || !lp_is_blank(lines[i]))
+                act = SEG_ACTIONS[state][line_event(&rules, lines[i], nest, depth, &pair)];
+            if (act == SEG_ACT_SPLIT) break;
 
             /* Classify this line */
             line_type = classify_line(lines[i], mode);
             bool this_is_progress = lp_is_build_progress(lines[i]);
 
-            /* KEY FIX: If we're in an error segment and hit a normal build
-               progress line (not itself an error), break the segment here.
-               This prevents [N/M] Building lines after the error from being
-               absorbed into the error block. */
-            if (saw_error_content && this_is_progress && line_type == LP_SEG_NORMAL) {
-                break;
-            }
+            if (act == SEG_ACT_HEURISTIC) {
+                if (lp_is_blank(lines[i])) break;
+                if (is_phase_marker(lines[i], mode) && i > seg_start) break;
 
-            /* If we're in a build progress segment and hit a non-progress line
-               that's not just a cmake status line, break */
-            if (seg_type == LP_SEG_BUILD_PROGRESS && !this_is_progress &&
-                line_type == LP_SEG_ERROR) {
-                break;
+                int indent = lp_indent_level(lines[i]);
+                /* A big indent decrease (back to base or less) after indented block = new segment */
+                if (indent < base_indent - 2 && i > seg_start + 1) break;
+
+                /* KEY FIX: If we're in an error segment and hit a normal build
+                   progress line (not itself an error), break the segment here.
+                   This prevents [N/M] Building lines after the error from being
+                   absorbed into the error block. */
+                if (saw_error_content && this_is_progress && line_type == LP_SEG_NORMAL) {
+                    break;
+                }
+
+                /* If we're in a build progress segment and hit a non-progress line
+                   that's not just a cmake status line, break */
+                if (seg_type == LP_SEG_BUILD_PROGRESS && !this_is_progress &&
+                    line_type == LP_SEG_ERROR) {
+                    break;
+                }
+
+                /* Block trigger check */
+                if (is_block_trigger(lines[i], mode) && i > seg_start + 2 &&
+                    seg_type == LP_SEG_NORMAL && line_type == LP_SEG_NORMAL) {
+                    /* Start fresh segment for the triggered block */
+                    break;
+                }
             }
 
             if (line_type == LP_SEG_ERROR) {
@@ -414,17 +695,17 @@ lp_segment *lp_segment_detect(const char **lines, size_t count,
                 /* Non-progress normal line mixed in (e.g. cmake status) — keep extending */
             }
 
-            /* Block trigger check */
-            if (is_block_trigger(lines[i], mode) && i > seg_start + 2 &&
-                seg_type == LP_SEG_NORMAL) {
-                /* Start fresh segment for the triggered block */
-                break;
+            if (act == SEG_ACT_PUSH && depth < SEG_MAX_DEPTH) {
+                if (depth == 0) nest_start = i;
+                nest[depth++] = pair;
             }
-
             i++;
+            if (act == SEG_ACT_POP && --depth == 0) break;
         }
 
+        /* A nested block may have run on past blank lines */
         size_t seg_end = i;
+        while (seg_end > seg_start + 1 && lp_is_blank(lines[seg_end - 1])) seg_end--;
         size_t seg_lines = seg_end - seg_start;
 
         /* Post-classify: if most lines are boilerplate, mark as such */
@@ -443,12 +724,16 @@ lp_segment *lp_segment_detect(const char **lines, size_t count,
         }
 
         /* Check if this segment is tabular data */
-        if (seg_type == LP_SEG_NORMAL && lp_is_tabular(lines + seg_start, seg_lines)) {
+        lp_columns cols;
+        bool tabular = false;
+        if (seg_type == LP_SEG_NORMAL && lp_detect_columns(lines + seg_start, seg_lines, &cols)) {
             seg_type = LP_SEG_DATA;
+            tabular = true;
         }
 
-        push_segment(&segs, lines, seg_start, seg_end, seg_type);
+        push_segment(&segs, lines, seg_start, seg_end, seg_type, tabular ? &cols : NULL);
     }
+    free(rules.pats);
 
     *out_count = segs.len;
     return segs.items;
@@ -457,6 +742,7 @@ lp_segment *lp_segment_detect(const char **lines, size_t count,
 void lp_segment_free(lp_segment *seg) {
     free(seg->label);
     free(seg->lines);
+    free(seg->columns);
 }
 
 void lp_segments_free(lp_segment *segs, size_t count) {
@@ -7,6 +7,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include "util.h"
+#include "mode.h"
 
 /* Segment types */
 typedef enum {
@@ -19,6 +20,16 @@ typedef enum {
     LP_SEG_BOILERPLATE,   /* CMake/west config lines — zero diagnostic value */
     LP_SEG_NORMAL
 } lp_seg_type;
+#define LP_SEG_TYPE_COUNT (LP_SEG_NORMAL + 1)
+
+/* Column layout of a table: byte offsets where each column starts and
+   where the gap after it begins (SIZE_MAX for the last column) */
+#define LP_MAX_COLUMNS 16
+typedef struct {
+    size_t count;
+    size_t start[LP_MAX_COLUMNS];
+    size_t end[LP_MAX_COLUMNS];
+} lp_columns;
 
 /* A detected segment (contiguous block of lines) */
 typedef struct {
@@ -30,6 +41,7 @@ typedef struct {
     size_t       line_count;
     size_t       token_count;
     float        score;         /* Set later by scoring */
+    lp_columns  *columns;       /* LP_SEG_DATA: inferred layout (owned), else NULL */
 } lp_segment;
 
 /* Forward-declare mode struct to avoid circular include */
@@ -58,6 +70,15 @@ bool lp_is_blank(const char *line);
 /* Detect if lines form tabular data (consistent column alignment) */
 bool lp_is_tabular(const char **lines, size_t count);
 
+/* Infer the columns of lines in one pass: a column gap is a run of 2+
+   positions blank in every line with more than one cell. False unless
+   there are 2+ columns and most lines have cells in at least two. */
+bool lp_detect_columns(const char **lines, size_t count, lp_columns *cols);
+
+/* Append line as its trimmed cells joined by '|' (trailing empty cells
+   dropped), or trimmed whole if it spans a gap; no newline */
+void lp_format_row(const char *line, const lp_columns *cols, lp_string *out);
+
 /* Check if a line is a ninja/cmake build progress line like [N/M] Building... */
 bool lp_is_build_progress(const char *line);
 
@@ -74,6 +95,10 @@ bool lp_is_source_context(const char *line);
    "      |   ^~~~"  or  "      ^~~~~"  — pure alignment noise */
 bool lp_is_caret_line(const char *line);
 
+/* Check if a line is an include-chain continuation ("   from <sdk path>:NN,")
+   pointing into SDK sources rather than the user's own code */
+bool lp_is_sdk_include_continuation(const char *line);
+
 /* Line fate: determines whether a line survives to output */
 typedef enum {
     LP_FATE_KEEP,       /* Emit verbatim (errors, warnings, diagnostics) */
@@ -89,4 +114,39 @@ typedef enum {
    otherwise → KEEP. */
 lp_fate lp_line_fate(const char *line, const struct lp_mode *mode);
 
+/* Where in that order a line was decided */
+typedef enum {
+    LP_FATE_STAGE_FIXED,      /* Blank, caret, SDK include chain */
+    LP_FATE_STAGE_KEEP,       /* Generic and mode error/warning patterns */
+    LP_FATE_STAGE_DROP,       /* drop_contains, boilerplate */
+    LP_FATE_STAGE_KEEP_ONCE,  /* keep_once_contains */
+    LP_FATE_STAGE_LATE_DROP,  /* Build progress, compiler commands */
+    LP_FATE_STAGE_DEFAULT     /* Nothing matched: keep */
+} lp_fate_stage;
+
+#define LP_FATE_GENERIC (-1)  /* lp_fate_step.set: the generic literals */
+
+/* One rule of lp_line_fate. Every copy of the rule order (the profiling
+   classifier, the pipeline evaluator, logexplore --profile-mode) walks
+   lp_fate_steps rather than restating it; the first step that matches
+   decides. */
+typedef struct {
+    lp_fate_stage stage;
+    lp_fate       fate;
+    const char   *name;
+    bool        (*check)(const char *line);  /* Fixed check, or NULL */
+    int           set;   /* Without check: lp_pattern_set or LP_FATE_GENERIC */
+} lp_fate_step;
+
+extern const lp_fate_step lp_fate_steps[];
+extern const size_t       lp_fate_step_count;
+
+/* Generic error/warning literals every mode keeps (case-insensitive) */
+extern const char *const lp_fate_generic[];
+extern const size_t      lp_fate_generic_count;
+
+/* lp_line_fate, also reporting the stage that decided (stage may be NULL) */
+lp_fate lp_line_fate_stage(const char *line, const struct lp_mode *mode,
+                           lp_fate_stage *stage);
+
 #endif /* LP_SEGMENT_H */
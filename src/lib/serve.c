@@ -0,0 +1,437 @@
+/*
+ * serve.c — Warm request server over a Unix domain socket
+ *
+ * Request, client to server (one sendmsg, native byte order):
+ *   serve_header   magic "LPS1", argc, payload_len, has_input
+ *   char           payload[payload_len]   cwd\0 arg0\0 arg1\0 ...
+ *   SCM_RIGHTS     stdout, stderr[, input]
+ * Reply: int32_t exit status.
+ */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE                               /* struct ucred for SO_PEERCRED */
+#endif
+#include "serve.h"
+#include "thread.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+int lp_serve(const char *socket_path, size_t workers, lp_serve_fn fn, void *ctx) {
+    (void)socket_path; (void)workers; (void)fn; (void)ctx;
+    fprintf(stderr, "logparse: --serve needs Unix domain sockets (not available on Windows)\n");
+    return 1;
+}
+
+bool lp_serve_request(const char *socket_path, int argc, char *const *argv,
+                      int input_fd, int *status) {
+    (void)socket_path; (void)argc; (void)argv; (void)input_fd; (void)status;
+    return false;
+}
+
+#else /* POSIX */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SERVE_MAX_WORKERS   64
+#define SERVE_MAX_REQUESTS  1000          /* Then the worker is recycled */
+#define SERVE_MAX_PAYLOAD   (1u << 20)
+#define SERVE_MAX_ARGS      4096
+#define SERVE_RECV_TIMEOUT  10            /* Seconds a client may take to send */
+
+typedef struct {
+    char     magic[4];
+    uint32_t argc;
+    uint32_t payload_len;
+    uint32_t has_input;
+} serve_header;
+
+static const char SERVE_MAGIC[4] = { 'L', 'P', 'S', '1' };
+
+static bool socket_address(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) return false;
+    strcpy(addr->sun_path, path);
+    return true;
+}
+
+static bool read_full(int fd, void *buf, size_t len) {
+    char *p = (char *)buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool write_full(int fd, const void *buf, size_t len) {
+    const char *p = (const char *)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* ---- Client ---- */
+
+bool lp_serve_request(const char *socket_path, int argc, char *const *argv,
+                      int input_fd, int *status) {
+    struct sockaddr_un addr;
+    if (!socket_address(socket_path, &addr)) return false;
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) return false;
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(sock);
+        return false;
+    }
+
+    char cwd[4096];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        close(sock);
+        return false;
+    }
+    size_t len = strlen(cwd) + 1;
+    for (int i = 0; i < argc; i++) len += strlen(argv[i]) + 1;
+    if (len > SERVE_MAX_PAYLOAD || argc > SERVE_MAX_ARGS) {
+        close(sock);
+        return false;
+    }
+    char *payload = (char *)malloc(len);
+    size_t pos = strlen(cwd) + 1;
+    memcpy(payload, cwd, pos);
+    for (int i = 0; i < argc; i++) {
+        size_t n = strlen(argv[i]) + 1;
+        memcpy(payload + pos, argv[i], n);
+        pos += n;
+    }
+
+    serve_header h;
+    memcpy(h.magic, SERVE_MAGIC, sizeof(h.magic));
+    h.argc = (uint32_t)argc;
+    h.payload_len = (uint32_t)len;
+    h.has_input = input_fd >= 0;
+
+    int fds[3] = { STDOUT_FILENO, STDERR_FILENO, input_fd };
+    size_t nfds = input_fd >= 0 ? 3 : 2;
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(fds))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct iovec iov[2] = { { &h, sizeof(h) }, { payload, len } };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = CMSG_SPACE(nfds * sizeof(int));
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(nfds * sizeof(int));
+    memcpy(CMSG_DATA(cm), fds, nfds * sizeof(int));
+
+    /* The descriptors ride on the first byte; the rest may need more
+       writes. A worker that dies meanwhile must not take us with it. */
+    struct sigaction ign, old_pipe;
+    memset(&ign, 0, sizeof(ign));
+    ign.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &ign, &old_pipe);
+    ssize_t sent;
+    do sent = sendmsg(sock, &msg, 0); while (sent < 0 && errno == EINTR);
+    bool ok = sent > 0;
+    size_t total = sizeof(h) + len;
+    if (ok && (size_t)sent < total) {
+        size_t done = (size_t)sent;
+        if (done < sizeof(h)) {
+            ok = write_full(sock, (char *)&h + done, sizeof(h) - done) &&
+                 write_full(sock, payload, len);
+        } else {
+            ok = write_full(sock, payload + (done - sizeof(h)), total - done);
+        }
+    }
+    free(payload);
+    sigaction(SIGPIPE, &old_pipe, NULL);
+    if (!ok) {
+        close(sock);
+        return false;
+    }
+
+    /* From here the server owns the request: a lost reply is a failure,
+       not a reason to run it again */
+    int32_t st;
+    if (read_full(sock, &st, sizeof(st))) {
+        *status = st;
+    } else {
+        fprintf(stderr, "logparse: server at '%s' dropped the request\n", socket_path);
+        *status = 1;
+    }
+    close(sock);
+    return true;
+}
+
+/* ---- Worker ---- */
+
+/* Only the server's own user may hand it descriptors and a working
+   directory: the socket is 0600, and this also covers a looser directory
+   or a system that ignores socket file modes */
+static bool peer_is_owner(int conn) {
+#if defined(SO_PEERCRED)
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) return false;
+    uid_t uid = cred.uid;
+#else
+    uid_t uid;
+    gid_t gid;
+    if (getpeereid(conn, &uid, &gid) != 0) return false;
+#endif
+    if (uid == geteuid()) return true;
+    fprintf(stderr, "logparse: refused a request from uid %ld\n", (long)uid);
+    return false;
+}
+
+/* Read one request; fds[] gets stdout, stderr and input (-1 if none) */
+static char *recv_request(int conn, serve_header *h, int fds[3]) {
+    fds[0] = fds[1] = fds[2] = -1;
+    if (!peer_is_owner(conn)) return NULL;
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(3 * sizeof(int))];
+    } control;
+    struct iovec iov = { h, sizeof(*h) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t n;
+    do n = recvmsg(conn, &msg, 0); while (n < 0 && errno == EINTR);
+    if (n <= 0) return NULL;
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) continue;
+        size_t count = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        int got[3];
+        if (count > 3) count = 3;
+        memcpy(got, CMSG_DATA(cm), count * sizeof(int));
+        for (size_t i = 0; i < count; i++) {
+            fcntl(got[i], F_SETFD, FD_CLOEXEC);
+            fds[i] = got[i];
+        }
+    }
+    if ((size_t)n < sizeof(*h) && !read_full(conn, (char *)h + n, sizeof(*h) - (size_t)n))
+        return NULL;
+    if (memcmp(h->magic, SERVE_MAGIC, sizeof(h->magic)) != 0 ||
+        h->payload_len == 0 || h->payload_len > SERVE_MAX_PAYLOAD ||
+        h->argc > SERVE_MAX_ARGS || fds[0] < 0 || fds[1] < 0 ||
+        (h->has_input && fds[2] < 0))
+        return NULL;
+
+    char *payload = (char *)malloc(h->payload_len);
+    if (!read_full(conn, payload, h->payload_len) || payload[h->payload_len - 1] != '\0') {
+        free(payload);
+        return NULL;
+    }
+    return payload;
+}
+
+static void close_fds(int fds[3]) {
+    for (int i = 0; i < 3; i++)
+        if (fds[i] >= 0) close(fds[i]);
+}
+
+static void handle_connection(int conn, lp_serve_fn fn, void *ctx) {
+    serve_header h;
+    int fds[3];
+    char *payload = recv_request(conn, &h, fds);
+    if (!payload) {
+        close_fds(fds);
+        return;
+    }
+
+    /* Split cwd and argv out of the payload */
+    char **argv = (char **)malloc((h.argc + 1) * sizeof(char *));
+    char *p = payload, *end = payload + h.payload_len;
+    const char *cwd = p;
+    p += strlen(p) + 1;
+    uint32_t argc = 0;
+    while (argc < h.argc && p < end) {
+        argv[argc++] = p;
+        p += strlen(p) + 1;
+    }
+    argv[argc] = NULL;
+
+    /* The client's stdout/stderr stand in for ours while the handler runs */
+    fflush(stdout);
+    fflush(stderr);
+    int saved_out = dup(STDOUT_FILENO), saved_err = dup(STDERR_FILENO);
+    dup2(fds[0], STDOUT_FILENO);
+    dup2(fds[1], STDERR_FILENO);
+
+    int status = 1;
+    int input_fd = h.has_input ? fds[2] : -1;
+    fds[2] = -1;                                  /* The handler owns it now */
+    if (chdir(cwd) != 0) {
+        fprintf(stderr, "logparse: server cannot enter '%s'\n", cwd);
+        if (input_fd >= 0) close(input_fd);
+    } else {
+        status = fn(ctx, (int)argc, argv, input_fd);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(saved_out, STDOUT_FILENO);
+    dup2(saved_err, STDERR_FILENO);
+    close(saved_out);
+    close(saved_err);
+    close_fds(fds);
+
+    int32_t st = status;
+    write_full(conn, &st, sizeof(st));
+    free(argv);
+    free(payload);
+}
+
+static void worker_main(int listen_fd, lp_serve_fn fn, void *ctx) {
+    signal(SIGINT, SIG_IGN);                      /* Ctrl-C reaches the parent, which stops us */
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGPIPE, SIG_IGN);                     /* A client that hangs up costs its request */
+    for (size_t served = 0; served < SERVE_MAX_REQUESTS; ) {
+        int conn = accept(listen_fd, NULL, NULL);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        struct timeval tv = { SERVE_RECV_TIMEOUT, 0 };
+        setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        handle_connection(conn, fn, ctx);
+        close(conn);
+        served++;
+    }
+}
+
+/* ---- Server ---- */
+
+static volatile sig_atomic_t serve_stop;
+
+static void on_stop(int sig) {
+    (void)sig;
+    serve_stop = 1;
+}
+
+static pid_t spawn_worker(int listen_fd, lp_serve_fn fn, void *ctx) {
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        worker_main(listen_fd, fn, ctx);
+        _exit(0);
+    }
+    return pid;
+}
+
+/* Bind, replacing a stale socket file but never a live server. The socket
+   is created owner-only (0600) and stays so until it listens. */
+static int bind_socket(const char *path) {
+    struct sockaddr_un addr;
+    if (!socket_address(path, &addr)) {
+        fprintf(stderr, "logparse: socket path too long: '%s'\n", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    mode_t old_mask = umask(077);
+    int rc = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    if (rc != 0 && errno == EADDRINUSE) {
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool live = probe >= 0 && connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+        if (probe >= 0) close(probe);
+        if (live) {
+            umask(old_mask);
+            fprintf(stderr, "logparse: a server is already listening on '%s'\n", path);
+            close(fd);
+            return -1;
+        }
+        unlink(path);
+        rc = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    }
+    umask(old_mask);
+    if (rc != 0 || chmod(path, 0600) != 0 || listen(fd, 64) != 0) {
+        fprintf(stderr, "logparse: cannot listen on '%s'\n", path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int lp_serve(const char *socket_path, size_t workers, lp_serve_fn fn, void *ctx) {
+    int listen_fd = bind_socket(socket_path);
+    if (listen_fd < 0) return 1;
+    fcntl(listen_fd, F_SETFD, FD_CLOEXEC);
+
+    if (workers == 0) workers = lp_cpu_count();
+    if (workers > SERVE_MAX_WORKERS) workers = SERVE_MAX_WORKERS;
+
+    /* No SA_RESTART: wait() must return so the pool can shut down */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    pid_t pids[SERVE_MAX_WORKERS];
+    for (size_t w = 0; w < workers; w++)
+        pids[w] = spawn_worker(listen_fd, fn, ctx);
+    fprintf(stderr, "logparse: serving on '%s' with %zu worker%s\n",
+            socket_path, workers, workers == 1 ? "" : "s");
+
+    /* Replace workers that exit (recycled or crashed) until told to stop */
+    while (!serve_stop) {
+        int st;
+        pid_t pid = wait(&st);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (size_t w = 0; w < workers; w++) {
+            if (pids[w] != pid) continue;
+            if (WIFSIGNALED(st) && !serve_stop)
+                fprintf(stderr, "logparse: worker %ld died (signal %d), restarting\n",
+                        (long)pid, WTERMSIG(st));
+            pids[w] = serve_stop ? -1 : spawn_worker(listen_fd, fn, ctx);
+        }
+    }
+
+    for (size_t w = 0; w < workers; w++)
+        if (pids[w] > 0) kill(pids[w], SIGTERM);
+    while (wait(NULL) > 0 || errno == EINTR) {}
+    close(listen_fd);
+    unlink(socket_path);
+    return 0;
+}
+
+#endif
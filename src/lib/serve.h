@@ -0,0 +1,41 @@
+/*
+ * serve.h — Warm request server over a Unix domain socket
+ *
+ * The server sets up its state once (modes loaded, matchers built, heap
+ * grown), then forks a pool of workers that inherit it. Each worker
+ * accepts one connection at a time. A request carries the client's
+ * working directory and arguments. It also carries, over SCM_RIGHTS, the
+ * client's stdout and stderr and optionally an open input file. The
+ * handler therefore writes straight into the client's terminal or pipe
+ * and can map the input in place. The reply is the handler's exit status.
+ * The socket is created 0600, and connections from any other user are
+ * refused.
+ *
+ * Workers are processes rather than threads, so the regex engine's static
+ * state stays private. A crash loses one request and the worker is
+ * replaced. POSIX only: on Windows lp_serve fails and lp_serve_request
+ * always asks the caller to run in-process.
+ */
+#ifndef LP_SERVE_H
+#define LP_SERVE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Handle one request in a worker. stdout/stderr are the client's while it
+   runs. input_fd is the client's input (-1: none; the handler owns it). */
+typedef int (*lp_serve_fn)(void *ctx, int argc, char **argv, int input_fd);
+
+/* Serve on socket_path with `workers` processes (0 = lp_cpu_count())
+   until SIGINT or SIGTERM, then remove the socket. Returns 0 on a clean
+   shutdown, 1 if the socket cannot be set up (message on stderr). */
+int lp_serve(const char *socket_path, size_t workers, lp_serve_fn fn, void *ctx);
+
+/* Run argv on the server at socket_path with input_fd (-1: none; it stays
+   open) and this process's stdout/stderr; *status gets the exit status.
+   False if no server took the request: nothing was written, so run it
+   in-process instead. */
+bool lp_serve_request(const char *socket_path, int argc, char *const *argv,
+                      int input_fd, int *status);
+
+#endif /* LP_SERVE_H */
@@ -0,0 +1,103 @@
+/*
+ * sketch.c — HyperLogLog and space-saving top-k
+ */
+#include "sketch.h"
+
+#include <string.h>
+#include <math.h>
+
+/* splitmix64 finaliser: FNV-1a low bits are too correlated for HLL */
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+void lp_hll_init(lp_hll *h) {
+    memset(h->reg, 0, sizeof(h->reg));
+}
+
+void lp_hll_add(lp_hll *h, uint64_t hash) {
+    uint64_t x = mix64(hash);
+    size_t idx = (size_t)(x >> (64 - LP_HLL_P));
+    uint64_t rest = x << LP_HLL_P;
+    uint8_t rank = 1;
+    while (rank <= 64 - LP_HLL_P && !(rest & 0x8000000000000000ULL)) {
+        rank++;
+        rest <<= 1;
+    }
+    if (rank > h->reg[idx]) h->reg[idx] = rank;
+}
+
+double lp_hll_estimate(const lp_hll *h) {
+    const double m = (double)LP_HLL_M;
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < LP_HLL_M; i++) {
+        sum += ldexp(1.0, -(int)h->reg[i]);
+        if (h->reg[i] == 0) zeros++;
+    }
+    double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double est = alpha * m * m / sum;
+    /* Small range: linear counting is near-exact while registers are empty */
+    if (est <= 2.5 * m && zeros > 0)
+        est = m * log(m / (double)zeros);
+    return est;
+}
+
+void lp_hll_merge(lp_hll *dst, const lp_hll *src) {
+    for (size_t i = 0; i < LP_HLL_M; i++) {
+        if (src->reg[i] > dst->reg[i]) dst->reg[i] = src->reg[i];
+    }
+}
+
+void lp_topk_init(lp_topk *t) {
+    memset(t, 0, sizeof(*t));
+}
+
+void lp_topk_add(lp_topk *t, uint64_t hash) {
+    for (size_t i = 0; i < t->used; i++) {
+        if (t->hash[i] == hash) {
+            t->count[i]++;
+            return;
+        }
+    }
+    if (t->used < LP_TOPK_SIZE) {
+        t->hash[t->used] = hash;
+        t->count[t->used++] = 1;
+        return;
+    }
+    /* Space-saving: evict the minimum, inheriting its count */
+    size_t min = 0;
+    for (size_t i = 1; i < LP_TOPK_SIZE; i++) {
+        if (t->count[i] < t->count[min]) min = i;
+    }
+    t->hash[min] = hash;
+    t->error[min] = t->count[min];
+    t->count[min]++;
+}
+
+double lp_sketch_entropy(const lp_topk *t, uint64_t n, double distinct) {
+    if (n == 0) return 0.0;
+    double total = (double)n, heavy = 0.0, h = 0.0, heavy_values = 0.0;
+    for (size_t i = 0; i < t->used && heavy < total; i++) {
+        double c = (double)(t->count[i] - t->error[i]);
+        if (heavy + c > total) c = total - heavy;
+        if (c <= 0.0) continue;
+        heavy += c;
+        heavy_values += 1.0;
+        double p = c / total;
+        h -= p * log2(p);
+    }
+    double rest = total - heavy;
+    if (rest > 0.0) {
+        double tail = distinct - heavy_values;
+        if (tail < 1.0) tail = 1.0;
+        if (tail > rest) tail = rest;
+        h += (rest / total) * log2(total * tail / rest);
+    }
+    return h;
+}
@@ -0,0 +1,42 @@
+/*
+ * sketch.h — Fixed-size cardinality and frequency sketches
+ *
+ * HyperLogLog estimates distinct counts in 1 KiB regardless of input
+ * size; a space-saving top-k table tracks the heaviest values. Together
+ * they give a bounded-memory estimate of a value stream's entropy.
+ */
+#ifndef LP_SKETCH_H
+#define LP_SKETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LP_HLL_P     10
+#define LP_HLL_M     (1u << LP_HLL_P)   /* Registers; ~3.3% standard error */
+#define LP_TOPK_SIZE 16
+
+typedef struct {
+    uint8_t reg[LP_HLL_M];
+} lp_hll;
+
+typedef struct {
+    uint64_t hash[LP_TOPK_SIZE];
+    uint64_t count[LP_TOPK_SIZE];   /* Over-estimates once the table is full */
+    uint64_t error[LP_TOPK_SIZE];   /* Max over-estimate: count - error is a lower bound */
+    size_t   used;
+} lp_topk;
+
+void   lp_hll_init(lp_hll *h);
+/* Add a value by its hash (any 64-bit hash; it is re-mixed internally) */
+void   lp_hll_add(lp_hll *h, uint64_t hash);
+double lp_hll_estimate(const lp_hll *h);
+void   lp_hll_merge(lp_hll *dst, const lp_hll *src);
+
+void   lp_topk_init(lp_topk *t);
+void   lp_topk_add(lp_topk *t, uint64_t hash);
+
+/* Shannon entropy in bits of a stream of n values with ~distinct distinct
+   values: guaranteed mass for the top-k, the remainder assumed uniform. */
+double lp_sketch_entropy(const lp_topk *t, uint64_t n, double distinct);
+
+#endif /* LP_SKETCH_H */
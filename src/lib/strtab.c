@@ -0,0 +1,206 @@
+/*
+ * strtab.c — Persistent string table: typed keys to string values
+ *
+ * File layout (native byte order; it is a per-machine cache):
+ *   char           magic[8]     owner's
+ *   uint64_t       stamp        owner's hash of the sources
+ *   uint32_t       slot_count   power of 2
+ *   uint32_t       pool_len
+ *   uint32_t       user         owner-defined
+ *   uint32_t       reserved
+ *   lp_strtab_slot slots[slot_count]
+ *   char           pool[pool_len]   keys ("<kind><name>\0") and values ("...\0")
+ */
+#include "strtab.h"
+#include "dedup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+typedef struct {
+    char     magic[8];
+    uint64_t stamp;
+    uint32_t slot_count;
+    uint32_t pool_len;
+    uint32_t user;
+    uint32_t reserved;
+} strtab_header;
+
+static uint64_t key_hash(char kind, const char *name, size_t len) {
+    char k[1] = { kind };
+    uint64_t h = lp_fnv1a(k, 1) ^ lp_fnv1a(name, len) * 31;
+    return h ? h : 1;
+}
+
+/* Slot holding (kind, name), or the empty slot where it would go.
+   Offsets are bounds-checked so a damaged file cannot read past the pool. */
+static const lp_strtab_slot *probe(const lp_strtab_slot *slots, size_t slot_count,
+                                   const char *pool, size_t pool_len,
+                                   uint64_t h, char kind, const char *name, size_t len) {
+    size_t mask = slot_count - 1;
+    for (size_t i = (size_t)h & mask, n = 0; n < slot_count; i = (i + 1) & mask, n++) {
+        const lp_strtab_slot *s = &slots[i];
+        if (s->hash == 0) return s;
+        if (s->hash != h || (size_t)s->key + len + 2 > pool_len) continue;
+        const char *k = pool + s->key;
+        if (k[0] == kind && memcmp(k + 1, name, len) == 0 && k[len + 1] == '\0') return s;
+    }
+    return NULL;
+}
+
+/* ---- Building ---- */
+
+static void grow(lp_strtab_builder *b) {
+    lp_strtab_slot *old = b->slots;
+    size_t old_count = b->slot_count;
+    b->slot_count = old_count ? old_count * 2 : 256;
+    b->slots = (lp_strtab_slot *)calloc(b->slot_count, sizeof(lp_strtab_slot));
+    size_t mask = b->slot_count - 1;
+    for (size_t i = 0; i < old_count; i++) {
+        if (old[i].hash == 0) continue;
+        size_t j = (size_t)old[i].hash & mask;
+        while (b->slots[j].hash != 0) j = (j + 1) & mask;
+        b->slots[j] = old[i];
+    }
+    free(old);
+}
+
+static uint32_t pool_add(lp_strtab_builder *b, char kind, const char *s, size_t len) {
+    size_t need = b->pool_len + len + 2;
+    if (need > b->pool_cap) {
+        while (b->pool_cap < need) b->pool_cap = b->pool_cap ? b->pool_cap * 2 : 4096;
+        b->pool = (char *)realloc(b->pool, b->pool_cap);
+    }
+    uint32_t off = (uint32_t)b->pool_len;
+    if (kind) b->pool[b->pool_len++] = kind;
+    if (len) memcpy(b->pool + b->pool_len, s, len);
+    b->pool_len += len;
+    b->pool[b->pool_len++] = '\0';
+    return off;
+}
+
+void lp_strtab_builder_init(lp_strtab_builder *b) {
+    memset(b, 0, sizeof(*b));
+    grow(b);
+}
+
+void lp_strtab_put(lp_strtab_builder *b, char kind, const char *name, size_t len,
+                   const char *value, size_t value_len) {
+    if ((b->used + 1) * 2 > b->slot_count) grow(b);
+    uint64_t h = key_hash(kind, name, len);
+    lp_strtab_slot *s = (lp_strtab_slot *)probe(b->slots, b->slot_count, b->pool,
+                                                b->pool_len, h, kind, name, len);
+    if (s->hash != 0) return;
+    s->hash = h;
+    s->key = pool_add(b, kind, name, len);
+    s->value = pool_add(b, 0, value, value_len);
+    b->used++;
+}
+
+const char *lp_strtab_builder_get(const lp_strtab_builder *b, char kind,
+                                  const char *name, size_t len) {
+    const lp_strtab_slot *s = probe(b->slots, b->slot_count, b->pool, b->pool_len,
+                                    key_hash(kind, name, len), kind, name, len);
+    return s && s->hash ? b->pool + s->value : NULL;
+}
+
+static bool write_image(const char *path, const char *image, size_t len) {
+    char tmp[1100];
+#ifdef _WIN32
+    snprintf(tmp, sizeof(tmp), "%s.tmp%d", path, _getpid());
+#else
+    snprintf(tmp, sizeof(tmp), "%s.tmp%d", path, (int)getpid());
+#endif
+    lp_make_parent_dirs(path);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) return false;
+    bool ok = fwrite(image, 1, len, fp) == len;
+    if (fclose(fp) != 0) ok = false;
+#ifdef _WIN32
+    if (ok) ok = MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    if (ok) ok = rename(tmp, path) == 0;
+#endif
+    if (!ok) remove(tmp);
+    return ok;
+}
+
+/* Point t at a table image; false if it is foreign or stale */
+static bool attach(lp_strtab *t, const char magic[8], uint64_t stamp) {
+    strtab_header h;
+    if (t->file.len < sizeof(h)) return false;
+    memcpy(&h, t->file.data, sizeof(h));
+    size_t want = sizeof(h) + (size_t)h.slot_count * sizeof(lp_strtab_slot) + h.pool_len;
+    if (memcmp(h.magic, magic, sizeof(h.magic)) != 0 || h.stamp != stamp ||
+        h.slot_count == 0 || (h.slot_count & (h.slot_count - 1)) != 0 ||
+        t->file.len != want || h.pool_len == 0)
+        return false;
+    t->slots = (const lp_strtab_slot *)(t->file.data + sizeof(h));
+    t->slot_count = h.slot_count;
+    t->pool = (const char *)(t->slots + h.slot_count);
+    t->pool_len = h.pool_len;
+    t->user = h.user;
+    return t->pool[t->pool_len - 1] == '\0';
+}
+
+void lp_strtab_finish(lp_strtab_builder *b, const char magic[8], uint64_t stamp,
+                      uint32_t user, const char *path, lp_strtab *t) {
+    strtab_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, magic, sizeof(h.magic));
+    h.stamp = stamp;
+    h.slot_count = (uint32_t)b->slot_count;
+    h.pool_len = (uint32_t)b->pool_len;
+    h.user = user;
+
+    size_t slots_len = b->slot_count * sizeof(lp_strtab_slot);
+    size_t image_len = sizeof(h) + slots_len + b->pool_len;
+    char *image = (char *)malloc(image_len);
+    memcpy(image, &h, sizeof(h));
+    memcpy(image + sizeof(h), b->slots, slots_len);
+    memcpy(image + sizeof(h) + slots_len, b->pool, b->pool_len);
+    free(b->slots);
+    free(b->pool);
+    memset(b, 0, sizeof(*b));
+
+    if (path) write_image(path, image, image_len);
+
+    /* Serve this run from the heap image; the next one maps the file */
+    memset(t, 0, sizeof(*t));
+    t->file.data = image;
+    t->file.len = image_len;
+    t->file.handle = image;
+    t->file.mapped = false;
+    attach(t, magic, stamp);
+}
+
+/* ---- Reading ---- */
+
+bool lp_strtab_open(lp_strtab *t, const char *path, const char magic[8], uint64_t stamp) {
+    memset(t, 0, sizeof(*t));
+    if (!lp_map_file(path, &t->file)) return false;
+    if (attach(t, magic, stamp)) return true;
+    lp_strtab_close(t);
+    return false;
+}
+
+void lp_strtab_close(lp_strtab *t) {
+    lp_unmap_file(&t->file);
+    memset(t, 0, sizeof(*t));
+}
+
+const char *lp_strtab_get(const lp_strtab *t, char kind, const char *name, size_t len) {
+    if (!t->slots) return NULL;
+    const lp_strtab_slot *s = probe(t->slots, t->slot_count, t->pool, t->pool_len,
+                                    key_hash(kind, name, len), kind, name, len);
+    if (!s || s->hash == 0 || s->value >= t->pool_len) return NULL;
+    return t->pool + s->value;
+}
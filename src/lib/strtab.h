@@ -0,0 +1,64 @@
+/*
+ * strtab.h — Persistent string table: typed keys to string values
+ *
+ * An open-addressing hash table whose keys ("<kind byte><name>") and
+ * values live in one string pool. It is built in memory, written once to
+ * a cache file (temp file + rename) and afterwards mapped and probed in
+ * place, so a lookup costs one hash and a probe regardless of how large
+ * the sources it was built from are. Each file carries the owner's magic
+ * and a stamp of its sources; a mismatch on either means rebuild.
+ */
+#ifndef LP_STRTAB_H
+#define LP_STRTAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "util.h"
+
+typedef struct {
+    uint64_t hash;         /* 0 = empty slot */
+    uint32_t key;          /* Offset of the NUL-terminated key in the pool */
+    uint32_t value;        /* Offset of the NUL-terminated value */
+} lp_strtab_slot;
+
+typedef struct {
+    lp_mapped_file        file;
+    const lp_strtab_slot *slots;
+    size_t                slot_count;   /* Power of 2 */
+    const char           *pool;
+    size_t                pool_len;
+    uint32_t              user;         /* Owner-defined header word */
+} lp_strtab;
+
+typedef struct {
+    char           *pool;
+    size_t          pool_len;
+    size_t          pool_cap;
+    lp_strtab_slot *slots;
+    size_t          slot_count;
+    size_t          used;
+} lp_strtab_builder;
+
+void lp_strtab_builder_init(lp_strtab_builder *b);
+
+/* Add a key; the first value put for a key wins */
+void lp_strtab_put(lp_strtab_builder *b, char kind, const char *name, size_t len,
+                   const char *value, size_t value_len);
+const char *lp_strtab_builder_get(const lp_strtab_builder *b, char kind,
+                                  const char *name, size_t len);
+
+/* Consume the builder into t. Writes the table to path when non-NULL (a
+   failed write is not an error: t is then served from memory). */
+void lp_strtab_finish(lp_strtab_builder *b, const char magic[8], uint64_t stamp,
+                      uint32_t user, const char *path, lp_strtab *t);
+
+/* Map the table at path: false if missing, foreign, stale or damaged */
+bool lp_strtab_open(lp_strtab *t, const char *path, const char magic[8], uint64_t stamp);
+void lp_strtab_close(lp_strtab *t);
+
+/* Value for a key, or NULL */
+const char *lp_strtab_get(const lp_strtab *t, char kind, const char *name, size_t len);
+
+#endif /* LP_STRTAB_H */
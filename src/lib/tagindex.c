@@ -0,0 +1,525 @@
+/*
+ * tagindex.c — Interned fix tags with compressed bitmaps over fix ids
+ */
+#include "tagindex.h"
+#include "dedup.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define WORDS 1024   /* 65536 bits per bitset container */
+
+/* ---- Containers ---- */
+
+static unsigned popcount64(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (unsigned)((x * 0x0101010101010101ULL) >> 56);
+}
+
+static void container_free(lp_bitmap_container *c) {
+    free(c->array);
+    free(c->bits);
+    c->array = NULL;
+    c->bits = NULL;
+}
+
+static bool container_has(const lp_bitmap_container *c, uint16_t low) {
+    if (c->is_bitset) return (c->bits[low >> 6] >> (low & 63)) & 1;
+    size_t lo = 0, hi = c->card;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (c->array[mid] < low) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < c->card && c->array[lo] == low;
+}
+
+static void container_to_words(const lp_bitmap_container *c, uint64_t *w) {
+    if (c->is_bitset) {
+        memcpy(w, c->bits, WORDS * sizeof(uint64_t));
+        return;
+    }
+    memset(w, 0, WORDS * sizeof(uint64_t));
+    for (uint32_t i = 0; i < c->card; i++)
+        w[c->array[i] >> 6] |= 1ULL << (c->array[i] & 63);
+}
+
+/* Pick the representation by cardinality; card 0 means "skip" */
+static lp_bitmap_container container_from_words(uint16_t key, const uint64_t *w) {
+    lp_bitmap_container c;
+    memset(&c, 0, sizeof(c));
+    c.key = key;
+    for (size_t i = 0; i < WORDS; i++) c.card += popcount64(w[i]);
+    if (c.card == 0) return c;
+    if (c.card > LP_BITMAP_ARRAY_MAX) {
+        c.is_bitset = true;
+        c.bits = (uint64_t *)malloc(WORDS * sizeof(uint64_t));
+        memcpy(c.bits, w, WORDS * sizeof(uint64_t));
+        return c;
+    }
+    c.cap = c.card;
+    c.array = (uint16_t *)malloc(c.cap * sizeof(uint16_t));
+    uint32_t n = 0;
+    for (size_t i = 0; i < WORDS; i++) {
+        for (uint64_t bits = w[i]; bits; bits &= bits - 1) {
+            unsigned b = 0;
+            while (!((bits >> b) & 1)) b++;
+            c.array[n++] = (uint16_t)(i * 64 + b);
+        }
+    }
+    return c;
+}
+
+static lp_bitmap_container container_copy(const lp_bitmap_container *src) {
+    lp_bitmap_container c = *src;
+    if (src->is_bitset) {
+        c.bits = (uint64_t *)malloc(WORDS * sizeof(uint64_t));
+        memcpy(c.bits, src->bits, WORDS * sizeof(uint64_t));
+    } else {
+        c.cap = src->card;
+        c.array = (uint16_t *)malloc((c.cap ? c.cap : 1) * sizeof(uint16_t));
+        memcpy(c.array, src->array, src->card * sizeof(uint16_t));
+    }
+    return c;
+}
+
+static void container_add(lp_bitmap_container *c, uint16_t low) {
+    if (c->is_bitset) {
+        uint64_t bit = 1ULL << (low & 63);
+        if (!(c->bits[low >> 6] & bit)) {
+            c->bits[low >> 6] |= bit;
+            c->card++;
+        }
+        return;
+    }
+    size_t lo = 0, hi = c->card;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (c->array[mid] < low) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < c->card && c->array[lo] == low) return;
+
+    if (c->card == LP_BITMAP_ARRAY_MAX) {
+        uint64_t *w = (uint64_t *)calloc(WORDS, sizeof(uint64_t));
+        container_to_words(c, w);
+        w[low >> 6] |= 1ULL << (low & 63);
+        free(c->array);
+        c->array = NULL;
+        c->bits = w;
+        c->is_bitset = true;
+        c->card++;
+        return;
+    }
+    if (c->card == c->cap) {
+        c->cap = c->cap ? c->cap * 2 : 4;
+        if (c->cap > LP_BITMAP_ARRAY_MAX) c->cap = LP_BITMAP_ARRAY_MAX;
+        c->array = (uint16_t *)realloc(c->array, c->cap * sizeof(uint16_t));
+    }
+    memmove(c->array + lo + 1, c->array + lo, (c->card - lo) * sizeof(uint16_t));
+    c->array[lo] = low;
+    c->card++;
+}
+
+/* ---- Bitmaps ---- */
+
+void lp_bitmap_init(lp_bitmap *b) {
+    memset(b, 0, sizeof(*b));
+}
+
+void lp_bitmap_free(lp_bitmap *b) {
+    for (size_t i = 0; i < b->count; i++) container_free(&b->c[i]);
+    free(b->c);
+    memset(b, 0, sizeof(*b));
+}
+
+static void push_container(lp_bitmap *b, lp_bitmap_container c) {
+    if (c.card == 0) {
+        container_free(&c);
+        return;
+    }
+    if (b->count >= b->cap) {
+        b->cap = b->cap ? b->cap * 2 : 4;
+        b->c = (lp_bitmap_container *)realloc(b->c, b->cap * sizeof(lp_bitmap_container));
+    }
+    b->c[b->count++] = c;
+}
+
+/* Index of the container for key, or -(insertion point) - 1 */
+static long find_container(const lp_bitmap *b, uint16_t key) {
+    size_t lo = 0, hi = b->count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (b->c[mid].key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < b->count && b->c[lo].key == key) return (long)lo;
+    return -(long)lo - 1;
+}
+
+void lp_bitmap_add(lp_bitmap *b, uint32_t v) {
+    uint16_t key = (uint16_t)(v >> 16);
+    long at = find_container(b, key);
+    if (at < 0) {
+        size_t pos = (size_t)(-at - 1);
+        if (b->count >= b->cap) {
+            b->cap = b->cap ? b->cap * 2 : 4;
+            b->c = (lp_bitmap_container *)realloc(b->c, b->cap * sizeof(lp_bitmap_container));
+        }
+        memmove(b->c + pos + 1, b->c + pos, (b->count - pos) * sizeof(lp_bitmap_container));
+        memset(&b->c[pos], 0, sizeof(lp_bitmap_container));
+        b->c[pos].key = key;
+        b->count++;
+        at = (long)pos;
+    }
+    container_add(&b->c[at], (uint16_t)(v & 0xffff));
+}
+
+bool lp_bitmap_contains(const lp_bitmap *b, uint32_t v) {
+    long at = find_container(b, (uint16_t)(v >> 16));
+    return at >= 0 && container_has(&b->c[at], (uint16_t)(v & 0xffff));
+}
+
+size_t lp_bitmap_cardinality(const lp_bitmap *b) {
+    size_t n = 0;
+    for (size_t i = 0; i < b->count; i++) n += b->c[i].card;
+    return n;
+}
+
+static lp_bitmap_container array_container(uint16_t key, uint32_t cap) {
+    lp_bitmap_container c;
+    memset(&c, 0, sizeof(c));
+    c.key = key;
+    c.cap = cap;
+    c.array = (uint16_t *)malloc((cap ? cap : 1) * sizeof(uint16_t));
+    return c;
+}
+
+lp_bitmap lp_bitmap_and(const lp_bitmap *a, const lp_bitmap *b) {
+    lp_bitmap out;
+    lp_bitmap_init(&out);
+    uint64_t *wa = NULL;
+    size_t i = 0, j = 0;
+    while (i < a->count && j < b->count) {
+        const lp_bitmap_container *ca = &a->c[i], *cb = &b->c[j];
+        if (ca->key < cb->key) { i++; continue; }
+        if (cb->key < ca->key) { j++; continue; }
+
+        if (!ca->is_bitset || !cb->is_bitset) {
+            /* Probe the smaller array against the other container */
+            const lp_bitmap_container *small = ca, *other = cb;
+            if (ca->is_bitset || (!cb->is_bitset && cb->card < ca->card)) {
+                small = cb;
+                other = ca;
+            }
+            lp_bitmap_container c = array_container(ca->key, small->card);
+            for (uint32_t k = 0; k < small->card; k++) {
+                if (container_has(other, small->array[k])) c.array[c.card++] = small->array[k];
+            }
+            push_container(&out, c);
+        } else {
+            if (!wa) wa = (uint64_t *)malloc(WORDS * sizeof(uint64_t));
+            for (size_t w = 0; w < WORDS; w++) wa[w] = ca->bits[w] & cb->bits[w];
+            push_container(&out, container_from_words(ca->key, wa));
+        }
+        i++;
+        j++;
+    }
+    free(wa);
+    return out;
+}
+
+lp_bitmap lp_bitmap_or(const lp_bitmap *a, const lp_bitmap *b) {
+    lp_bitmap out;
+    lp_bitmap_init(&out);
+    uint64_t *wa = NULL, *wb = NULL;
+    size_t i = 0, j = 0;
+    while (i < a->count || j < b->count) {
+        if (j >= b->count || (i < a->count && a->c[i].key < b->c[j].key)) {
+            push_container(&out, container_copy(&a->c[i++]));
+            continue;
+        }
+        if (i >= a->count || b->c[j].key < a->c[i].key) {
+            push_container(&out, container_copy(&b->c[j++]));
+            continue;
+        }
+        const lp_bitmap_container *ca = &a->c[i], *cb = &b->c[j];
+        if (!ca->is_bitset && !cb->is_bitset && ca->card + cb->card <= LP_BITMAP_ARRAY_MAX) {
+            lp_bitmap_container c = array_container(ca->key, ca->card + cb->card);
+            uint32_t x = 0, y = 0;
+            while (x < ca->card || y < cb->card) {
+                uint16_t v;
+                if (y >= cb->card || (x < ca->card && ca->array[x] < cb->array[y])) {
+                    v = ca->array[x++];
+                } else if (x >= ca->card || cb->array[y] < ca->array[x]) {
+                    v = cb->array[y++];
+                } else {
+                    v = ca->array[x++];
+                    y++;
+                }
+                c.array[c.card++] = v;
+            }
+            push_container(&out, c);
+        } else {
+            if (!wa) {
+                wa = (uint64_t *)malloc(WORDS * sizeof(uint64_t));
+                wb = (uint64_t *)malloc(WORDS * sizeof(uint64_t));
+            }
+            container_to_words(ca, wa);
+            container_to_words(cb, wb);
+            for (size_t w = 0; w < WORDS; w++) wa[w] |= wb[w];
+            push_container(&out, container_from_words(ca->key, wa));
+        }
+        i++;
+        j++;
+    }
+    free(wa);
+    free(wb);
+    return out;
+}
+
+lp_bitmap lp_bitmap_andnot(const lp_bitmap *a, const lp_bitmap *b) {
+    lp_bitmap out;
+    lp_bitmap_init(&out);
+    uint64_t *wa = NULL, *wb = NULL;
+    for (size_t i = 0; i < a->count; i++) {
+        const lp_bitmap_container *ca = &a->c[i];
+        long at = find_container(b, ca->key);
+        if (at < 0) {
+            push_container(&out, container_copy(ca));
+            continue;
+        }
+        const lp_bitmap_container *cb = &b->c[at];
+        if (!ca->is_bitset) {
+            lp_bitmap_container c = array_container(ca->key, ca->card);
+            for (uint32_t k = 0; k < ca->card; k++) {
+                if (!container_has(cb, ca->array[k])) c.array[c.card++] = ca->array[k];
+            }
+            push_container(&out, c);
+        } else {
+            if (!wa) {
+                wa = (uint64_t *)malloc(WORDS * sizeof(uint64_t));
+                wb = (uint64_t *)malloc(WORDS * sizeof(uint64_t));
+            }
+            container_to_words(cb, wb);
+            for (size_t w = 0; w < WORDS; w++) wa[w] = ca->bits[w] & ~wb[w];
+            push_container(&out, container_from_words(ca->key, wa));
+        }
+    }
+    free(wa);
+    free(wb);
+    return out;
+}
+
+lp_bitmap lp_bitmap_range(uint32_t n) {
+    lp_bitmap out;
+    lp_bitmap_init(&out);
+    uint64_t *w = (uint64_t *)malloc(WORDS * sizeof(uint64_t));
+    for (uint32_t base = 0; base < n; base += 65536) {
+        uint32_t span = n - base < 65536 ? n - base : 65536;
+        memset(w, 0, WORDS * sizeof(uint64_t));
+        for (uint32_t k = 0; k < span / 64; k++) w[k] = ~0ULL;
+        if (span % 64) w[span / 64] = (1ULL << (span % 64)) - 1;
+        push_container(&out, container_from_words((uint16_t)(base >> 16), w));
+        if (base + span < base) break;   /* Wrapped at 2^32 */
+    }
+    free(w);
+    return out;
+}
+
+uint32_t *lp_bitmap_to_array(const lp_bitmap *b, size_t *count) {
+    *count = lp_bitmap_cardinality(b);
+    uint32_t *out = (uint32_t *)malloc((*count ? *count : 1) * sizeof(uint32_t));
+    size_t n = 0;
+    for (size_t i = 0; i < b->count; i++) {
+        const lp_bitmap_container *c = &b->c[i];
+        uint32_t high = (uint32_t)c->key << 16;
+        if (!c->is_bitset) {
+            for (uint32_t k = 0; k < c->card; k++) out[n++] = high | c->array[k];
+            continue;
+        }
+        for (uint32_t w = 0; w < WORDS; w++) {
+            for (uint64_t bits = c->bits[w]; bits; bits &= bits - 1) {
+                unsigned bit = 0;
+                while (!((bits >> bit) & 1)) bit++;
+                out[n++] = high | (w * 64 + bit);
+            }
+        }
+    }
+    return out;
+}
+
+/* ---- Tag index ---- */
+
+static size_t tag_slot(const lp_tag_index *ti, const char *tag) {
+    size_t h = (size_t)lp_fnv1a(tag, strlen(tag)) & ti->slot_mask;
+    while (ti->slots[h] && strcmp(ti->names[ti->slots[h] - 1], tag) != 0)
+        h = (h + 1) & ti->slot_mask;
+    return h;
+}
+
+static void grow_slots(lp_tag_index *ti) {
+    size_t size = ti->slots ? (ti->slot_mask + 1) * 2 : 64;
+    free(ti->slots);
+    ti->slots = (uint32_t *)calloc(size, sizeof(uint32_t));
+    ti->slot_mask = size - 1;
+    for (size_t i = 0; i < ti->count; i++)
+        ti->slots[tag_slot(ti, ti->names[i])] = (uint32_t)(i + 1);
+}
+
+static size_t intern(lp_tag_index *ti, const char *tag) {
+    size_t h = tag_slot(ti, tag);
+    if (ti->slots[h]) return ti->slots[h] - 1;
+
+    size_t id = ti->count++;
+    ti->names = (char **)realloc(ti->names, ti->count * sizeof(char *));
+    ti->fix_counts = (size_t *)realloc(ti->fix_counts, ti->count * sizeof(size_t));
+    ti->sets = (lp_bitmap *)realloc(ti->sets, ti->count * sizeof(lp_bitmap));
+    ti->names[id] = strdup(tag);
+    ti->fix_counts[id] = 0;
+    lp_bitmap_init(&ti->sets[id]);
+    ti->slots[h] = (uint32_t)(id + 1);
+    if (ti->count * 2 > ti->slot_mask + 1) grow_slots(ti);
+    return id;
+}
+
+void lp_tag_index_build(lp_tag_index *ti, lp_fix **fixes, size_t fix_count) {
+    memset(ti, 0, sizeof(*ti));
+    ti->fix_count = fix_count;
+    grow_slots(ti);
+    for (size_t i = 0; i < fix_count; i++) {
+        for (size_t t = 0; t < fixes[i]->tag_count; t++) {
+            size_t id = intern(ti, fixes[i]->tags[t]);
+            if (!lp_bitmap_contains(&ti->sets[id], (uint32_t)i)) {
+                lp_bitmap_add(&ti->sets[id], (uint32_t)i);
+                ti->fix_counts[id]++;
+            }
+        }
+    }
+}
+
+void lp_tag_index_free(lp_tag_index *ti) {
+    for (size_t i = 0; i < ti->count; i++) {
+        free(ti->names[i]);
+        lp_bitmap_free(&ti->sets[i]);
+    }
+    free(ti->names);
+    free(ti->fix_counts);
+    free(ti->sets);
+    free(ti->slots);
+    memset(ti, 0, sizeof(*ti));
+}
+
+int lp_tag_index_find(const lp_tag_index *ti, const char *tag) {
+    if (!ti->slots) return -1;
+    size_t h = tag_slot(ti, tag);
+    return ti->slots[h] ? (int)(ti->slots[h] - 1) : -1;
+}
+
+/* ---- Filter expressions ---- */
+
+typedef struct {
+    const lp_tag_index *ti;
+    const char         *p;
+    char               *errbuf;
+    size_t              errlen;
+    bool                failed;
+} query_parser;
+
+static lp_bitmap parse_or(query_parser *qp);
+
+static void skip_space(query_parser *qp) {
+    while (*qp->p == ' ' || *qp->p == '\t') qp->p++;
+}
+
+static void parse_error(query_parser *qp, const char *what) {
+    if (!qp->failed && qp->errbuf && qp->errlen > 0) {
+        if (*qp->p) snprintf(qp->errbuf, qp->errlen, "%s at '%s'", what, qp->p);
+        else snprintf(qp->errbuf, qp->errlen, "%s at end of filter", what);
+    }
+    qp->failed = true;
+}
+
+static lp_bitmap parse_factor(query_parser *qp) {
+    lp_bitmap result;
+    lp_bitmap_init(&result);
+    skip_space(qp);
+
+    if (*qp->p == '!') {
+        qp->p++;
+        lp_bitmap inner = parse_factor(qp);
+        lp_bitmap all = lp_bitmap_range((uint32_t)qp->ti->fix_count);
+        result = lp_bitmap_andnot(&all, &inner);
+        lp_bitmap_free(&all);
+        lp_bitmap_free(&inner);
+        return result;
+    }
+    if (*qp->p == '(') {
+        qp->p++;
+        result = parse_or(qp);
+        skip_space(qp);
+        if (*qp->p == ')') qp->p++;
+        else parse_error(qp, "expected ')'");
+        return result;
+    }
+
+    const char *start = qp->p;
+    while (*qp->p && !strchr(",+!() \t", *qp->p)) qp->p++;
+    if (qp->p == start) {
+        parse_error(qp, "expected a tag");
+        return result;
+    }
+    char tag[256];
+    size_t len = (size_t)(qp->p - start);
+    if (len >= sizeof(tag)) len = sizeof(tag) - 1;
+    memcpy(tag, start, len);
+    tag[len] = '\0';
+
+    int id = lp_tag_index_find(qp->ti, tag);
+    if (id >= 0) result = lp_bitmap_or(&result, &qp->ti->sets[id]);
+    return result;
+}
+
+static lp_bitmap parse_and(query_parser *qp) {
+    lp_bitmap result = parse_factor(qp);
+    for (;;) {
+        skip_space(qp);
+        if (*qp->p != '+') return result;
+        qp->p++;
+        lp_bitmap rhs = parse_factor(qp);
+        lp_bitmap both = lp_bitmap_and(&result, &rhs);
+        lp_bitmap_free(&result);
+        lp_bitmap_free(&rhs);
+        result = both;
+    }
+}
+
+static lp_bitmap parse_or(query_parser *qp) {
+    lp_bitmap result = parse_and(qp);
+    for (;;) {
+        skip_space(qp);
+        if (*qp->p != ',') return result;
+        qp->p++;
+        lp_bitmap rhs = parse_and(qp);
+        lp_bitmap either = lp_bitmap_or(&result, &rhs);
+        lp_bitmap_free(&result);
+        lp_bitmap_free(&rhs);
+        result = either;
+    }
+}
+
+bool lp_tag_index_query(const lp_tag_index *ti, const char *expr, lp_bitmap *out,
+                        char *errbuf, size_t errlen) {
+    query_parser qp = { ti, expr, errbuf, errlen, false };
+    *out = parse_or(&qp);
+    skip_space(&qp);
+    if (*qp.p) parse_error(&qp, "unexpected character");
+    if (qp.failed) {
+        lp_bitmap_free(out);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,80 @@
+/*
+ * tagindex.h — Interned fix tags with compressed bitmaps over fix ids
+ *
+ * Each distinct tag gets an id and a Roaring-style bitmap of the fixes
+ * carrying it: ids are split into 16-bit chunks, and each chunk is stored
+ * as a sorted uint16 array while sparse, or as a 65536-bit set once it
+ * holds more than LP_BITMAP_ARRAY_MAX ids. Tag filters are evaluated on
+ * the bitmaps, so matching only touches the fixes that pass the filter.
+ */
+#ifndef LP_TAGINDEX_H
+#define LP_TAGINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "fix.h"
+
+#define LP_BITMAP_ARRAY_MAX 4096   /* Array container limit (8 KiB, as a bitset) */
+
+typedef struct {
+    uint16_t  key;         /* High 16 bits of the ids held */
+    bool      is_bitset;
+    uint32_t  card;
+    uint32_t  cap;         /* Array capacity */
+    uint16_t *array;       /* Sorted low halves, when !is_bitset */
+    uint64_t *bits;        /* 1024 words, when is_bitset */
+} lp_bitmap_container;
+
+typedef struct {
+    lp_bitmap_container *c;   /* Sorted by key */
+    size_t               count;
+    size_t               cap;
+} lp_bitmap;
+
+void   lp_bitmap_init(lp_bitmap *b);
+void   lp_bitmap_free(lp_bitmap *b);
+void   lp_bitmap_add(lp_bitmap *b, uint32_t v);
+bool   lp_bitmap_contains(const lp_bitmap *b, uint32_t v);
+size_t lp_bitmap_cardinality(const lp_bitmap *b);
+
+/* Set operations: results are new bitmaps (free with lp_bitmap_free) */
+lp_bitmap lp_bitmap_and(const lp_bitmap *a, const lp_bitmap *b);
+lp_bitmap lp_bitmap_or(const lp_bitmap *a, const lp_bitmap *b);
+lp_bitmap lp_bitmap_andnot(const lp_bitmap *a, const lp_bitmap *b);
+
+/* [0, n) */
+lp_bitmap lp_bitmap_range(uint32_t n);
+
+/* Members in ascending order. Returns malloc'd array, sets *count. */
+uint32_t *lp_bitmap_to_array(const lp_bitmap *b, size_t *count);
+
+typedef struct {
+    char     **names;      /* Interned tags, in first-seen order */
+    size_t    *fix_counts; /* Fixes per tag */
+    lp_bitmap *sets;       /* Fix ids per tag */
+    size_t     count;
+    size_t     fix_count;
+
+    uint32_t  *slots;      /* Open-addressing table: tag id + 1, 0 = empty */
+    size_t     slot_mask;
+} lp_tag_index;
+
+void lp_tag_index_build(lp_tag_index *ti, lp_fix **fixes, size_t fix_count);
+void lp_tag_index_free(lp_tag_index *ti);
+
+/* Tag id, or -1 if no fix carries the tag */
+int lp_tag_index_find(const lp_tag_index *ti, const char *tag);
+
+/* Evaluate a tag filter into the set of matching fix ids:
+     a,b     either tag (comma binds loosest)
+     a+b     both tags
+     !a      fixes without the tag
+     (a,b)+c grouping
+   Unknown tags match nothing. Returns false with a message on a syntax
+   error. */
+bool lp_tag_index_query(const lp_tag_index *ti, const char *expr, lp_bitmap *out,
+                        char *errbuf, size_t errlen);
+
+#endif /* LP_TAGINDEX_H */
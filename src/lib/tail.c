@@ -0,0 +1,46 @@
+/*
+ * tail.c — Reverse line scanning from EOF
+ */
+#include "tail.h"
+
+void lp_rev_init(lp_rev_scanner *rs, const char *data, size_t len) {
+    rs->base = data;
+    rs->lines = 0;
+    rs->done = (len == 0);
+
+    /* Strip one trailing terminator */
+    if (len > 0 && data[len - 1] == '\n') {
+        len--;
+        if (len > 0 && data[len - 1] == '\r') len--;
+    } else if (len > 0 && data[len - 1] == '\r') {
+        len--;
+    }
+    rs->pos = len;
+}
+
+const char *lp_rev_next(lp_rev_scanner *rs, size_t *len) {
+    if (rs->done) return NULL;
+
+    size_t end = rs->pos;
+    size_t start = end;
+    while (start > 0 && rs->base[start - 1] != '\n' && rs->base[start - 1] != '\r')
+        start--;
+
+    *len = end - start;
+    rs->lines++;
+
+    if (start == 0) {
+        rs->done = true;
+        rs->pos = 0;
+    } else {
+        /* Consume the terminator preceding this line */
+        size_t p = start - 1;
+        if (rs->base[p] == '\n' && p > 0 && rs->base[p - 1] == '\r') p--;
+        rs->pos = p;
+    }
+    return rs->base + start;
+}
+
+size_t lp_rev_consumed(const lp_rev_scanner *rs, size_t total_len) {
+    return total_len - rs->pos;
+}
@@ -0,0 +1,33 @@
+/*
+ * tail.h — Reverse line scanning from EOF
+ *
+ * Summary-at-end formats (pytest short summary, gradle BUILD FAILED,
+ * Zephyr memory-region table) keep their key facts in the last few
+ * hundred lines. Scanning backwards over a mapped file reaches them
+ * in O(tail) instead of O(log).
+ */
+#ifndef LP_TAIL_H
+#define LP_TAIL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct {
+    const char *base;
+    size_t      pos;     /* End (exclusive) of the next line to return */
+    size_t      lines;   /* Lines returned so far */
+    bool        done;
+} lp_rev_scanner;
+
+/* Start scanning data[0..len) from its end. A single trailing line
+   terminator does not produce an empty last line (matches lp_readline). */
+void lp_rev_init(lp_rev_scanner *rs, const char *data, size_t len);
+
+/* Return the previous line (without terminator) and set *len.
+   Handles \n, \r\n and bare \r. Returns NULL once the start is reached. */
+const char *lp_rev_next(lp_rev_scanner *rs, size_t *len);
+
+/* Bytes between the scanner position and the end of the buffer */
+size_t lp_rev_consumed(const lp_rev_scanner *rs, size_t total_len);
+
+#endif /* LP_TAIL_H */
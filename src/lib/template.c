@@ -0,0 +1,281 @@
+/*
+ * template.c — Streaming log template miner (Drain-style)
+ */
+#include "template.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+struct lp_tmpl_node {
+    char          *key;
+    lp_tmpl_node **children;
+    size_t         child_count;
+    size_t         child_cap;
+    size_t        *tmpl;         /* Leaf: template indices */
+    size_t         tmpl_count;
+    size_t         tmpl_cap;
+};
+
+static lp_tmpl_node *node_new(const char *key) {
+    lp_tmpl_node *n = (lp_tmpl_node *)calloc(1, sizeof(lp_tmpl_node));
+    n->key = strdup(key);
+    return n;
+}
+
+static void node_free(lp_tmpl_node *n) {
+    if (!n) return;
+    for (size_t i = 0; i < n->child_count; i++)
+        node_free(n->children[i]);
+    free(n->children);
+    free(n->tmpl);
+    free(n->key);
+    free(n);
+}
+
+static lp_tmpl_node *node_child(lp_tmpl_node *n, const char *key) {
+    for (size_t i = 0; i < n->child_count; i++) {
+        if (strcmp(n->children[i]->key, key) == 0) return n->children[i];
+    }
+    return NULL;
+}
+
+static lp_tmpl_node *node_add_child(lp_tmpl_node *n, const char *key) {
+    if (n->child_count >= n->child_cap) {
+        n->child_cap = n->child_cap ? n->child_cap * 2 : 4;
+        n->children = (lp_tmpl_node **)realloc(n->children,
+                                               n->child_cap * sizeof(lp_tmpl_node *));
+    }
+    lp_tmpl_node *c = node_new(key);
+    n->children[n->child_count++] = c;
+    return c;
+}
+
+void lp_template_init(lp_template_miner *tm, size_t depth, float sim_threshold,
+                      size_t max_children) {
+    memset(tm, 0, sizeof(*tm));
+    tm->depth = depth ? depth : 2;
+    tm->sim_threshold = sim_threshold > 0.0f ? sim_threshold : 0.4f;
+    tm->max_children = max_children ? max_children : 100;
+    tm->root = node_new("");
+}
+
+void lp_template_free(lp_template_miner *tm) {
+    for (size_t i = 0; i < tm->count; i++) {
+        lp_template *t = &tm->items[i];
+        for (size_t k = 0; k < t->token_count; k++)
+            free(t->tokens[k]);
+        free(t->tokens);
+        free(t->kinds);
+    }
+    free(tm->items);
+    node_free(tm->root);
+    memset(tm, 0, sizeof(*tm));
+}
+
+/* ---- Tokens ---- */
+
+unsigned lp_token_kind(const char *tok) {
+    size_t len = strlen(tok);
+    if (len == 0) return LP_TOK_WORD;
+    if (tok[0] == '"' || tok[0] == '\'' || tok[0] == '`') return LP_TOK_QUOTED;
+    if (len > 2 && tok[0] == '0' && (tok[1] == 'x' || tok[1] == 'X')) return LP_TOK_HEX;
+    if (strchr(tok, '/') || strchr(tok, '\\')) return LP_TOK_PATH;
+
+    bool digits = false, numeric = true, hex = len >= 8;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)tok[i];
+        if (isdigit(c)) digits = true;
+        else if (!strchr(".,:%-+()[]", c)) numeric = false;
+        if (!isxdigit(c)) hex = false;
+    }
+    if (digits && numeric) return LP_TOK_NUM;
+    if (hex && digits) return LP_TOK_HEX;
+    return LP_TOK_WORD;
+}
+
+static bool has_digit(const char *tok) {
+    for (; *tok; tok++) {
+        if (isdigit((unsigned char)*tok)) return true;
+    }
+    return false;
+}
+
+/* Whitespace tokenisation into a caller-freed array of malloc'd strings */
+static char **tokenize(const char *line, size_t *count) {
+    LP_VEC(char *) toks;
+    lp_vec_init(toks);
+    const char *p = line;
+    while (*p) {
+        while (*p && isspace((unsigned char)*p)) p++;
+        if (!*p) break;
+        const char *start = p;
+        while (*p && !isspace((unsigned char)*p)) p++;
+        lp_vec_push(toks, lp_strdup_range(start, 0, (size_t)(p - start)));
+    }
+    *count = toks.len;
+    return toks.items;
+}
+
+/* ---- Matching ---- */
+
+/* Share of positions where the template's constant token equals the line's */
+static float similarity(const lp_template *t, char **toks, size_t *wild) {
+    size_t same = 0;
+    *wild = 0;
+    for (size_t i = 0; i < t->token_count; i++) {
+        if (!t->tokens[i]) { (*wild)++; continue; }
+        if (strcmp(t->tokens[i], toks[i]) == 0) same++;
+    }
+    return t->token_count ? (float)same / (float)t->token_count : 1.0f;
+}
+
+static size_t new_template(lp_template_miner *tm, char **toks, size_t n) {
+    if (tm->count >= tm->cap) {
+        tm->cap = tm->cap ? tm->cap * 2 : 64;
+        tm->items = (lp_template *)realloc(tm->items, tm->cap * sizeof(lp_template));
+    }
+    lp_template *t = &tm->items[tm->count];
+    memset(t, 0, sizeof(*t));
+    t->tokens = toks;   /* Takes ownership */
+    t->kinds = (unsigned *)calloc(n ? n : 1, sizeof(unsigned));
+    t->token_count = n;
+    return tm->count++;
+}
+
+size_t lp_template_add(lp_template_miner *tm, const char *line, size_t line_num) {
+    size_t n;
+    char **toks = tokenize(line, &n);
+    if (n == 0) {
+        free(toks);
+        return (size_t)-1;
+    }
+
+    /* Route: token count, then the first `depth` tokens */
+    char len_key[32];
+    snprintf(len_key, sizeof(len_key), "%zu", n);
+    lp_tmpl_node *node = node_child(tm->root, len_key);
+    if (!node) node = node_add_child(tm->root, len_key);
+
+    size_t route = n < tm->depth ? n : tm->depth;
+    for (size_t d = 0; d < route; d++) {
+        const char *key = has_digit(toks[d]) ? LP_TMPL_WILDCARD : toks[d];
+        lp_tmpl_node *child = node_child(node, key);
+        if (!child) {
+            if (node->child_count < tm->max_children) {
+                child = node_add_child(node, key);
+            } else {
+                child = node_child(node, LP_TMPL_WILDCARD);
+                if (!child) child = node_add_child(node, LP_TMPL_WILDCARD);
+            }
+        }
+        node = child;
+    }
+
+    /* Leaf: most similar template, preferring more wildcards on ties */
+    size_t best = (size_t)-1;
+    float best_sim = -1.0f;
+    size_t best_wild = 0;
+    for (size_t i = 0; i < node->tmpl_count; i++) {
+        size_t wild;
+        float sim = similarity(&tm->items[node->tmpl[i]], toks, &wild);
+        if (sim > best_sim || (sim == best_sim && wild > best_wild)) {
+            best = node->tmpl[i];
+            best_sim = sim;
+            best_wild = wild;
+        }
+    }
+
+    size_t idx;
+    if (best != (size_t)-1 && best_sim >= tm->sim_threshold) {
+        idx = best;
+        lp_template *t = &tm->items[idx];
+        for (size_t i = 0; i < n; i++) {
+            if (t->tokens[i] && strcmp(t->tokens[i], toks[i]) != 0) {
+                /* Position varies: record both values' kinds */
+                t->kinds[i] |= lp_token_kind(t->tokens[i]);
+                free(t->tokens[i]);
+                t->tokens[i] = NULL;
+            }
+            if (!t->tokens[i]) t->kinds[i] |= lp_token_kind(toks[i]);
+        }
+        lp_free_strings(toks, n);
+    } else {
+        idx = new_template(tm, toks, n);
+        tm->items[idx].first_line = line_num;
+        if (node->tmpl_count >= node->tmpl_cap) {
+            node->tmpl_cap = node->tmpl_cap ? node->tmpl_cap * 2 : 4;
+            node->tmpl = (size_t *)realloc(node->tmpl, node->tmpl_cap * sizeof(size_t));
+        }
+        node->tmpl[node->tmpl_count++] = idx;
+    }
+
+    lp_template *t = &tm->items[idx];
+    size_t len = strlen(line);
+    t->count++;
+    t->bytes += len;
+    t->last_line = line_num;
+    tm->lines++;
+    tm->total_bytes += len;
+    return idx;
+}
+
+/* ---- Reporting ---- */
+
+char *lp_template_string(const lp_template *t) {
+    lp_string s = lp_string_new(128);
+    for (size_t i = 0; i < t->token_count; i++) {
+        if (i > 0) lp_string_append_cstr(&s, " ");
+        lp_string_append_cstr(&s, t->tokens[i] ? t->tokens[i] : LP_TMPL_WILDCARD);
+    }
+    char *out = strdup(lp_string_cstr(&s) ? lp_string_cstr(&s) : "");
+    lp_string_free(&s);
+    return out;
+}
+
+char *lp_template_prefix(const lp_template *t) {
+    lp_string s = lp_string_new(64);
+    for (size_t i = 0; i < t->token_count && t->tokens[i]; i++) {
+        if (i > 0) lp_string_append_cstr(&s, " ");
+        lp_string_append_cstr(&s, t->tokens[i]);
+    }
+    char *out = strdup(lp_string_cstr(&s) ? lp_string_cstr(&s) : "");
+    lp_string_free(&s);
+    return out;
+}
+
+size_t lp_template_wildcards(const lp_template *t) {
+    size_t w = 0;
+    for (size_t i = 0; i < t->token_count; i++) {
+        if (!t->tokens[i]) w++;
+    }
+    return w;
+}
+
+size_t lp_template_collapsed_bytes(const lp_template *t) {
+    char *s = lp_template_string(t);
+    size_t len = strlen(s) + 8;  /* " [xNNNN]" */
+    free(s);
+    return len;
+}
+
+float lp_template_ratio(const lp_template *t) {
+    size_t collapsed = lp_template_collapsed_bytes(t);
+    return collapsed ? (float)t->bytes / (float)collapsed : 1.0f;
+}
+
+static int cmp_count_desc(const void *a, const void *b) {
+    const lp_template *ta = *(const lp_template *const *)a;
+    const lp_template *tb = *(const lp_template *const *)b;
+    if (ta->count != tb->count) return ta->count > tb->count ? -1 : 1;
+    return ta->first_line < tb->first_line ? -1 : (ta->first_line > tb->first_line);
+}
+
+lp_template **lp_template_sorted(const lp_template_miner *tm) {
+    lp_template **arr = (lp_template **)malloc((tm->count ? tm->count : 1) * sizeof(lp_template *));
+    for (size_t i = 0; i < tm->count; i++) arr[i] = &tm->items[i];
+    qsort(arr, tm->count, sizeof(lp_template *), cmp_count_desc);
+    return arr;
+}
@@ -0,0 +1,77 @@
+/*
+ * template.h — Streaming log template miner (Drain-style)
+ *
+ * Lines are routed through a fixed-depth prefix tree: first by token
+ * count, then by their leading tokens (tokens with digits route through a
+ * "<*>" child). The leaf holds candidate templates; a line joins the most
+ * similar one if enough positions agree, turning the differing positions
+ * into wildcards, or starts a new template. One linear pass, no regex.
+ */
+#ifndef LP_TEMPLATE_H
+#define LP_TEMPLATE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define LP_TMPL_WILDCARD "<*>"
+
+/* Value kinds seen at a wildcard position (bitmask) */
+#define LP_TOK_NUM    0x01u  /* 42, 3.14, 97% */
+#define LP_TOK_HEX    0x02u  /* 0x1f00, deadbeef */
+#define LP_TOK_PATH   0x04u  /* src/main.c, C:\x */
+#define LP_TOK_QUOTED 0x08u  /* "name", 'node' */
+#define LP_TOK_WORD   0x10u  /* anything else */
+
+typedef struct {
+    char    **tokens;        /* NULL = wildcard position */
+    unsigned *kinds;         /* Per position: value kinds seen there */
+    size_t    token_count;
+    size_t    count;         /* Lines matched */
+    size_t    bytes;         /* Total length of matched lines */
+    size_t    first_line;
+    size_t    last_line;
+} lp_template;
+
+typedef struct lp_tmpl_node lp_tmpl_node;
+
+typedef struct {
+    size_t        depth;          /* Leading tokens used for routing */
+    float         sim_threshold;  /* Min share of agreeing positions to merge */
+    size_t        max_children;   /* Beyond this, new keys share "<*>" */
+    lp_tmpl_node *root;
+    lp_template  *items;
+    size_t        count;
+    size_t        cap;
+    size_t        lines;          /* Non-blank lines added */
+    size_t        total_bytes;
+} lp_template_miner;
+
+/* Drain defaults: depth 2, threshold 0.4, 100 children */
+void lp_template_init(lp_template_miner *tm, size_t depth, float sim_threshold,
+                      size_t max_children);
+void lp_template_free(lp_template_miner *tm);
+
+/* Add one line. Returns the template index, or (size_t)-1 for blank lines. */
+size_t lp_template_add(lp_template_miner *tm, const char *line, size_t line_num);
+
+/* Value kind of a single token (one LP_TOK_* bit) */
+unsigned lp_token_kind(const char *tok);
+
+/* Template text with "<*>" at wildcard positions. malloc'd. */
+char *lp_template_string(const lp_template *t);
+
+/* Tokens before the first wildcard, space-joined. malloc'd (may be ""). */
+char *lp_template_prefix(const lp_template *t);
+
+size_t lp_template_wildcards(const lp_template *t);
+
+/* Bytes the template's lines would take collapsed to one template line
+   ("<template> [xN]"), and the resulting compression ratio. */
+size_t lp_template_collapsed_bytes(const lp_template *t);
+float  lp_template_ratio(const lp_template *t);
+
+/* Templates sorted by count descending (pointers into tm->items, valid
+   until the next add). malloc'd array of tm->count entries. */
+lp_template **lp_template_sorted(const lp_template_miner *tm);
+
+#endif /* LP_TEMPLATE_H */
@@ -0,0 +1,162 @@
+/*
+ * thread.c — Minimal parallel-for and threads over native threads
+ */
+#include "thread.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#endif
+
+#define LP_MAX_THREADS 64
+
+typedef struct {
+    lp_task_fn     fn;
+    void          *ctx;
+    size_t         count;
+#ifdef _WIN32
+    volatile LONG64 next;   /* MSVC lacks <stdatomic.h> in C mode */
+#else
+    atomic_size_t  next;
+#endif
+} parallel_job;
+
+static size_t claim_item(parallel_job *job) {
+#ifdef _WIN32
+    return (size_t)(InterlockedIncrement64(&job->next) - 1);
+#else
+    return atomic_fetch_add(&job->next, 1);
+#endif
+}
+
+static void run_items(parallel_job *job) {
+    for (;;) {
+        size_t i = claim_item(job);
+        if (i >= job->count) break;
+        job->fn(job->ctx, i);
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker_main(LPVOID arg) {
+    run_items((parallel_job *)arg);
+    return 0;
+}
+#else
+static void *worker_main(void *arg) {
+    run_items((parallel_job *)arg);
+    return NULL;
+}
+#endif
+
+size_t lp_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors > 0 ? (size_t)si.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+#endif
+}
+
+void lp_parallel_for(size_t count, size_t threads, lp_task_fn fn, void *ctx) {
+    if (count == 0) return;
+    if (threads == 0) threads = lp_cpu_count();
+    if (threads > count) threads = count;
+    if (threads > LP_MAX_THREADS) threads = LP_MAX_THREADS;
+
+    parallel_job job;
+    job.fn = fn;
+    job.ctx = ctx;
+    job.count = count;
+#ifdef _WIN32
+    job.next = 0;
+#else
+    atomic_init(&job.next, 0);
+#endif
+
+    /* Workers that fail to start just leave more items for the others */
+#ifdef _WIN32
+    HANDLE workers[LP_MAX_THREADS];
+    size_t started = 0;
+    for (size_t t = 1; t < threads; t++) {
+        HANDLE h = CreateThread(NULL, 0, worker_main, &job, 0, NULL);
+        if (h) workers[started++] = h;
+    }
+    run_items(&job);
+    for (size_t t = 0; t < started; t++) {
+        WaitForSingleObject(workers[t], INFINITE);
+        CloseHandle(workers[t]);
+    }
+#else
+    pthread_t workers[LP_MAX_THREADS];
+    size_t started = 0;
+    for (size_t t = 1; t < threads; t++) {
+        if (pthread_create(&workers[started], NULL, worker_main, &job) == 0) started++;
+    }
+    run_items(&job);
+    for (size_t t = 0; t < started; t++)
+        pthread_join(workers[t], NULL);
+#endif
+}
+
+/* ---- Single threads ---- */
+
+typedef struct {
+    lp_thread_fn fn;
+    void        *ctx;
+} thread_start;
+
+#ifdef _WIN32
+static DWORD WINAPI thread_main(LPVOID arg) {
+#else
+static void *thread_main(void *arg) {
+#endif
+    thread_start st = *(thread_start *)arg;
+    free(arg);
+    st.fn(st.ctx);
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+bool lp_thread_start(lp_thread *t, lp_thread_fn fn, void *ctx) {
+    thread_start *st = (thread_start *)malloc(sizeof(thread_start));
+    if (!st) return false;
+    st->fn = fn;
+    st->ctx = ctx;
+#ifdef _WIN32
+    HANDLE h = CreateThread(NULL, 0, thread_main, st, 0, NULL);
+    if (!h) { free(st); return false; }
+    *t = h;
+#else
+    if (pthread_create(t, NULL, thread_main, st) != 0) { free(st); return false; }
+#endif
+    return true;
+}
+
+void lp_thread_join(lp_thread t) {
+#ifdef _WIN32
+    WaitForSingleObject((HANDLE)t, INFINITE);
+    CloseHandle((HANDLE)t);
+#else
+    pthread_join(t, NULL);
+#endif
+}
+
+void lp_thread_yield(void) {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
@@ -0,0 +1,45 @@
+/*
+ * thread.h — Minimal parallel-for and threads over native threads
+ *
+ * pthreads on POSIX, Win32 threads on Windows. Work items are handed out
+ * one at a time from a shared atomic counter, so uneven items balance
+ * themselves. The vendored regex engine is not thread-safe: tasks must not
+ * call lp_normalize_line or other tiny-regex users, and at most one
+ * started thread may use it while no other thread does.
+ */
+#ifndef LP_THREAD_H
+#define LP_THREAD_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+/* Online logical CPUs (at least 1) */
+size_t lp_cpu_count(void);
+
+typedef void (*lp_task_fn)(void *ctx, size_t index);
+
+/* Run fn(ctx, i) for every i in [0, count) on up to `threads` workers
+   (0 = lp_cpu_count()). The calling thread works too; returns when all
+   items are done. Runs inline when one thread suffices. */
+void lp_parallel_for(size_t count, size_t threads, lp_task_fn fn, void *ctx);
+
+/* A single thread running fn(ctx), e.g. one pipeline stage */
+#ifdef _WIN32
+typedef void *lp_thread;         /* HANDLE */
+#else
+typedef pthread_t lp_thread;
+#endif
+typedef void (*lp_thread_fn)(void *ctx);
+
+/* False if the thread could not be created (fn has not run) */
+bool lp_thread_start(lp_thread *t, lp_thread_fn fn, void *ctx);
+void lp_thread_join(lp_thread t);
+
+/* Give up the CPU to another runnable thread */
+void lp_thread_yield(void);
+
+#endif /* LP_THREAD_H */
@@ -10,10 +10,17 @@
 #ifdef _WIN32
 #include <windows.h>
 #include <direct.h>
+#include <io.h>
 #else
 #include <dirent.h>
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <time.h>
 #endif
 
 /* ================================================================
@@ -116,6 +123,125 @@ char *lp_read_file(const char *path, size_t *out_len) {
     return buf;
 }
 
+static bool map_heap_fallback(const char *path, lp_mapped_file *mf) {
+    size_t len = 0;
+    char *buf = lp_read_file(path, &len);
+    if (!buf) return false;
+    mf->data = buf;
+    mf->len = len;
+    mf->handle = buf;
+    mf->mapped = false;
+    return true;
+}
+
+#ifdef _WIN32
+
+bool lp_map_file(const char *path, lp_mapped_file *mf) {
+    memset(mf, 0, sizeof(*mf));
+    HANDLE fh = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                            NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fh == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(fh, &sz) || sz.QuadPart == 0) {
+        CloseHandle(fh);
+        return map_heap_fallback(path, mf);
+    }
+
+    HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(fh);
+    if (!mh) return map_heap_fallback(path, mf);
+
+    void *view = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mh);
+        return map_heap_fallback(path, mf);
+    }
+    mf->data = (const char *)view;
+    mf->len = (size_t)sz.QuadPart;
+    mf->handle = mh;
+    mf->mapped = true;
+    return true;
+}
+
+bool lp_map_fd(int fd, lp_mapped_file *mf) {
+    memset(mf, 0, sizeof(*mf));
+    HANDLE fh = (HANDLE)_get_osfhandle(fd);
+    LARGE_INTEGER sz;
+    if (fh == INVALID_HANDLE_VALUE || GetFileType(fh) != FILE_TYPE_DISK ||
+        !GetFileSizeEx(fh, &sz) || sz.QuadPart == 0)
+        return false;
+    HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mh) return false;
+    void *view = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mh);
+        return false;
+    }
+    mf->data = (const char *)view;
+    mf->len = (size_t)sz.QuadPart;
+    mf->handle = mh;
+    mf->mapped = true;
+    return true;
+}
+
+void lp_unmap_file(lp_mapped_file *mf) {
+    if (mf->mapped) {
+        UnmapViewOfFile((void *)mf->data);
+        CloseHandle((HANDLE)mf->handle);
+    } else {
+        free(mf->handle);
+    }
+    memset(mf, 0, sizeof(*mf));
+}
+
+#else /* POSIX */
+
+bool lp_map_file(const char *path, lp_mapped_file *mf) {
+    memset(mf, 0, sizeof(*mf));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        /* Pipes, devices and empty files cannot be mapped */
+        close(fd);
+        return map_heap_fallback(path, mf);
+    }
+
+    void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return map_heap_fallback(path, mf);
+
+    mf->data = (const char *)addr;
+    mf->len = (size_t)st.st_size;
+    mf->handle = addr;
+    mf->mapped = true;
+    return true;
+}
+
+bool lp_map_fd(int fd, lp_mapped_file *mf) {
+    memset(mf, 0, sizeof(*mf));
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) return false;
+    if (lseek(fd, 0, SEEK_CUR) > 0) return false;   /* Partly read: stream the rest */
+    void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) return false;
+    mf->data = (const char *)addr;
+    mf->len = (size_t)st.st_size;
+    mf->handle = addr;
+    mf->mapped = true;
+    return true;
+}
+
+void lp_unmap_file(lp_mapped_file *mf) {
+    if (mf->mapped) munmap(mf->handle, mf->len);
+    else free(mf->handle);
+    memset(mf, 0, sizeof(*mf));
+}
+
+#endif
+
 /* ================================================================
  * String utilities
  * ================================================================ */
@@ -230,6 +356,75 @@ bool lp_file_exists(const char *path) {
 #endif
 }
 
+char *lp_path_real(const char *path) {
+#ifdef _WIN32
+    if (!lp_file_exists(path)) return NULL;
+    return _fullpath(NULL, path, 0);
+#else
+    return realpath(path, NULL);
+#endif
+}
+
+uint64_t lp_file_stamp(const char *path) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path, &st) != 0) return 0;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+#endif
+    uint64_t h = (uint64_t)st.st_size * 0x9E3779B97F4A7C15ULL ^ (uint64_t)st.st_mtime;
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 29;
+    return h ? h : 1;
+}
+
+char *lp_cache_path(const char *name) {
+    const char *env = getenv("LOGPILOT_CACHE");
+    if (env && env[0]) return lp_path_join(env, name);
+#ifdef _WIN32
+    const char *home = getenv("USERPROFILE");
+#else
+    const char *home = getenv("HOME");
+#endif
+    if (!home) return NULL;
+    char *dir = lp_path_join(home, ".logpilot/cache");
+    char *path = lp_path_join(dir, name);
+    free(dir);
+    return path;
+}
+
+void lp_make_parent_dirs(const char *path) {
+    char *dir = strdup(path);
+    for (char *p = dir + 1; *p; p++) {
+        if (*p != '/' && *p != '\\') continue;
+        char c = *p;
+        *p = '\0';
+#ifdef _WIN32
+        _mkdir(dir);
+#else
+        mkdir(dir, 0755);
+#endif
+        *p = c;
+    }
+    free(dir);
+}
+
+uint64_t lp_now_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
 char *lp_get_exe_dir(void) {
 #ifdef _WIN32
     char buf[MAX_PATH];
@@ -366,3 +561,119 @@ int lp_dir_iter_recursive(const char *dir, const char *suffix, lp_dir_cb cb, voi
 }
 
 #endif
+
+typedef struct {
+    char  **items;
+    size_t  len;
+    size_t  cap;
+} path_list;
+
+static void path_list_push(path_list *l, char *path) {
+    if (l->len >= l->cap) {
+        l->cap = l->cap ? l->cap * 2 : 64;
+        l->items = (char **)realloc(l->items, l->cap * sizeof(char *));
+    }
+    l->items[l->len++] = path;
+}
+
+static bool has_suffix(const char *name, const char *suffix) {
+    if (!suffix) return true;
+    size_t nlen = strlen(name), slen = strlen(suffix);
+    return nlen >= slen && strcmp(name + nlen - slen, suffix) == 0;
+}
+
+static int cmp_path(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+#ifdef _WIN32
+
+static void collect_path(const char *path, void *userdata) {
+    path_list_push((path_list *)userdata, strdup(path));
+}
+
+static void list_files(const char *root, const char *suffix, path_list *files) {
+    lp_dir_iter_recursive(root, suffix, collect_path, files);
+}
+
+#else
+
+/* Sort one directory entry into files or the pending-directory stack */
+static void list_entry(const char *dir, const char *name, unsigned char type,
+                       const char *suffix, path_list *files, path_list *dirs) {
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) return;
+    char *full = lp_path_join(dir, name);
+    if (type == DT_UNKNOWN) {
+        struct stat st;
+        type = stat(full, &st) == 0 && S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+    }
+    if (type == DT_DIR) {
+        path_list_push(dirs, full);
+    } else if (has_suffix(name, suffix)) {
+        path_list_push(files, full);
+    } else {
+        free(full);
+    }
+}
+
+#ifdef __linux__
+/* Layout returned by the getdents64 syscall */
+struct lp_dirent64 {
+    unsigned long long d_ino;
+    long long          d_off;
+    unsigned short     d_reclen;
+    unsigned char      d_type;
+    char               d_name[];
+};
+
+#define DIRENT_BATCH (64 * 1024)
+#endif
+
+static void list_files(const char *root, const char *suffix, path_list *files) {
+    path_list dirs = { NULL, 0, 0 };
+    path_list_push(&dirs, strdup(root));
+#ifdef __linux__
+    char *buf = (char *)malloc(DIRENT_BATCH);
+#endif
+    while (dirs.len > 0) {
+        char *dir = dirs.items[--dirs.len];
+#ifdef __linux__
+        /* One syscall returns hundreds of entries, vs one readdir() call each */
+        int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            long n;
+            while ((n = syscall(SYS_getdents64, fd, buf, DIRENT_BATCH)) > 0) {
+                for (long off = 0; off < n;) {
+                    struct lp_dirent64 *d = (struct lp_dirent64 *)(buf + off);
+                    list_entry(dir, d->d_name, d->d_type, suffix, files, &dirs);
+                    off += d->d_reclen;
+                }
+            }
+            close(fd);
+        }
+#else
+        DIR *d = opendir(dir);
+        if (d) {
+            struct dirent *ent;
+            while ((ent = readdir(d)) != NULL)
+                list_entry(dir, ent->d_name, ent->d_type, suffix, files, &dirs);
+            closedir(d);
+        }
+#endif
+        free(dir);
+    }
+#ifdef __linux__
+    free(buf);
+#endif
+    free(dirs.items);
+}
+
+#endif
+
+char **lp_dir_list_recursive(const char *dir, const char *suffix, size_t *count) {
+    path_list files = { NULL, 0, 0 };
+    list_files(dir, suffix, &files);
+    if (files.len > 1) qsort(files.items, files.len, sizeof(char *), cmp_path);
+    *count = files.len;
+    return files.items;
+}
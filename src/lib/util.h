@@ -48,6 +48,23 @@ int  lp_readline(FILE *fp, char **buf, size_t *buf_cap);
 /* Read entire file into a malloc'd buffer. Sets *out_len. Returns NULL on error. */
 char *lp_read_file(const char *path, size_t *out_len);
 
+/* Read-only view of a whole file. Uses mmap / MapViewOfFile where possible,
+   falls back to a heap copy (lp_read_file) otherwise. data is NOT NUL-terminated. */
+typedef struct {
+    const char *data;
+    size_t      len;
+    void       *handle;   /* Platform mapping handle, or heap buffer */
+    bool        mapped;   /* true: data is a mapping; false: heap copy */
+} lp_mapped_file;
+
+bool lp_map_file(const char *path, lp_mapped_file *mf);
+void lp_unmap_file(lp_mapped_file *mf);
+
+/* Map an already open regular file. False for pipes, devices, empty files
+   or a failed mapping — read those as a stream. fd stays open and owned
+   by the caller. */
+bool lp_map_fd(int fd, lp_mapped_file *mf);
+
 /* ---- String utilities ---- */
 char *lp_strtrim(const char *str);           /* Returns malloc'd trimmed copy */
 char *lp_strdup_range(const char *s, size_t start, size_t end);
@@ -62,6 +79,22 @@ void   lp_free_strings(char **strs, size_t count);
 /* ---- Platform ---- */
 char *lp_path_join(const char *dir, const char *file);
 bool  lp_file_exists(const char *path);
+/* Absolute path with links and ./.. resolved (malloc'd), or NULL if the
+   file does not exist. Relative paths resolve against the current dir. */
+char *lp_path_real(const char *path);
+
+/* Hash of a file's size and mtime, for cache invalidation; 0 if missing */
+uint64_t lp_file_stamp(const char *path);
+
+/* $LOGPILOT_CACHE/name, else ~/.logpilot/cache/name. Returns malloc'd
+   path, or NULL if neither is available. */
+char *lp_cache_path(const char *name);
+
+/* mkdir -p for the directory part of path */
+void lp_make_parent_dirs(const char *path);
+
+/* Monotonic clock in nanoseconds (arbitrary epoch), for profiling */
+uint64_t lp_now_ns(void);
 
 /* Get directory containing the running executable. Returns malloc'd string. */
 char *lp_get_exe_dir(void);
@@ -74,4 +107,9 @@ int lp_dir_iter(const char *dir, const char *suffix, lp_dir_cb cb, void *userdat
 /* Recursively iterate files matching suffix */
 int lp_dir_iter_recursive(const char *dir, const char *suffix, lp_dir_cb cb, void *userdata);
 
+/* Recursively list files matching suffix, sorted by path so the order is
+   deterministic. Reads directory entries in large batches (getdents64 on
+   Linux). Returns a malloc'd array for lp_free_strings(); NULL if empty. */
+char **lp_dir_list_recursive(const char *dir, const char *suffix, size_t *count);
+
 #endif /* LP_UTIL_H */
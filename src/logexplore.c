@@ -11,15 +11,25 @@
 #include <string.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <math.h>
 
 #include "util.h"
 #include "mode.h"
+#include "builtin.h"
 #include "dedup.h"
 #include "segment.h"
 #include "token.h"
+#include "template.h"
+#include "sketch.h"
+#include "fate.h"
+#include "pipeline.h"
+#include "thread.h"
+#include "lineidx.h"
 
 #define DEFAULT_TOP     15
 #define SNIFF_LINES     50
+#define TUNE_DEFAULT_BUDGET 3000   /* Tokens per log (logparse's 300 lines) */
+#define SAMPLE_DEFAULT_BYTES (4u << 20)   /* 64 blocks x 64 KiB */
 
 /* ---- Help text ---- */
 
@@ -37,13 +47,31 @@ static const char *HELP_TEXT =
     "  --show-phases      Phase boundary analysis only\n"
     "  --top <N>          Number of frequency entries to show (default: 15)\n"
     "  --suggest-mode     Output a draft TOML mode file based on analysis\n"
+    "  --discover-strips  Propose [dedup] strip_patterns from per-position\n"
+    "                     cardinality (two streaming passes, bounded memory)\n"
+    "  --profile-mode <name>  Per-pattern hits, cost, dead and shadowed\n"
+    "                     patterns of a mode's line classification\n"
+    "  --tune-mode <name> <FILE>...  Search mode additions and [score]\n"
+    "                     weights that cut tokens without losing errors;\n"
+    "                     prints the result as a diff of the mode TOML\n"
+    "  --budget <N>       Token budget per log for --tune-mode (default: 3000)\n"
+    "  --volume           Rank templates, phases and segment types by bytes\n"
+    "                     and estimated tokens (what to make less verbose)\n"
+    "  --sample [SIZE]    Analyze stratified blocks (head, tail, random middle)\n"
+    "                     totalling SIZE (default 4M) and extrapolate totals\n"
+    "                     with 95% confidence intervals; for huge logs\n"
     "  --help             Show this help\n"
     "  --help agent       Machine-readable self-update instructions\n"
     "\n"
     "Examples:\n"
     "  logexplore build.log\n"
     "  logexplore build.log --show-freq --top 20\n"
-    "  logexplore build.log --suggest-mode > modes/draft.toml\n";
+    "  logexplore build.log --suggest-mode > modes/draft.toml\n"
+    "  logexplore huge.log --discover-strips\n"
+    "  logexplore 20GB.log --sample\n"
+    "  logexplore build.log --volume\n"
+    "  logexplore build.log --profile-mode zephyr\n"
+    "  logexplore --tune-mode zephyr ci/*.log\n";
 
 static const char *HELP_AGENT_TEXT =
     "AGENT SELF-UPDATE INSTRUCTIONS\n"
@@ -57,10 +85,14 @@ static const char *HELP_AGENT_TEXT =
     "     - Blank line boundaries\n"
     "     - Indentation level changes (>2 level shift)\n"
     "     - Mode-specific phase markers\n"
+    "     - Mode [segments] start/end/nest patterns (checked first)\n"
     "     - Tabular data detection (consistent column alignment)\n"
     "  2. To add custom heuristics, add to [segments] in mode TOML:\n"
     "     segment_start_patterns = [\"^=+$\", \"^-+$\"]\n"
     "     segment_end_patterns = [\"^$\"]\n"
+    "     nest_begin_patterns = [\"^Traceback \"]\n"
+    "     nest_end_patterns = [\"^\\\\S+: \"]\n"
+    "     (begin/end pairs by index; blank lines inside a pair don't split)\n"
     "\n"
     "TO REGISTER A NEW LOG FORMAT:\n"
     "  1. Run: logexplore <sample.log> --suggest-mode\n"
@@ -70,21 +102,45 @@ static const char *HELP_AGENT_TEXT =
 
 /* ---- Argument parsing ---- */
 
+#define MAX_INPUTS 64
+
 typedef struct {
     const char *input_file;
+    const char *inputs[MAX_INPUTS];   /* --tune-mode corpus */
+    size_t      input_count;
     size_t      top_n;
     bool        show_freq;
     bool        show_segments;
     bool        show_phases;
     bool        suggest_mode;
+    bool        discover_strips;
+    bool        volume;
+    const char *profile_mode;
+    const char *tune_mode;
+    size_t      sample_bytes;    /* --sample; 0 = read the whole file */
+    size_t      budget;
     bool        show_help;
     bool        show_help_agent;
 } logexplore_args;
 
+/* "64K", "4M", "1G" or plain bytes */
+static size_t parse_size(const char *s) {
+    char *end;
+    double v = strtod(s, &end);
+    switch (toupper((unsigned char)*end)) {
+        case 'K': v *= 1024.0; break;
+        case 'M': v *= 1048576.0; break;
+        case 'G': v *= 1073741824.0; break;
+        default: break;
+    }
+    return v > 0.0 ? (size_t)v : 0;
+}
+
 static logexplore_args parse_args(int argc, char **argv) {
     logexplore_args args;
     memset(&args, 0, sizeof(args));
     args.top_n = DEFAULT_TOP;
+    args.budget = TUNE_DEFAULT_BUDGET;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--help") == 0) {
@@ -102,10 +158,25 @@ static logexplore_args parse_args(int argc, char **argv) {
             args.show_phases = true;
         } else if (strcmp(argv[i], "--suggest-mode") == 0) {
             args.suggest_mode = true;
+        } else if (strcmp(argv[i], "--volume") == 0) {
+            args.volume = true;
+        } else if (strcmp(argv[i], "--discover-strips") == 0) {
+            args.discover_strips = true;
+        } else if (strcmp(argv[i], "--profile-mode") == 0 && i + 1 < argc) {
+            args.profile_mode = argv[++i];
+        } else if (strcmp(argv[i], "--tune-mode") == 0 && i + 1 < argc) {
+            args.tune_mode = argv[++i];
+        } else if (strcmp(argv[i], "--sample") == 0) {
+            args.sample_bytes = SAMPLE_DEFAULT_BYTES;
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+                args.sample_bytes = parse_size(argv[++i]);
+        } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            args.budget = (size_t)atoi(argv[++i]);
         } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
             args.top_n = (size_t)atoi(argv[++i]);
         } else if (argv[i][0] != '-') {
-            args.input_file = argv[i];
+            if (!args.input_file) args.input_file = argv[i];
+            if (args.input_count < MAX_INPUTS) args.inputs[args.input_count++] = argv[i];
         }
     }
     return args;
@@ -119,24 +190,24 @@ typedef struct {
     size_t  cap;
 } line_array;
 
-static line_array read_all_lines(FILE *fp) {
-    line_array la;
-    la.count = 0;
-    la.cap = 1024;
-    la.lines = (char **)malloc(la.cap * sizeof(char *));
+/* Map the file and index it in one pass; the index's encoding and length
+   statistics come with it at no extra cost. idx may be NULL. */
+static bool load_lines(const char *path, line_array *la, lp_line_index *idx) {
+    lp_mapped_file mf;
+    if (!lp_map_file(path, &mf)) return false;
 
-    char *buf = NULL;
-    size_t buf_cap = 0;
-    int len;
-    while ((len = lp_readline(fp, &buf, &buf_cap)) >= 0) {
-        if (la.count >= la.cap) {
-            la.cap *= 2;
-            la.lines = (char **)realloc(la.lines, la.cap * sizeof(char *));
-        }
-        la.lines[la.count++] = strdup(buf);
-    }
-    free(buf);
-    return la;
+    lp_line_index local;
+    lp_line_index *ix = idx ? idx : &local;
+    lp_line_index_build(ix, mf.data, mf.len);
+
+    la->count = la->cap = ix->count;
+    la->lines = (char **)malloc((la->cap ? la->cap : 1) * sizeof(char *));
+    for (size_t i = 0; i < ix->count; i++)
+        la->lines[i] = lp_strdup_range(mf.data + ix->starts[i], 0, ix->lengths[i]);
+
+    if (!idx) lp_line_index_free(&local);
+    lp_unmap_file(&mf);
+    return true;
 }
 
 static void free_line_array(line_array *la) {
@@ -149,25 +220,44 @@ static void free_line_array(line_array *la) {
 
 /* ---- Encoding analysis ---- */
 
-static void analyze_encoding(FILE *out, line_array *la) {
-    size_t longest = 0;
-    size_t total_len = 0;
-    bool all_ascii = true;
+static void analyze_encoding(FILE *out, const lp_line_index *idx) {
+    lp_encoding enc = lp_line_index_encoding(idx);
+    size_t avg = idx->count > 0 ? idx->total_len / idx->count : 0;
 
-    for (size_t i = 0; i < la->count; i++) {
-        size_t len = strlen(la->lines[i]);
-        total_len += len;
-        if (len > longest) longest = len;
-        for (size_t j = 0; j < len; j++) {
-            if ((unsigned char)la->lines[i][j] > 127) {
-                all_ascii = false;
-            }
-        }
+    fprintf(out, "[ENCODING] %s", lp_encoding_name(enc));
+    switch (enc) {
+        case LP_ENC_UTF8:
+            fprintf(out, " (%zu non-ASCII bytes)", idx->non_ascii_bytes);
+            break;
+        case LP_ENC_INVALID:
+            fprintf(out, " (%zu malformed sequences, first at byte %zu; likely Latin-1)",
+                    idx->invalid_seqs, idx->first_invalid);
+            break;
+        case LP_ENC_BINARY:
+            fprintf(out, " (%zu NUL, %zu control bytes)", idx->nul_bytes, idx->ctrl_bytes);
+            break;
+        case LP_ENC_ASCII:
+            break;
     }
+    fprintf(out, " | longest line: %zu chars | avg: %zu chars\n", idx->longest, avg);
+
+    size_t kinds = (idx->lf > 0) + (idx->crlf > 0) + (idx->cr > 0);
+    fprintf(out, "[LINE ENDINGS] LF %zu | CRLF %zu | CR %zu | final newline: %s%s\n",
+            idx->lf, idx->crlf, idx->cr, idx->final_newline ? "yes" : "no",
+            kinds > 1 ? " | MIXED" : "");
 
-    size_t avg = la->count > 0 ? total_len / la->count : 0;
-    fprintf(out, "[ENCODING] %s | longest line: %zu chars | avg: %zu chars\n",
-            all_ascii ? "ASCII" : "UTF-8", longest, avg);
+    fprintf(out, "[LINE LENGTHS] p50 <=%zu | p90 <=%zu | p99 <=%zu |",
+            lp_line_index_percentile(idx, 0.50), lp_line_index_percentile(idx, 0.90),
+            lp_line_index_percentile(idx, 0.99));
+    for (size_t b = 0; b < LP_LINE_HIST_BUCKETS; b++) {
+        if (!idx->hist[b]) continue;
+        if (b <= 1) fprintf(out, " %zu:%zu", b, idx->hist[b]);
+        else if (b == LP_LINE_HIST_BUCKETS - 1)
+            fprintf(out, " %zu+:%zu", (size_t)1 << (b - 1), idx->hist[b]);
+        else
+            fprintf(out, " %zu-%zu:%zu", (size_t)1 << (b - 1), ((size_t)1 << b) - 1, idx->hist[b]);
+    }
+    fprintf(out, "\n");
 }
 
 /* ---- Phase boundary detection ---- */
@@ -178,78 +268,172 @@ typedef struct {
     char   label[128];
 } phase_info;
 
+/* A run of segments between phase markers or large gaps */
+typedef struct {
+    size_t start_line;
+    size_t end_line;
+    size_t first_seg;
+    size_t last_seg;
+} phase_span;
+
+/* Group consecutive segments into phases separated by large gaps or
+   phase markers. Returns a malloc'd array. */
+static phase_span *group_phases(const lp_segment *segs, size_t seg_count, size_t *out_count) {
+    phase_span *phases = (phase_span *)malloc((seg_count ? seg_count : 1) * sizeof(phase_span));
+    size_t n = 0;
+    for (size_t i = 0; i < seg_count; i++) {
+        phase_span *ph = &phases[n++];
+        ph->start_line = segs[i].start_line;
+        ph->end_line = segs[i].end_line;
+        ph->first_seg = ph->last_seg = i;
+        /* Extend phase to next boundary */
+        for (size_t j = i + 1; j < seg_count; j++) {
+            if (segs[j].type == LP_SEG_PHASE) break;
+            if (segs[j].start_line > segs[j-1].end_line + 10) break;
+            ph->end_line = segs[j].end_line;
+            ph->last_seg = i = j;
+        }
+    }
+    *out_count = n;
+    return phases;
+}
+
+/* First line of a phase, trimmed, as a label */
+static void phase_label(char *label, size_t cap, const line_array *la, size_t line) {
+    label[0] = '\0';
+    if (line >= la->count) return;
+    const char *first = la->lines[line];
+    size_t llen = strlen(first);
+    if (llen > 100) llen = 100;
+    /* Trim leading whitespace for label */
+    while (*first && isspace((unsigned char)*first)) { first++; llen--; }
+    snprintf(label, cap, "%.*s", (int)llen, first);
+}
+
 static void detect_phases(FILE *out, line_array *la, lp_segment *segs,
                           size_t seg_count, bool detailed) {
     /* Identify phase boundaries from segments */
     fprintf(out, "\n[PHASE BOUNDARIES] (detected by blank lines + pattern shifts)\n");
 
-    /* Group consecutive segments into phases separated by large gaps or phase markers */
-    size_t phase_num = 0;
-    size_t phase_start = 0;
-
-    for (size_t i = 0; i < seg_count; i++) {
-        bool new_phase = false;
-
-        if (i == 0) {
-            new_phase = true;
-        } else if (segs[i].type == LP_SEG_PHASE) {
-            new_phase = true;
-        } else if (segs[i].start_line > segs[i-1].end_line + 10) {
-            /* Large gap between segments */
-            new_phase = true;
-        }
-
-        if (new_phase && i > 0) {
-            /* End previous phase */
-            phase_num++;
-        }
-
-        if (new_phase) {
-            phase_start = segs[i].start_line;
-            size_t phase_end = segs[i].end_line;
-            /* Extend phase to next boundary */
-            for (size_t j = i + 1; j < seg_count; j++) {
-                if (segs[j].type == LP_SEG_PHASE) break;
-                if (segs[j].start_line > segs[j-1].end_line + 10) break;
-                phase_end = segs[j].end_line;
-                i = j;
-            }
-
-            /* Get a label from the first line */
-            char label[128] = "";
-            if (phase_start < la->count) {
-                const char *first = la->lines[phase_start];
-                size_t llen = strlen(first);
-                if (llen > 100) llen = 100;
-                /* Trim leading whitespace for label */
-                while (*first && isspace((unsigned char)*first)) { first++; llen--; }
-                snprintf(label, sizeof(label), "%.*s", (int)llen, first);
-            }
+    size_t phase_count;
+    phase_span *phases = group_phases(segs, seg_count, &phase_count);
+    for (size_t p = 0; p < phase_count; p++) {
+        size_t phase_start = phases[p].start_line;
+        char label[128];
+        phase_label(label, sizeof(label), la, phase_start);
 
-            fprintf(out, "  Phase %zu: lines %zu-%zu      (%s)\n",
-                    phase_num + 1, phase_start + 1, phase_end + 1, label);
+        fprintf(out, "  Phase %zu: lines %zu-%zu      (%s)\n",
+                p + 1, phase_start + 1, phases[p].end_line + 1, label);
 
-            if (detailed && phase_start < la->count) {
-                /* Show first 3 lines */
-                size_t preview = 3;
-                if (phase_start + preview > la->count)
-                    preview = la->count - phase_start;
-                for (size_t p = 0; p < preview; p++) {
-                    fprintf(out, "    | %s\n", la->lines[phase_start + p]);
-                }
+        if (detailed && phase_start < la->count) {
+            /* Show first 3 lines */
+            size_t preview = 3;
+            if (phase_start + preview > la->count)
+                preview = la->count - phase_start;
+            for (size_t k = 0; k < preview; k++) {
+                fprintf(out, "    | %s\n", la->lines[phase_start + k]);
             }
         }
     }
+    free(phases);
 }
 
 /* ---- Suggest mode ---- */
 
+#define SUGGEST_MIN_REPEAT 3    /* Template must cover this many lines to become a rule */
+#define SUGGEST_MAX_RULES  10
+#define SUGGEST_TOP_TMPL   10
+
+static void print_toml_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', out);
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+/* Lines worth keeping must never become drop/boilerplate rules */
+static bool is_diagnostic_text(const char *s) {
+    return lp_str_contains_ci(s, "error") || lp_str_contains_ci(s, "warning") ||
+           lp_str_contains_ci(s, "fail") || lp_str_contains_ci(s, "fatal") ||
+           lp_str_contains_ci(s, "undefined");
+}
+
+/* Tokens [from, from+ntokens) of line with the line's own spacing, so the
+   result is a literal substring of it. Stops early past max_len. malloc'd. */
+static char *original_span(const char *line, size_t from, size_t ntokens, size_t max_len) {
+    const char *p = line;
+    for (size_t t = 0; t < from && *p; t++) {
+        while (*p && isspace((unsigned char)*p)) p++;
+        while (*p && !isspace((unsigned char)*p)) p++;
+    }
+    while (*p && isspace((unsigned char)*p)) p++;
+    const char *start = p, *end = p;
+    for (size_t t = 0; t < ntokens && *p; t++) {
+        while (*p && isspace((unsigned char)*p)) p++;
+        const char *tok_end = p;
+        while (*tok_end && !isspace((unsigned char)*tok_end)) tok_end++;
+        if ((size_t)(tok_end - start) > max_len && t > 0) break;
+        end = p = tok_end;
+    }
+    return lp_strdup_range(start, 0, (size_t)(end - start));
+}
+
+/* Longest run of constant tokens in a template; returns its length */
+static size_t longest_constant_run(const lp_template *t, size_t *from) {
+    size_t best = 0, run = 0;
+    *from = 0;
+    for (size_t k = 0; k < t->token_count; k++) {
+        run = t->tokens[k] ? run + 1 : 0;
+        if (run > best) {
+            best = run;
+            *from = k + 1 - run;
+        }
+    }
+    return best;
+}
+
 static void suggest_mode_toml(FILE *out, line_array *la, lp_dedup_table *dedup,
                               lp_segment *segs, size_t seg_count) {
     (void)dedup;
 
+    /* Mine templates in one pass */
+    lp_template_miner tm;
+    lp_template_init(&tm, 0, 0.0f, 0);
+    for (size_t i = 0; i < la->count; i++)
+        lp_template_add(&tm, la->lines[i], i);
+    lp_template **sorted = lp_template_sorted(&tm);
+
+    size_t collapsed_total = 0;
+    for (size_t i = 0; i < tm.count; i++)
+        collapsed_total += tm.items[i].count > 1
+            ? lp_template_collapsed_bytes(&tm.items[i]) : tm.items[i].bytes;
+    size_t first_diag = la->count;
+    for (size_t i = 0; i < la->count; i++) {
+        if (is_diagnostic_text(la->lines[i])) { first_diag = i; break; }
+    }
+    size_t min_repeat = tm.lines / 50;
+    if (min_repeat < SUGGEST_MIN_REPEAT) min_repeat = SUGGEST_MIN_REPEAT;
+
     fprintf(out, "# Draft mode generated by logexplore\n");
-    fprintf(out, "# Review and customize before using\n\n");
+    fprintf(out, "# Review and customize before using\n");
+    fprintf(out, "#\n# Template mining: %zu lines -> %zu templates, %zu -> %zu bytes "
+                 "if repeats collapse (%.1f:1)\n",
+            tm.lines, tm.count, tm.total_bytes, collapsed_total,
+            collapsed_total ? (double)tm.total_bytes / (double)collapsed_total : 1.0);
+    size_t shown = 0;
+    for (size_t i = 0; i < tm.count && shown < SUGGEST_TOP_TMPL; i++) {
+        const lp_template *t = sorted[i];
+        if (t->count < 2) break;
+        char *text = lp_template_string(t);
+        fprintf(out, "#   x%-4zu %6zu B -> %4zu B (%5.1f:1)  %s\n", t->count, t->bytes,
+                lp_template_collapsed_bytes(t), (double)lp_template_ratio(t), text);
+        free(text);
+        shown++;
+    }
+    fprintf(out, "\n");
+
     fprintf(out, "[mode]\n");
     fprintf(out, "name = \"draft\"\n");
     fprintf(out, "description = \"Auto-generated mode\"\n\n");
@@ -278,9 +462,38 @@ static void suggest_mode_toml(FILE *out, line_array *la, lp_dedup_table *dedup,
     }
     fprintf(out, "]\n\n");
 
-    /* Dedup strip patterns */
+    /* Dedup strip patterns: one per value kind seen at wildcard positions
+       of repeating templates, weighted by the lines they cover */
+    size_t kind_lines[5] = {0};
+    static const unsigned KIND_BITS[5] = {
+        LP_TOK_QUOTED, LP_TOK_HEX, LP_TOK_PATH, LP_TOK_NUM, LP_TOK_WORD
+    };
+    static const char *KIND_NAMES[5] = { "quoted", "hex", "path", "number", "word" };
+    for (size_t i = 0; i < tm.count; i++) {
+        const lp_template *t = &tm.items[i];
+        if (t->count < 2) continue;
+        unsigned seen = 0;
+        for (size_t k = 0; k < t->token_count; k++) {
+            if (!t->tokens[k]) seen |= t->kinds[k];
+        }
+        for (int b = 0; b < 5; b++) {
+            if (seen & KIND_BITS[b]) kind_lines[b] += t->count;
+        }
+    }
     fprintf(out, "[dedup]\n");
-    fprintf(out, "strip_patterns = [\"\\\"[^\\\"]*\\\"\", \"0x[0-9a-f]+\"]\n\n");
+    fprintf(out, "# Wildcard values seen:");
+    for (int b = 0; b < 5; b++)
+        fprintf(out, " %s x%zu%s", KIND_NAMES[b], kind_lines[b], b < 4 ? "," : "\n");
+    fprintf(out, "strip_patterns = [");
+    int sp = 0;
+    if (kind_lines[0]) {
+        fprintf(out, "%s\"\\\"[^\\\"]*\\\"\", \"'[^']*'\"", sp++ ? ", " : "");
+    }
+    if (kind_lines[1]) fprintf(out, "%s\"0x[0-9a-fA-F]+\"", sp++ ? ", " : "");
+    if (kind_lines[2]) fprintf(out, "%s\"[^ ]*/[^ ]+\"", sp++ ? ", " : "");
+    if (kind_lines[3]) fprintf(out, "%s\"[0-9]+\"", sp++ ? ", " : "");
+    if (sp == 0) fprintf(out, "\"\\\"[^\\\"]*\\\"\", \"0x[0-9a-f]+\"");
+    fprintf(out, "]\n\n");
 
     /* Phase markers from phase segments */
     fprintf(out, "[segments]\n");
@@ -290,19 +503,1388 @@ static void suggest_mode_toml(FILE *out, line_array *la, lp_dedup_table *dedup,
         if (segs[i].type == LP_SEG_PHASE && segs[i].line_count > 0) {
             if (pm_count > 0) fprintf(out, ", ");
             char *trimmed = lp_strtrim(segs[i].lines[0]);
-            fprintf(out, "\"%s\"", trimmed);
+            print_toml_string(out, trimmed);
             free(trimmed);
             pm_count++;
         }
     }
     fprintf(out, "]\n");
-    fprintf(out, "block_triggers = [\"error:\", \"warning:\", \"FAILED\"]\n\n");
+    fprintf(out, "block_triggers = [\"error:\", \"warning:\", \"FAILED\"]\n");
+
+    /* Boilerplate: constant (wildcard-free) templates in the log's preamble,
+       before the first diagnostic */
+    fprintf(out, "boilerplate_patterns = [");
+    int bp = 0;
+    for (size_t i = 0; i < tm.count && bp < SUGGEST_MAX_RULES; i++) {
+        const lp_template *t = sorted[i];
+        if (lp_template_wildcards(t) > 0 || t->token_count < 3) continue;
+        if (t->first_line > la->count / 4) continue;
+        if (t->first_line > first_diag) continue;
+        char *lit = original_span(la->lines[t->first_line], 0, t->token_count, 60);
+        if (strlen(lit) >= 8 && !is_diagnostic_text(lit)) {
+            fprintf(out, "%s\n    ", bp++ ? "," : "");
+            print_toml_string(out, lit);
+        }
+        free(lit);
+    }
+    fprintf(out, "%s]\n\n", bp ? "\n" : "");
 
     /* Interest keywords — look for common interesting terms */
     fprintf(out, "[interest]\n");
     fprintf(out, "keywords = [\"error\", \"warning\", \"FAILED\", \"undefined\"]\n");
     fprintf(out, "error_patterns = [\"error:\", \"fatal:\", \"FAILED\", \"undefined reference\"]\n");
-    fprintf(out, "warning_patterns = [\"warning:\"]\n");
+    fprintf(out, "warning_patterns = [\"warning:\"]\n\n");
+
+    /* Drop: high-volume variable templates, keyed by their longest constant run */
+    fprintf(out, "[elision]\n");
+    fprintf(out, "drop_contains = [");
+    int dc = 0;
+    for (size_t i = 0; i < tm.count && dc < SUGGEST_MAX_RULES; i++) {
+        const lp_template *t = sorted[i];
+        if (t->count < min_repeat) break;
+        if (lp_template_wildcards(t) == 0) continue;
+        size_t from, k = longest_constant_run(t, &from);
+        if (k < 2) continue;
+        char *lit = original_span(la->lines[t->first_line], from, k, 60);
+        if (strlen(lit) >= 8 && !is_diagnostic_text(lit)) {
+            fprintf(out, "%s\n    ", dc++ ? "," : "");
+            print_toml_string(out, lit);
+            fprintf(out, "  # x%zu, %.1f:1", t->count, (double)lp_template_ratio(t));
+        }
+        free(lit);
+    }
+    fprintf(out, "%s]\n", dc ? "\n" : "");
+
+    free(sorted);
+    lp_template_free(&tm);
+}
+
+/* ---- Strip-pattern discovery ---- */
+
+/* Streams the file twice in bounded memory. Pass 1 groups lines by token
+   skeleton (literal tokens kept, variable-looking tokens replaced by their
+   kind) and sketches each variable position's cardinality and entropy.
+   Pass 2 measures how many unique lines each proposed pattern removes. */
+
+#define DISCOVER_MAX_GROUPS   512   /* Skeletons sketched; later ones only counted */
+#define DISCOVER_TABLE_SIZE   1024  /* Open-addressed, 2x DISCOVER_MAX_GROUPS */
+#define DISCOVER_MAX_TOKENS   64
+#define DISCOVER_MAX_VARS     16    /* Variable positions sketched per skeleton */
+#define DISCOVER_MIN_DISTINCT 3
+#define DISCOVER_LABEL_MAX    100
+
+typedef enum {
+    STRIP_ADDR, STRIP_HASH, STRIP_PATH, STRIP_NUM, STRIP_KIND_COUNT
+} strip_kind;
+
+/* In application order: addresses before numbers so "0x" stays whole */
+static const struct {
+    const char *name;
+    const char *pattern;
+} STRIP_KINDS[STRIP_KIND_COUNT] = {
+    { "address", "0x[0-9a-fA-F]+" },
+    { "hash",    "[0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f]+" },
+    { "path",    "[^ ]*/[^ ]+" },
+    { "number",  "[0-9]+" },
+};
+
+typedef struct {
+    strip_kind kind;
+    size_t     pos;
+    lp_hll     hll;
+    lp_topk    top;
+} discover_var;
+
+typedef struct {
+    uint64_t      hash;
+    size_t        count;
+    char         *label;
+    discover_var *vars;
+    size_t        var_count;
+    bool          used;
+} discover_group;
+
+/* Strip kind of a token that looks variable, or -1 for a literal */
+static int strip_kind_of(const char *tok, size_t len) {
+    char buf[256];
+    if (len >= sizeof(buf)) len = sizeof(buf) - 1;
+    memcpy(buf, tok, len);
+    buf[len] = '\0';
+
+    /* Counters like "[12/50]" or "3/4" are numbers, not paths */
+    bool digits = false, counter = true;
+    for (size_t i = 0; i < len; i++) {
+        if (isdigit((unsigned char)buf[i])) digits = true;
+        else if (!strchr("[]()/%:.,", buf[i])) counter = false;
+    }
+    if (digits && counter) return STRIP_NUM;
+    switch (lp_token_kind(buf)) {
+        case LP_TOK_HEX:  return (buf[0] == '0' && (buf[1] == 'x' || buf[1] == 'X'))
+                                 ? STRIP_ADDR : STRIP_HASH;
+        case LP_TOK_PATH: return STRIP_PATH;
+        case LP_TOK_NUM:  return STRIP_NUM;
+        default:          return digits ? STRIP_NUM : -1;
+    }
+}
+
+static discover_group *discover_lookup(discover_group *table, size_t *groups,
+                                       uint64_t h, const char *key) {
+    size_t idx = (size_t)(h & (DISCOVER_TABLE_SIZE - 1));
+    while (table[idx].used) {
+        if (table[idx].hash == h) return &table[idx];
+        idx = (idx + 1) & (DISCOVER_TABLE_SIZE - 1);
+    }
+    if (*groups >= DISCOVER_MAX_GROUPS) return NULL;
+    (*groups)++;
+    discover_group *g = &table[idx];
+    g->used = true;
+    g->hash = h;
+    g->label = lp_strdup_range(key, 0, strlen(key) > DISCOVER_LABEL_MAX
+                                           ? DISCOVER_LABEL_MAX : strlen(key));
+    return g;
+}
+
+typedef struct {
+    discover_group *group;
+    discover_var   *var;
+    double          distinct;
+    double          entropy;
+} discover_hit;
+
+static int cmp_hit_desc(const void *a, const void *b) {
+    const discover_hit *ha = (const discover_hit *)a;
+    const discover_hit *hb = (const discover_hit *)b;
+    double da = ha->distinct * (double)ha->group->count;
+    double db = hb->distinct * (double)hb->group->count;
+    return (da < db) - (da > db);
+}
+
+static double pct_less(double before, double after) {
+    return before > 0.0 ? 100.0 * (before - after) / before : 0.0;
+}
+
+static int discover_strips(FILE *out, FILE *fp, size_t top_n) {
+    discover_group *table = (discover_group *)calloc(DISCOVER_TABLE_SIZE,
+                                                     sizeof(discover_group));
+    size_t groups = 0, lines = 0, unsketched = 0;
+    char *buf = NULL;
+    size_t buf_cap = 0;
+    lp_string key = lp_string_new(256);
+
+    /* Pass 1: skeletons and per-position sketches */
+    while (lp_readline(fp, &buf, &buf_cap) >= 0) {
+        lines++;
+        const char *start[DISCOVER_MAX_TOKENS];
+        size_t len[DISCOVER_MAX_TOKENS];
+        int kind[DISCOVER_MAX_TOKENS];
+        size_t n = 0;
+        const char *p = buf;
+        lp_string_clear(&key);
+        while (*p && n < DISCOVER_MAX_TOKENS) {
+            while (*p && isspace((unsigned char)*p)) p++;
+            if (!*p) break;
+            start[n] = p;
+            while (*p && !isspace((unsigned char)*p)) p++;
+            len[n] = (size_t)(p - start[n]);
+            kind[n] = strip_kind_of(start[n], len[n]);
+            if (n > 0) lp_string_append(&key, " ", 1);
+            if (kind[n] >= 0) {
+                lp_string_append_cstr(&key, "<");
+                lp_string_append_cstr(&key, STRIP_KINDS[kind[n]].name);
+                lp_string_append_cstr(&key, ">");
+            } else {
+                lp_string_append(&key, start[n], len[n]);
+            }
+            n++;
+        }
+        const char *k = lp_string_cstr(&key);
+        discover_group *g = discover_lookup(table, &groups, lp_fnv1a(k, key.len), k);
+        if (!g) {
+            unsketched++;
+            continue;
+        }
+        g->count++;
+
+        size_t v = 0;
+        for (size_t t = 0; t < n && v < DISCOVER_MAX_VARS; t++) {
+            if (kind[t] < 0) continue;
+            if (v == g->var_count) {
+                g->vars = (discover_var *)realloc(g->vars,
+                                                  (v + 1) * sizeof(discover_var));
+                g->vars[v].kind = (strip_kind)kind[t];
+                g->vars[v].pos = t;
+                lp_hll_init(&g->vars[v].hll);
+                lp_topk_init(&g->vars[v].top);
+                g->var_count++;
+            }
+            uint64_t th = lp_fnv1a(start[t], len[t]);
+            lp_hll_add(&g->vars[v].hll, th);
+            lp_topk_add(&g->vars[v].top, th);
+            v++;
+        }
+    }
+    lp_string_free(&key);
+
+    /* High-cardinality positions */
+    LP_VEC(discover_hit) hits;
+    lp_vec_init(hits);
+    size_t kind_positions[STRIP_KIND_COUNT] = {0};
+    size_t kind_lines[STRIP_KIND_COUNT] = {0};
+    for (size_t i = 0; i < DISCOVER_TABLE_SIZE; i++) {
+        discover_group *g = &table[i];
+        if (!g->used) continue;
+        bool counted[STRIP_KIND_COUNT] = {false};
+        for (size_t v = 0; v < g->var_count; v++) {
+            discover_var *dv = &g->vars[v];
+            double d = lp_hll_estimate(&dv->hll);
+            if (d > (double)g->count) d = (double)g->count;
+            if (d < DISCOVER_MIN_DISTINCT || d * 10.0 < (double)g->count) continue;
+            discover_hit hit = { g, dv, d, lp_sketch_entropy(&dv->top, g->count, d) };
+            lp_vec_push(hits, hit);
+            kind_positions[dv->kind]++;
+            if (!counted[dv->kind]) {
+                kind_lines[dv->kind] += g->count;
+                counted[dv->kind] = true;
+            }
+        }
+    }
+    if (hits.len > 0)
+        qsort(hits.items, hits.len, sizeof(discover_hit), cmp_hit_desc);
+
+    fprintf(out, "[DISCOVER STRIPS] %zu lines | %zu skeletons | %zu high-cardinality positions\n",
+            lines, groups, hits.len);
+    if (unsketched > 0)
+        fprintf(out, "  (%zu lines beyond the first %d skeletons were not sketched)\n",
+                unsketched, DISCOVER_MAX_GROUPS);
+
+    size_t show = hits.len < top_n ? hits.len : top_n;
+    fprintf(out, "\n[HIGH-CARDINALITY POSITIONS: top %zu]\n", show);
+    for (size_t i = 0; i < show; i++) {
+        discover_hit *h = &hits.items[i];
+        fprintf(out, "  ~%-6.0f %5.1f bits  %-7s tok %-2zu x%-5zu %s\n",
+                h->distinct, h->entropy, STRIP_KINDS[h->var->kind].name,
+                h->var->pos + 1, h->group->count, h->group->label);
+    }
+
+    /* Pass 2: measure unique lines under each proposal, and all combined */
+    const char *proposed[STRIP_KIND_COUNT];
+    strip_kind proposed_kind[STRIP_KIND_COUNT];
+    size_t pc = 0;
+    for (int k = 0; k < STRIP_KIND_COUNT; k++) {
+        if (kind_positions[k] == 0) continue;
+        proposed_kind[pc] = (strip_kind)k;
+        proposed[pc++] = STRIP_KINDS[k].pattern;
+    }
+
+    /* chain[m]: unique lines with the patterns in bitmask m applied in
+       order, each once per line on the previous one's output. Every subset
+       is measured in one pass, so a pattern that turns out to be skipped
+       can be left out of the chain the next one is measured on. */
+    size_t chains = (size_t)1 << pc;
+    lp_hll chain[1u << STRIP_KIND_COUNT];
+    char *norm[1u << STRIP_KIND_COUNT];
+    for (size_t m = 0; m < chains; m++) lp_hll_init(&chain[m]);
+    if (pc > 0) {
+        rewind(fp);
+        while (lp_readline(fp, &buf, &buf_cap) >= 0) {
+            norm[0] = lp_normalize_line(buf, NULL, 0);
+            lp_hll_add(&chain[0], lp_fnv1a(norm[0], strlen(norm[0])));
+            for (size_t m = 1; m < chains; m++) {
+                size_t last = 0;                  /* Highest pattern in m runs last */
+                while (m >> (last + 1)) last++;
+                norm[m] = lp_normalize_line(norm[m & ~((size_t)1 << last)], &proposed[last], 1);
+                lp_hll_add(&chain[m], lp_fnv1a(norm[m], strlen(norm[m])));
+            }
+            for (size_t m = 0; m < chains; m++) free(norm[m]);
+        }
+    }
+    free(buf);
+
+    fprintf(out, "\n[PROPOSALS]\n");
+    if (pc == 0) {
+        fprintf(out, "  No high-cardinality positions; current strip patterns suffice.\n");
+    } else {
+        /* A pattern is recommended when it still removes unique lines on
+           top of the ones before it */
+        bool keep[STRIP_KIND_COUNT];
+        size_t kept_mask = 0;
+        double before = lp_hll_estimate(&chain[0]), prev = before;
+        fprintf(out, "  unique lines ~%.0f before stripping\n", before);
+        for (size_t i = 0; i < pc; i++) {
+            double with = lp_hll_estimate(&chain[kept_mask | ((size_t)1 << i)]);
+            keep[i] = prev - with >= 1.0 && pct_less(prev, with) >= 1.0;
+            if (keep[i]) kept_mask |= (size_t)1 << i;
+            char quoted[96];
+            snprintf(quoted, sizeof(quoted), "\"%s\"", proposed[i]);
+            fprintf(out, "  %-7s %-22s %3zu positions %7zu lines | unique ~%.0f -> ~%.0f"
+                         " (-%.0f%%)%s\n",
+                    STRIP_KINDS[proposed_kind[i]].name, quoted,
+                    kind_positions[proposed_kind[i]], kind_lines[proposed_kind[i]],
+                    prev, keep[i] ? with : prev, keep[i] ? pct_less(prev, with) : 0.0,
+                    keep[i] ? "" : "  [no gain, skipped]");
+            if (keep[i]) prev = with;
+        }
+        fprintf(out, "  total unique ~%.0f -> ~%.0f (-%.0f%%)\n",
+                before, prev, pct_less(before, prev));
+
+        fprintf(out, "\n[dedup]\nstrip_patterns = [");
+        size_t emitted = 0;
+        for (size_t i = 0; i < pc; i++) {
+            if (keep[i]) fprintf(out, "%s\"%s\"", emitted++ ? ", " : "", proposed[i]);
+        }
+        fprintf(out, "]\n");
+    }
+
+    lp_vec_free(hits);
+    for (size_t i = 0; i < DISCOVER_TABLE_SIZE; i++) {
+        free(table[i].label);
+        free(table[i].vars);
+    }
+    free(table);
+    return 0;
+}
+
+/* ---- Mode profiling ---- */
+
+/* Replays lp_line_fate's rule order over the log. Every rule is checked
+   against every line (so hits include lines an earlier rule already
+   decided), then the fate order is walked to find which rule decides each
+   line. Time is measured per rule over whole passes, not per call. */
+
+#define PROFILE_MIN_CHECKS 20000   /* Checks timed per rule, at least */
+
+typedef bool (*line_check_fn)(const char *line);
+
+typedef struct {
+    const char   *label;      /* Pattern text, or fixed check name */
+    const char   *group;
+    lp_fate       fate;
+    line_check_fn check;      /* Fixed check; NULL for a pattern */
+    bool          ci;
+    uint64_t     *bits;       /* Lines matched */
+    size_t        hits;
+    size_t        first;      /* Lines this rule decided */
+    size_t        reached;    /* Lines not decided before this rule */
+    double        ns_per_line;
+} profile_rule;
+
+static bool profile_rule_matches(const profile_rule *r, const char *line) {
+    if (r->check) return r->check(line);
+    return r->ci ? lp_str_contains_ci(line, r->label) : lp_str_contains(line, r->label);
+}
+
+static const char *fate_name(lp_fate f) {
+    switch (f) {
+        case LP_FATE_KEEP:      return "keep";
+        case LP_FATE_DROP:      return "drop";
+        case LP_FATE_KEEP_ONCE: return "keep_once";
+    }
+    return "?";
+}
+
+typedef LP_VEC(profile_rule) profile_rule_vec;
+
+static void profile_add_fixed(profile_rule_vec *rules, const char *label,
+                              line_check_fn check, lp_fate fate) {
+    profile_rule r;
+    memset(&r, 0, sizeof(r));
+    r.label = label;
+    r.group = "fixed";
+    r.fate = fate;
+    r.check = check;
+    lp_vec_push(*rules, r);
+}
+
+/* Does pattern a occur in every line that contains pattern b? */
+static bool pattern_implies(const profile_rule *a, const profile_rule *b) {
+    if (a->check || b->check) return false;
+    if (a->ci) return lp_str_contains_ci(b->label, a->label);
+    return !b->ci && lp_str_contains(b->label, a->label);
+}
+
+static int profile_mode(FILE *out, line_array *la, const lp_mode *mode) {
+    lp_fate_classifier fc;
+    lp_fate_init(&fc, (const struct lp_mode *)mode, SIZE_MAX);
+
+    /* Rules in lp_line_fate order: lp_fate_steps, each pattern group as
+       lp_fate_init lays it out (declaration order) */
+    profile_rule_vec rules;
+    lp_vec_init(rules);
+    lp_fate_stage done = LP_FATE_STAGE_FIXED;
+    for (size_t s = 0; s < lp_fate_step_count; s++) {
+        const lp_fate_step *step = &lp_fate_steps[s];
+        if (step->check) {
+            profile_add_fixed(&rules, step->name, step->check, step->fate);
+            continue;
+        }
+        if (step->stage == done) continue;
+        done = step->stage;
+        lp_fate_group g = (lp_fate_group)(step->stage - LP_FATE_STAGE_KEEP);
+        for (size_t i = 0; i < fc.counts[g]; i++) {
+            profile_rule r;
+            memset(&r, 0, sizeof(r));
+            r.label = fc.rules[g][i].pattern;
+            r.group = lp_fate_group_name(g);
+            r.fate = step->fate;
+            r.ci = fc.rules[g][i].ci;
+            lp_vec_push(rules, r);
+        }
+    }
+
+    /* Match bitsets and per-rule cost */
+    size_t words = (la->count + 63) / 64;
+    size_t reps = PROFILE_MIN_CHECKS / la->count;
+    if (reps == 0) reps = 1;
+    volatile size_t sink = 0;
+    for (size_t r = 0; r < rules.len; r++) {
+        profile_rule *pr = &rules.items[r];
+        pr->bits = (uint64_t *)calloc(words, sizeof(uint64_t));
+        uint64_t t0 = lp_now_ns();
+        for (size_t rep = 0; rep < reps; rep++) {
+            size_t hits = 0;
+            for (size_t i = 0; i < la->count; i++) {
+                if (!profile_rule_matches(pr, la->lines[i])) continue;
+                hits++;
+                if (rep == 0) pr->bits[i / 64] |= 1ULL << (i % 64);
+            }
+            pr->hits = hits;
+            sink += hits;
+        }
+        pr->ns_per_line = (double)(lp_now_ns() - t0) / (double)(reps * la->count);
+    }
+    (void)sink;
+
+    /* Walk the fate order: which rule decides each line */
+    size_t undecided = 0;
+    for (size_t i = 0; i < la->count; i++) {
+        bool decided = false;
+        for (size_t r = 0; r < rules.len && !decided; r++) {
+            rules.items[r].reached++;
+            if (rules.items[r].bits[i / 64] & (1ULL << (i % 64))) {
+                rules.items[r].first++;
+                decided = true;
+            }
+        }
+        if (!decided) undecided++;
+    }
+
+    double total_us = 0.0;
+    for (size_t r = 0; r < rules.len; r++)
+        total_us += rules.items[r].ns_per_line * (double)rules.items[r].reached / 1000.0;
+
+    fprintf(out, "[PROFILE MODE] %s%s | %zu lines | %zu rules | ~%.1f us per classification pass\n",
+            mode->name ? mode->name : "?", mode->builtin ? " (built-in)" : "",
+            la->count, rules.len, total_us);
+    if (mode->plugin_path)
+        fprintf(out, "  (plugin %s not profiled; it runs before these rules)\n", mode->plugin_path);
+
+    fprintf(out, "\n[RULES] in lp_line_fate order; hits count every matching line, "
+                 "first counts lines the rule decided\n");
+    fprintf(out, "  %3s  %-9s %-9s %7s %7s %6s %8s %8s %8s  %s\n", "#", "group", "fate",
+            "hits", "first", "share", "reached", "ns/line", "est.us", "rule");
+    for (size_t r = 0; r < rules.len; r++) {
+        profile_rule *pr = &rules.items[r];
+        fprintf(out, "  %3zu  %-9s %-9s %7zu %7zu %5.1f%% %8zu %8.1f %8.2f  %s%s%s\n",
+                r + 1, pr->group, fate_name(pr->fate), pr->hits, pr->first,
+                100.0 * (double)pr->first / (double)la->count, pr->reached,
+                pr->ns_per_line, pr->ns_per_line * (double)pr->reached / 1000.0,
+                pr->check ? "(" : "\"", pr->label, pr->check ? ")" : "\"");
+    }
+    fprintf(out, "  %3s  %-9s %-9s %7s %7zu %5.1f%%  (no rule matched: kept)\n", "", "default",
+            "keep", "", undecided, 100.0 * (double)undecided / (double)la->count);
+
+    /* Dead weight: mode patterns that never match */
+    size_t never = 0;
+    for (size_t r = 0; r < rules.len; r++) {
+        if (!rules.items[r].check && rules.items[r].hits == 0) never++;
+    }
+    fprintf(out, "\n[NEVER MATCHED: %zu patterns]\n", never);
+    for (size_t r = 0; r < rules.len; r++) {
+        profile_rule *pr = &rules.items[r];
+        if (pr->check || pr->hits > 0) continue;
+        fprintf(out, "  #%-3zu %-9s \"%s\"", r + 1, pr->group, pr->label);
+        for (size_t a = 0; a < r; a++) {
+            if (pattern_implies(&rules.items[a], pr)) {
+                fprintf(out, "  (would be shadowed by #%zu \"%s\")", a + 1, rules.items[a].label);
+                break;
+            }
+        }
+        fprintf(out, "\n");
+    }
+
+    /* Shadowed: every line the rule matches is decided by one earlier rule */
+    size_t shadowed = 0;
+    for (size_t r = 0; r < rules.len; r++) {
+        profile_rule *pr = &rules.items[r];
+        if (pr->check || pr->hits == 0 || pr->first > 0) continue;
+        for (size_t a = 0; a < r; a++) {
+            profile_rule *ar = &rules.items[a];
+            bool covers = true;
+            for (size_t w = 0; w < words && covers; w++) {
+                if (pr->bits[w] & ~ar->bits[w]) covers = false;
+            }
+            if (!covers) continue;
+            if (shadowed++ == 0) fprintf(out, "\n[SHADOWED]\n");
+            fprintf(out, "  #%-3zu %-9s \"%s\" (%zu hits) %s #%zu %s %s%s%s%s\n",
+                    r + 1, pr->group, pr->label, pr->hits,
+                    ar->fate == pr->fate ? "redundant with" : "overridden by",
+                    a + 1, ar->group, ar->check ? "(" : "\"", ar->label,
+                    ar->check ? ")" : "\"",
+                    pattern_implies(ar, pr) ? " (always: substring)" : "");
+            break;
+        }
+    }
+    if (shadowed == 0) fprintf(out, "\n[SHADOWED] none\n");
+
+    for (size_t r = 0; r < rules.len; r++) free(rules.items[r].bits);
+    lp_vec_free(rules);
+    lp_fate_free(&fc);
+    return 0;
+}
+
+/* ---- Sampled exploration ---- */
+
+/* For logs too large to read whole. The file is mapped and cut into equal
+   strata and one block is taken from each: the head and tail blocks are
+   anchored at the ends, the rest start at a seeded random offset. The usual
+   frequency/segment/phase analysis then runs on the blocks, and totals are
+   extrapolated with a ratio estimator over blocks, so the cost is bounded
+   by the sample size, not the file size. */
+
+#define SAMPLE_BLOCKS     64
+#define SAMPLE_MIN_BLOCK  512
+#define SAMPLE_Z95        1.96
+
+typedef struct {
+    size_t offset;   /* File offset of the first sampled line */
+    size_t bytes;
+    size_t first;    /* Index of its first line in the sample */
+    size_t lines;
+    size_t ends;     /* Lines that end in the block: cut ones don't count */
+} sample_block;
+
+static uint64_t sample_rand(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/* File total of a per-block count y[], with its 95% half-width:
+   R = sum(y) / sum(bytes) scaled to the file size */
+static double sample_estimate(const double *y, const sample_block *blocks, size_t n,
+                              size_t file_bytes, double *half_width) {
+    double sy = 0.0, sb = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        sy += y[i];
+        sb += (double)blocks[i].bytes;
+    }
+    *half_width = 0.0;
+    if (sb <= 0.0) return 0.0;
+    double r = sy / sb;
+    if (n > 1 && sb < (double)file_bytes) {
+        double ss = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            double d = y[i] - r * (double)blocks[i].bytes;
+            ss += d * d;
+        }
+        double var_r = (double)n / (double)(n - 1) * ss / (sb * sb);
+        var_r *= 1.0 - sb / (double)file_bytes;   /* Finite population */
+        *half_width = SAMPLE_Z95 * sqrt(var_r) * (double)file_bytes;
+    }
+    return r * (double)file_bytes;
+}
+
+static void print_estimate(FILE *out, double total, double hw) {
+    if (hw <= 0.0) {
+        fprintf(out, "%.0f", total);
+    } else {
+        fprintf(out, "~%.0f ±%.0f", total, hw);
+    }
+}
+
+static void format_bytes(char *buf, size_t cap, double b) {
+    if (b >= 1073741824.0)  snprintf(buf, cap, "%.1f GiB", b / 1073741824.0);
+    else if (b >= 1048576.0) snprintf(buf, cap, "%.1f MiB", b / 1048576.0);
+    else if (b >= 1024.0)    snprintf(buf, cap, "%.1f KiB", b / 1024.0);
+    else                     snprintf(buf, cap, "%.0f B", b);
+}
+
+static void print_bytes(FILE *out, double b) {
+    char buf[32];
+    format_bytes(buf, sizeof(buf), b);
+    fputs(buf, out);
+}
+
+static int sample_explore(FILE *out, const char *path, size_t sample_bytes, size_t top_n) {
+    uint64_t t0 = lp_now_ns();
+    lp_mapped_file mf;
+    if (!lp_map_file(path, &mf)) {
+        fprintf(stderr, "logexplore: cannot open '%s'\n", path);
+        return 1;
+    }
+    if (mf.len == 0) {
+        fprintf(stderr, "logexplore: empty file\n");
+        lp_unmap_file(&mf);
+        return 1;
+    }
+
+    /* Plan the blocks */
+    size_t nblocks = SAMPLE_BLOCKS;
+    if (sample_bytes / nblocks < SAMPLE_MIN_BLOCK) nblocks = sample_bytes / SAMPLE_MIN_BLOCK;
+    if (nblocks < 2) nblocks = 2;
+    size_t block_bytes = sample_bytes / nblocks;
+    bool whole = mf.len <= sample_bytes;
+    if (whole) {
+        nblocks = 1;
+        block_bytes = mf.len;
+    }
+    size_t stratum = mf.len / nblocks;
+
+    sample_block *blocks = (sample_block *)calloc(nblocks, sizeof(sample_block));
+    LP_VEC(char *) lines;
+    lp_vec_init(lines);
+    LP_VEC(size_t) line_block;
+    lp_vec_init(line_block);
+    uint64_t rng = (uint64_t)mf.len;   /* Same file, same sample */
+
+    for (size_t b = 0; b < nblocks; b++) {
+        size_t start;
+        if (b == 0) {
+            start = 0;
+        } else if (b == nblocks - 1) {
+            start = mf.len - block_bytes;
+        } else {
+            size_t slack = stratum > block_bytes ? stratum - block_bytes : 0;
+            start = b * stratum + (slack ? (size_t)(sample_rand(&rng) % slack) : 0);
+        }
+        /* Align to the next line start, never overlapping the previous
+           block. The alignment scan and the block's reads below are capped
+           at block_bytes, so the sample size is a real limit even when the
+           file has few newlines: a block then starts mid-line, and a line
+           running past the block's end is cut there. */
+        if (start > 0 && start < mf.len && mf.data[start - 1] != '\n') {
+            size_t scan = mf.len - start < block_bytes ? mf.len - start : block_bytes;
+            const char *nl = (const char *)memchr(mf.data + start, '\n', scan);
+            if (nl) start = (size_t)(nl - mf.data) + 1;
+        }
+        if (b > 0 && start < blocks[b - 1].offset + blocks[b - 1].bytes)
+            start = blocks[b - 1].offset + blocks[b - 1].bytes;
+
+        blocks[b].offset = start;
+        blocks[b].first = lines.len;
+        size_t pos = start;
+        size_t stop = mf.len - start < block_bytes ? mf.len : start + block_bytes;
+        while (pos < stop) {
+            size_t scan = stop - pos;
+            const char *nl = (const char *)memchr(mf.data + pos, '\n', scan);
+            size_t end = nl ? (size_t)(nl - mf.data) : pos + scan;
+            size_t len = end - pos;
+            if (len > 0 && mf.data[pos + len - 1] == '\r') len--;
+            lp_vec_push(lines, lp_strdup_range(mf.data + pos, 0, len));
+            lp_vec_push(line_block, b);
+            if (nl || end == mf.len) blocks[b].ends++;
+            pos = nl ? end + 1 : end;
+        }
+        blocks[b].bytes = pos - start;
+        blocks[b].lines = lines.len - blocks[b].first;
+        /* A blank separator keeps segments from spanning blocks */
+        if (b + 1 < nblocks) {
+            lp_vec_push(lines, lp_strdup_range("", 0, 0));
+            lp_vec_push(line_block, b);
+        }
+    }
+
+    size_t sampled = 0, sample_lines = 0;
+    for (size_t b = 0; b < nblocks; b++) {
+        sampled += blocks[b].bytes;
+        sample_lines += blocks[b].lines;
+    }
+
+    fprintf(out, "[LOGEXPLORE SAMPLE] ");
+    print_bytes(out, (double)mf.len);
+    if (whole) {
+        fprintf(out, " | whole file (smaller than the sample size)");
+    } else {
+        fprintf(out, " | %zu blocks x ", nblocks);
+        print_bytes(out, (double)block_bytes);
+        fprintf(out, " (");
+        print_bytes(out, (double)sampled);
+        fprintf(out, ", %.2f%% of the file)", 100.0 * (double)sampled / (double)mf.len);
+    }
+    fprintf(out, "\n");
+
+    /* Line total */
+    double *y = (double *)calloc(nblocks, sizeof(double));
+    double hw;
+    for (size_t b = 0; b < nblocks; b++) y[b] = (double)blocks[b].ends;
+    double est_lines = sample_estimate(y, blocks, nblocks, mf.len, &hw);
+    fprintf(out, "[ESTIMATE] lines ");
+    print_estimate(out, est_lines, hw);
+    fputs(hw > 0.0 ? " (95% CI)" : " (exact)", out);
+    fprintf(out, " | avg %.0f bytes/line\n",
+            sample_lines ? (double)sampled / (double)sample_lines : 0.0);
+
+    /* Frequency over the sample */
+    lp_dedup_table dedup;
+    lp_dedup_init(&dedup, lines.len / 2 + 64);
+    for (size_t i = 0; i < lines.len; i++) {
+        const sample_block *blk = &blocks[line_block.items[i]];
+        if (i == blk->first + blk->lines) continue;   /* Separator */
+        lp_dedup_insert(&dedup, lines.items[i], i, NULL, 0);
+    }
+    size_t sorted_count;
+    lp_dedup_entry **sorted = lp_dedup_sorted(&dedup, &sorted_count);
+    fprintf(out, "[ESTIMATE] %zu unique in %zu sampled lines (%.1f%% repeats)\n",
+            sorted_count, sample_lines,
+            sample_lines ? 100.0 * (double)(sample_lines - sorted_count) / (double)sample_lines
+                         : 0.0);
+
+    size_t top = top_n < sorted_count ? top_n : sorted_count;
+    fprintf(out, "\n[FREQUENCY TABLE: top %zu, estimated file totals]\n", top);
+    for (size_t t = 0; t < top; t++) {
+        memset(y, 0, nblocks * sizeof(double));
+        for (size_t i = 0; i < lines.len; i++) {
+            const sample_block *blk = &blocks[line_block.items[i]];
+            if (i == blk->first + blk->lines) continue;
+            if (strcmp(lines.items[i], sorted[t]->original) == 0) y[line_block.items[i]] += 1.0;
+        }
+        double est = sample_estimate(y, blocks, nblocks, mf.len, &hw);
+        fprintf(out, "  ");
+        print_estimate(out, est, hw);
+        fprintf(out, "  %s\n", sorted[t]->original);
+    }
+
+    /* Segments over the sample, mode detected from the head block */
+    char *mode_dir = lp_mode_find_dir();
+    size_t mode_count = 0;
+    lp_mode **modes = lp_mode_load_all(mode_dir, &mode_count);
+    free(mode_dir);
+    lp_mode *mode = NULL;
+    if (mode_count > 0) {
+        size_t sniff = blocks[0].lines < SNIFF_LINES ? blocks[0].lines : SNIFF_LINES;
+        mode = lp_mode_find(modes, mode_count,
+                            lp_mode_detect((const char **)lines.items, sniff, modes, mode_count));
+    }
+    size_t seg_count;
+    lp_segment *segs = lp_segment_detect((const char **)lines.items, lines.len,
+                                          (const struct lp_mode *)mode, &seg_count);
+
+    static const struct { lp_seg_type type; const char *name; } SEG_KINDS[] = {
+        { LP_SEG_ERROR, "error" },
+        { LP_SEG_WARNING, "warning" },
+        { LP_SEG_DATA, "tabular data" },
+        { LP_SEG_BUILD_PROGRESS, "build progress" },
+        { LP_SEG_PHASE, "phase marker" },
+    };
+    fprintf(out, "\n[SEGMENTS: %zu in sample, estimated file totals]", seg_count);
+    if (mode) fprintf(out, "  mode: %s", mode->name);
+    fprintf(out, "\n");
+    for (size_t k = 0; k < sizeof(SEG_KINDS) / sizeof(SEG_KINDS[0]); k++) {
+        memset(y, 0, nblocks * sizeof(double));
+        size_t in_sample = 0;
+        for (size_t i = 0; i < seg_count; i++) {
+            if (segs[i].type != SEG_KINDS[k].type) continue;
+            y[line_block.items[segs[i].start_line]] += 1.0;
+            in_sample++;
+        }
+        if (!in_sample) continue;
+        double est = sample_estimate(y, blocks, nblocks, mf.len, &hw);
+        fprintf(out, "  %-15s %4zu in sample -> ", SEG_KINDS[k].name, in_sample);
+        print_estimate(out, est, hw);
+        fprintf(out, "\n");
+    }
+
+    /* Phase markers, placed by file offset */
+    fprintf(out, "\n[PHASES IN SAMPLE] (position in file)\n");
+    size_t shown = 0;
+    for (size_t i = 0; i < seg_count && shown < top_n; i++) {
+        if (segs[i].type != LP_SEG_PHASE || segs[i].line_count == 0) continue;
+        const sample_block *blk = &blocks[line_block.items[segs[i].start_line]];
+        size_t off = blk->offset;
+        for (size_t l = blk->first; l < segs[i].start_line; l++)
+            off += strlen(lines.items[l]) + 1;
+        const char *label = segs[i].lines[0];
+        while (*label && isspace((unsigned char)*label)) label++;
+        fprintf(out, "  @ %5.1f%%  %.100s\n", 100.0 * (double)off / (double)mf.len, label);
+        shown++;
+    }
+    if (shown == 0) fprintf(out, "  (none)\n");
+
+    fprintf(out, "\n[SAMPLE TIME] %.3f s\n", (double)(lp_now_ns() - t0) / 1e9);
+
+    lp_segments_free(segs, seg_count);
+    if (modes) lp_modes_free(modes, mode_count);
+    free(sorted);
+    lp_dedup_free(&dedup);
+    free(y);
+    for (size_t i = 0; i < lines.len; i++) free(lines.items[i]);
+    lp_vec_free(lines);
+    lp_vec_free(line_block);
+    free(blocks);
+    lp_unmap_file(&mf);
+    return 0;
+}
+
+/* ---- Volume attribution ---- */
+
+/* Where the bytes go, from data already computed: dedup entries carry the
+   total length of their occurrences, and phase/segment spans are summed
+   from the line index lengths. Tokens are estimated once per line and
+   summed the same way into all three tables, so their totals agree. */
+
+typedef struct {
+    size_t      bytes;
+    size_t      tokens;
+    size_t      lines;
+    size_t      first_line;   /* Phases: start line */
+    size_t      last_line;
+} volume_row;
+
+typedef struct {
+    const lp_dedup_entry *entry;
+    size_t                tokens;
+} volume_entry;
+
+static int cmp_entry_hash(const void *a, const void *b) {
+    uint64_t ha = ((const volume_entry *)a)->entry->hash;
+    uint64_t hb = ((const volume_entry *)b)->entry->hash;
+    return ha < hb ? -1 : ha > hb;
+}
+
+static int cmp_entry_bytes_desc(const void *a, const void *b) {
+    const lp_dedup_entry *ea = ((const volume_entry *)a)->entry;
+    const lp_dedup_entry *eb = ((const volume_entry *)b)->entry;
+    if (ea->bytes != eb->bytes) return ea->bytes > eb->bytes ? -1 : 1;
+    return ea->first_line < eb->first_line ? -1 : ea->first_line > eb->first_line;
+}
+
+static int cmp_row_bytes_desc(const void *a, const void *b) {
+    const volume_row *ra = (const volume_row *)a;
+    const volume_row *rb = (const volume_row *)b;
+    if (ra->bytes != rb->bytes) return ra->bytes > rb->bytes ? -1 : 1;
+    return ra->first_line < rb->first_line ? -1 : ra->first_line > rb->first_line;
+}
+
+/* line_hash[i] is the dedup hash of line i, which finds its template */
+static void volume_report(FILE *out, const line_array *la, const lp_line_index *idx,
+                          lp_dedup_table *dedup, const uint64_t *line_hash,
+                          const lp_segment *segs, size_t seg_count,
+                          size_t top_n, const lp_mode *mode) {
+    size_t n;
+    lp_dedup_entry **sorted = lp_dedup_sorted(dedup, &n);
+    volume_entry *entries = (volume_entry *)calloc(n ? n : 1, sizeof(volume_entry));
+    for (size_t i = 0; i < n; i++) entries[i].entry = sorted[i];
+    free(sorted);
+    qsort(entries, n, sizeof(entries[0]), cmp_entry_hash);
+
+    /* Byte and token offsets of every line. A line's tokens include its
+       newline, as logparse counts them against the budget. */
+    size_t *prefix = (size_t *)malloc((la->count + 1) * sizeof(size_t));
+    size_t *tok_prefix = (size_t *)malloc((la->count + 1) * sizeof(size_t));
+    prefix[0] = tok_prefix[0] = 0;
+    for (size_t i = 0; i < la->count; i++) {
+        size_t tokens = lp_estimate_tokens(la->lines[i], strlen(la->lines[i])) + 1;
+        prefix[i + 1] = prefix[i] + idx->lengths[i];
+        tok_prefix[i + 1] = tok_prefix[i] + tokens;
+        size_t lo = 0, hi = n;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (entries[mid].entry->hash < line_hash[i]) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo < n && entries[lo].entry->hash == line_hash[i]) entries[lo].tokens += tokens;
+    }
+    qsort(entries, n, sizeof(entries[0]), cmp_entry_bytes_desc);
+
+    size_t total_tokens = tok_prefix[la->count];
+    double total = idx->total_len ? (double)idx->total_len : 1.0;
+    char size[32];
+
+    format_bytes(size, sizeof(size), (double)idx->total_len);
+    fprintf(out, "[VOLUME] %s in %zu lines | ~%zu tokens | %zu templates", size,
+            la->count, total_tokens, n);
+    fprintf(out, " (%s strip patterns + numbers)", mode ? mode->name : "no mode");
+    fprintf(out, "\n");
+
+    /* Templates */
+    size_t top = top_n < n ? top_n : n;
+    fprintf(out, "\n[TEMPLATES BY BYTES: top %zu]\n", top);
+    fprintf(out, "  %10s %6s %6s %9s %7s  %s\n", "bytes", "share", "cum", "~tokens", "count",
+            "template");
+    size_t cum = 0;
+    for (size_t i = 0; i < top; i++) {
+        const lp_dedup_entry *e = entries[i].entry;
+        cum += e->bytes;
+        format_bytes(size, sizeof(size), (double)e->bytes);
+        fprintf(out, "  %10s %5.1f%% %5.1f%% %9zu %7zu  %.100s\n", size,
+                100.0 * (double)e->bytes / total, 100.0 * (double)cum / total,
+                entries[i].tokens, e->count, e->normalized);
+    }
+
+    /* Phases */
+    size_t phase_count;
+    phase_span *phases = group_phases(segs, seg_count, &phase_count);
+    volume_row *rows = (volume_row *)calloc(phase_count ? phase_count : 1, sizeof(volume_row));
+    for (size_t p = 0; p < phase_count; p++) {
+        rows[p].first_line = phases[p].start_line;
+        rows[p].last_line = phases[p].end_line;
+        rows[p].lines = phases[p].end_line - phases[p].start_line + 1;
+        rows[p].bytes = prefix[phases[p].end_line + 1] - prefix[phases[p].start_line];
+        rows[p].tokens = tok_prefix[phases[p].end_line + 1] - tok_prefix[phases[p].start_line];
+    }
+    qsort(rows, phase_count, sizeof(volume_row), cmp_row_bytes_desc);
+    top = top_n < phase_count ? top_n : phase_count;
+    fprintf(out, "\n[PHASES BY BYTES: top %zu of %zu]\n", top, phase_count);
+    for (size_t p = 0; p < top; p++) {
+        char label[128];
+        phase_label(label, sizeof(label), la, rows[p].first_line);
+        format_bytes(size, sizeof(size), (double)rows[p].bytes);
+        fprintf(out, "  %10s %5.1f%% %9zu ~tokens  lines %zu-%zu  (%s)\n", size,
+                100.0 * (double)rows[p].bytes / total, rows[p].tokens,
+                rows[p].first_line + 1, rows[p].last_line + 1, label);
+    }
+
+    /* Segment types */
+    static const struct { lp_seg_type type; const char *name; } TYPES[] = {
+        { LP_SEG_ERROR, "error" },
+        { LP_SEG_WARNING, "warning" },
+        { LP_SEG_INFO, "info" },
+        { LP_SEG_DATA, "tabular data" },
+        { LP_SEG_PHASE, "phase marker" },
+        { LP_SEG_BUILD_PROGRESS, "build progress" },
+        { LP_SEG_BOILERPLATE, "boilerplate" },
+        { LP_SEG_NORMAL, "block" },
+    };
+    volume_row by_type[sizeof(TYPES) / sizeof(TYPES[0])];
+    memset(by_type, 0, sizeof(by_type));
+    for (size_t i = 0; i < seg_count; i++) {
+        for (size_t t = 0; t < sizeof(TYPES) / sizeof(TYPES[0]); t++) {
+            if (segs[i].type != TYPES[t].type) continue;
+            by_type[t].bytes += prefix[segs[i].end_line + 1] - prefix[segs[i].start_line];
+            by_type[t].tokens += tok_prefix[segs[i].end_line + 1] - tok_prefix[segs[i].start_line];
+            by_type[t].lines += segs[i].line_count;
+            by_type[t].first_line = t;   /* Keeps the name through the sort */
+        }
+    }
+    qsort(by_type, sizeof(TYPES) / sizeof(TYPES[0]), sizeof(volume_row), cmp_row_bytes_desc);
+    fprintf(out, "\n[SEGMENT TYPES BY BYTES]\n");
+    for (size_t t = 0; t < sizeof(TYPES) / sizeof(TYPES[0]); t++) {
+        if (by_type[t].lines == 0) continue;
+        format_bytes(size, sizeof(size), (double)by_type[t].bytes);
+        fprintf(out, "  %10s %5.1f%% %9zu ~tokens %8zu lines  %s\n", size,
+                100.0 * (double)by_type[t].bytes / total, by_type[t].tokens,
+                by_type[t].lines, TYPES[by_type[t].first_line].name);
+    }
+
+    free(rows);
+    free(phases);
+    free(tok_prefix);
+    free(prefix);
+    free(entries);
+}
+
+/* ---- Mode tuning ---- */
+
+/* Greedy hill-climb over mode additions. Candidates are drop/keep-once
+   literals mined as templates from the corpus, the strip patterns of
+   --discover-strips, and score weight steps. Each round evaluates every
+   (neighbour, log) pair in parallel on cached lp_pipeline state and keeps
+   the best improving move. */
+
+#define TUNE_MAX_ROUNDS     12
+#define TUNE_MAX_DROP       16
+#define TUNE_MAX_KEEP_ONCE  8
+#define TUNE_MIN_GAIN       0.005  /* Token savings below 0.5% are noise */
+
+typedef enum { MOVE_DROP, MOVE_KEEP_ONCE, MOVE_STRIP, MOVE_WEIGHT } move_kind;
+
+typedef struct {
+    move_kind kind;
+    size_t    cand;      /* Literal index, or strip kind */
+    int       feature;   /* MOVE_WEIGHT */
+    float     value;
+} tune_move;
+
+typedef struct {
+    bool    *literal_on;            /* Per literal candidate */
+    unsigned strip_mask;            /* Bits of strip_kind */
+    float    weights[LP_SF_COUNT];
+} tune_state;
+
+typedef struct {
+    size_t tokens;
+    size_t errors_kept, error_lines;
+    size_t warnings_kept, warning_lines;
+    size_t over_budget;
+} tune_score;
+
+typedef struct {
+    char     *text;
+    move_kind kind;   /* MOVE_DROP or MOVE_KEEP_ONCE */
+} tune_literal;
+
+typedef LP_VEC(tune_literal) tune_literal_vec;
+
+typedef struct {
+    lp_pipeline        **pipes;
+    size_t               logs;
+    lp_pipeline_config  *cfgs;   /* One per (neighbour, log) job */
+    lp_pipeline_result  *res;
+    size_t               budget;
+} tune_jobs;
+
+static void tune_eval_task(void *ctx, size_t i) {
+    tune_jobs *j = (tune_jobs *)ctx;
+    lp_pipeline_eval(j->pipes[i % j->logs], &j->cfgs[i], j->budget, &j->res[i]);
+}
+
+/* Strip set id of a mask in one log's pipeline, registering it on first use */
+static size_t tune_strip_set(lp_pipeline *pipe, size_t *ids, unsigned mask) {
+    if (ids[mask] != (size_t)-1) return ids[mask];
+    const char *extra[STRIP_KIND_COUNT];
+    size_t n = 0;
+    for (int k = 0; k < STRIP_KIND_COUNT; k++) {
+        if (mask & (1u << k)) extra[n++] = STRIP_KINDS[k].pattern;
+    }
+    ids[mask] = lp_pipeline_add_strip_set(pipe, extra, n);
+    return ids[mask];
+}
+
+static void tune_apply(tune_state *st, const tune_move *m) {
+    switch (m->kind) {
+        case MOVE_DROP:
+        case MOVE_KEEP_ONCE: st->literal_on[m->cand] = true; break;
+        case MOVE_STRIP:     st->strip_mask |= 1u << m->cand; break;
+        case MOVE_WEIGHT:    st->weights[m->feature] = m->value; break;
+    }
+}
+
+/* Positive when a beats b. Token savings only count for pattern moves:
+   reweighting to show less is not an improvement by itself. */
+static int tune_compare(const tune_score *a, const tune_score *b, bool tokens_count) {
+    if (a->errors_kept != b->errors_kept) return a->errors_kept > b->errors_kept ? 1 : -1;
+    if (a->warnings_kept != b->warnings_kept) return a->warnings_kept > b->warnings_kept ? 1 : -1;
+    if (a->over_budget != b->over_budget) return a->over_budget < b->over_budget ? 1 : -1;
+    if (!tokens_count) return 0;
+    if ((double)a->tokens < (double)b->tokens * (1.0 - TUNE_MIN_GAIN)) return 1;
+    return a->tokens > b->tokens ? -1 : 0;
+}
+
+static double pct_of(size_t part, size_t whole) {
+    return whole ? 100.0 * (double)part / (double)whole : 100.0;
+}
+
+static void tune_print_score(FILE *out, const char *tag, const tune_score *sc) {
+    fprintf(out, "[%s] error recall %.1f%% (%zu/%zu) | warning recall %.1f%% (%zu/%zu) | "
+                 "%zu tokens | %zu logs over budget\n", tag,
+            pct_of(sc->errors_kept, sc->error_lines), sc->errors_kept, sc->error_lines,
+            pct_of(sc->warnings_kept, sc->warning_lines), sc->warnings_kept, sc->warning_lines,
+            sc->tokens, sc->over_budget);
+}
+
+static void tune_describe(FILE *out, const tune_move *m, const tune_literal *lits,
+                          const tune_state *st) {
+    switch (m->kind) {
+        case MOVE_DROP:      fprintf(out, "+drop_contains \"%s\"", lits[m->cand].text); break;
+        case MOVE_KEEP_ONCE: fprintf(out, "+keep_once_contains \"%s\"", lits[m->cand].text); break;
+        case MOVE_STRIP:     fprintf(out, "+strip_patterns \"%s\"", STRIP_KINDS[m->cand].pattern); break;
+        case MOVE_WEIGHT:
+            fprintf(out, "[score] %s %g -> %g", lp_score_feature_name((lp_score_feature)m->feature),
+                    (double)st->weights[m->feature], (double)m->value);
+            break;
+    }
+}
+
+/* Drop and keep-once candidates from templates mined over the corpus */
+static void tune_mine_literals(const char **lines, size_t count, size_t logs,
+                               const lp_mode *mode, tune_literal_vec *out) {
+    lp_template_miner tm;
+    lp_template_init(&tm, 0, 0.0f, 0);
+    for (size_t i = 0; i < count; i++)
+        lp_template_add(&tm, lines[i], i);
+    lp_template **sorted = lp_template_sorted(&tm);
+
+    size_t min_repeat = count / 100;
+    if (min_repeat < SUGGEST_MIN_REPEAT) min_repeat = SUGGEST_MIN_REPEAT;
+    size_t drops = 0, keeps = 0;
+    for (size_t i = 0; i < tm.count; i++) {
+        const lp_template *t = sorted[i];
+        const char *first = lines[t->first_line];
+        if (lp_line_fate(first, (const struct lp_mode *)mode) != LP_FATE_KEEP) continue;
+
+        char *lit = NULL;
+        move_kind kind = MOVE_DROP;
+        size_t from, k = longest_constant_run(t, &from);
+        if (t->count >= min_repeat && lp_template_wildcards(t) > 0 && k >= 2 &&
+            drops < TUNE_MAX_DROP) {
+            lit = original_span(first, from, k, 60);
+        } else if (t->count <= 2 * logs && t->token_count >= 2 && keeps < TUNE_MAX_KEEP_ONCE) {
+            /* "key: value" facts, keyed by the text up to the first "word:" */
+            size_t colon = 0;
+            while (colon < t->token_count && t->tokens[colon]) {
+                size_t len = strlen(t->tokens[colon]);
+                if (len > 1 && t->tokens[colon][len - 1] == ':') break;
+                colon++;
+            }
+            if (colon < t->token_count && t->tokens[colon] && colon + 1 < t->token_count) {
+                lit = original_span(first, 0, colon + 1, 60);
+                kind = MOVE_KEEP_ONCE;
+            }
+        }
+        if (!lit) continue;
+
+        bool dup = strlen(lit) < 8 || is_diagnostic_text(lit);
+        for (size_t d = 0; d < out->len && !dup; d++)
+            dup = strcmp(out->items[d].text, lit) == 0;
+        if (dup) {
+            free(lit);
+            continue;
+        }
+        tune_literal tl = { lit, kind };
+        lp_vec_push(*out, tl);
+        if (kind == MOVE_DROP) drops++; else keeps++;
+    }
+    free(sorted);
+    lp_template_free(&tm);
+}
+
+static void tune_print_diff(FILE *out, const lp_mode *mode, const tune_state *best,
+                            const tune_literal *lits, size_t lit_count) {
+    fprintf(out, "\n--- %s.toml\n+++ %s.toml (tuned)\n", mode->name, mode->name);
+    bool any = false;
+    if (best->strip_mask) {
+        fprintf(out, "@@ [dedup] strip_patterns @@\n");
+        for (int k = 0; k < STRIP_KIND_COUNT; k++) {
+            if (best->strip_mask & (1u << k))
+                fprintf(out, "+    \"%s\",\n", STRIP_KINDS[k].pattern);
+        }
+        any = true;
+    }
+    static const move_kind KINDS[2] = { MOVE_DROP, MOVE_KEEP_ONCE };
+    static const char *KEYS[2] = { "drop_contains", "keep_once_contains" };
+    for (int g = 0; g < 2; g++) {
+        bool header = false;
+        for (size_t i = 0; i < lit_count; i++) {
+            if (!best->literal_on[i] || lits[i].kind != KINDS[g]) continue;
+            if (!header) fprintf(out, "@@ [elision] %s @@\n", KEYS[g]);
+            header = any = true;
+            fprintf(out, "+    ");
+            print_toml_string(out, lits[i].text);
+            fprintf(out, ",\n");
+        }
+    }
+    bool header = false;
+    for (int f = 0; f < LP_SF_COUNT; f++) {
+        if (best->weights[f] == mode->score_weights[f]) continue;
+        if (!header) fprintf(out, "@@ [score] @@\n");
+        header = any = true;
+        const char *name = lp_score_feature_name((lp_score_feature)f);
+        fprintf(out, "-%s = %g\n+%s = %g\n", name, (double)mode->score_weights[f],
+                name, (double)best->weights[f]);
+    }
+    if (!any) fprintf(out, "  (no change improves the objective)\n");
+}
+
+static int tune_mode(FILE *out, const char **inputs, size_t input_count,
+                     const lp_mode *mode, size_t budget) {
+    /* Load the corpus */
+    line_array *logs = (line_array *)calloc(input_count, sizeof(line_array));
+    LP_VEC(const char *) all;
+    lp_vec_init(all);
+    for (size_t l = 0; l < input_count; l++) {
+        if (!load_lines(inputs[l], &logs[l], NULL)) {
+            fprintf(stderr, "logexplore: cannot open '%s'\n", inputs[l]);
+            for (size_t k = 0; k < l; k++) free_line_array(&logs[k]);
+            free(logs);
+            lp_vec_free(all);
+            return 1;
+        }
+        for (size_t i = 0; i < logs[l].count; i++) lp_vec_push(all, logs[l].lines[i]);
+    }
+
+    /* Candidates */
+    tune_literal_vec lits;
+    lp_vec_init(lits);
+    tune_mine_literals(all.items, all.len, input_count, mode, &lits);
+    unsigned strip_cands = 0;
+    int strip_cand_count = 0;
+    for (int k = 0; k < STRIP_KIND_COUNT; k++) {
+        bool present = false;
+        for (size_t i = 0; i < mode->strip_count && !present; i++)
+            present = strcmp(mode->strip_patterns[i], STRIP_KINDS[k].pattern) == 0;
+        if (!present) {
+            strip_cands |= 1u << k;
+            strip_cand_count++;
+        }
+    }
+
+    /* Cached per-log analysis */
+    lp_pipeline **pipes = (lp_pipeline **)malloc(input_count * sizeof(lp_pipeline *));
+    size_t (*strip_ids)[1u << STRIP_KIND_COUNT] =
+        malloc(input_count * sizeof(*strip_ids));
+    for (size_t l = 0; l < input_count; l++) {
+        pipes[l] = lp_pipeline_prepare((const char **)logs[l].lines, logs[l].count, mode);
+        for (size_t i = 0; i < lits.len; i++) lp_pipeline_add_literal(pipes[l], lits.items[i].text);
+        for (unsigned m = 0; m < (1u << STRIP_KIND_COUNT); m++) strip_ids[l][m] = (size_t)-1;
+        strip_ids[l][0] = 0;
+    }
+
+    tune_state cur;
+    cur.literal_on = (bool *)calloc(lits.len ? lits.len : 1, sizeof(bool));
+    cur.strip_mask = 0;
+    memcpy(cur.weights, mode->score_weights, sizeof(cur.weights));
+
+    size_t weight_steps = 0;
+    for (int f = 0; f < LP_SF_COUNT; f++) {
+        if (f != LP_SF_CLI_KEYWORD) weight_steps += 3;
+    }
+    size_t n_drop = 0;
+    for (size_t i = 0; i < lits.len; i++) n_drop += lits.items[i].kind == MOVE_DROP;
+    fprintf(out, "[TUNE] mode %s | %zu logs, %zu lines | budget %zu tokens/log | "
+                 "%zu threads\n", mode->name, input_count, all.len, budget, lp_cpu_count());
+    fprintf(out, "[CANDIDATES] %zu drop_contains, %zu keep_once_contains, %d strip_patterns, "
+                 "%zu weight steps per round\n", n_drop, lits.len - n_drop,
+            strip_cand_count, weight_steps);
+
+    tune_score cur_score;
+    memset(&cur_score, 0, sizeof(cur_score));
+    LP_VEC(tune_move) moves;
+    lp_vec_init(moves);
+    size_t evaluations = 0;
+    uint64_t t0 = lp_now_ns();
+
+    for (int round = 0; round <= TUNE_MAX_ROUNDS; round++) {
+        /* Neighbours of the current state; round 0 scores the state itself */
+        moves.len = 0;
+        if (round > 0) {
+            for (size_t i = 0; i < lits.len; i++) {
+                if (cur.literal_on[i]) continue;
+                tune_move m = { lits.items[i].kind, i, 0, 0.0f };
+                lp_vec_push(moves, m);
+            }
+            for (int k = 0; k < STRIP_KIND_COUNT; k++) {
+                if (!(strip_cands & (1u << k)) || (cur.strip_mask & (1u << k))) continue;
+                tune_move m = { MOVE_STRIP, (size_t)k, 0, 0.0f };
+                lp_vec_push(moves, m);
+            }
+            for (int f = 0; f < LP_SF_COUNT; f++) {
+                if (f == LP_SF_CLI_KEYWORD) continue;
+                float w = cur.weights[f];
+                float steps[3] = { w * 0.5f, w * 2.0f, w > 0.0f ? 0.0f : 1.0f };
+                for (int s = 0; s < 3; s++) {
+                    if (steps[s] == w || (s < 2 && w == 0.0f)) continue;
+                    tune_move m = { MOVE_WEIGHT, 0, f, steps[s] };
+                    lp_vec_push(moves, m);
+                }
+            }
+            if (moves.len == 0) break;
+        }
+        size_t states = round > 0 ? moves.len : 1;
+
+        /* Build every (state, log) job; strip sets are registered here,
+           serially, because they run the regex engine */
+        size_t jobs = states * input_count;
+        tune_jobs tj;
+        tj.pipes = pipes;
+        tj.logs = input_count;
+        tj.budget = budget;
+        tj.cfgs = (lp_pipeline_config *)calloc(jobs, sizeof(lp_pipeline_config));
+        tj.res = (lp_pipeline_result *)calloc(jobs, sizeof(lp_pipeline_result));
+        size_t **idx = (size_t **)calloc(states * 2, sizeof(size_t *));
+        for (size_t s = 0; s < states; s++) {
+            tune_state st = cur;
+            st.literal_on = (bool *)malloc((lits.len ? lits.len : 1) * sizeof(bool));
+            memcpy(st.literal_on, cur.literal_on, lits.len * sizeof(bool));
+            if (round > 0) tune_apply(&st, &moves.items[s]);
+
+            size_t *drop = idx[s * 2] = (size_t *)malloc((lits.len + 1) * sizeof(size_t));
+            size_t *keep = idx[s * 2 + 1] = (size_t *)malloc((lits.len + 1) * sizeof(size_t));
+            size_t nd = 0, nk = 0;
+            for (size_t i = 0; i < lits.len; i++) {
+                if (!st.literal_on[i]) continue;
+                if (lits.items[i].kind == MOVE_DROP) drop[nd++] = i; else keep[nk++] = i;
+            }
+            for (size_t l = 0; l < input_count; l++) {
+                lp_pipeline_config *cfg = &tj.cfgs[s * input_count + l];
+                cfg->drop = drop;
+                cfg->drop_count = nd;
+                cfg->keep_once = keep;
+                cfg->keep_once_count = nk;
+                cfg->strip_set = tune_strip_set(pipes[l], strip_ids[l], st.strip_mask);
+                memcpy(cfg->weights, st.weights, sizeof(cfg->weights));
+            }
+            free(st.literal_on);
+        }
+        lp_parallel_for(jobs, 0, tune_eval_task, &tj);
+        evaluations += jobs;
+
+        /* Aggregate per state and pick the best improving one */
+        size_t best = (size_t)-1;
+        tune_score best_score;
+        memset(&best_score, 0, sizeof(best_score));
+        for (size_t s = 0; s < states; s++) {
+            tune_score sc;
+            memset(&sc, 0, sizeof(sc));
+            for (size_t l = 0; l < input_count; l++) {
+                const lp_pipeline_result *r = &tj.res[s * input_count + l];
+                sc.tokens += r->output_tokens;
+                sc.errors_kept += r->errors_kept;
+                sc.error_lines += r->error_lines;
+                sc.warnings_kept += r->warnings_kept;
+                sc.warning_lines += r->warning_lines;
+                if (r->output_tokens > budget) sc.over_budget++;
+            }
+            if (round == 0) {
+                cur_score = sc;
+                break;
+            }
+            bool pattern_move = moves.items[s].kind != MOVE_WEIGHT;
+            if (tune_compare(&sc, &cur_score, pattern_move) <= 0) continue;
+            if (best == (size_t)-1 || tune_compare(&sc, &best_score, true) > 0) {
+                best = s;
+                best_score = sc;
+            }
+        }
+        for (size_t s = 0; s < states * 2; s++) free(idx[s]);
+        free(idx);
+        free(tj.cfgs);
+        free(tj.res);
+
+        if (round == 0) {
+            tune_print_score(out, "BASELINE", &cur_score);
+            continue;
+        }
+        if (best == (size_t)-1) break;
+
+        fprintf(out, "[STEP %d] ", round);
+        tune_describe(out, &moves.items[best], lits.items, &cur);
+        fprintf(out, ": tokens %zu -> %zu, error recall %.1f%% -> %.1f%%\n",
+                cur_score.tokens, best_score.tokens,
+                pct_of(cur_score.errors_kept, cur_score.error_lines),
+                pct_of(best_score.errors_kept, best_score.error_lines));
+        tune_apply(&cur, &moves.items[best]);
+        cur_score = best_score;
+    }
+
+    tune_print_score(out, "BEST", &cur_score);
+    fprintf(out, "[SEARCH] %zu pipeline evaluations in %.1f ms\n", evaluations,
+            (double)(lp_now_ns() - t0) / 1e6);
+    tune_print_diff(out, mode, &cur, lits.items, lits.len);
+
+    lp_vec_free(moves);
+    free(cur.literal_on);
+    for (size_t l = 0; l < input_count; l++) {
+        lp_pipeline_free(pipes[l]);
+        free_line_array(&logs[l]);
+    }
+    free(pipes);
+    free(strip_ids);
+    for (size_t i = 0; i < lits.len; i++) free(lits.items[i].text);
+    lp_vec_free(lits);
+    lp_vec_free(all);
+    free(logs);
+    return 0;
 }
 
 /* ---- Main ---- */
@@ -325,44 +1907,84 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    FILE *fp = fopen(args.input_file, "r");
-    if (!fp) {
+    if (args.tune_mode) {
+        char *dir = lp_mode_find_dir();
+        size_t n = 0;
+        lp_mode **all = lp_mode_load_all(dir, &n);
+        free(dir);
+        lp_mode *tm = lp_mode_find(all, n, args.tune_mode);
+        int rc = 1;
+        if (tm) {
+            rc = tune_mode(stdout, args.inputs, args.input_count, tm, args.budget);
+        } else {
+            fprintf(stderr, "logexplore: unknown mode '%s'\n", args.tune_mode);
+        }
+        if (all) lp_modes_free(all, n);
+        return rc;
+    }
+
+    if (args.sample_bytes) {
+        return sample_explore(stdout, args.input_file, args.sample_bytes, args.top_n);
+    }
+
+    if (args.discover_strips) {
+        FILE *fp = fopen(args.input_file, "r");
+        if (!fp) {
+            fprintf(stderr, "logexplore: cannot open '%s'\n", args.input_file);
+            return 1;
+        }
+        int rc = discover_strips(stdout, fp, args.top_n);
+        fclose(fp);
+        return rc;
+    }
+
+    line_array la;
+    lp_line_index idx;
+    if (!load_lines(args.input_file, &la, &idx)) {
         fprintf(stderr, "logexplore: cannot open '%s'\n", args.input_file);
         return 1;
     }
 
-    line_array la = read_all_lines(fp);
-    fclose(fp);
-
     if (la.count == 0) {
         fprintf(stderr, "logexplore: empty file\n");
         free_line_array(&la);
+        lp_line_index_free(&idx);
         return 1;
     }
 
-    /* Dedup analysis */
-    lp_dedup_table dedup;
-    lp_dedup_init(&dedup, la.count / 2 + 64);
-    for (size_t i = 0; i < la.count; i++) {
-        lp_dedup_insert(&dedup, la.lines[i], i, NULL, 0);
-    }
-
     /* Try to detect mode */
     char *mode_dir = lp_mode_find_dir();
-    lp_mode **modes = NULL;
     size_t mode_count = 0;
+    lp_mode **modes = lp_mode_load_all(mode_dir, &mode_count);
     lp_mode *active_mode = NULL;
+    free(mode_dir);
 
-    if (mode_dir) {
-        modes = lp_mode_load_dir(mode_dir, &mode_count);
-        free(mode_dir);
-        if (mode_count > 0) {
-            size_t sniff = la.count < SNIFF_LINES ? la.count : SNIFF_LINES;
-            const char *detected = lp_mode_detect((const char **)la.lines, sniff,
-                                                   modes, mode_count);
-            active_mode = lp_mode_find(modes, mode_count, detected);
-        }
+    if (mode_count > 0) {
+        size_t sniff = la.count < SNIFF_LINES ? la.count : SNIFF_LINES;
+        const char *detected = lp_mode_detect((const char **)la.lines, sniff,
+                                               modes, mode_count);
+        active_mode = lp_mode_find(modes, mode_count, detected);
+    }
+
+    /* Dedup analysis. --volume groups lines into templates: the mode's
+       strip patterns plus addresses and numbers. */
+    lp_dedup_table dedup;
+    lp_dedup_init(&dedup, la.count / 2 + 64);
+    const char **strip = NULL;
+    size_t strip_count = 0;
+    if (args.volume) {
+        size_t mode_strips = active_mode ? active_mode->strip_count : 0;
+        strip = (const char **)malloc((mode_strips + 2) * sizeof(char *));
+        for (size_t i = 0; i < mode_strips; i++) strip[strip_count++] = active_mode->strip_patterns[i];
+        strip[strip_count++] = STRIP_KINDS[STRIP_ADDR].pattern;
+        strip[strip_count++] = STRIP_KINDS[STRIP_NUM].pattern;
+    }
+    uint64_t *line_hash = args.volume ? (uint64_t *)malloc((la.count + 1) * sizeof(uint64_t)) : NULL;
+    for (size_t i = 0; i < la.count; i++) {
+        lp_dedup_entry *e = lp_dedup_insert(&dedup, la.lines[i], i, strip, strip_count);
+        if (line_hash) line_hash[i] = e->hash;
     }
+    free(strip);
 
     /* Segment detection */
     size_t seg_count;
@@ -370,6 +1992,24 @@ int main(int argc, char **argv) {
                                           (const struct lp_mode *)active_mode,
                                           &seg_count);
 
+    int rc = 0;
+    if (args.profile_mode) {
+        lp_mode *pm = lp_mode_find(modes, mode_count, args.profile_mode);
+        if (pm) {
+            rc = profile_mode(stdout, &la, pm);
+        } else {
+            fprintf(stderr, "logexplore: unknown mode '%s'\n", args.profile_mode);
+            rc = 1;
+        }
+        goto cleanup;
+    }
+
+    if (args.volume) {
+        volume_report(stdout, &la, &idx, &dedup, line_hash, segs, seg_count, args.top_n,
+                      active_mode);
+        goto cleanup;
+    }
+
     /* Suggest mode output (different from normal output) */
     if (args.suggest_mode) {
         suggest_mode_toml(stdout, &la, &dedup, segs, seg_count);
@@ -386,7 +2026,7 @@ int main(int argc, char **argv) {
     fprintf(stdout, "[LOGEXPLORE] %zu lines | %zu unique | %zu duplicates\n",
             la.count, unique, duplicates);
 
-    analyze_encoding(stdout, &la);
+    analyze_encoding(stdout, &idx);
 
     /* Phase analysis */
     if (!args.show_freq || args.show_phases) {
@@ -452,8 +2092,10 @@ int main(int argc, char **argv) {
 cleanup:
     lp_segments_free(segs, seg_count);
     lp_dedup_free(&dedup);
+    free(line_hash);
     if (modes) lp_modes_free(modes, mode_count);
     free_line_array(&la);
+    lp_line_index_free(&idx);
 
-    return 0;
+    return rc;
 }
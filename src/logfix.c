@@ -14,6 +14,10 @@
 
 #include "util.h"
 #include "fix.h"
+#include "journal.h"
+#include "tagindex.h"
+#include "memo.h"
+#include "dedup.h"
 
 #define MIN_CONFIDENCE 0.3f
 
@@ -27,21 +31,34 @@ static const char *HELP_TEXT =
     "Matches error patterns against a YAML knowledge base of fixes.\n"
     "\n"
     "Options:\n"
-    "  --check            Read logparse output from stdin, match all errors\n"
+    "  --check            Match error lines from stdin (logparse output or a\n"
+    "                     live build) as they arrive; repeats are matched once\n"
     "  --query <text>     Match a single error string\n"
     "  --add              Interactive: create a new fix entry\n"
     "  --add-from <file>  Create fix entry from a YAML file\n"
-    "  --tags <csv>       Filter matches by tags\n"
+    "  --compact          Fold the journal of added fixes into fixes/<tag>/\n"
+    "  --tags <filter>    Only match fixes with these tags: a,b (either),\n"
+    "                     a+b (both), !a (without), parentheses to group\n"
     "  --validate         Check all fix entries against schema\n"
     "  --stats            Show database statistics\n"
+    "  --no-memo          Match every error afresh, bypassing the match memo\n"
     "  --help             Show this help\n"
     "  --help agent       Machine-readable self-update instructions\n"
     "\n"
     "Examples:\n"
     "  logparse build.log | logfix --check\n"
+    "  make 2>&1 | logfix --check\n"
     "  logfix --query \"undefined node 'ord,\"\n"
+    "  logfix --query \"undefined node\" --tags 'zephyr+!nordic'\n"
     "  logfix --add --tags zephyr,devicetree\n"
-    "  logfix --validate\n";
+    "  logfix --validate\n"
+    "\n"
+    "New entries are appended to fixes/journal.ylog, so concurrent --add runs\n"
+    "never collide; --compact (or a journal past 64 KiB) writes them out as\n"
+    "fixes/<tag>/<slug>.yaml files.\n"
+    "\n"
+    "Match results are memoised per error line in $LOGPILOT_CACHE (default\n"
+    "~/.logpilot/cache); any change to the fix database invalidates the memo.\n";
 
 static const char *HELP_AGENT_TEXT =
     "AGENT SELF-UPDATE INSTRUCTIONS\n"
@@ -52,6 +69,8 @@ static const char *HELP_AGENT_TEXT =
     "  3. Optional fields: regex, context, resolved, commit_ref, severity\n"
     "  4. Validate: logfix --validate\n"
     "  5. Or use interactive: logfix --add\n"
+    "  6. Or, with other agents writing at the same time:\n"
+    "     logfix --add-from <file>  (appends to fixes/journal.ylog)\n"
     "\n"
     "TO UPDATE AN EXISTING FIX:\n"
     "  1. Locate: logfix --query \"<pattern>\" --show-path\n"
@@ -78,10 +97,13 @@ typedef struct {
     const char *query_text;
     bool        add_mode;
     const char *add_from;
-    char      **filter_tags;
+    const char *tag_filter;
+    char      **filter_tags;      /* tag_filter as a list, for --add */
     size_t      filter_tag_count;
     bool        validate_mode;
     bool        stats_mode;
+    bool        compact_mode;
+    bool        no_memo;
     bool        show_help;
     bool        show_help_agent;
 } logfix_args;
@@ -107,72 +129,28 @@ static logfix_args parse_args(int argc, char **argv) {
         } else if (strcmp(argv[i], "--add-from") == 0 && i + 1 < argc) {
             args.add_from = argv[++i];
         } else if (strcmp(argv[i], "--tags") == 0 && i + 1 < argc) {
-            args.filter_tags = lp_split_csv(argv[++i], &args.filter_tag_count);
+            args.tag_filter = argv[++i];
+            args.filter_tags = lp_split_csv(args.tag_filter, &args.filter_tag_count);
         } else if (strcmp(argv[i], "--validate") == 0) {
             args.validate_mode = true;
         } else if (strcmp(argv[i], "--stats") == 0) {
             args.stats_mode = true;
+        } else if (strcmp(argv[i], "--compact") == 0) {
+            args.compact_mode = true;
+        } else if (strcmp(argv[i], "--no-memo") == 0) {
+            args.no_memo = true;
         }
     }
     return args;
 }
 
-/* ---- Read stdin lines ---- */
+/* ---- Error lines in logparse output ---- */
 
-static char *read_stdin_all(void) {
-    lp_string buf = lp_string_new(4096);
-    char line[4096];
-    while (fgets(line, sizeof(line), stdin)) {
-        lp_string_append_cstr(&buf, line);
-    }
-    char *result = strdup(lp_string_cstr(&buf));
-    lp_string_free(&buf);
-    return result;
-}
-
-/* ---- Extract error lines from logparse output ---- */
-
-typedef struct {
-    char **errors;
-    size_t count;
-    size_t cap;
-} error_list;
-
-static error_list extract_errors(const char *text) {
-    error_list el;
-    el.count = 0;
-    el.cap = 16;
-    el.errors = (char **)malloc(el.cap * sizeof(char *));
-
-    /* Look for [SEGMENT: error] blocks and extract their content */
-    const char *p = text;
-    while (*p) {
-        /* Find error segment markers */
-        if (lp_str_starts_with(p, "[SEGMENT: error]") ||
-            lp_str_contains_ci(p, "error:") ||
-            lp_str_contains_ci(p, "fatal:") ||
-            lp_str_contains_ci(p, "undefined reference")) {
-
-            /* Read this line */
-            const char *line_start = p;
-            while (*p && *p != '\n') p++;
-            size_t len = (size_t)(p - line_start);
-            if (len > 0) {
-                if (el.count >= el.cap) {
-                    el.cap *= 2;
-                    el.errors = (char **)realloc(el.errors, el.cap * sizeof(char *));
-                }
-                el.errors[el.count] = (char *)malloc(len + 1);
-                memcpy(el.errors[el.count], line_start, len);
-                el.errors[el.count][len] = '\0';
-                el.count++;
-            }
-        }
-        /* Advance to next line */
-        while (*p && *p != '\n') p++;
-        if (*p == '\n') p++;
-    }
-    return el;
+static bool is_error_line(const char *line) {
+    return lp_str_starts_with(line, "[SEGMENT: error]") ||
+           lp_str_contains_ci(line, "error:") ||
+           lp_str_contains_ci(line, "fatal:") ||
+           lp_str_contains_ci(line, "undefined reference");
 }
 
 /* ---- Print match result ---- */
@@ -209,17 +187,76 @@ static void print_match(const lp_fix_match *m, bool show_path) {
     printf("\n");
 }
 
-/* ---- Tag filter ---- */
+/* ---- Matching ---- */
+
+static lp_fix_match *match_error(lp_memo *memo, uint64_t scope, const char *error,
+                                 lp_fix **fixes, size_t fix_count, const uint32_t *ids,
+                                 size_t id_count, size_t *match_count) {
+    if (!memo) return lp_fix_match_ids(error, fixes, ids, id_count, match_count, MIN_CONFIDENCE);
+    return lp_fix_match_memo(memo, scope, error, fixes, fix_count, ids, id_count, match_count,
+                             MIN_CONFIDENCE);
+}
+
+/* ---- Loading ---- */
 
-static bool matches_tag_filter(const lp_fix *f, char **tags, size_t tag_count) {
-    if (!tags || tag_count == 0) return true;
-    for (size_t t = 0; t < tag_count; t++) {
-        for (size_t ft = 0; ft < f->tag_count; ft++) {
-            if (strcmp(f->tags[ft], tags[t]) == 0)
-                return true;
+/* Local fixes (journal left at their end) followed by the global ones */
+static lp_fix **load_fixes(const char *fix_dir, lp_journal *journal, size_t *fix_count) {
+    lp_fix **fixes = lp_fix_load_dir_tail(fix_dir, fix_count, journal);
+
+    /* Also load from global ~/.logpilot/fixes/ */
+    char *global_dir = lp_fix_find_global_dir();
+    if (global_dir && strcmp(global_dir, fix_dir) != 0) {
+        size_t global_count = 0;
+        lp_fix **global_fixes = lp_fix_load_dir(global_dir, &global_count);
+        if (global_fixes && global_count > 0) {
+            fixes = realloc(fixes, (*fix_count + global_count) * sizeof(lp_fix *));
+            for (size_t i = 0; i < global_count; i++)
+                fixes[*fix_count + i] = global_fixes[i];
+            *fix_count += global_count;
         }
+        free(global_fixes); /* only free array, not entries */
+    }
+    free(global_dir);
+    return fixes;
+}
+
+/* Fold fixes appended to the local journal since the last poll into the
+   database; a compaction reloads it. True if the database changed. */
+static bool poll_fixes(const char *fix_dir, lp_journal *journal, lp_fix ***fixes,
+                       size_t *fix_count) {
+    lp_fix **added = NULL;
+    size_t added_count = 0;
+    if (lp_journal_poll(journal, &added, &added_count) == LP_JOURNAL_RESET) {
+        lp_fixes_free(*fixes, *fix_count);
+        *fixes = load_fixes(fix_dir, journal, fix_count);
+        return true;
+    }
+    if (added_count == 0) {
+        free(added);
+        return false;
     }
-    return false;
+    *fixes = realloc(*fixes, (*fix_count + added_count) * sizeof(lp_fix *));
+    memcpy(*fixes + *fix_count, added, added_count * sizeof(lp_fix *));
+    *fix_count += added_count;
+    free(added);
+    return true;
+}
+
+/* Ids of the fixes passing a --tags filter; all fixes (NULL) without one */
+static bool select_fixes(const lp_tag_index *tag_index, const char *tag_filter, size_t fix_count,
+                         uint32_t **ids, size_t *id_count) {
+    *ids = NULL;
+    *id_count = fix_count;
+    if (!tag_filter) return true;
+    lp_bitmap selected;
+    char errbuf[256];
+    if (!lp_tag_index_query(tag_index, tag_filter, &selected, errbuf, sizeof(errbuf))) {
+        fprintf(stderr, "logfix: bad --tags filter: %s\n", errbuf);
+        return false;
+    }
+    *ids = lp_bitmap_to_array(&selected, id_count);
+    lp_bitmap_free(&selected);
+    return true;
 }
 
 /* ---- Interactive add ---- */
@@ -288,38 +325,19 @@ static int do_interactive_add(char **filter_tags, size_t filter_tag_count) {
         return 1;
     }
 
-    /* Generate filename */
     char *fix_dir = lp_fix_find_dir();
     if (!fix_dir) fix_dir = strdup("fixes");
 
-    /* Use primary tag as subdirectory */
-    const char *primary_tag = (f.tag_count > 0) ? f.tags[0] : "general";
-    char *subdir = lp_path_join(fix_dir, primary_tag);
-
-    /* Slugify pattern for filename */
-    char slug[64];
-    size_t si = 0;
-    for (const char *p = f.pattern; *p && si < sizeof(slug) - 6; p++) {
-        if (isalnum((unsigned char)*p)) slug[si++] = (char)tolower((unsigned char)*p);
-        else if (si > 0 && slug[si - 1] != '-') slug[si++] = '-';
-    }
-    while (si > 0 && slug[si - 1] == '-') si--;
-    slug[si] = '\0';
-
-    char filename[128];
-    snprintf(filename, sizeof(filename), "%s.yaml", slug);
-    char *filepath = lp_path_join(subdir, filename);
-
-    printf("\nWriting fix to: %s\n", filepath);
-    int result = lp_fix_write(filepath, &f);
+    char *journal = lp_path_join(fix_dir, LP_JOURNAL_NAME);
+    printf("\nAppending fix to: %s\n", journal);
+    int result = lp_journal_append(fix_dir, &f);
     if (result == 0) {
         printf("Fix entry created successfully.\n");
     } else {
-        fprintf(stderr, "logfix: failed to write fix file\n");
+        fprintf(stderr, "logfix: failed to append to journal\n");
     }
 
-    free(filepath);
-    free(subdir);
+    free(journal);
     free(fix_dir);
     free(f.pattern);
     free(f.regex);
@@ -357,7 +375,7 @@ int main(int argc, char **argv) {
     /* Load fix database (local + global) */
     char *fix_dir = lp_fix_find_dir();
     if (!fix_dir) {
-        if (args.stats_mode || args.validate_mode) {
+        if (args.stats_mode || args.validate_mode || args.compact_mode) {
             fprintf(stderr, "logfix: no fixes directory found\n");
             return 1;
         }
@@ -365,29 +383,30 @@ int main(int argc, char **argv) {
         fix_dir = strdup("fixes");
     }
 
-    size_t fix_count = 0;
-    lp_fix **fixes = lp_fix_load_dir(fix_dir, &fix_count);
-
-    /* Also load from global ~/.logpilot/fixes/ */
-    char *global_dir = lp_fix_find_global_dir();
-    if (global_dir && (!fix_dir || strcmp(global_dir, fix_dir) != 0)) {
-        size_t global_count = 0;
-        lp_fix **global_fixes = lp_fix_load_dir(global_dir, &global_count);
-        if (global_fixes && global_count > 0) {
-            fixes = realloc(fixes, (fix_count + global_count) * sizeof(lp_fix *));
-            for (size_t i = 0; i < global_count; i++)
-                fixes[fix_count + i] = global_fixes[i];
-            fix_count += global_count;
-            free(global_fixes); /* only free array, not entries */
+    if (args.compact_mode) {
+        int folded = lp_journal_compact(fix_dir, true);
+        if (folded < 0) {
+            fprintf(stderr, "logfix: failed to compact journal in '%s'\n", fix_dir);
+            free(fix_dir);
+            return 1;
         }
-        free(global_dir);
+        printf("Compacted %d journal record%s into %s\n", folded, folded == 1 ? "" : "s",
+               fix_dir);
+        free(fix_dir);
+        return 0;
     }
 
+    size_t fix_count = 0;
+    lp_journal journal;
+    lp_journal_init(&journal, fix_dir);
+    lp_fix **fixes = load_fixes(fix_dir, &journal, &fix_count);
+
     /* Add from file */
     if (args.add_from) {
         lp_fix *f = lp_fix_load(args.add_from);
         if (!f) {
             fprintf(stderr, "logfix: cannot load '%s'\n", args.add_from);
+            lp_journal_free(&journal);
             free(fix_dir);
             if (fixes) lp_fixes_free(fixes, fix_count);
             return 1;
@@ -396,6 +415,7 @@ int main(int argc, char **argv) {
         if (!lp_fix_validate(f, errbuf, sizeof(errbuf))) {
             fprintf(stderr, "logfix: validation failed: %s\n", errbuf);
             lp_fix_free(f);
+            lp_journal_free(&journal);
             free(fix_dir);
             if (fixes) lp_fixes_free(fixes, fix_count);
             return 1;
@@ -408,10 +428,37 @@ int main(int argc, char **argv) {
             printf("%s", f->tags[i]);
         }
         printf("\n");
+        int result = lp_journal_append(fix_dir, f);
+        if (result == 0) printf("Appended to journal: %s/%s\n", fix_dir, LP_JOURNAL_NAME);
+        else fprintf(stderr, "logfix: failed to append to journal in '%s'\n", fix_dir);
         lp_fix_free(f);
+        lp_journal_free(&journal);
         free(fix_dir);
         if (fixes) lp_fixes_free(fixes, fix_count);
-        return 0;
+        return result == 0 ? 0 : 1;
+    }
+
+    /* Intern tags; a --tags filter then selects fix ids before any matching */
+    int status = 0;
+    lp_memo memo_store;
+    lp_memo *memo = NULL;
+    char *memo_path = NULL;
+    lp_tag_index tag_index;
+    lp_tag_index_build(&tag_index, fixes, fix_count);
+    uint32_t *candidates = NULL;
+    size_t candidate_count = fix_count;
+    if (!select_fixes(&tag_index, args.tag_filter, fix_count, &candidates, &candidate_count)) {
+        status = 1;
+        goto cleanup;
+    }
+
+    /* Recurring errors are answered from the memo without a database scan */
+    uint64_t memo_scope = args.tag_filter ? lp_fnv1a(args.tag_filter, strlen(args.tag_filter)) : 0;
+    if (!args.no_memo && (args.query_text || args.check_mode))
+        memo_path = lp_memo_default_path();
+    if (memo_path && fix_count > 0) {
+        lp_memo_open(&memo_store, memo_path, lp_fix_db_generation(fixes, fix_count));
+        memo = &memo_store;
     }
 
     /* Stats mode */
@@ -430,26 +477,10 @@ int main(int argc, char **argv) {
         printf("  Errors: %zu | Warnings: %zu | Other: %zu\n", errors, warnings, other);
 
         /* Unique tags */
-        char *seen_tags[256];
-        size_t seen_count = 0;
-        for (size_t i = 0; i < fix_count; i++) {
-            for (size_t t = 0; t < fixes[i]->tag_count; t++) {
-                bool found = false;
-                for (size_t s = 0; s < seen_count; s++) {
-                    if (strcmp(seen_tags[s], fixes[i]->tags[t]) == 0) {
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found && seen_count < 256) {
-                    seen_tags[seen_count++] = fixes[i]->tags[t];
-                }
-            }
-        }
-        printf("  Unique tags: %zu (", seen_count);
-        for (size_t i = 0; i < seen_count; i++) {
+        printf("  Unique tags: %zu (", tag_index.count);
+        for (size_t i = 0; i < tag_index.count; i++) {
             if (i > 0) printf(", ");
-            printf("%s", seen_tags[i]);
+            printf("%s", tag_index.names[i]);
         }
         printf(")\n");
 
@@ -483,18 +514,17 @@ int main(int argc, char **argv) {
         }
 
         size_t match_count;
-        lp_fix_match *matches = lp_fix_match_all(args.query_text, fixes, fix_count,
-                                                  &match_count, MIN_CONFIDENCE);
+        lp_fix_match *matches = match_error(memo, memo_scope, args.query_text, fixes, fix_count,
+                                            candidates, candidate_count, &match_count);
 
-        /* Filter by tags */
         printf("[LOGFIX] Query: %s\n", args.query_text);
+        if (args.tag_filter)
+            printf("[LOGFIX] Tags: %s (%zu of %zu fixes)\n", args.tag_filter, candidate_count,
+                   fix_count);
         printf("[LOGFIX] %zu matches found:\n\n", match_count);
 
-        for (size_t i = 0; i < match_count; i++) {
-            if (!matches_tag_filter(matches[i].fix, args.filter_tags, args.filter_tag_count))
-                continue;
+        for (size_t i = 0; i < match_count; i++)
             print_match(&matches[i], true);
-        }
 
         if (match_count == 0) {
             printf("  No matching fixes found.\n");
@@ -504,28 +534,57 @@ int main(int argc, char **argv) {
         goto cleanup;
     }
 
-    /* Check mode (read from stdin) */
+    /* Check mode: match error lines as they arrive on stdin, so a live
+       pipeline gets hints while the build is still running */
     if (args.check_mode) {
-        char *input = read_stdin_all();
-        error_list el = extract_errors(input);
-
-        printf("[LOGFIX CHECK] Scanning %zu error lines against %zu fix entries...\n\n",
-               el.count, fix_count);
+        printf("[LOGFIX CHECK] Matching error lines against %zu fix entries as they arrive...\n\n",
+               fix_count);
+        fflush(stdout);
+
+        lp_dedup_table seen;
+        lp_dedup_init(&seen, 256);
+        char *line = NULL;
+        size_t line_cap = 0;
+        size_t error_lines = 0, matched_errors = 0, total_matches = 0;
+        size_t memo_found = 0;   /* Answered by memos closed on a database update */
+        int len;
+        while ((len = lp_readline(stdin, &line, &line_cap)) >= 0) {
+            if (len == 0 || !is_error_line(line)) continue;
+            error_lines++;
+
+            /* A repeated error was already answered */
+            lp_dedup_entry *e = lp_dedup_insert(&seen, line, error_lines, NULL, 0);
+            if (e->count > 1) continue;
+
+            /* Fixes added while the build runs apply from the next new error */
+            if (poll_fixes(fix_dir, &journal, &fixes, &fix_count)) {
+                lp_tag_index_free(&tag_index);
+                lp_tag_index_build(&tag_index, fixes, fix_count);
+                free(candidates);
+                select_fixes(&tag_index, args.tag_filter, fix_count, &candidates,
+                             &candidate_count);
+                if (memo) {
+                    memo_found += memo->found;
+                    lp_memo_close(memo);
+                }
+                memo = NULL;
+                if (memo_path && fix_count > 0) {
+                    lp_memo_open(&memo_store, memo_path, lp_fix_db_generation(fixes, fix_count));
+                    memo = &memo_store;
+                }
+                printf("[LOGFIX CHECK] Fix database updated: %zu fix entries\n", fix_count);
+            }
 
-        size_t total_matches = 0;
-        for (size_t i = 0; i < el.count; i++) {
             size_t match_count;
-            lp_fix_match *matches = lp_fix_match_all(el.errors[i], fixes, fix_count,
-                                                      &match_count, MIN_CONFIDENCE);
+            lp_fix_match *matches = match_error(memo, memo_scope, line, fixes, fix_count,
+                                                candidates, candidate_count, &match_count);
             if (match_count > 0) {
-                printf("Error: %s\n", el.errors[i]);
-                for (size_t m = 0; m < match_count; m++) {
-                    if (!matches_tag_filter(matches[m].fix,
-                                            args.filter_tags, args.filter_tag_count))
-                        continue;
+                printf("Error: %s\n", line);
+                for (size_t m = 0; m < match_count; m++)
                     print_match(&matches[m], false);
-                    total_matches++;
-                }
+                matched_errors++;
+                total_matches += match_count;
+                fflush(stdout);
             }
             lp_fix_matches_free(matches, match_count);
         }
@@ -533,12 +592,15 @@ int main(int argc, char **argv) {
         if (total_matches == 0) {
             printf("No known fixes matched the errors.\n");
         }
-
-        /* Free error list */
-        for (size_t i = 0; i < el.count; i++)
-            free(el.errors[i]);
-        free(el.errors);
-        free(input);
+        printf("[LOGFIX CHECK] %zu error lines, %zu distinct, %zu with known fixes\n",
+               error_lines, seen.count, matched_errors);
+        if (memo) memo_found += memo->found;
+        if (memo_path) {
+            printf("[LOGFIX MEMO] %zu of %zu distinct error lines answered from memo\n",
+                   memo_found, seen.count);
+        }
+        free(line);
+        lp_dedup_free(&seen);
         goto cleanup;
     }
 
@@ -546,8 +608,13 @@ int main(int argc, char **argv) {
     fputs(HELP_TEXT, stdout);
 
 cleanup:
+    if (memo) lp_memo_close(memo);
+    free(memo_path);
+    lp_journal_free(&journal);
+    free(candidates);
+    lp_tag_index_free(&tag_index);
     free(fix_dir);
     if (fixes) lp_fixes_free(fixes, fix_count);
     if (args.filter_tags) lp_free_strings(args.filter_tags, args.filter_tag_count);
-    return 0;
+    return status;
 }
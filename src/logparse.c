@@ -17,16 +17,37 @@
 
 #include "util.h"
 #include "mode.h"
+#include "builtin.h"
 #include "dedup.h"
 #include "segment.h"
 #include "score.h"
 #include "budget.h"
+#include "ring.h"
+#include "thread.h"
 #include "token.h"
+#include "tail.h"
+#include "cmdline.h"
+#include "fate.h"
+#include "plugin.h"
+#include "dtindex.h"
+#include "kconfig.h"
+#include "serve.h"
+
+#ifdef _WIN32
+#include <io.h>
+#define fileno _fileno
+#define fdopen _fdopen
+#define close  _close
+#else
+#include <unistd.h>
+#endif
 
 #define DEFAULT_BUDGET_LINES 300
 #define DEFAULT_FREQ_TOP     10
 #define SNIFF_LINES          50
 #define DEFAULT_TAIL_LINES   20
+#define DEFAULT_TAIL_SCAN    2000  /* Reverse-scan bound for tail-resident modes */
+#define MAX_TAIL_SECTION     24    /* Lines kept from the trailing summary section */
 
 /* ---- Help text ---- */
 
@@ -42,17 +63,39 @@ static const char *HELP_TEXT =
     "Options:\n"
     "  --mode <name>      Force a specific build system mode\n"
     "  --budget <lines>   Target output size in lines (default: 300)\n"
+    "  --diverse          Fill the budget for coverage of distinct warnings,\n"
+    "                     files and phases rather than by score alone\n"
     "  --keywords <csv>   Additional keywords to score as high-interest\n"
     "  --raw-freq         Show full frequency table, not just top N\n"
     "  --no-tail          Omit final lines of log\n"
+    "  --summary-only     Print only the build summary header. For modes with\n"
+    "                     tail_resident = true, reads backwards from EOF.\n"
+    "  --fate-stats <dir> Load/save per-mode line classifier hit counts in DIR\n"
+    "                     so pattern checks start out ordered by frequency\n"
+    "  --explain-budget   Report where the token budget went: per segment type\n"
+    "                     and phase, the score cutoff and the largest segments\n"
+    "                     left out (to stderr with --json)\n"
     "  --json             Output as JSON\n"
+    "  --list-modes       List available modes (TOML and built-in) and exit\n"
+    "  --plugin <path>    Load a native mode plugin (overrides [plugin] path)\n"
+    "  --build-dir <dir>  Zephyr build directory for devicetree references in\n"
+    "                     errors (default: the one the log names)\n"
+    "  --serve <socket>   Run as a server on a Unix domain socket, with modes\n"
+    "                     loaded once and one warm worker per CPU; only your\n"
+    "                     user can connect, and requests may only --plugin\n"
+    "                     the plugin the server was started with\n"
+    "  --connect <socket> Hand this run to a --serve server (the input is\n"
+    "                     passed as an open file); runs in-process if none\n"
+    "                     is listening\n"
     "  --help             Show this help\n"
     "  --help agent       Machine-readable self-update instructions\n"
     "\n"
     "Examples:\n"
     "  logparse build.log\n"
     "  logparse build.log --mode zephyr --budget 400\n"
-    "  west build 2>&1 | logparse --mode zephyr\n";
+    "  west build 2>&1 | logparse --mode zephyr\n"
+    "  logparse --serve /tmp/logparse.sock &\n"
+    "  logparse --connect /tmp/logparse.sock build.log\n";
 
 static const char *HELP_AGENT_TEXT =
     "AGENT SELF-UPDATE INSTRUCTIONS\n"
@@ -92,11 +135,20 @@ typedef struct {
     const char *input_file;
     const char *mode_name;
     size_t      budget_lines;
+    bool        diverse;
+    bool        explain_budget;
     char      **keywords;
     size_t      keyword_count;
     bool        raw_freq;
     bool        no_tail;
+    bool        summary_only;
+    const char *fate_stats_dir;
     bool        json_output;
+    bool        list_modes;
+    const char *plugin_path;
+    const char *build_dir;
+    const char *serve_path;
+    const char *connect_path;
     bool        show_help;
     bool        show_help_agent;
 } logparse_args;
@@ -118,14 +170,32 @@ static logparse_args parse_args(int argc, char **argv) {
             args.mode_name = argv[++i];
         } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
             args.budget_lines = (size_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--diverse") == 0) {
+            args.diverse = true;
+        } else if (strcmp(argv[i], "--explain-budget") == 0) {
+            args.explain_budget = true;
         } else if (strcmp(argv[i], "--keywords") == 0 && i + 1 < argc) {
             args.keywords = lp_split_csv(argv[++i], &args.keyword_count);
         } else if (strcmp(argv[i], "--raw-freq") == 0) {
             args.raw_freq = true;
         } else if (strcmp(argv[i], "--no-tail") == 0) {
             args.no_tail = true;
+        } else if (strcmp(argv[i], "--summary-only") == 0) {
+            args.summary_only = true;
+        } else if (strcmp(argv[i], "--fate-stats") == 0 && i + 1 < argc) {
+            args.fate_stats_dir = argv[++i];
         } else if (strcmp(argv[i], "--json") == 0) {
             args.json_output = true;
+        } else if (strcmp(argv[i], "--list-modes") == 0) {
+            args.list_modes = true;
+        } else if (strcmp(argv[i], "--plugin") == 0 && i + 1 < argc) {
+            args.plugin_path = argv[++i];
+        } else if (strcmp(argv[i], "--build-dir") == 0 && i + 1 < argc) {
+            args.build_dir = argv[++i];
+        } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            args.serve_path = argv[++i];
+        } else if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+            args.connect_path = argv[++i];
         } else if (argv[i][0] != '-') {
             args.input_file = argv[i];
         }
@@ -133,7 +203,7 @@ static logparse_args parse_args(int argc, char **argv) {
     return args;
 }
 
-/* ---- Read all lines from file or stdin ---- */
+/* ---- Input ---- */
 
 typedef struct {
     char  **lines;
@@ -141,24 +211,98 @@ typedef struct {
     size_t  cap;
 } line_array;
 
-static line_array read_all_lines(FILE *fp) {
-    line_array la;
-    la.count = 0;
-    la.cap = 1024;
-    la.lines = (char **)malloc(la.cap * sizeof(char *));
+/* The log being read. A regular file is mapped and split in place;
+   anything else (stdin from a pipe, <(cmd), a received pipe) is read as a
+   stream. */
+typedef struct {
+    FILE          *fp;        /* Stream, when not mapped */
+    bool           owns_fp;
+    lp_mapped_file map;
+    bool           mapped;
+    size_t         pos;       /* Next unsplit byte of map */
+    int            fd;        /* Descriptor behind map to close, or -1 */
+} log_input;
+
+/* Open the log: fd when given (ownership passes to in), else path, else
+   stdin. False (message on stderr) if it cannot be opened. */
+static bool open_input(log_input *in, const char *path, int fd) {
+    memset(in, 0, sizeof(*in));
+    in->fd = -1;
+    if (fd >= 0) {
+        if (lp_map_fd(fd, &in->map)) {
+            in->mapped = true;
+            in->fd = fd;
+            return true;
+        }
+        in->fp = fdopen(fd, "r");
+        if (!in->fp) {
+            close(fd);
+            fprintf(stderr, "logparse: cannot read input\n");
+            return false;
+        }
+        in->owns_fp = true;
+        return true;
+    }
+    if (path) {
+        in->fp = fopen(path, "r");
+        if (!in->fp) {
+            fprintf(stderr, "logparse: cannot open '%s'\n", path);
+            return false;
+        }
+        in->owns_fp = true;
+    } else {
+        in->fp = stdin;
+    }
+    in->mapped = lp_map_fd(fileno(in->fp), &in->map);
+    return true;
+}
 
-    char *buf = NULL;
+static void close_input(log_input *in) {
+    if (in->mapped) lp_unmap_file(&in->map);
+    if (in->owns_fp) fclose(in->fp);
+    if (in->fd >= 0) close(in->fd);
+}
+
+/* Next line (malloc'd), or NULL at end of input. Lines end at \n, \r\n
+   or a bare \r either way. */
+static char *input_line(log_input *in, char **buf, size_t *buf_cap) {
+    if (!in->mapped)
+        return lp_readline(in->fp, buf, buf_cap) < 0 ? NULL : strdup(*buf);
+
+    const char *d = in->map.data;
+    size_t len = in->map.len, pos = in->pos;
+    if (pos >= len) return NULL;
+    size_t start = pos;
+    while (pos < len && d[pos] != '\n' && d[pos] != '\r') pos++;
+    char *line = lp_strdup_range(d, start, pos);
+    if (pos < len && d[pos] == '\r') {
+        pos++;
+        if (pos < len && d[pos] == '\n') pos++;
+    } else if (pos < len) {
+        pos++;
+    }
+    in->pos = pos;
+    return line;
+}
+
+/* Append up to max_lines more lines to la (zeroed la: starts a new array) */
+static void read_lines(log_input *in, line_array *la, size_t max_lines) {
+    if (!la->lines) {
+        la->count = 0;
+        la->cap = max_lines < 1024 ? max_lines + 1 : 1024;
+        la->lines = (char **)malloc(la->cap * sizeof(char *));
+    }
+
+    char *buf = NULL, *line;
     size_t buf_cap = 0;
-    int len;
-    while ((len = lp_readline(fp, &buf, &buf_cap)) >= 0) {
-        if (la.count >= la.cap) {
-            la.cap *= 2;
-            la.lines = (char **)realloc(la.lines, la.cap * sizeof(char *));
+    for (size_t n = 0; n < max_lines && (line = input_line(in, &buf, &buf_cap)) != NULL; n++) {
+        if (la->count >= la->cap) {
+            la->cap *= 2;
+            la->lines = (char **)realloc(la->lines, la->cap * sizeof(char *));
         }
-        la.lines[la.count++] = strdup(buf);
+        la->lines[la->count++] = line;
     }
     free(buf);
-    return la;
 }
 
 static void free_line_array(line_array *la) {
@@ -169,6 +313,26 @@ static void free_line_array(line_array *la) {
     la->count = la->cap = 0;
 }
 
+/* ---- Mode set ---- */
+
+/* Modes loaded once per process (once per server in --serve mode) */
+typedef struct {
+    char     *dir;
+    lp_mode **modes;
+    size_t    count;
+} mode_set;
+
+static void mode_set_load(mode_set *ms) {
+    ms->dir = lp_mode_find_dir();
+    ms->count = 0;
+    ms->modes = lp_mode_load_all(ms->dir, &ms->count);
+}
+
+static void mode_set_free(mode_set *ms) {
+    if (ms->modes) lp_modes_free(ms->modes, ms->count);
+    free(ms->dir);
+}
+
 /* ---- JSON escaping helper ---- */
 
 static void print_json_string(FILE *out, const char *s) {
@@ -208,6 +372,15 @@ static const char *seg_type_name(lp_seg_type t) {
     return "unknown";
 }
 
+/* True for labels other than the default per-type ones (set by plugins) */
+static bool is_custom_label(const char *label) {
+    if (!label) return false;
+    for (int t = LP_SEG_ERROR; t <= LP_SEG_NORMAL; t++) {
+        if (strcmp(label, seg_type_name((lp_seg_type)t)) == 0) return false;
+    }
+    return true;
+}
+
 /* ---- Summary fact extraction ---- */
 
 typedef struct {
@@ -221,150 +394,229 @@ typedef struct {
     size_t total_build_steps;
     size_t max_build_step;
     bool build_failed;
+    /* Trailing summary section (tail-resident modes) */
+    char tail_title[256];
+    char tail_lines[MAX_TAIL_SECTION][256];
+    size_t tail_line_count;
 } build_summary;
 
-static void extract_summary(build_summary *s, line_array *la) {
-    memset(s, 0, sizeof(*s));
-
-    for (size_t i = 0; i < la->count; i++) {
-        const char *line = la->lines[i];
-
-        /* Board */
-        if (s->board[0] == '\0') {
-            const char *p = strstr(line, "-- Board: ");
-            if (p) {
-                p += 10;
-                const char *end = p;
-                while (*end && *end != '\n' && *end != '\r') end++;
-                size_t len = (size_t)(end - p);
-                if (len >= sizeof(s->board)) len = sizeof(s->board) - 1;
-                memcpy(s->board, p, len);
-                s->board[len] = '\0';
-            }
+/* Pull summary facts out of one line. Each fact keeps the first value seen. */
+static void summary_scan_line(build_summary *s, const char *line) {
+    /* Board */
+    if (s->board[0] == '\0') {
+        const char *p = strstr(line, "-- Board: ");
+        if (p) {
+            p += 10;
+            const char *end = p;
+            while (*end && *end != '\n' && *end != '\r') end++;
+            size_t len = (size_t)(end - p);
+            if (len >= sizeof(s->board)) len = sizeof(s->board) - 1;
+            memcpy(s->board, p, len);
+            s->board[len] = '\0';
         }
+    }
 
-        /* Zephyr version */
-        if (s->zephyr_version[0] == '\0') {
-            const char *p = strstr(line, "-- Zephyr version: ");
-            if (p) {
-                p += 19;
-                const char *end = p;
-                while (*end && *end != ' ' && *end != '\n') end++;
-                size_t len = (size_t)(end - p);
-                if (len >= sizeof(s->zephyr_version)) len = sizeof(s->zephyr_version) - 1;
-                memcpy(s->zephyr_version, p, len);
-                s->zephyr_version[len] = '\0';
-            }
+    /* Zephyr version */
+    if (s->zephyr_version[0] == '\0') {
+        const char *p = strstr(line, "-- Zephyr version: ");
+        if (p) {
+            p += 19;
+            const char *end = p;
+            while (*end && *end != ' ' && *end != '\n') end++;
+            size_t len = (size_t)(end - p);
+            if (len >= sizeof(s->zephyr_version)) len = sizeof(s->zephyr_version) - 1;
+            memcpy(s->zephyr_version, p, len);
+            s->zephyr_version[len] = '\0';
         }
+    }
 
-        /* Overlay */
-        if (s->overlay[0] == '\0') {
-            const char *p = strstr(line, "-- Found devicetree overlay: ");
-            if (p) {
-                p += 29;
-                /* Shorten: just keep filename relative to project */
-                const char *last_slash = p;
-                const char *end = p;
-                while (*end && *end != '\n' && *end != '\r') end++;
-                /* Find last path separator after common project root indicators */
-                const char *short_name = p;
-                const char *boards = strstr(p, "boards/");
-                if (boards) short_name = boards;
-                size_t len = (size_t)(end - short_name);
-                if (len >= sizeof(s->overlay)) len = sizeof(s->overlay) - 1;
-                memcpy(s->overlay, short_name, len);
-                s->overlay[len] = '\0';
-                (void)last_slash;
-            }
+    /* Overlay */
+    if (s->overlay[0] == '\0') {
+        const char *p = strstr(line, "-- Found devicetree overlay: ");
+        if (p) {
+            p += 29;
+            /* Shorten: just keep filename relative to project */
+            const char *last_slash = p;
+            const char *end = p;
+            while (*end && *end != '\n' && *end != '\r') end++;
+            /* Find last path separator after common project root indicators */
+            const char *short_name = p;
+            const char *boards = strstr(p, "boards/");
+            if (boards) short_name = boards;
+            size_t len = (size_t)(end - short_name);
+            if (len >= sizeof(s->overlay)) len = sizeof(s->overlay) - 1;
+            memcpy(s->overlay, short_name, len);
+            s->overlay[len] = '\0';
+            (void)last_slash;
         }
+    }
 
-        /* Toolchain version - extract just the compiler */
-        if (s->toolchain[0] == '\0') {
-            const char *p = strstr(line, "The C compiler identification is ");
-            if (p) {
-                p += 33;
-                const char *end = p;
-                while (*end && *end != '\n' && *end != '\r') end++;
-                size_t len = (size_t)(end - p);
-                if (len >= sizeof(s->toolchain)) len = sizeof(s->toolchain) - 1;
-                memcpy(s->toolchain, p, len);
-                s->toolchain[len] = '\0';
-            }
+    /* Toolchain version - extract just the compiler */
+    if (s->toolchain[0] == '\0') {
+        const char *p = strstr(line, "The C compiler identification is ");
+        if (p) {
+            p += 33;
+            const char *end = p;
+            while (*end && *end != '\n' && *end != '\r') end++;
+            size_t len = (size_t)(end - p);
+            if (len >= sizeof(s->toolchain)) len = sizeof(s->toolchain) - 1;
+            memcpy(s->toolchain, p, len);
+            s->toolchain[len] = '\0';
         }
+    }
 
-        /* Memory: FLASH */
-        if (s->memory_flash[0] == '\0') {
-            const char *p = strstr(line, "FLASH:");
-            if (p && strstr(line, "Used Size")) {
-                /* This is the header line, skip */
-            } else if (p) {
-                p += 6;
-                while (*p == ' ') p++;
-                const char *end = p;
-                while (*end && *end != '\n' && *end != '\r') end++;
-                size_t len = (size_t)(end - p);
-                if (len >= sizeof(s->memory_flash)) len = sizeof(s->memory_flash) - 1;
-                memcpy(s->memory_flash, p, len);
-                s->memory_flash[len] = '\0';
-                /* Trim trailing spaces */
-                while (len > 0 && s->memory_flash[len-1] == ' ') s->memory_flash[--len] = '\0';
-            }
+    /* Memory: FLASH */
+    if (s->memory_flash[0] == '\0') {
+        const char *p = strstr(line, "FLASH:");
+        if (p && strstr(line, "Used Size")) {
+            /* This is the header line, skip */
+        } else if (p) {
+            p += 6;
+            while (*p == ' ') p++;
+            const char *end = p;
+            while (*end && *end != '\n' && *end != '\r') end++;
+            size_t len = (size_t)(end - p);
+            if (len >= sizeof(s->memory_flash)) len = sizeof(s->memory_flash) - 1;
+            memcpy(s->memory_flash, p, len);
+            s->memory_flash[len] = '\0';
+            /* Trim trailing spaces */
+            while (len > 0 && s->memory_flash[len-1] == ' ') s->memory_flash[--len] = '\0';
         }
+    }
 
-        /* Memory: RAM */
-        if (s->memory_ram[0] == '\0') {
-            const char *p = strstr(line, "RAM:");
-            if (p && !strstr(line, "Used Size")) {
-                p += 4;
-                while (*p == ' ') p++;
-                const char *end = p;
-                while (*end && *end != '\n' && *end != '\r') end++;
-                size_t len = (size_t)(end - p);
-                if (len >= sizeof(s->memory_ram)) len = sizeof(s->memory_ram) - 1;
-                memcpy(s->memory_ram, p, len);
-                s->memory_ram[len] = '\0';
-                while (len > 0 && s->memory_ram[len-1] == ' ') s->memory_ram[--len] = '\0';
-            }
+    /* Memory: RAM */
+    if (s->memory_ram[0] == '\0') {
+        const char *p = strstr(line, "RAM:");
+        if (p && !strstr(line, "Used Size")) {
+            p += 4;
+            while (*p == ' ') p++;
+            const char *end = p;
+            while (*end && *end != '\n' && *end != '\r') end++;
+            size_t len = (size_t)(end - p);
+            if (len >= sizeof(s->memory_ram)) len = sizeof(s->memory_ram) - 1;
+            memcpy(s->memory_ram, p, len);
+            s->memory_ram[len] = '\0';
+            while (len > 0 && s->memory_ram[len-1] == ' ') s->memory_ram[--len] = '\0';
         }
+    }
 
-        /* Output file */
-        if (s->output_file[0] == '\0') {
-            const char *p = strstr(line, "Wrote ");
-            if (p && strstr(p, " bytes to ")) {
-                const char *end = p;
-                while (*end && *end != '\n' && *end != '\r') end++;
-                size_t len = (size_t)(end - p);
-                if (len >= sizeof(s->output_file)) len = sizeof(s->output_file) - 1;
-                memcpy(s->output_file, p, len);
-                s->output_file[len] = '\0';
-            }
+    /* Output file */
+    if (s->output_file[0] == '\0') {
+        const char *p = strstr(line, "Wrote ");
+        if (p && strstr(p, " bytes to ")) {
+            const char *end = p;
+            while (*end && *end != '\n' && *end != '\r') end++;
+            size_t len = (size_t)(end - p);
+            if (len >= sizeof(s->output_file)) len = sizeof(s->output_file) - 1;
+            memcpy(s->output_file, p, len);
+            s->output_file[len] = '\0';
         }
+    }
 
-        /* Build step counts */
-        if (lp_is_build_progress(line)) {
-            const char *p = line;
-            while (*p && isspace((unsigned char)*p)) p++;
-            if (*p == '[') {
+    /* Build step counts */
+    if (lp_is_build_progress(line)) {
+        const char *p = line;
+        while (*p && isspace((unsigned char)*p)) p++;
+        if (*p == '[') {
+            p++;
+            size_t current = (size_t)atoi(p);
+            while (*p && *p != '/') p++;
+            if (*p == '/') {
                 p++;
-                size_t current = (size_t)atoi(p);
-                while (*p && *p != '/') p++;
-                if (*p == '/') {
-                    p++;
-                    size_t total = (size_t)atoi(p);
-                    if (current > s->total_build_steps) s->total_build_steps = current;
-                    if (total > s->max_build_step) s->max_build_step = total;
-                }
+                size_t total = (size_t)atoi(p);
+                if (current > s->total_build_steps) s->total_build_steps = current;
+                if (total > s->max_build_step) s->max_build_step = total;
             }
         }
+    }
 
-        /* Build failure */
-        if (lp_str_contains_ci(line, "ninja: build stopped") ||
-            (lp_str_contains(line, "FAILED:") && !lp_str_contains(line, "FAILED: _"))) {
-            s->build_failed = true;
-        }
-        if (lp_str_contains(line, "FATAL ERROR:")) {
-            s->build_failed = true;
+    /* Build failure */
+    if (lp_str_contains_ci(line, "ninja: build stopped") ||
+        (lp_str_contains(line, "FAILED:") && !lp_str_contains(line, "FAILED: _"))) {
+        s->build_failed = true;
+    }
+    if (lp_str_contains(line, "FATAL ERROR:") || lp_str_contains(line, "BUILD FAILED")) {
+        s->build_failed = true;
+    }
+}
+
+static void extract_summary(build_summary *s, line_array *la) {
+    memset(s, 0, sizeof(*s));
+    for (size_t i = 0; i < la->count; i++)
+        summary_scan_line(s, la->lines[i]);
+}
+
+/* ---- Tail-first summary extraction ---- */
+
+/* Reverse-scan state. Lines are visited from EOF backwards until one of the
+   mode's tail markers (the header of the trailing summary section) is seen.
+   The ring keeps the non-blank lines nearest to that header. */
+typedef struct {
+    size_t limit;
+    char   ring[MAX_TAIL_SECTION][256];
+    size_t pushed;
+} tail_scan;
+
+/* Visit one line, walking backwards. Returns true when scanning can stop. */
+static bool tail_visit(build_summary *s, tail_scan *ts, const lp_mode *mode,
+                       const char *line, size_t visited) {
+    summary_scan_line(s, line);
+
+    for (size_t i = 0; i < mode->tail_marker_count; i++) {
+        if (!lp_str_contains(line, mode->tail_markers[i])) continue;
+        char *title = lp_strtrim(line);
+        snprintf(s->tail_title, sizeof(s->tail_title), "%s", title);
+        free(title);
+        /* Ring holds the section newest-first; emit it in log order */
+        size_t n = ts->pushed < MAX_TAIL_SECTION ? ts->pushed : MAX_TAIL_SECTION;
+        for (size_t k = 0; k < n; k++) {
+            size_t idx = (ts->pushed - 1 - k) % MAX_TAIL_SECTION;
+            memcpy(s->tail_lines[k], ts->ring[idx], sizeof(s->tail_lines[k]));
         }
+        s->tail_line_count = n;
+        return true;
+    }
+
+    if (!lp_is_blank(line)) {
+        snprintf(ts->ring[ts->pushed % MAX_TAIL_SECTION], sizeof(ts->ring[0]), "%s", line);
+        ts->pushed++;
+    }
+    return visited >= ts->limit;
+}
+
+static void tail_scan_init(tail_scan *ts, const lp_mode *mode) {
+    memset(ts, 0, sizeof(*ts));
+    ts->limit = mode->tail_scan_lines ? mode->tail_scan_lines : DEFAULT_TAIL_SCAN;
+}
+
+/* Reverse scan over a mapped file: cost is O(tail), independent of log size.
+   Returns lines visited; sets *scanned_bytes. */
+static size_t extract_summary_tail(build_summary *s, const lp_mapped_file *mf,
+                                   const lp_mode *mode, size_t *scanned_bytes) {
+    tail_scan ts;
+    tail_scan_init(&ts, mode);
+
+    lp_rev_scanner rs;
+    lp_rev_init(&rs, mf->data, mf->len);
+    char buf[4096];
+    const char *ln;
+    size_t len;
+    while ((ln = lp_rev_next(&rs, &len)) != NULL) {
+        if (len >= sizeof(buf)) len = sizeof(buf) - 1;  /* long lines are command noise */
+        memcpy(buf, ln, len);
+        buf[len] = '\0';
+        if (tail_visit(s, &ts, mode, buf, rs.lines)) break;
+    }
+    *scanned_bytes = lp_rev_consumed(&rs, mf->len);
+    return rs.lines;
+}
+
+/* Same section search over lines already in memory (stdin input) */
+static void extract_tail_section(build_summary *s, line_array *la, const lp_mode *mode) {
+    tail_scan ts;
+    tail_scan_init(&ts, mode);
+    for (size_t i = la->count; i > 0; i--) {
+        if (tail_visit(s, &ts, mode, la->lines[i - 1], la->count - i + 1)) break;
     }
 }
 
@@ -388,6 +640,139 @@ static bool is_wrapper_error(lp_segment *seg) {
     return true;
 }
 
+/* ---- Failed-step command lines ---- */
+
+/* Index of the compiler invocation ninja prints right after a "FAILED:"
+   line, or (size_t)-1 when there is none. The diff printed for it stands
+   in for the command, so it is marked in replaced (one flag per line) for
+   the output to skip. */
+static size_t failed_command_line(const line_array *la, size_t line_idx, bool *replaced) {
+    if (!lp_str_starts_with(la->lines[line_idx], "FAILED:")) return (size_t)-1;
+    for (size_t i = line_idx + 1; i < la->count && i <= line_idx + 2; i++) {
+        if (lp_is_blank(la->lines[i])) continue;
+        if (!lp_is_compiler_command(la->lines[i])) return (size_t)-1;
+        replaced[i] = true;
+        return i;
+    }
+    return (size_t)-1;
+}
+
+/* Emit the failing command as a diff against the common flag set */
+static void print_failed_command(FILE *out, const line_array *la, size_t line_idx,
+                                 const lp_cmd_table *cmds, bool *replaced) {
+    size_t ci = failed_command_line(la, line_idx, replaced);
+    if (ci == (size_t)-1) return;
+    char *diff = lp_cmd_compress(cmds, la->lines[ci]);
+    fprintf(out, "  $ %s\n", diff);
+    free(diff);
+}
+
+/* ---- Enrichment notes ---- */
+
+/* Print (or, with out NULL, just count) the newline-terminated notes that
+   are not in seen yet, each after prefix. seen holds the notes shown so
+   far, newline-delimited. */
+static size_t print_new_notes(FILE *out, const char *prefix, lp_string *notes,
+                              lp_string *seen) {
+    size_t shown = 0;
+    if (notes->len == 0) return 0;
+    if (seen->len == 0) lp_string_append(seen, "\n", 1);
+    char *p = lp_string_cstr(notes);
+    for (char *nl; (nl = strchr(p, '\n')) != NULL; p = nl + 1) {
+        size_t len = (size_t)(nl - p) + 1;
+        lp_string key = lp_string_new(len + 2);
+        lp_string_append(&key, "\n", 1);
+        lp_string_append(&key, p, len);
+        if (!strstr(lp_string_cstr(seen), lp_string_cstr(&key))) {
+            lp_string_append(seen, p, len);
+            if (out) fprintf(out, "%s%.*s", prefix, (int)len, p);
+            shown++;
+        }
+        lp_string_free(&key);
+    }
+    return shown;
+}
+
+/* Devicetree references in an error/warning line, once per segment */
+static size_t print_dt_notes(FILE *out, const lp_dt_index *dt, const char *line,
+                             lp_string *seen) {
+    if (!dt) return 0;
+    lp_string notes = lp_string_new(128);
+    lp_dt_index_explain(dt, line, &notes);
+    size_t shown = print_new_notes(out, "    [DT] ", &notes, seen);
+    lp_string_free(&notes);
+    return shown;
+}
+
+/* Origins of the symbols named by the log's Kconfig warnings, once each */
+static size_t print_kconfig_notes(FILE *out, const lp_kconfig_index *kc,
+                                  const line_array *la, lp_string *seen) {
+    if (!kc) return 0;
+    size_t shown = 0;
+    lp_string notes = lp_string_new(128);
+    for (size_t i = 0; i < la->count; i++) {
+        if (!lp_kconfig_is_warning(la->lines[i])) continue;
+        lp_string_clear(&notes);
+        lp_kconfig_explain(kc, la->lines[i], &notes);
+        shown += print_new_notes(out, "  Kconfig ", &notes, seen);
+    }
+    lp_string_free(&notes);
+    return shown;
+}
+
+/* Notes collected by print_new_notes as a JSON array of strings */
+static void print_json_notes(FILE *out, lp_string *seen, const char *indent) {
+    fprintf(out, "[");
+    bool first = true;
+    char *p = lp_string_cstr(seen);
+    if (*p == '\n') p++;
+    for (char *nl; (nl = strchr(p, '\n')) != NULL; p = nl + 1) {
+        *nl = '\0';
+        fprintf(out, "%s\n%s  ", first ? "" : ",", indent);
+        print_json_string(out, p);
+        *nl = '\n';
+        first = false;
+    }
+    fprintf(out, "\n%s]", indent);
+}
+
+/* Board / build / memory facts shared by the full and summary-only output */
+static void print_summary_block(FILE *out, const build_summary *summary,
+                                size_t error_count) {
+    if (summary->board[0]) {
+        fprintf(out, "  Board: %s", summary->board);
+        if (summary->zephyr_version[0])
+            fprintf(out, " | Zephyr %s", summary->zephyr_version);
+        if (summary->toolchain[0])
+            fprintf(out, " | %s", summary->toolchain);
+        fprintf(out, "\n");
+    }
+    if (summary->overlay[0])
+        fprintf(out, "  Overlay: %s\n", summary->overlay);
+
+    /* Build steps summary */
+    if (summary->max_build_step > 0) {
+        if (error_count > 0 || summary->build_failed) {
+            fprintf(out, "  Build: FAILED at step %zu/%zu\n",
+                    summary->total_build_steps, summary->max_build_step);
+        } else {
+            fprintf(out, "  Build: %zu/%zu steps OK\n",
+                    summary->total_build_steps, summary->max_build_step);
+        }
+    }
+
+    /* Memory summary */
+    if (summary->memory_flash[0]) {
+        fprintf(out, "  FLASH: %s\n", summary->memory_flash);
+    }
+    if (summary->memory_ram[0]) {
+        fprintf(out, "  RAM:   %s\n", summary->memory_ram);
+    }
+    if (summary->output_file[0]) {
+        fprintf(out, "  Output: %s\n", summary->output_file);
+    }
+}
+
 static void output_text(FILE *out, const logparse_args *args,
                         const char *mode_name,
                         line_array *la,
@@ -395,38 +780,85 @@ static void output_text(FILE *out, const logparse_args *args,
                         lp_segment *segs, size_t seg_count,
                         lp_budget_result *budget,
                         size_t error_count, size_t warning_count,
-                        const struct lp_mode *mode) {
+                        const struct lp_mode *mode,
+                        lp_fate_classifier *fc,
+                        lp_plugin *plugin,
+                        const lp_dt_index *dt,
+                        const lp_kconfig_index *kc,
+                        size_t *kept_lines) {
 
-    (void)seg_count;
+    lp_string dt_seen = lp_string_new(256);
+    bool *replaced = (bool *)calloc(la->count ? la->count : 1, sizeof(bool));
 
     /* Extract summary facts from the full log */
     build_summary summary;
     extract_summary(&summary, la);
 
-    /* Count output lines — matches the actual filtering in the output loop */
+    /* Count output lines — matches the actual filtering in the output loop.
+       With kept_lines (--explain-budget) each segment's non-dropped lines
+       are recorded for the report: shown ones from this pass, the rest
+       with lp_line_fate, so the classifier's stats only see lines it would
+       have seen anyway. budget->indices is sorted, so a merge walk finds
+       the packed. */
     size_t output_lines = 0;
     size_t real_error_count = 0;
-    for (size_t i = 0; i < budget->count; i++) {
-        lp_segment *seg = &segs[budget->indices[i]];
-        if (seg->type == LP_SEG_BUILD_PROGRESS || seg->type == LP_SEG_BOILERPLATE)
+    size_t failed_cmds = 0;
+    size_t next_packed = 0;
+    for (size_t si = 0; si < seg_count; si++) {
+        bool packed = next_packed < budget->count && budget->indices[next_packed] == si;
+        if (packed) next_packed++;
+        lp_segment *seg = &segs[si];
+        bool shown = packed && seg->type != LP_SEG_BUILD_PROGRESS &&
+                     seg->type != LP_SEG_BOILERPLATE && !is_wrapper_error(seg) &&
+                     (seg->type == LP_SEG_ERROR || seg->type == LP_SEG_WARNING ||
+                      seg->score >= 3.0f);
+        if (!shown) {
+            for (size_t l = 0; kept_lines && l < seg->line_count; l++)
+                if (lp_line_fate(seg->lines[l], mode) != LP_FATE_DROP) kept_lines[si]++;
             continue;
-        if (is_wrapper_error(seg)) continue;
-
-        if (seg->type != LP_SEG_ERROR && seg->type != LP_SEG_WARNING) {
-            if (seg->score < 3.0f) continue;
         }
         if (seg->type == LP_SEG_ERROR) real_error_count++;
 
         /* Count non-noise lines within the segment */
+        lp_string_clear(&dt_seen);
+        size_t kept = 0;
         for (size_t l = 0; l < seg->line_count; l++) {
-            lp_fate f = lp_line_fate(seg->lines[l], mode);
+            lp_fate f = lp_fate_classify(fc, seg->lines[l]);
             if (f == LP_FATE_DROP) continue;
+            kept++;
             if (f == LP_FATE_KEEP_ONCE) continue;
+            if (replaced[seg->start_line + l]) continue;
             output_lines++;
+            if (seg->type == LP_SEG_ERROR || seg->type == LP_SEG_WARNING)
+                output_lines += print_dt_notes(NULL, dt, seg->lines[l], &dt_seen);
+            if (seg->type == LP_SEG_ERROR &&
+                failed_command_line(la, seg->start_line + l, replaced) != (size_t)-1) {
+                output_lines++;
+                failed_cmds++;
+            }
         }
+        if (kept_lines) kept_lines[si] = kept;
     }
     /* Add summary header lines */
     output_lines += 6;
+    if (dt) output_lines++;
+    lp_string kc_seen = lp_string_new(256);
+    output_lines += print_kconfig_notes(NULL, kc, la, &kc_seen);
+
+    /* Factor failing compiler commands against every invocation in the log,
+       so each one costs only its distinguishing flags */
+    lp_cmd_table cmds;
+    lp_cmd_init(&cmds);
+    char *cmd_legend = NULL;
+    size_t cmd_common = 0;
+    if (failed_cmds > 0) {
+        for (size_t i = 0; i < la->count; i++) {
+            if (lp_is_compiler_command(la->lines[i]))
+                lp_cmd_add(&cmds, la->lines[i]);
+        }
+        cmd_legend = lp_cmd_legend(&cmds, &cmd_common);
+        if (cmd_common > 0) output_lines++;
+    }
 
     float reduction = la->count > 0
         ? (1.0f - (float)output_lines / (float)la->count) * 100.0f
@@ -443,39 +875,29 @@ static void output_text(FILE *out, const logparse_args *args,
     fprintf(out, "\n");
 
     /* --- Build summary --- */
-    if (summary.board[0]) {
-        fprintf(out, "  Board: %s", summary.board);
-        if (summary.zephyr_version[0])
-            fprintf(out, " | Zephyr %s", summary.zephyr_version);
-        if (summary.toolchain[0])
-            fprintf(out, " | %s", summary.toolchain);
-        fprintf(out, "\n");
-    }
-    if (summary.overlay[0])
-        fprintf(out, "  Overlay: %s\n", summary.overlay);
-
-    /* Build steps summary */
-    if (summary.max_build_step > 0) {
-        if (error_count > 0 || summary.build_failed) {
-            fprintf(out, "  Build: FAILED at step %zu/%zu\n",
-                    summary.total_build_steps, summary.max_build_step);
-        } else {
-            fprintf(out, "  Build: %zu/%zu steps OK\n",
-                    summary.total_build_steps, summary.max_build_step);
+    print_summary_block(out, &summary, error_count);
+    if (dt)
+        fprintf(out, "  Devicetree: %zu nodes indexed from %s\n", dt->node_count, dt->build_dir);
+    lp_string_clear(&kc_seen);
+    print_kconfig_notes(out, kc, la, &kc_seen);
+    lp_string_free(&kc_seen);
+    const char *plugin_text = lp_plugin_summary_text(plugin);
+    if (plugin_text) {
+        /* Plugin facts, indented like the built-in summary lines */
+        for (const char *p = plugin_text; *p; ) {
+            const char *nl = strchr(p, '\n');
+            size_t len = nl ? (size_t)(nl - p) : strlen(p);
+            fprintf(out, "  %.*s\n", (int)len, p);
+            p += len + (nl ? 1 : 0);
         }
     }
+    fprintf(out, "\n");
 
-    /* Memory summary */
-    if (summary.memory_flash[0]) {
-        fprintf(out, "  FLASH: %s\n", summary.memory_flash);
-    }
-    if (summary.memory_ram[0]) {
-        fprintf(out, "  RAM:   %s\n", summary.memory_ram);
-    }
-    if (summary.output_file[0]) {
-        fprintf(out, "  Output: %s\n", summary.output_file);
+    /* --- Common compiler flags, printed once for all failing commands --- */
+    if (cmd_legend && cmd_common > 0) {
+        fprintf(out, "[COMMON CMD] %zu tokens shared by %zu invocations: %s\n\n",
+                cmd_common, cmds.cmd_count, cmd_legend);
     }
-    fprintf(out, "\n");
 
     /* --- Frequency table: only if genuinely interesting (3+ repeats) --- */
     size_t sorted_count;
@@ -486,7 +908,7 @@ static void output_text(FILE *out, const logparse_args *args,
     for (size_t i = 0; i < freq_top; i++) {
         if (sorted[i]->count < 3 && !args->raw_freq) continue;
         /* Use fate to decide: only KEEP lines belong in FREQ */
-        lp_fate fate = lp_line_fate(sorted[i]->original, mode);
+        lp_fate fate = lp_fate_classify(fc, sorted[i]->original);
         if (fate == LP_FATE_DROP) continue;
         if (fate == LP_FATE_KEEP_ONCE) continue;  /* already in summary */
         /* Skip GCC source-context lines (line numbers, carets, underlines) */
@@ -503,6 +925,7 @@ static void output_text(FILE *out, const logparse_args *args,
     if (freq_shown > 0) fprintf(out, "\n");
 
     /* --- Segments --- */
+    memset(replaced, 0, (la->count ? la->count : 1) * sizeof(bool));
     for (size_t b = 0; b < budget->count; b++) {
         size_t si = budget->indices[b];
         lp_segment *seg = &segs[si];
@@ -540,7 +963,13 @@ static void output_text(FILE *out, const logparse_args *args,
             if (all_summarized) continue;
         }
 
-        fprintf(out, "[%s]\n", seg_type_name(seg->type));
+        /* Plugins may relabel a block, e.g. [error: devicetree] */
+        const char *tname = seg_type_name(seg->type);
+        if (is_custom_label(seg->label))
+            fprintf(out, "[%s: %s]\n", tname, seg->label);
+        else
+            fprintf(out, "[%s]\n", tname);
+        lp_string_clear(&dt_seen);
 
         /* Within-segment dedup for warning/error blocks:
            When the same warning appears N times (e.g. -Wdouble-promotion on
@@ -604,13 +1033,16 @@ static void output_text(FILE *out, const logparse_args *args,
 
             /* Emit lines, skipping suppressed ones */
             for (size_t l = 0; l < seg->line_count; l++) {
-                if (suppress[l]) continue;
+                if (suppress[l] || replaced[seg->start_line + l]) continue;
                 const char *line = seg->lines[l];
 
-                lp_fate line_fate = lp_line_fate(line, mode);
+                lp_fate line_fate = lp_fate_classify(fc, line);
                 if (line_fate == LP_FATE_DROP && !lp_is_blank(line)) continue;
 
                 fprintf(out, "  %s\n", line);
+                print_dt_notes(out, dt, line, &dt_seen);
+                if (seg->type == LP_SEG_ERROR)
+                    print_failed_command(out, la, seg->start_line + l, &cmds, replaced);
 
                 /* After first instance of a repeated warning, emit count */
                 for (size_t w = 0; w < seen_count; w++) {
@@ -623,12 +1055,15 @@ static void output_text(FILE *out, const logparse_args *args,
             }
             free(suppress);
         } else {
-            /* Standard output for non-repeated segments */
+            /* Standard output for non-repeated segments; tables print as
+               compact '|'-separated rows, header row first */
+            lp_string row = lp_string_new(256);
             for (size_t l = 0; l < seg->line_count; l++) {
                 const char *line = seg->lines[l];
+                if (replaced[seg->start_line + l]) continue;
 
                 /* Use centralized fate to filter noise lines */
-                lp_fate line_fate = lp_line_fate(line, mode);
+                lp_fate line_fate = lp_fate_classify(fc, line);
                 if (seg->type == LP_SEG_ERROR || seg->type == LP_SEG_WARNING) {
                     if (line_fate == LP_FATE_DROP && !lp_is_blank(line)) continue;
                 } else {
@@ -650,16 +1085,32 @@ static void output_text(FILE *out, const logparse_args *args,
                     }
                     idx = (idx + 1) & (dedup->capacity - 1);
                 }
+                const char *shown = line;
+                if (seg->columns) {
+                    lp_string_clear(&row);
+                    lp_format_row(line, seg->columns, &row);
+                    shown = lp_string_cstr(&row);
+                }
+                bool is_issue = seg->type == LP_SEG_ERROR || seg->type == LP_SEG_WARNING;
                 if (dup_count > 1 && line_num == dedup->buckets[idx].first_line) {
-                    fprintf(out, "  [x%zu] %s\n", dup_count, line);
+                    fprintf(out, "  [x%zu] %s\n", dup_count, shown);
+                    if (is_issue) print_dt_notes(out, dt, line, &dt_seen);
                 } else if (dup_count <= 1) {
-                    fprintf(out, "  %s\n", line);
+                    fprintf(out, "  %s\n", shown);
+                    if (is_issue) print_dt_notes(out, dt, line, &dt_seen);
+                    if (seg->type == LP_SEG_ERROR)
+                        print_failed_command(out, la, line_num, &cmds, replaced);
                 }
             }
+            lp_string_free(&row);
         }
         fprintf(out, "\n");
     }
 
+    free(cmd_legend);
+    lp_cmd_free(&cmds);
+    lp_string_free(&dt_seen);
+    free(replaced);
     free(sorted);
 }
 
@@ -673,7 +1124,10 @@ static void output_json(FILE *out, const logparse_args *args,
                         lp_dedup_table *dedup,
                         lp_segment *segs, size_t seg_count,
                         lp_budget_result *budget,
-                        size_t error_count, size_t warning_count) {
+                        size_t error_count, size_t warning_count,
+                        lp_plugin *plugin,
+                        const lp_dt_index *dt,
+                        const lp_kconfig_index *kc) {
     (void)seg_count;
 
     build_summary summary;
@@ -717,6 +1171,24 @@ static void output_json(FILE *out, const logparse_args *args,
         print_json_string(out, summary.memory_ram);
         fprintf(out, ",\n");
     }
+    lp_string kc_notes = lp_string_new(256);
+    if (print_kconfig_notes(NULL, kc, la, &kc_notes) > 0) {
+        fprintf(out, "    \"kconfig\": ");
+        print_json_notes(out, &kc_notes, "    ");
+        fprintf(out, ",\n");
+    }
+    lp_string_free(&kc_notes);
+    const char *plugin_text = lp_plugin_summary_text(plugin);
+    if (plugin_text && *plugin_text) {
+        /* Plugin facts, one string per summary line */
+        lp_string facts = lp_string_new(256);
+        lp_string_append_cstr(&facts, plugin_text);
+        if (plugin_text[strlen(plugin_text) - 1] != '\n') lp_string_append_cstr(&facts, "\n");
+        fprintf(out, "    \"plugin\": ");
+        print_json_notes(out, &facts, "    ");
+        fprintf(out, ",\n");
+        lp_string_free(&facts);
+    }
     fprintf(out, "    \"build_steps\": %zu,\n", summary.max_build_step);
     fprintf(out, "    \"build_failed\": %s\n", summary.build_failed ? "true" : "false");
     fprintf(out, "  },\n");
@@ -752,6 +1224,11 @@ static void output_json(FILE *out, const logparse_args *args,
         first = false;
         fprintf(out, "    {\n");
         fprintf(out, "      \"type\": \"%s\",\n", seg_type_name(seg->type));
+        if (is_custom_label(seg->label)) {
+            fprintf(out, "      \"label\": ");
+            print_json_string(out, seg->label);
+            fprintf(out, ",\n");
+        }
         fprintf(out, "      \"start_line\": %zu,\n", seg->start_line + 1);
         fprintf(out, "      \"end_line\": %zu,\n", seg->end_line + 1);
         fprintf(out, "      \"score\": %.1f,\n", seg->score);
@@ -761,7 +1238,19 @@ static void output_json(FILE *out, const logparse_args *args,
             fprintf(out, "        ");
             print_json_string(out, seg->lines[l]);
         }
-        fprintf(out, "\n      ]\n");
+        fprintf(out, "\n      ]");
+        if (dt && (seg->type == LP_SEG_ERROR || seg->type == LP_SEG_WARNING)) {
+            /* Resolved devicetree references, one string per note */
+            lp_string notes = lp_string_new(256);
+            for (size_t l = 0; l < seg->line_count; l++)
+                print_dt_notes(NULL, dt, seg->lines[l], &notes);
+            if (notes.len > 1) {
+                fprintf(out, ",\n      \"devicetree\": ");
+                print_json_notes(out, &notes, "      ");
+            }
+            lp_string_free(&notes);
+        }
+        fprintf(out, "\n");
         fprintf(out, "    }");
     }
     fprintf(out, "\n  ]\n");
@@ -771,35 +1260,106 @@ static void output_json(FILE *out, const logparse_args *args,
     free(sorted);
 }
 
-/* ---- Main ---- */
+/* ---- Budget report ---- */
 
-int main(int argc, char **argv) {
-    logparse_args args = parse_args(argc, argv);
+static void print_budget_row(FILE *out, const char *name, const lp_budget_row *row) {
+    fprintf(out, "  %-24.24s %5zu %5zu %6zu %8zu %8zu %7zu %7zu\n", name,
+            row->segments, row->candidates, row->packed, row->tokens,
+            row->packed_tokens, row->lines, row->kept_lines);
+}
 
-    if (args.show_help_agent) {
-        fputs(HELP_AGENT_TEXT, stdout);
-        return 0;
+static void print_budget_header(FILE *out, const char *first) {
+    fprintf(out, "  %-24s %5s %5s %6s %8s %8s %7s %7s\n", first,
+            "segs", "cand", "packed", "tokens", "used", "lines", "kept");
+}
+
+/* kept_lines: each segment's fate-filtered line count, as the output pass
+   recorded it */
+static void output_budget_report(FILE *out, lp_segment *segs, size_t seg_count,
+                                 const lp_budget_result *budget,
+                                 const size_t *kept_lines) {
+    lp_budget_report rep;
+    lp_budget_report_build(segs, seg_count, budget, kept_lines, &rep);
+
+    size_t packed = budget->total_tokens - budget->reserve_tokens;
+    size_t unused = budget->budget_tokens > budget->total_tokens
+        ? budget->budget_tokens - budget->total_tokens : 0;
+    fprintf(out, "\n[BUDGET] %zu tokens: %zu packed (%zu errors, %zu by score) + %zu reserve, %zu unused\n",
+            budget->budget_tokens, packed, rep.error_tokens, packed - rep.error_tokens,
+            budget->reserve_tokens, unused);
+    fprintf(out, "[BUDGET] score cutoff: ");
+    if (rep.cutoff_score >= 0.0f) fprintf(out, "lowest packed %.1f", rep.cutoff_score);
+    else fprintf(out, "nothing packed by score");
+    if (rep.best_dropped >= 0.0f) fprintf(out, ", highest left out %.1f\n", rep.best_dropped);
+    else fprintf(out, ", nothing eligible left out\n");
+
+    fprintf(out, "\n[BUDGET BY TYPE]\n");
+    print_budget_header(out, "type");
+    for (size_t t = 0; t < LP_SEG_TYPE_COUNT; t++)
+        if (rep.by_type[t].segments)
+            print_budget_row(out, seg_type_name((lp_seg_type)t), &rep.by_type[t]);
+
+    fprintf(out, "\n[BUDGET BY PHASE]\n");
+    print_budget_header(out, "phase");
+    for (size_t p = 0; p < rep.phase_count; p++) {
+        if (!rep.by_phase[p].segments) continue;
+        const lp_segment *first = &segs[rep.phase_first[p]];
+        const char *label = first->line_count ? first->lines[0] : "";
+        while (*label == ' ' || *label == '\t') label++;
+        char name[64];
+        snprintf(name, sizeof(name), "%zu: %s", first->start_line + 1, label);
+        print_budget_row(out, name, &rep.by_phase[p]);
     }
-    if (args.show_help) {
-        fputs(HELP_TEXT, stdout);
-        return 0;
+
+    if (rep.excluded_count) {
+        fprintf(out, "\n[BUDGET LARGEST EXCLUDED]\n");
+        for (size_t k = 0; k < rep.excluded_count; k++) {
+            const lp_segment *seg = &segs[rep.excluded[k]];
+            char span[48];
+            snprintf(span, sizeof(span), "lines %zu-%zu", seg->start_line + 1, seg->end_line + 1);
+            fprintf(out, "  %-18s %-11s %6zu tokens  score %5.1f  %s\n", span, seg_type_name(seg->type),
+                    seg->token_count, seg->score,
+                    seg->score < 0.0f ? "never packed" : "no room");
+        }
     }
+    lp_budget_report_free(&rep);
+}
 
-    /* Open input */
-    FILE *fp;
-    if (args.input_file) {
-        fp = fopen(args.input_file, "r");
-        if (!fp) {
-            fprintf(stderr, "logparse: cannot open '%s'\n", args.input_file);
-            return 1;
+/* ---- Mode selection ---- */
+
+/* --mode wins; otherwise sniff the first SNIFF_LINES lines. */
+static const char *select_mode(const logparse_args *args, line_array *la,
+                               lp_mode **modes, size_t mode_count,
+                               lp_mode **active_mode) {
+    const char *mode_name = "generic";
+    *active_mode = NULL;
+
+    if (args->mode_name) {
+        mode_name = args->mode_name;
+        *active_mode = lp_mode_find(modes, mode_count, args->mode_name);
+        if (!*active_mode) {
+            fprintf(stderr, "logparse: warning: mode '%s' not found, using generic\n",
+                    args->mode_name);
+            mode_name = "generic";
         }
-    } else {
-        fp = stdin;
+    } else if (mode_count > 0) {
+        size_t sniff = la->count < SNIFF_LINES ? la->count : SNIFF_LINES;
+        mode_name = lp_mode_detect((const char **)la->lines, sniff,
+                                    modes, mode_count);
+        *active_mode = lp_mode_find(modes, mode_count, mode_name);
     }
+    return mode_name;
+}
 
-    /* Read all lines */
-    line_array la = read_all_lines(fp);
-    if (args.input_file) fclose(fp);
+/* ---- Summary-only run ---- */
+
+/* Header + summary block only. Tail-resident modes on a mapped file read
+   the head (for detection) and scan backwards from EOF; nothing in between
+   is touched. Everything else falls back to a full forward pass. */
+static int run_summary_only(const logparse_args *args, log_input *in, const mode_set *ms) {
+    line_array la;
+    memset(&la, 0, sizeof(la));
+    read_lines(in, &la, in->mapped ? SNIFF_LINES : (size_t)-1);
 
     if (la.count == 0) {
         fprintf(stderr, "logparse: empty input\n");
@@ -807,48 +1367,283 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    /* Load modes */
-    char *mode_dir = lp_mode_find_dir();
-    lp_mode **modes = NULL;
-    size_t mode_count = 0;
-    if (mode_dir) {
-        modes = lp_mode_load_dir(mode_dir, &mode_count);
-        free(mode_dir);
+    lp_mode *active_mode = NULL;
+    const char *mode_name = select_mode(args, &la, ms->modes, ms->count, &active_mode);
+
+    build_summary summary;
+    memset(&summary, 0, sizeof(summary));
+    bool tail_first = in->mapped && active_mode && active_mode->tail_resident;
+    size_t scanned_lines = 0, scanned_bytes = 0;
+
+    if (tail_first) {
+        /* Head facts first (board, versions), then the trailing section */
+        for (size_t i = 0; i < la.count; i++)
+            summary_scan_line(&summary, la.lines[i]);
+        scanned_lines = extract_summary_tail(&summary, &in->map, active_mode, &scanned_bytes);
+    } else {
+        read_lines(in, &la, (size_t)-1);
+        extract_summary(&summary, &la);
+        if (active_mode && active_mode->tail_marker_count > 0)
+            extract_tail_section(&summary, &la, active_mode);
     }
 
-    /* Detect or select mode */
-    const char *mode_name = "generic";
-    lp_mode *active_mode = NULL;
+    if (tail_first) {
+        fprintf(stdout, "[LOGPARSE] mode: %s | summary-only | tail scan: %zu lines "
+                "(%.1f of %.1f KB)\n", mode_name, scanned_lines,
+                (double)scanned_bytes / 1024.0, (double)in->map.len / 1024.0);
+    } else {
+        fprintf(stdout, "[LOGPARSE] mode: %s | summary-only | %zu lines\n",
+                mode_name, la.count);
+    }
+    if (args->input_file)
+        fprintf(stdout, "[SOURCE] %s\n", args->input_file);
+    fprintf(stdout, "\n");
+
+    print_summary_block(stdout, &summary, 0);
+    if (summary.build_failed && summary.max_build_step == 0)
+        fprintf(stdout, "  Build: FAILED\n");
+    if (summary.tail_title[0]) {
+        fprintf(stdout, "  %s\n", summary.tail_title);
+        for (size_t i = 0; i < summary.tail_line_count; i++)
+            fprintf(stdout, "    %s\n", summary.tail_lines[i]);
+    }
 
-    if (args.mode_name) {
-        mode_name = args.mode_name;
-        active_mode = lp_mode_find(modes, mode_count, args.mode_name);
-        if (!active_mode) {
-            fprintf(stderr, "logparse: warning: mode '%s' not found, using generic\n",
-                    args.mode_name);
-            mode_name = "generic";
+    free_line_array(&la);
+    return 0;
+}
+
+/* ---- Plugin loading ---- */
+
+static lp_plugin *load_plugin(const logparse_args *args, const lp_mode *mode,
+                              const char *mode_name, const char *mode_dir) {
+    const char *path = args->plugin_path;
+    if (!path && mode) path = mode->plugin_path;
+    if (!path) return NULL;
+
+    char err[512];
+    lp_plugin *plugin = lp_plugin_load(path, mode_dir, mode_name, err, sizeof(err));
+    if (!plugin)
+        fprintf(stderr, "logparse: warning: %s\n", err);
+    return plugin;
+}
+
+/* ---- Mode listing ---- */
+
+static void list_modes(const mode_set *ms) {
+    fprintf(stdout, "[LOGPARSE] %zu modes (%zu built-in)\n", ms->count, lp_builtin_mode_count);
+    for (size_t i = 0; i < ms->count; i++) {
+        const lp_mode *m = ms->modes[i];
+        const char *origin = m->builtin ? "built-in"
+                           : m->overrides_builtin ? "TOML, overrides built-in"
+                           : "TOML";
+        fprintf(stdout, "  %-12s %-26s %s\n", m->name ? m->name : "(unnamed)",
+                origin, m->description ? m->description : "");
+    }
+    if (ms->dir) fprintf(stdout, "[MODES DIR] %s\n", ms->dir);
+}
+
+/* ---- Pipelined ingest ----
+ *
+ * Reading, mode sniffing and deduplication overlap: a reader thread cuts
+ * the input into line batches, the main thread appends them to the line
+ * array (in order) and forwards them to a dedup thread, over SPSC rings of
+ * batch pointers. Segmentation, scoring and packing need the whole log, so
+ * they start once the last batch has been deduplicated. Only the dedup
+ * stage runs regexes while the pipeline is up (tiny-regex is not
+ * thread-safe); the mode is sniffed from the first batch before it starts.
+ */
+
+#define PIPE_BATCH_LINES 128   /* ~10 KB of text: still cache-hot for the next stage */
+#define PIPE_RING_SLOTS  64
+
+#if PIPE_BATCH_LINES < SNIFF_LINES
+#error "the first batch must cover the mode sniffing window"
+#endif
+
+typedef struct {
+    size_t first;                       /* Line number of lines[0] */
+    size_t count;
+    char  *lines[PIPE_BATCH_LINES];     /* Owned by the line array once appended */
+} line_batch;
+
+/* Next batch of lines, or NULL at end of input */
+static line_batch *read_batch(log_input *in, char **buf, size_t *buf_cap, size_t first) {
+    line_batch *b = NULL;
+    char *line;
+    while ((!b || b->count < PIPE_BATCH_LINES) && (line = input_line(in, buf, buf_cap)) != NULL) {
+        if (!b) {
+            b = (line_batch *)malloc(sizeof(line_batch));
+            b->first = first;
+            b->count = 0;
         }
-    } else if (mode_count > 0) {
-        size_t sniff = la.count < SNIFF_LINES ? la.count : SNIFF_LINES;
-        mode_name = lp_mode_detect((const char **)la.lines, sniff,
-                                    modes, mode_count);
-        active_mode = lp_mode_find(modes, mode_count, mode_name);
+        b->lines[b->count++] = line;
     }
+    return b;
+}
+
+typedef struct {
+    log_input *in;
+    lp_ring   *out;
+} reader_stage;
+
+static void reader_main(void *arg) {
+    reader_stage *st = (reader_stage *)arg;
+    char *buf = NULL;
+    size_t buf_cap = 0, next = 0;
+    line_batch *b;
+    while ((b = read_batch(st->in, &buf, &buf_cap, next)) != NULL) {
+        next += b->count;
+        lp_ring_push(st->out, &b);
+    }
+    free(buf);
+    lp_ring_close(st->out);
+}
 
-    /* Get strip patterns from mode */
-    const char **strip_pats = NULL;
-    size_t strip_count = 0;
-    if (active_mode) {
-        strip_pats = (const char **)active_mode->strip_patterns;
-        strip_count = active_mode->strip_count;
+typedef struct {
+    lp_ring        *in;
+    lp_dedup_table *dedup;
+    const char    **strip_pats;
+    size_t          strip_count;
+    lp_plugin      *plugin;
+} dedup_stage;
+
+static void dedup_batch(dedup_stage *st, line_batch *b) {
+    for (size_t k = 0; k < b->count; k++) {
+        lp_dedup_insert(st->dedup, b->lines[k], b->first + k, st->strip_pats, st->strip_count);
+        lp_plugin_summary_line(st->plugin, b->lines[k], b->first + k);
     }
+    free(b);
+}
+
+static void dedup_main(void *arg) {
+    dedup_stage *st = (dedup_stage *)arg;
+    line_batch *b;
+    while (lp_ring_pop(st->in, &b))
+        dedup_batch(st, b);
+}
 
-    /* Step 1: Deduplication */
+/* Read all lines, select the mode and load its plugin from the first
+   batch, and fill dedup. Falls back to running the stages inline when
+   threads are unavailable or would not help. */
+static line_array ingest(log_input *in, const logparse_args *args, const mode_set *ms,
+                         const char **mode_name, lp_mode **active_mode,
+                         lp_plugin **plugin, lp_dedup_table *dedup) {
+    line_array la;
+    la.count = 0;
+    la.cap = 1024;
+    la.lines = (char **)malloc(la.cap * sizeof(char *));
+    lp_dedup_init(dedup, 1024);
+    *mode_name = "generic";
+    *active_mode = NULL;
+    *plugin = NULL;
+
+    lp_ring *lines_ring = NULL, *dedup_ring = NULL;
+    if (lp_cpu_count() > 1) {
+        lines_ring = lp_ring_new(PIPE_RING_SLOTS, sizeof(line_batch *));
+        dedup_ring = lp_ring_new(PIPE_RING_SLOTS, sizeof(line_batch *));
+    }
+    reader_stage rd = { in, lines_ring };
+    lp_thread reader, deduper;
+    bool threaded = lines_ring && dedup_ring && lp_thread_start(&reader, reader_main, &rd);
+    bool dedup_threaded = false;
+    dedup_stage dd = { dedup_ring, dedup, NULL, 0, NULL };
+
+    char *buf = NULL;
+    size_t buf_cap = 0;
+    line_batch *b;
+    for (;;) {
+        if (threaded) {
+            if (!lp_ring_pop(lines_ring, &b)) break;
+        } else if ((b = read_batch(in, &buf, &buf_cap, la.count)) == NULL) {
+            break;
+        }
+        if (la.count + b->count > la.cap) {
+            while (la.count + b->count > la.cap) la.cap *= 2;
+            la.lines = (char **)realloc(la.lines, la.cap * sizeof(char *));
+        }
+        memcpy(la.lines + la.count, b->lines, b->count * sizeof(char *));
+        la.count += b->count;
+
+        if (la.count == b->count) {
+            /* First batch: everything the mode needs is here */
+            *mode_name = select_mode(args, &la, ms->modes, ms->count, active_mode);
+            *plugin = load_plugin(args, *active_mode, *mode_name, ms->dir);
+            if (*active_mode) {
+                dd.strip_pats = (const char **)(*active_mode)->strip_patterns;
+                dd.strip_count = (*active_mode)->strip_count;
+            }
+            dd.plugin = *plugin;
+            dedup_threaded = threaded && lp_thread_start(&deduper, dedup_main, &dd);
+        }
+        if (dedup_threaded) lp_ring_push(dedup_ring, &b);
+        else dedup_batch(&dd, b);
+    }
+    free(buf);
+
+    if (dedup_threaded) {
+        lp_ring_close(dedup_ring);
+        lp_thread_join(deduper);
+    }
+    if (threaded) lp_thread_join(reader);
+    lp_ring_free(lines_ring);
+    lp_ring_free(dedup_ring);
+    return la;
+}
+
+/* ---- Full run ---- */
+
+static int run_full(const logparse_args *args, log_input *in, const mode_set *ms) {
+    /* Steps 0-1: read all lines, detect or select the mode, load its native
+       plugin (--plugin wins over the mode's [plugin] path) and deduplicate */
+    const char *mode_name;
+    lp_mode *active_mode;
+    lp_plugin *plugin;
     lp_dedup_table dedup;
-    lp_dedup_init(&dedup, la.count / 2 + 64);
-    for (size_t i = 0; i < la.count; i++) {
-        lp_dedup_insert(&dedup, la.lines[i], i, strip_pats, strip_count);
+    line_array la = ingest(in, args, ms, &mode_name, &active_mode, &plugin, &dedup);
+
+    if (la.count == 0) {
+        fprintf(stderr, "logparse: empty input\n");
+        lp_dedup_free(&dedup);
+        free_line_array(&la);
+        return 1;
+    }
+
+    /* Devicetree index: --build-dir, else the build directory the log names */
+    lp_dt_index dt_index;
+    bool have_dt = false;
+    if (args->build_dir || (active_mode && active_mode->enrich_devicetree)) {
+        char *dir = args->build_dir
+            ? strdup(args->build_dir)
+            : lp_dt_find_build_dir((const char *const *)la.lines, la.count);
+        if (dir) {
+            char *cache_path = lp_dt_index_default_path(dir);
+            have_dt = lp_dt_index_open(&dt_index, dir, cache_path);
+            if (!have_dt && args->build_dir)
+                fprintf(stderr, "logparse: no devicetree_generated.h under '%s'\n", dir);
+            free(cache_path);
+            free(dir);
+        }
+    }
+    const lp_dt_index *dt = have_dt ? &dt_index : NULL;
+
+    /* Kconfig origins: index the configuration files the log merged */
+    lp_kconfig_index kc_index;
+    bool have_kc = false;
+    if (active_mode && active_mode->enrich_kconfig) {
+        size_t frag_count = 0;
+        char *config_path = NULL;
+        char **frags = lp_kconfig_find_fragments((const char *const *)la.lines, la.count,
+                                                 &frag_count, &config_path);
+        if (frags) {
+            char *cache_path = lp_kconfig_default_path(frags, frag_count, config_path);
+            have_kc = lp_kconfig_index_open(&kc_index, frags, frag_count, config_path,
+                                            cache_path);
+            free(cache_path);
+            lp_free_strings(frags, frag_count);
+        }
+        free(config_path);
     }
+    const lp_kconfig_index *kc = have_kc ? &kc_index : NULL;
 
     /* Step 2: Segment detection */
     size_t seg_count;
@@ -859,8 +1654,9 @@ int main(int argc, char **argv) {
     /* Step 3: Scoring */
     lp_score_all(segs, seg_count,
                  (const struct lp_mode *)active_mode,
-                 (const char **)args.keywords, args.keyword_count,
+                 (const char **)args->keywords, args->keyword_count,
                  &dedup);
+    lp_plugin_post_segments(plugin, segs, seg_count);
 
     /* Count error/warning segments */
     size_t error_count = 0, warning_count = 0;
@@ -870,29 +1666,198 @@ int main(int argc, char **argv) {
     }
 
     /* Step 4: Budget packing */
-    size_t budget_tokens = args.budget_lines * 10;
+    size_t budget_tokens = args->budget_lines * 10;
     size_t reserve_tokens = 200;
 
-    lp_budget_result budget = lp_budget_pack(segs, seg_count,
-                                              budget_tokens, reserve_tokens);
+    lp_budget_result budget = args->diverse
+        ? lp_budget_pack_diverse(segs, seg_count, budget_tokens, reserve_tokens)
+        : lp_budget_pack(segs, seg_count, budget_tokens, reserve_tokens);
+
+    /* Line-fate classifier, warm-started from persisted hit counts */
+    lp_fate_classifier fate;
+    lp_fate_init(&fate, (const struct lp_mode *)active_mode, 0);
+    fate.plugin = plugin;
+    char *fate_path = NULL;
+    if (args->fate_stats_dir) {
+        /* The mode name becomes a file name: keep it inside the directory */
+        if (strchr(mode_name, '/') || strchr(mode_name, '\\') || strstr(mode_name, "..")) {
+            fprintf(stderr, "logparse: warning: mode name '%s' is not a valid stats file "
+                    "name, --fate-stats ignored\n", mode_name);
+        } else {
+            char fate_file[256];
+            snprintf(fate_file, sizeof(fate_file), "%s.fate", mode_name);
+            fate_path = lp_path_join(args->fate_stats_dir, fate_file);
+            lp_fate_load_stats(&fate, fate_path);
+        }
+    }
 
     /* Step 5: Output */
-    if (args.json_output) {
-        output_json(stdout, &args, mode_name, &la, &dedup,
-                    segs, seg_count, &budget, error_count, warning_count);
+    size_t *kept_lines = NULL;
+    if (args->explain_budget)
+        kept_lines = (size_t *)calloc(seg_count ? seg_count : 1, sizeof(size_t));
+    if (args->json_output) {
+        output_json(stdout, args, mode_name, &la, &dedup,
+                    segs, seg_count, &budget, error_count, warning_count, plugin, dt, kc);
+        /* JSON has no fate pass to record them: count without touching the
+           classifier's stats */
+        for (size_t i = 0; kept_lines && i < seg_count; i++)
+            for (size_t l = 0; l < segs[i].line_count; l++)
+                if (lp_line_fate(segs[i].lines[l], (const struct lp_mode *)active_mode) !=
+                    LP_FATE_DROP)
+                    kept_lines[i]++;
     } else {
-        output_text(stdout, &args, mode_name, &la, &dedup,
+        output_text(stdout, args, mode_name, &la, &dedup,
                     segs, seg_count, &budget, error_count, warning_count,
-                    active_mode);
+                    active_mode, &fate, plugin, dt, kc, kept_lines);
+    }
+    if (args->explain_budget)
+        output_budget_report(args->json_output ? stderr : stdout, segs, seg_count,
+                             &budget, kept_lines);
+    free(kept_lines);
+
+    if (fate_path) {
+        if (!lp_fate_save_stats(&fate, fate_path))
+            fprintf(stderr, "logparse: cannot write '%s'\n", fate_path);
+        free(fate_path);
     }
+    lp_fate_free(&fate);
+    lp_plugin_unload(plugin);
+    if (have_dt) lp_dt_index_close(&dt_index);
+    if (have_kc) lp_kconfig_index_close(&kc_index);
 
     /* Cleanup */
     lp_budget_result_free(&budget);
     lp_segments_free(segs, seg_count);
     lp_dedup_free(&dedup);
-    if (modes) lp_modes_free(modes, mode_count);
-    if (args.keywords) lp_free_strings(args.keywords, args.keyword_count);
     free_line_array(&la);
 
     return 0;
 }
+
+/* ---- Request dispatch ---- */
+
+/* One logparse invocation. input_fd (-1: the input file or stdin) is
+   owned by the call; ms holds warm modes, or NULL to load them here. */
+static int run_request(const logparse_args *args, int input_fd, const mode_set *ms) {
+    if (args->show_help_agent || args->show_help) {
+        fputs(args->show_help_agent ? HELP_AGENT_TEXT : HELP_TEXT, stdout);
+        if (input_fd >= 0) close(input_fd);
+        return 0;
+    }
+
+    mode_set own;
+    if (!ms) {
+        mode_set_load(&own);
+        ms = &own;
+    }
+    int ret = 0;
+    log_input in;
+    if (args->list_modes) {
+        list_modes(ms);
+        if (input_fd >= 0) close(input_fd);
+    } else if (!open_input(&in, args->input_file, input_fd)) {
+        ret = 1;
+    } else {
+        ret = args->summary_only ? run_summary_only(args, &in, ms)
+                                 : run_full(args, &in, ms);
+        close_input(&in);
+    }
+    if (ms == &own) mode_set_free(&own);
+    return ret;
+}
+
+/* ---- Service mode ---- */
+
+/* What a --serve server hands its workers. Paths are absolute: a worker
+   runs in its client's directory. */
+typedef struct {
+    mode_set modes;
+    char    *plugin_path;   /* The server's --plugin: the only one requests may load */
+} serve_state;
+
+/* Server side: the client's stdout/stderr are ours for the duration, and
+   so is its working directory, which relative paths resolve against */
+static int serve_request(void *ctx, int argc, char **argv, int input_fd) {
+    const serve_state *state = (const serve_state *)ctx;
+    logparse_args args = parse_args(argc, argv);
+    char *plugin = args.plugin_path ? lp_path_real(args.plugin_path) : NULL;
+    int ret;
+    if (args.plugin_path &&
+        (!plugin || !state->plugin_path || strcmp(plugin, state->plugin_path) != 0)) {
+        /* A worker outlives the request: code it loads would stay resident */
+        fprintf(stderr, "logparse: --plugin '%s' refused: the server only loads the "
+                "plugin it was started with\n", args.plugin_path);
+        if (input_fd >= 0) close(input_fd);
+        ret = 1;
+    } else {
+        if (plugin) args.plugin_path = plugin;
+        ret = run_request(&args, input_fd, &state->modes);
+    }
+    free(plugin);
+    if (args.keywords) lp_free_strings(args.keywords, args.keyword_count);
+    return ret;
+}
+
+/* Client side: forward argv (less --connect) with the log as an open file,
+   so the server maps it even when the path means nothing to it (<(cmd),
+   relative to a different root). False: nobody answered. */
+static bool connect_request(const logparse_args *args, int argc, char **argv, int *status) {
+    FILE *fp = NULL;
+    int input_fd = -1;
+    if (!args->show_help && !args->show_help_agent && !args->list_modes) {
+        if (args->input_file) {
+            fp = fopen(args->input_file, "r");
+            if (!fp) return false;          /* In-process run reports it */
+            input_fd = fileno(fp);
+        } else {
+            input_fd = fileno(stdin);
+        }
+    }
+
+    char **fwd = (char **)malloc((size_t)argc * sizeof(char *));
+    int fwd_count = 0;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+            i++;
+            continue;
+        }
+        fwd[fwd_count++] = argv[i];
+    }
+    bool ok = lp_serve_request(args->connect_path, fwd_count, fwd, input_fd, status);
+    free(fwd);
+    if (fp) fclose(fp);
+    return ok;
+}
+
+/* ---- Main ---- */
+
+int main(int argc, char **argv) {
+    logparse_args args = parse_args(argc, argv);
+    int ret;
+
+    if (args.serve_path) {
+        /* Everything that does not depend on the log is set up once here
+           and inherited by the workers */
+        serve_state state;
+        state.plugin_path = args.plugin_path ? lp_path_real(args.plugin_path) : NULL;
+        if (args.plugin_path && !state.plugin_path) {
+            fprintf(stderr, "logparse: cannot open plugin '%s'\n", args.plugin_path);
+            ret = 1;
+        } else {
+            mode_set_load(&state.modes);
+            char *dir = state.modes.dir ? lp_path_real(state.modes.dir) : NULL;
+            if (dir) {
+                free(state.modes.dir);
+                state.modes.dir = dir;
+            }
+            ret = lp_serve(args.serve_path, 0, serve_request, &state);
+            mode_set_free(&state.modes);
+        }
+        free(state.plugin_path);
+    } else if (!args.connect_path || !connect_request(&args, argc, argv, &ret)) {
+        ret = run_request(&args, -1, NULL);
+    }
+
+    if (args.keywords) lp_free_strings(args.keywords, args.keyword_count);
+    return ret;
+}
@@ -0,0 +1,347 @@
+/*
+ * lpmodec — Mode-to-C compiler (build-time generator)
+ * Part of LogPilot toolkit
+ *
+ * Usage: lpmodec <out_dir> <mode.toml>...
+ *
+ * Writes builtin_<stem>.c for every mode file plus builtin_registry.c.
+ * Each translation unit holds the mode's constant tables and, per literal
+ * pattern set, a matcher that switches on the current byte and compares
+ * only the patterns starting with it. Linked into logpilot_core, these
+ * give built-in modes with no TOML parsing at startup.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+
+#include "util.h"
+#include "mode.h"
+
+/* ---- C emission helpers ---- */
+
+/* Emit a C string literal. Octal escapes never swallow following digits. */
+static void emit_literal(FILE *out, const char *s) {
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *)s; p && *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', out);
+            fputc(*p, out);
+        } else if (*p < 0x20 || *p >= 0x7f) {
+            fprintf(out, "\\%03o", *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void emit_string_field(FILE *out, const char *field, const char *value) {
+    if (!value) return;
+    fprintf(out, "    .%s = ", field);
+    emit_literal(out, value);
+    fprintf(out, ",\n");
+}
+
+static void emit_array(FILE *out, const char *ident, char **values, size_t count) {
+    if (count == 0) return;
+    fprintf(out, "static char *%s[] = {\n", ident);
+    for (size_t i = 0; i < count; i++) {
+        fprintf(out, "    ");
+        emit_literal(out, values[i]);
+        fprintf(out, ",\n");
+    }
+    fprintf(out, "};\n\n");
+}
+
+static void emit_array_field(FILE *out, const char *field, const char *count_field,
+                             const char *ident, size_t count) {
+    if (count == 0) return;
+    fprintf(out, "    .%s = %s,\n    .%s = %zu,\n", field, ident, count_field, count);
+}
+
+/* Case label(s) for a pattern's first byte */
+static void emit_case(FILE *out, unsigned char c, bool ci) {
+    if (ci && isalpha(c)) {
+        fprintf(out, "        case '%c': case '%c':\n", tolower(c), toupper(c));
+    } else if (c >= 0x20 && c < 0x7f && c != '\'' && c != '\\') {
+        fprintf(out, "        case '%c':\n", c);
+    } else {
+        fprintf(out, "        case 0x%02x:\n", c);
+    }
+}
+
+/* Lowercased copy for case-insensitive comparison */
+static char *fold_copy(const char *s) {
+    char *f = strdup(s);
+    for (char *p = f; *p; p++) *p = (char)tolower((unsigned char)*p);
+    return f;
+}
+
+/* Specialised matcher for one pattern set. Returns false if the set is empty. */
+static bool emit_matcher(FILE *out, const lp_mode *m, lp_pattern_set set) {
+    size_t n;
+    char **pats = lp_mode_patterns(m, set, &n);
+    if (n == 0) return false;
+    bool ci = lp_pattern_set_ci(set);
+
+    fprintf(out, "static size_t match_%s(const char *line, bool first_only) {\n",
+            lp_pattern_set_name(set));
+    fprintf(out, "    unsigned char seen[%zu] = {0};\n", n);
+    fprintf(out, "    size_t found = 0;\n");
+
+    /* Empty patterns are contained in every line */
+    for (size_t i = 0; i < n; i++) {
+        if (pats[i][0]) continue;
+        fprintf(out, "    seen[%zu] = 1;\n", i);
+        fprintf(out, "    if (++found == %zu || first_only) return found;\n", n);
+    }
+
+    fprintf(out, "    for (const unsigned char *p = (const unsigned char *)line; *p; p++) {\n");
+    fprintf(out, "        switch (*p) {\n");
+
+    /* One case per distinct first byte (folded for ci sets) */
+    bool *done = (bool *)calloc(n, sizeof(bool));
+    for (size_t i = 0; i < n; i++) {
+        if (done[i] || !pats[i][0]) continue;
+        unsigned char c0 = (unsigned char)pats[i][0];
+        if (ci) c0 = (unsigned char)tolower(c0);
+        emit_case(out, c0, ci);
+        for (size_t j = i; j < n; j++) {
+            if (done[j] || !pats[j][0]) continue;
+            unsigned char cj = (unsigned char)pats[j][0];
+            if (ci) cj = (unsigned char)tolower(cj);
+            if (cj != c0) continue;
+            done[j] = true;
+
+            char *lit = ci ? fold_copy(pats[j]) : strdup(pats[j]);
+            size_t rest = strlen(lit) - 1;
+            fprintf(out, "            if (!seen[%zu]", j);
+            if (rest > 0) {
+                fprintf(out, " && %s((const char *)p + 1, ", ci ? "lit_eq_ci" : "lit_eq");
+                emit_literal(out, lit + 1);
+                fprintf(out, ", %zu)", rest);
+            }
+            fprintf(out, ") {\n");
+            fprintf(out, "                seen[%zu] = 1;\n", j);
+            fprintf(out, "                if (++found == %zu || first_only) return found;\n", n);
+            fprintf(out, "            }\n");
+            free(lit);
+        }
+        fprintf(out, "            break;\n");
+    }
+    free(done);
+
+    fprintf(out, "        default:\n            break;\n");
+    fprintf(out, "        }\n    }\n    return found;\n}\n\n");
+    return true;
+}
+
+/* C identifier from a file stem */
+static void make_ident(char *dst, size_t cap, const char *stem) {
+    size_t i = 0;
+    for (; stem[i] && i + 1 < cap; i++)
+        dst[i] = isalnum((unsigned char)stem[i]) ? stem[i] : '_';
+    dst[i] = '\0';
+}
+
+/* File stem: basename without extension */
+static void file_stem(char *dst, size_t cap, const char *path) {
+    const char *base = path;
+    for (const char *p = path; *p; p++) {
+        if (*p == '/' || *p == '\\') base = p + 1;
+    }
+    size_t len = strlen(base);
+    const char *dot = strrchr(base, '.');
+    if (dot) len = (size_t)(dot - base);
+    if (len >= cap) len = cap - 1;
+    memcpy(dst, base, len);
+    dst[len] = '\0';
+}
+
+/* ---- Per-mode translation unit ---- */
+
+static bool emit_mode(const char *out_dir, const char *path, const lp_mode *m,
+                      const char *stem, const char *ident) {
+    char file[256];
+    snprintf(file, sizeof(file), "builtin_%s.c", stem);
+    char *out_path = lp_path_join(out_dir, file);
+    FILE *out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "lpmodec: cannot write '%s'\n", out_path);
+        free(out_path);
+        return false;
+    }
+    free(out_path);
+
+    fprintf(out, "/*\n * %s — Built-in \"%s\" mode\n", file, m->name);
+    const char *base = path + strlen(path);
+    while (base > path && base[-1] != '/' && base[-1] != '\\') base--;
+    fprintf(out, " * Generated by lpmodec from %s. Do not edit.\n */\n", base);
+    fprintf(out, "#include \"mode.h\"\n\n#include <stdbool.h>\n#include <stddef.h>\n"
+                 "#include <string.h>\n\n");
+
+    /* Comparison helpers, only those the matchers below will call */
+    bool used_cs = false, used_ci = false;
+    for (int s = 0; s < LP_PAT_COUNT; s++) {
+        size_t n;
+        char **pats = lp_mode_patterns(m, (lp_pattern_set)s, &n);
+        for (size_t i = 0; i < n; i++) {
+            if (strlen(pats[i]) < 2) continue;  /* No tail to compare */
+            if (lp_pattern_set_ci((lp_pattern_set)s)) used_ci = true;
+            else used_cs = true;
+        }
+    }
+    if (used_cs) {
+        fprintf(out, "static bool lit_eq(const char *s, const char *lit, size_t n) {\n"
+                     "    return strncmp(s, lit, n) == 0;\n}\n\n");
+    }
+    if (used_ci) {
+        fprintf(out, "/* lit is already lowercase; stops at the line's NUL */\n"
+                     "static bool lit_eq_ci(const char *s, const char *lit, size_t n) {\n"
+                     "    for (size_t i = 0; i < n; i++) {\n"
+                     "        unsigned char c = (unsigned char)s[i];\n"
+                     "        if (c >= 'A' && c <= 'Z') c = (unsigned char)(c - 'A' + 'a');\n"
+                     "        if (c != (unsigned char)lit[i]) return false;\n"
+                     "    }\n"
+                     "    return true;\n}\n\n");
+    }
+    bool have[LP_PAT_COUNT];
+    for (int s = 0; s < LP_PAT_COUNT; s++)
+        have[s] = emit_matcher(out, m, (lp_pattern_set)s);
+
+    /* Constant tables */
+    emit_array(out, "signatures", m->signatures, m->sig_count);
+    emit_array(out, "strip_patterns", m->strip_patterns, m->strip_count);
+    emit_array(out, "phase_markers", m->phase_markers, m->phase_count);
+    emit_array(out, "block_triggers", m->block_triggers, m->trigger_count);
+    emit_array(out, "keywords", m->keywords, m->keyword_count);
+    emit_array(out, "error_patterns", m->error_patterns, m->error_count);
+    emit_array(out, "warning_patterns", m->warning_patterns, m->warning_count);
+    emit_array(out, "boilerplate_patterns", m->boilerplate_patterns, m->boilerplate_count);
+    emit_array(out, "segment_start_patterns", m->segment_start_patterns, m->segment_start_count);
+    emit_array(out, "segment_end_patterns", m->segment_end_patterns, m->segment_end_count);
+    emit_array(out, "nest_begin_patterns", m->nest_begin_patterns, m->nest_begin_count);
+    emit_array(out, "nest_end_patterns", m->nest_end_patterns, m->nest_end_count);
+    emit_array(out, "drop_contains", m->drop_contains, m->drop_count);
+    emit_array(out, "keep_once_contains", m->keep_once_contains, m->keep_once_count);
+    emit_array(out, "tail_markers", m->tail_markers, m->tail_marker_count);
+
+    fprintf(out, "static const struct lp_mode_matchers matchers = {\n    .fn = {\n");
+    for (int s = 0; s < LP_PAT_COUNT; s++) {
+        if (!have[s]) continue;
+        const char *name = lp_pattern_set_name((lp_pattern_set)s);
+        char upper[32];
+        size_t i = 0;
+        for (; name[i] && i + 1 < sizeof(upper); i++)
+            upper[i] = (char)toupper((unsigned char)name[i]);
+        upper[i] = '\0';
+        fprintf(out, "        [LP_PAT_%s] = match_%s,\n", upper, name);
+    }
+    fprintf(out, "    }\n};\n\n");
+
+    fprintf(out, "lp_mode lp_builtin_mode_%s = {\n", ident);
+    emit_string_field(out, "name", m->name);
+    emit_string_field(out, "description", m->description);
+    emit_array_field(out, "signatures", "sig_count", "signatures", m->sig_count);
+    emit_array_field(out, "strip_patterns", "strip_count", "strip_patterns", m->strip_count);
+    emit_array_field(out, "phase_markers", "phase_count", "phase_markers", m->phase_count);
+    emit_array_field(out, "block_triggers", "trigger_count", "block_triggers", m->trigger_count);
+    emit_array_field(out, "keywords", "keyword_count", "keywords", m->keyword_count);
+    emit_array_field(out, "error_patterns", "error_count", "error_patterns", m->error_count);
+    emit_array_field(out, "warning_patterns", "warning_count", "warning_patterns", m->warning_count);
+    emit_string_field(out, "progress_pattern", m->progress_pattern);
+    emit_array_field(out, "boilerplate_patterns", "boilerplate_count", "boilerplate_patterns",
+                     m->boilerplate_count);
+    emit_array_field(out, "segment_start_patterns", "segment_start_count",
+                     "segment_start_patterns", m->segment_start_count);
+    emit_array_field(out, "segment_end_patterns", "segment_end_count",
+                     "segment_end_patterns", m->segment_end_count);
+    emit_array_field(out, "nest_begin_patterns", "nest_begin_count", "nest_begin_patterns",
+                     m->nest_begin_count);
+    emit_array_field(out, "nest_end_patterns", "nest_end_count", "nest_end_patterns",
+                     m->nest_end_count);
+    emit_array_field(out, "drop_contains", "drop_count", "drop_contains", m->drop_count);
+    emit_array_field(out, "keep_once_contains", "keep_once_count", "keep_once_contains",
+                     m->keep_once_count);
+    emit_string_field(out, "board_pattern", m->board_pattern);
+    emit_string_field(out, "zephyr_version_pattern", m->zephyr_version_pattern);
+    emit_string_field(out, "toolchain_pattern", m->toolchain_pattern);
+    emit_string_field(out, "overlay_pattern", m->overlay_pattern);
+    emit_string_field(out, "memory_pattern", m->memory_pattern);
+    emit_string_field(out, "output_pattern", m->output_pattern);
+    if (m->tail_resident) fprintf(out, "    .tail_resident = true,\n");
+    emit_array_field(out, "tail_markers", "tail_marker_count", "tail_markers",
+                     m->tail_marker_count);
+    if (m->tail_scan_lines) fprintf(out, "    .tail_scan_lines = %zu,\n", m->tail_scan_lines);
+    emit_string_field(out, "plugin_path", m->plugin_path);
+    if (m->enrich_devicetree) fprintf(out, "    .enrich_devicetree = true,\n");
+    if (m->enrich_kconfig) fprintf(out, "    .enrich_kconfig = true,\n");
+    fprintf(out, "    .score_weights = {");
+    for (int f = 0; f < LP_SF_COUNT; f++) {
+        char num[32];
+        snprintf(num, sizeof(num), "%.9g", (double)m->score_weights[f]);
+        bool integral = !strpbrk(num, ".en");  /* "10" needs ".0" before the f suffix */
+        fprintf(out, "%s%s%sf", f ? ", " : " ", num, integral ? ".0" : "");
+    }
+    fprintf(out, " },\n");
+    fprintf(out, "    .builtin = true,\n    .matchers = &matchers,\n};\n");
+
+    fclose(out);
+    return true;
+}
+
+/* ---- Main ---- */
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: lpmodec <out_dir> <mode.toml>...\n");
+        return 1;
+    }
+    const char *out_dir = argv[1];
+
+    LP_VEC(char *) idents;
+    lp_vec_init(idents);
+    int ret = 0;
+
+    for (int i = 2; i < argc; i++) {
+        lp_mode *m = lp_mode_load(argv[i]);
+        if (!m || !m->name) {
+            fprintf(stderr, "lpmodec: cannot load mode '%s'\n", argv[i]);
+            lp_mode_free(m);
+            ret = 1;
+            continue;
+        }
+        char stem[128], ident[128];
+        file_stem(stem, sizeof(stem), argv[i]);
+        make_ident(ident, sizeof(ident), stem);
+        if (!emit_mode(out_dir, argv[i], m, stem, ident)) ret = 1;
+        lp_vec_push(idents, strdup(ident));
+        lp_mode_free(m);
+    }
+
+    /* Registry of every generated mode */
+    char *reg_path = lp_path_join(out_dir, "builtin_registry.c");
+    FILE *out = fopen(reg_path, "w");
+    if (!out) {
+        fprintf(stderr, "lpmodec: cannot write '%s'\n", reg_path);
+        ret = 1;
+    } else {
+        fprintf(out, "/*\n * builtin_registry.c — Built-in mode registry\n"
+                     " * Generated by lpmodec. Do not edit.\n */\n"
+                     "#include \"builtin.h\"\n\n");
+        for (size_t i = 0; i < idents.len; i++)
+            fprintf(out, "extern lp_mode lp_builtin_mode_%s;\n", idents.items[i]);
+        fprintf(out, "\nlp_mode *const lp_builtin_modes[] = {\n");
+        for (size_t i = 0; i < idents.len; i++)
+            fprintf(out, "    &lp_builtin_mode_%s,\n", idents.items[i]);
+        if (idents.len == 0) fprintf(out, "    NULL\n");
+        fprintf(out, "};\n\nconst size_t lp_builtin_mode_count = %zu;\n", idents.len);
+        fclose(out);
+    }
+    free(reg_path);
+
+    lp_free_strings(idents.items, idents.len);
+    return ret;
+}
@@ -0,0 +1,369 @@
+/*
+ * Generated by gen_defines.py
+ *
+ * DTS input file:
+ *   /home/user/project/build/zephyr/zephyr.dts.pre
+ *
+ * Directories with bindings:
+ *   $ZEPHYR_BASE/dts/bindings
+ *
+ * Node dependency ordering (ordinal and path):
+ *   0   /
+ *   1   /aliases
+ *   2   /chosen
+ *   3   /pin-controller
+ *   4   /pin-controller/i2c0_default
+ *   5   /pin-controller/uart0_default
+ *   6   /soc
+ *   7   /soc/gpio@50000000
+ *   8   /buttons
+ *   9   /buttons/button_0
+ *   10  /leds
+ *   11  /leds/led_0
+ *   12  /soc/i2c@40003000
+ *   13  /soc/memory@20000000
+ *   14  /soc/uart@40002000
+ *
+ * Definitions derived from these nodes in dependency order are next,
+ * followed by /chosen nodes.
+ */
+
+/* Used to remove brackets from around a single argument */
+#define DT_DEBRACKET_INTERNAL(...) __VA_ARGS__
+
+/*
+ * Devicetree node: /
+ *
+ * Node identifier: DT_N
+ */
+
+/* Node's full path: */
+#define DT_N_PATH "/"
+
+/* Node's name with unit-address: */
+#define DT_N_FULL_NAME "/"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_NODELABEL_NUM 0
+/* Node's dependency ordinal: */
+#define DT_N_ORD 0
+#define DT_N_ORD_STR_SORTABLE 00000
+
+/* Existence and alternate IDs: */
+#define DT_N_EXISTS 1
+
+/*
+ * Devicetree node: /aliases
+ *
+ * Node identifier: DT_N_S_aliases
+ */
+
+/* Node's full path: */
+#define DT_N_S_aliases_PATH "/aliases"
+
+/* Node's name with unit-address: */
+#define DT_N_S_aliases_FULL_NAME "aliases"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_aliases_NODELABEL_NUM 0
+/* Node's dependency ordinal: */
+#define DT_N_S_aliases_ORD 1
+#define DT_N_S_aliases_ORD_STR_SORTABLE 00001
+
+/* Existence and alternate IDs: */
+#define DT_N_S_aliases_EXISTS 1
+
+/*
+ * Devicetree node: /chosen
+ *
+ * Node identifier: DT_N_S_chosen
+ */
+
+/* Node's full path: */
+#define DT_N_S_chosen_PATH "/chosen"
+
+/* Node's name with unit-address: */
+#define DT_N_S_chosen_FULL_NAME "chosen"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_chosen_NODELABEL_NUM 0
+/* Node's dependency ordinal: */
+#define DT_N_S_chosen_ORD 2
+#define DT_N_S_chosen_ORD_STR_SORTABLE 00002
+
+/* Existence and alternate IDs: */
+#define DT_N_S_chosen_EXISTS 1
+
+/*
+ * Devicetree node: /pin-controller
+ *
+ * Node identifier: DT_N_S_pin_controller
+ */
+
+/* Node's full path: */
+#define DT_N_S_pin_controller_PATH "/pin-controller"
+
+/* Node's name with unit-address: */
+#define DT_N_S_pin_controller_FULL_NAME "pin-controller"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_pin_controller_NODELABEL_NUM 1
+/* Node's dependency ordinal: */
+#define DT_N_S_pin_controller_ORD 3
+#define DT_N_S_pin_controller_ORD_STR_SORTABLE 00003
+
+/* Existence and alternate IDs: */
+#define DT_N_S_pin_controller_EXISTS 1
+#define DT_N_NODELABEL_pinctrl DT_N_S_pin_controller
+
+/*
+ * Devicetree node: /pin-controller/i2c0_default
+ *
+ * Node identifier: DT_N_S_pin_controller_S_i2c0_default
+ */
+
+/* Node's full path: */
+#define DT_N_S_pin_controller_S_i2c0_default_PATH "/pin-controller/i2c0_default"
+
+/* Node's name with unit-address: */
+#define DT_N_S_pin_controller_S_i2c0_default_FULL_NAME "i2c0_default"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_pin_controller_S_i2c0_default_NODELABEL_NUM 1
+/* Node's dependency ordinal: */
+#define DT_N_S_pin_controller_S_i2c0_default_ORD 4
+#define DT_N_S_pin_controller_S_i2c0_default_ORD_STR_SORTABLE 00004
+
+/* Existence and alternate IDs: */
+#define DT_N_S_pin_controller_S_i2c0_default_EXISTS 1
+#define DT_N_NODELABEL_i2c0_default DT_N_S_pin_controller_S_i2c0_default
+
+/*
+ * Devicetree node: /pin-controller/uart0_default
+ *
+ * Node identifier: DT_N_S_pin_controller_S_uart0_default
+ */
+
+/* Node's full path: */
+#define DT_N_S_pin_controller_S_uart0_default_PATH "/pin-controller/uart0_default"
+
+/* Node's name with unit-address: */
+#define DT_N_S_pin_controller_S_uart0_default_FULL_NAME "uart0_default"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_pin_controller_S_uart0_default_NODELABEL_NUM 1
+/* Node's dependency ordinal: */
+#define DT_N_S_pin_controller_S_uart0_default_ORD 5
+#define DT_N_S_pin_controller_S_uart0_default_ORD_STR_SORTABLE 00005
+
+/* Existence and alternate IDs: */
+#define DT_N_S_pin_controller_S_uart0_default_EXISTS 1
+#define DT_N_NODELABEL_uart0_default DT_N_S_pin_controller_S_uart0_default
+
+/*
+ * Devicetree node: /soc
+ *
+ * Node identifier: DT_N_S_soc
+ */
+
+/* Node's full path: */
+#define DT_N_S_soc_PATH "/soc"
+
+/* Node's name with unit-address: */
+#define DT_N_S_soc_FULL_NAME "soc"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_soc_NODELABEL_NUM 0
+/* Node's dependency ordinal: */
+#define DT_N_S_soc_ORD 6
+#define DT_N_S_soc_ORD_STR_SORTABLE 00006
+
+/* Existence and alternate IDs: */
+#define DT_N_S_soc_EXISTS 1
+
+/*
+ * Devicetree node: /soc/gpio@50000000
+ *
+ * Node identifier: DT_N_S_soc_S_gpio_50000000
+ */
+
+/* Node's full path: */
+#define DT_N_S_soc_S_gpio_50000000_PATH "/soc/gpio@50000000"
+
+/* Node's name with unit-address: */
+#define DT_N_S_soc_S_gpio_50000000_FULL_NAME "gpio@50000000"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_soc_S_gpio_50000000_NODELABEL_NUM 1
+/* Node's dependency ordinal: */
+#define DT_N_S_soc_S_gpio_50000000_ORD 7
+#define DT_N_S_soc_S_gpio_50000000_ORD_STR_SORTABLE 00007
+
+/* Existence and alternate IDs: */
+#define DT_N_S_soc_S_gpio_50000000_EXISTS 1
+#define DT_N_NODELABEL_gpio0 DT_N_S_soc_S_gpio_50000000
+
+/*
+ * Devicetree node: /buttons
+ *
+ * Node identifier: DT_N_S_buttons
+ */
+
+/* Node's full path: */
+#define DT_N_S_buttons_PATH "/buttons"
+
+/* Node's name with unit-address: */
+#define DT_N_S_buttons_FULL_NAME "buttons"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_buttons_NODELABEL_NUM 0
+/* Node's dependency ordinal: */
+#define DT_N_S_buttons_ORD 8
+#define DT_N_S_buttons_ORD_STR_SORTABLE 00008
+
+/* Existence and alternate IDs: */
+#define DT_N_S_buttons_EXISTS 1
+
+/*
+ * Devicetree node: /buttons/button_0
+ *
+ * Node identifier: DT_N_S_buttons_S_button_0
+ */
+
+/* Node's full path: */
+#define DT_N_S_buttons_S_button_0_PATH "/buttons/button_0"
+
+/* Node's name with unit-address: */
+#define DT_N_S_buttons_S_button_0_FULL_NAME "button_0"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_buttons_S_button_0_NODELABEL_NUM 1
+/* Node's dependency ordinal: */
+#define DT_N_S_buttons_S_button_0_ORD 9
+#define DT_N_S_buttons_S_button_0_ORD_STR_SORTABLE 00009
+
+/* Existence and alternate IDs: */
+#define DT_N_S_buttons_S_button_0_EXISTS 1
+#define DT_N_ALIAS_sw0 DT_N_S_buttons_S_button_0
+#define DT_N_NODELABEL_button0 DT_N_S_buttons_S_button_0
+
+/*
+ * Devicetree node: /leds
+ *
+ * Node identifier: DT_N_S_leds
+ */
+
+/* Node's full path: */
+#define DT_N_S_leds_PATH "/leds"
+
+/* Node's name with unit-address: */
+#define DT_N_S_leds_FULL_NAME "leds"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_leds_NODELABEL_NUM 0
+/* Node's dependency ordinal: */
+#define DT_N_S_leds_ORD 10
+#define DT_N_S_leds_ORD_STR_SORTABLE 00010
+
+/* Existence and alternate IDs: */
+#define DT_N_S_leds_EXISTS 1
+
+/*
+ * Devicetree node: /leds/led_0
+ *
+ * Node identifier: DT_N_S_leds_S_led_0
+ */
+
+/* Node's full path: */
+#define DT_N_S_leds_S_led_0_PATH "/leds/led_0"
+
+/* Node's name with unit-address: */
+#define DT_N_S_leds_S_led_0_FULL_NAME "led_0"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_leds_S_led_0_NODELABEL_NUM 1
+/* Node's dependency ordinal: */
+#define DT_N_S_leds_S_led_0_ORD 11
+#define DT_N_S_leds_S_led_0_ORD_STR_SORTABLE 00011
+
+/* Existence and alternate IDs: */
+#define DT_N_S_leds_S_led_0_EXISTS 1
+#define DT_N_ALIAS_led0 DT_N_S_leds_S_led_0
+#define DT_N_NODELABEL_led0 DT_N_S_leds_S_led_0
+
+/*
+ * Devicetree node: /soc/i2c@40003000
+ *
+ * Node identifier: DT_N_S_soc_S_i2c_40003000
+ */
+
+/* Node's full path: */
+#define DT_N_S_soc_S_i2c_40003000_PATH "/soc/i2c@40003000"
+
+/* Node's name with unit-address: */
+#define DT_N_S_soc_S_i2c_40003000_FULL_NAME "i2c@40003000"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_soc_S_i2c_40003000_NODELABEL_NUM 2
+/* Node's dependency ordinal: */
+#define DT_N_S_soc_S_i2c_40003000_ORD 12
+#define DT_N_S_soc_S_i2c_40003000_ORD_STR_SORTABLE 00012
+
+/* Existence and alternate IDs: */
+#define DT_N_S_soc_S_i2c_40003000_EXISTS 1
+#define DT_N_ALIAS_i2c_sensor DT_N_S_soc_S_i2c_40003000
+#define DT_N_NODELABEL_i2c0 DT_N_S_soc_S_i2c_40003000
+#define DT_N_NODELABEL_arduino_i2c DT_N_S_soc_S_i2c_40003000
+
+/*
+ * Devicetree node: /soc/memory@20000000
+ *
+ * Node identifier: DT_N_S_soc_S_memory_20000000
+ */
+
+/* Node's full path: */
+#define DT_N_S_soc_S_memory_20000000_PATH "/soc/memory@20000000"
+
+/* Node's name with unit-address: */
+#define DT_N_S_soc_S_memory_20000000_FULL_NAME "memory@20000000"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_soc_S_memory_20000000_NODELABEL_NUM 1
+/* Node's dependency ordinal: */
+#define DT_N_S_soc_S_memory_20000000_ORD 13
+#define DT_N_S_soc_S_memory_20000000_ORD_STR_SORTABLE 00013
+
+/* Existence and alternate IDs: */
+#define DT_N_S_soc_S_memory_20000000_EXISTS 1
+#define DT_N_NODELABEL_sram0 DT_N_S_soc_S_memory_20000000
+
+/*
+ * Devicetree node: /soc/uart@40002000
+ *
+ * Node identifier: DT_N_S_soc_S_uart_40002000
+ */
+
+/* Node's full path: */
+#define DT_N_S_soc_S_uart_40002000_PATH "/soc/uart@40002000"
+
+/* Node's name with unit-address: */
+#define DT_N_S_soc_S_uart_40002000_FULL_NAME "uart@40002000"
+
+/* Helpers for dealing with node labels: */
+#define DT_N_S_soc_S_uart_40002000_NODELABEL_NUM 2
+/* Node's dependency ordinal: */
+#define DT_N_S_soc_S_uart_40002000_ORD 14
+#define DT_N_S_soc_S_uart_40002000_ORD_STR_SORTABLE 00014
+
+/* Existence and alternate IDs: */
+#define DT_N_S_soc_S_uart_40002000_EXISTS 1
+#define DT_N_NODELABEL_uart0 DT_N_S_soc_S_uart_40002000
+#define DT_N_NODELABEL_arduino_serial DT_N_S_soc_S_uart_40002000
+
+/*
+ * Chosen nodes
+ */
+#define DT_CHOSEN_zephyr_console DT_N_S_soc_S_uart_40002000
+#define DT_CHOSEN_zephyr_console_EXISTS 1
+#define DT_CHOSEN_zephyr_sram DT_N_S_soc_S_memory_20000000
+#define DT_CHOSEN_zephyr_sram_EXISTS 1